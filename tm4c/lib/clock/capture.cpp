@@ -9,6 +9,7 @@
 #include "tai.hpp"
 #include "util.hpp"
 #include "../delay.hpp"
+#include "../regression.hpp"
 #include "../run.hpp"
 #include "../hw/emac.h"
 #include "../hw/gpio.h"
@@ -17,14 +18,8 @@
 // mask for timer edge events
 static constexpr int EDGE_MASK = (1 << 24) - 1;
 
-// sample ring size
-static constexpr int RING_SIZE = 256;
-// sample ring mask
-static constexpr int RING_MASK = RING_SIZE - 1;
-// ring position
-static volatile int ringPos = 0;
-// ring buffer
-static volatile uint32_t ringBuffer[RING_SIZE];
+// temperature sensor edge regression window
+static regression::TimerWindow<256> tempWindow;
 
 // scale factor for converting timer ticks to seconds
 static constexpr float timeScale = 1.0f / static_cast<float>(CLK_FREQ);
@@ -37,32 +32,21 @@ void ISR_Timer4B() {
     uint32_t timer = clock::monotonic::raw();
     // determine edge time
     timer -= (timer - GPTM4.TBR.raw) & EDGE_MASK;
-    // add sample to buffer
-    const int next = (ringPos + 1) & RING_MASK;
-    ringBuffer[next] = timer;
-    ringPos = next;
+    // add sample to regression window
+    tempWindow.push(timer);
 }
 
 float clock::capture::temperature() {
-    // constant terms
-    static constexpr int mid = RING_MASK / 2;
-    static constexpr auto cc_ = static_cast<float>(mid + 1);
-    static constexpr auto xc_ = 0.5f * cc_ * (cc_ - 1.0f);
-    static constexpr auto xx_ = 2.0f * (cc_ - 0.5f) * xc_ / 3.0f;
-    static constexpr auto scale = 0.5f * xx_ / timeScale;
-
-    // compute slope
-    const auto pivot = ringPos - mid;
-    const auto zero = ringBuffer[pivot & RING_MASK];
-    float yx = 0;
-    for (int i = -mid; i <= mid; ++i) {
-        const auto x = static_cast<float>(i);
-        const auto y = static_cast<float>(static_cast<int32_t>(zero - ringBuffer[(pivot - i) & RING_MASK]));
-        yx += y * x;
-    }
+    // sensor output frequency is 4 Hz per kelvin
+    static constexpr auto scale = 0.25f / timeScale;
+
+    // snapshot edge period
+    __disable_irq();
+    const auto period = tempWindow.period();
+    __enable_irq();
 
     // update temperature measurement
-    return scale / yx - 273.15f;
+    return scale / period - 273.15f;
 }
 
 
@@ -93,6 +77,9 @@ static volatile uint32_t ppsGpsEvent;
 static volatile uint64_t ppsStamp[3];
 // task handle for timestamp update
 static void *volatile taskPpsUpdate;
+// consumer of GPS PPS timestamps
+static RunCall ppsHandler;
+static void *ppsHandlerRef;
 
 // capture rising edge of GPS PPS for offset measurement
 void ISR_Timer5B() {
@@ -110,6 +97,14 @@ void ISR_Timer5B() {
 
 static void runPpsGps([[maybe_unused]] void *ref) {
     clock::capture::rawToFull(ppsGpsEvent, const_cast<uint64_t*>(ppsStamp));
+    // hand off to the GPS reference
+    if (ppsHandler != nullptr)
+        (*ppsHandler)(ppsHandlerRef);
+}
+
+void clock::capture::onPpsGps(const RunCall callback, void *ref) {
+    ppsHandler = callback;
+    ppsHandlerRef = ref;
 }
 
 void clock::capture::ppsGps(uint64_t *tsResult) {
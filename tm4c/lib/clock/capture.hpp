@@ -6,6 +6,8 @@
 
 #include <cstdint>
 
+#include "../run.hpp"
+
 namespace clock::capture {
     /**
      * Get the filtered mean of the oscillator temperature sensor. (Celsius)
@@ -29,6 +31,13 @@ namespace clock::capture {
      */
     void ppsGps(uint64_t *tsResult);
 
+    /**
+     * Set the handler that is called by the PPS worker task once the full timestamps of a GPS PPS edge exist
+     * @param callback handler (called from task context, null to remove)
+     * @param ref context pointer for the handler
+     */
+    void onPpsGps(RunCall callback, void *ref);
+
     /**
      * Assemble 64-bit fixed-point timestamps from raw monotonic clock value
      * @param monoRaw raw monotonic clock value
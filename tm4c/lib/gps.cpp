@@ -6,33 +6,57 @@
 
 #include "delay.hpp"
 #include "run.hpp"
+#include "rxring.hpp"
+#include "store.hpp"
+#include "survey.hpp"
+#include "ubx.hpp"
 #include "../hw/interrupts.h"
 #include "../hw/uart.h"
 #include "clock/capture.hpp"
 #include "clock/mono.hpp"
 #include "clock/util.hpp"
+#include "ntp/timepulse.hpp"
 
+#include <cmath>
+#include <cstring>
 #include <memory>
 
 static constexpr int GPS_RING_SIZE = 256;
 static constexpr int GPS_RING_MASK = GPS_RING_SIZE - 1;
+// receive ring (holds a complete second of messages)
+static constexpr int GPS_RX_SIZE = 512;
+// RX FIFO interrupt level (1/2 of 16 bytes, leaves 8 byte times of interrupt latency)
+static constexpr int RX_FIFO_LEVEL = 8;
+static constexpr int RX_FIFO_LEVEL_SEL = 2;
+
+// receiver default baud rate
+static constexpr uint32_t GPS_BAUD_DEFAULT = 9600;
+// negotiated baud rate
+static constexpr uint32_t GPS_BAUD_FAST = 115200;
+// health checks without valid messages before reverting to the default baud rate
+static constexpr int GPS_BAUD_TIMEOUT = 8;
 
 #define GPS_RST_PORT (PORTP)
 #define GPS_RST_PIN (1<<5)
 #define GPS_RST_INTV (600)
 #define GPS_RST_THR (300)
 
-static constexpr uint32_t INTV_HEALTH = RUN_SEC / 2;
+// minimum survey-in duration (s), zero disables fixed-position timing mode
+#ifndef GPS_SURVEY_DURATION
+#define GPS_SURVEY_DURATION (86400)
+#endif
+// survey-in accuracy limit (mm)
+#ifndef GPS_SURVEY_ACCURACY
+#define GPS_SURVEY_ACCURACY (1000)
+#endif
 
-static constexpr int MAX_LENGTH = 256;
+static constexpr uint32_t INTV_HEALTH = RUN_SEC / 2;
 
-static uint8_t rxBuff[GPS_RING_SIZE];
+static RxRing<GPS_RX_SIZE> rxRing;
+// bytes lost by the UART FIFO before the interrupt drained it
+static volatile uint32_t fifoOverruns;
 static uint8_t txBuff[GPS_RING_SIZE];
-static uint8_t msgBuff[MAX_LENGTH];
-static volatile int rxHead, rxTail;
 static volatile int txHead, txTail;
-static volatile int lenNEMA, lenUBX;
-static volatile int endUBX;
 
 static void *volatile taskParse;
 
@@ -44,21 +68,73 @@ static volatile uint64_t taiEpochUpdate;
 static volatile uint32_t taiEpoch;
 static volatile int taiOffset = 37; // as of 2016-12-31
 
-static volatile bool hasNema, hasPvt, hasGpsTime, hasClock, wasReset;
+static ntp::TimePulse timePulse;
 
-__attribute__((noinline))
-static void processNEMA(const char *ptr, int len);
+static volatile bool hasNema, hasPvt, hasGpsTime, hasClock, hasTimePulse, wasReset;
 
-__attribute__((noinline))
-static void processUBX(uint8_t *msg, int len);
+// baud rate negotiation
+enum BaudState : uint8_t {
+    BAUD_DEFAULT,
+    BAUD_SWITCH,
+    BAUD_FAST
+};
+static BaudState baudState;
+static volatile uint32_t baudRate;
+static uint32_t rxValidLast;
+static int rxSilent;
+
+// surveyed antenna position
+struct SurveyRecord {
+    // latitude and longitude (1e-7 deg)
+    int32_t lat, lon;
+    // height above ellipsoid (mm)
+    int32_t alt;
+    // 3D accuracy (mm)
+    uint32_t accuracy;
+    // number of averaged fixes
+    uint32_t duration;
+};
+static constexpr int SURVEY_WORDS = sizeof(SurveyRecord) / sizeof(uint32_t);
+
+static gps::Survey survey;
+static SurveyRecord surveyed;
+static volatile gps::SurveyState surveyState;
+static volatile bool hasTimingMode;
+
+static void processNmea(const char *sentence, int length);
 static void processUbxClock(const uint8_t *payload);
 static void processUbxPVT(const uint8_t *payload);
 static void processUbxGpsTime(const uint8_t *payload);
+static void processUbxTimePulse(const uint8_t *payload);
+static void processUbxAck(const uint8_t *payload);
+static void processUbxNak(const uint8_t *payload);
+
+// UBX message registry
+static constexpr ubx::Message ubxMessages[] = {
+    // NAV class
+    {0x01, 0x07, 92, processUbxPVT},       // position, velocity, time
+    {0x01, 0x20, 16, processUbxGpsTime},   // GPS time
+    {0x01, 0x22, 20, processUbxClock},     // clock status
+    // TIM class
+    {0x0D, 0x01, ntp::TimePulse::PAYLOAD_SIZE, processUbxTimePulse}, // time pulse
+    // ACK class
+    {0x05, 0x01, 2, processUbxAck},         // acknowledged
+    {0x05, 0x00, 2, processUbxNak}          // not acknowledged
+};
+static_assert(ubx::isUnique(ubxMessages), "ubxMessages must not contain duplicate messages");
+
+static ubx::Parser parser(ubxMessages, processNmea);
 
 __attribute__((noinline))
 static void sendUBX(uint8_t _class, uint8_t id, int len, const uint8_t *payload);
 
 static void configureGPS();
+static bool negotiateBaud();
+static void setBaud(uint32_t baud);
+static void sendPortConfig(uint32_t baud);
+static void sendTimingMode();
+static void initSurvey();
+static void updateSurvey(const uint8_t *payload);
 
 static void runHealth(void *ref);
 static void runParse(void *ref);
@@ -104,21 +180,9 @@ void gps::init() {
     GPS_RST_PORT.LOCK = 0;
 
     // configure UART 3
-    UART3.CTL.UARTEN = 0;
-    // baud divisor
-    constexpr float divisor = static_cast<float>(CLK_FREQ) / (16.0f * 9600.0f);
-    constexpr int divisorInt = static_cast<int>(divisor);
-    constexpr int divisorFrac = static_cast<int>((divisor - divisorInt) * 64.0f);
-    UART3.IBRD.DIVINT = divisorInt;
-    UART3.FBRD.DIVFRAC = divisorFrac;
-    // 8-bit data
-    UART3.LCRH.WLEN = 3;
-    // enable FIFO
-    UART3.LCRH.FEN = 1;
-    // enable UART
-    UART3.CTL.RXE = 1;
-    UART3.CTL.TXE = 1;
-    UART3.CTL.UARTEN = 1;
+    setBaud(GPS_BAUD_DEFAULT);
+    // interrupt when RX FIFO is half full
+    UART3.IFLS.RXIFLSEL = RX_FIFO_LEVEL_SEL;
     // start parser thread
     taskParse = runWait(runParse, nullptr);
     // reduce interrupt priority
@@ -126,6 +190,10 @@ void gps::init() {
     // enable interrupts
     UART3.IM.RT = 1;
     UART3.IM.RX = 1;
+    UART3.IM.OE = 1;
+
+    // restore surveyed position
+    initSurvey();
 
     // reset GPS module
     GPS_RST_PORT.DATA[GPS_RST_PIN] = 0;
@@ -135,13 +203,18 @@ void gps::init() {
 }
 
 static void runHealth(void *ref) {
-    // check GPS message configuration
-    configureGPS();
+    // negotiate link baud rate, then check GPS message configuration
+    if (!negotiateBaud())
+        configureGPS();
 
     // release reset pin
     if (!GPS_RST_PORT.DATA[GPS_RST_PIN]) {
         GPS_RST_PORT.DATA[GPS_RST_PIN] = GPS_RST_PIN;
         wasReset = true;
+        hasTimingMode = false;
+        // receiver restarts at its default baud rate
+        setBaud(GPS_BAUD_DEFAULT);
+        baudState = BAUD_DEFAULT;
     }
 
     // reset GPS if PPS has ceased
@@ -160,22 +233,95 @@ static void runHealth(void *ref) {
     }
 }
 
+/**
+ * Advance the baud rate negotiation
+ * @return true if the link configuration changed
+ */
+static bool negotiateBaud() {
+    // track valid messages received since the last check
+    const uint32_t valid = parser.getFrames();
+    const bool active = valid != rxValidLast;
+    rxValidLast = valid;
+    rxSilent = active ? 0 : rxSilent + 1;
+
+    switch (baudState) {
+        case BAUD_DEFAULT:
+            // request faster link once the receiver is talking
+            if (active) {
+                sendPortConfig(GPS_BAUD_FAST);
+                baudState = BAUD_SWITCH;
+                return true;
+            }
+            return false;
+        case BAUD_SWITCH:
+            // port configuration has been transmitted
+            setBaud(GPS_BAUD_FAST);
+            rxSilent = 0;
+            baudState = BAUD_FAST;
+            return true;
+        case BAUD_FAST:
+            // revert to default baud rate if the receiver did not follow
+            if (rxSilent >= GPS_BAUD_TIMEOUT) {
+                setBaud(GPS_BAUD_DEFAULT);
+                rxSilent = 0;
+                baudState = BAUD_DEFAULT;
+                return true;
+            }
+            return false;
+    }
+    return false;
+}
+
+static void setBaud(const uint32_t baud) {
+    // wait for transmitter to finish
+    while (UART3.FR.BUSY) {}
+    UART3.CTL.UARTEN = 0;
+    // baud divisor
+    const float divisor = static_cast<float>(CLK_FREQ) / (16.0f * static_cast<float>(baud));
+    const int divisorInt = static_cast<int>(divisor);
+    const int divisorFrac = static_cast<int>((divisor - static_cast<float>(divisorInt)) * 64.0f + 0.5f);
+    UART3.IBRD.DIVINT = divisorInt;
+    UART3.FBRD.DIVFRAC = divisorFrac;
+    // 8-bit data (also latches the divisor)
+    UART3.LCRH.WLEN = 3;
+    // enable FIFO
+    UART3.LCRH.FEN = 1;
+    // enable UART
+    UART3.CTL.RXE = 1;
+    UART3.CTL.TXE = 1;
+    UART3.CTL.UARTEN = 1;
+    baudRate = baud;
+}
+
 void ISR_UART3() {
     const uint32_t flags = UART3.MIS.raw;
 
-    // RX FIFO watermark or RX timeout
-    if (flags & 0x50) {
-        // drain UART FIFO (clears interrupt)
-        int head = rxHead;
-        while (!UART3.FR.RXFE) {
-            rxBuff[head] = UART3.DR.DATA;
-            incrRing(head);
-        }
-        rxHead = head;
-        // wake parser
-        runWake(taskParse);
+    // RX FIFO overrun (hardware)
+    if (flags & 0x400) {
+        ++fifoOverruns;
+        UART3.ICR.OE = 1;
+    }
+
+    // RX FIFO watermark
+    if (flags & 0x10) {
+        // leave one byte in the FIFO so the receive timeout marks the end of the burst
+        for (int i = 1; i < RX_FIFO_LEVEL; i++)
+            rxRing.put(UART3.DR.DATA);
+        UART3.ICR.RX = 1;
+    }
+
+    // RX timeout (idle line)
+    if (flags & 0x40) {
+        // drain UART FIFO
+        while (!UART3.FR.RXFE)
+            rxRing.put(UART3.DR.DATA);
+        UART3.ICR.RT = 1;
     }
 
+    // hand off complete message bursts to the parser
+    if ((flags & 0x50) && rxRing.commit(flags & 0x40))
+        runWake(taskParse);
+
     // TX FIFO watermark
     if (flags & 0x20) {
         // fill UART FIFO
@@ -207,74 +353,7 @@ static void startTx() {
 }
 
 static void runParse(void *ref) {
-    int tail = rxTail;
-    while (tail != rxHead) {
-        // get next byte
-        uint8_t byte = rxBuff[tail];
-        incrRing(tail);
-
-        // process UBX message
-        if (lenUBX) {
-            // append character to message buffer
-            if (lenUBX < MAX_LENGTH)
-                msgBuff[lenUBX] = byte;
-
-            // end of message
-            if (++lenUBX >= endUBX) {
-                if (lenUBX > MAX_LENGTH)
-                    lenUBX = MAX_LENGTH;
-                processUBX((uint8_t*) msgBuff, lenUBX);
-                lenUBX = 0;
-                endUBX = 0;
-                continue;
-            }
-
-            // parse UBX message length
-            if (lenUBX == 6) {
-                endUBX = 8 + *reinterpret_cast<uint16_t*>(msgBuff + 4);
-                // resync if message length is bad
-                if (endUBX > MAX_LENGTH)
-                    lenUBX = 0;
-                continue;
-            }
-
-            // validate second sync byte
-            if (lenUBX == 2 && msgBuff[1] != 0x62)
-                lenUBX = 0;
-            continue;
-        }
-
-        // process NEMA message
-        if (lenNEMA) {
-            // append character to message buffer
-            if (lenNEMA < MAX_LENGTH)
-                msgBuff[lenNEMA++] = byte;
-            // end of message
-            if (byte == '\r' || byte == '\n') {
-                msgBuff[lenNEMA--] = 0;
-                processNEMA(reinterpret_cast<char*>(msgBuff), lenNEMA);
-                // reset parser state
-                lenNEMA = 0;
-            }
-        }
-
-        // check for NEMA message start
-        if (byte == '$') {
-            msgBuff[0] = byte;
-            lenNEMA = 1;
-            continue;
-        }
-
-        // check for UBX message start
-        if (byte == 0xB5) {
-            lenNEMA = 0;
-            msgBuff[0] = byte;
-            lenUBX = 1;
-            endUBX = 8;
-            continue;
-        }
-    }
-    rxTail = tail;
+    parser.parse(rxRing);
 }
 
 float gps::locLat() {
@@ -309,78 +388,11 @@ int gps::hasFix() {
     return fixGood;
 }
 
-static uint8_t fromHex(char c) {
-    if (c < 'A')
-        return c - '0';
-    if (c < 'a')
-        return c - 'A' + 10;
-    return c - 'a' + 10;
-}
-
-static void processNEMA(const char *ptr, const int len) {
-    uint8_t csum = 0;
-    const char *chksum = nullptr;
-
-    const char *const end = ptr + len;
-    while (++ptr < end) {
-        const char c = *ptr;
-        csum ^= c;
-        if (c == '*') {
-            csum ^= c;
-            chksum = ++ptr;
-            break;
-        }
-    }
-
-    // verify checksum if present
-    if (chksum) {
-        uint8_t test = fromHex(chksum[0]);
-        test <<= 4;
-        test |= fromHex(chksum[1]);
-        if (csum != test)
-            return;
-    }
-
+static void processNmea([[maybe_unused]] const char *sentence, [[maybe_unused]] const int length) {
     // no NMEA messages are expected, tell configuration check to disable them
     hasNema = true;
 }
 
-static void processUBX(uint8_t *msg, const int len) {
-    // initialize checksum
-    uint8_t chkA = 0, chkB = 0;
-    // compute checksum
-    for (int i = 2; i < (len - 2); i++) {
-        chkA += msg[i];
-        chkB += chkA;
-    }
-    // verify checksum
-    if (chkA != msg[len - 2] || chkB != msg[len - 1]) {
-        return;
-    }
-
-    uint8_t _class = msg[2];
-    uint8_t _id = msg[3];
-    uint16_t size = *reinterpret_cast<uint16_t*>(msg + 4);
-    // NAV class
-    if (_class == 0x01) {
-        // position message
-        if (_id == 0x07 && size == 92) {
-            processUbxPVT(msg + 6);
-            return;
-        }
-        // GPS time message
-        if (_id == 0x20 && size == 16) {
-            processUbxGpsTime(msg + 6);
-            return;
-        }
-        // UTC time message
-        if (_id == 0x22 && size == 20) {
-            processUbxClock(msg + 6);
-            return;
-        }
-    }
-}
-
 static void sendUBX(const uint8_t _class, const uint8_t id, int len, const uint8_t *payload) {
     if (len > 512)
         return;
@@ -434,19 +446,25 @@ static void sendUBX(const uint8_t _class, const uint8_t id, int len, const uint8
     startTx();
 }
 
-static const uint8_t payloadDisableNMEA[] = {
+static constexpr uint8_t payloadPortConfig[] = {
     0x01,                   // UART port
     0x00,                   // reserved
     0x00, 0x00,             // TX ready mode
     0xC0, 0x08, 0x00, 0x00, // UART mode (8-bit, no parity, 1 stop bit)
-    0x80, 0x25, 0x00, 0x00, // 9600 baud
+    0x00, 0x00, 0x00, 0x00, // baud rate (set when sent)
     0x01, 0x00,             // UBX input
-    0x01, 0x00,             // UBX output
+    0x01, 0x00,             // UBX output (disables NMEA)
     0x00, 0x00,             // TX timeout
     0x00, 0x00              // reserved
-
 };
-_Static_assert(sizeof(payloadDisableNMEA) == 20, "payloadDisableNMEA must be 20 bytes");
+_Static_assert(sizeof(payloadPortConfig) == 20, "payloadPortConfig must be 20 bytes");
+
+static void sendPortConfig(const uint32_t baud) {
+    uint8_t payload[sizeof(payloadPortConfig)];
+    memcpy(payload, payloadPortConfig, sizeof(payload));
+    memcpy(payload + 8, &baud, sizeof(baud));
+    sendUBX(0x06, 0x00, sizeof(payload), payload);
+}
 
 static constexpr uint8_t payloadEnablePVT[] = {
     0x01, // NAV class
@@ -469,6 +487,13 @@ static constexpr uint8_t payloadEnableClock[] = {
 };
 _Static_assert(sizeof(payloadEnableClock) == 3, "payloadEnableClock must be 3 bytes");
 
+static constexpr uint8_t payloadEnableTimePulse[] = {
+    0x0D, // TIM class
+    0x01, // time pulse
+    0x01  // every update
+};
+_Static_assert(sizeof(payloadEnableTimePulse) == 3, "payloadEnableTimePulse must be 3 bytes");
+
 static constexpr uint8_t payloadNavConfig[] = {
     0x01, 0x04,                  // mask (dynamic model, UTC reference)
     0x02,                        // stationary mode
@@ -492,26 +517,110 @@ static constexpr uint8_t payloadNavConfig[] = {
 };
 _Static_assert(sizeof(payloadNavConfig) == 36, "payloadNavConfig must be 36 bytes");
 
+static constexpr uint8_t payloadTimingMode[] = {
+    0x02,                   // fixed position mode
+    0x00,                   // reserved
+    0x01, 0x00,             // position is latitude, longitude and altitude
+    0x00, 0x00, 0x00, 0x00, // latitude (set when sent)
+    0x00, 0x00, 0x00, 0x00, // longitude (set when sent)
+    0x00, 0x00, 0x00, 0x00, // altitude (set when sent)
+    0x00, 0x00, 0x00, 0x00, // position accuracy (set when sent)
+    0x00, 0x00, 0x00, 0x00, // survey-in minimum duration (not used)
+    0x00, 0x00, 0x00, 0x00  // survey-in accuracy limit (not used)
+};
+_Static_assert(sizeof(payloadTimingMode) == 28, "payloadTimingMode must be 28 bytes");
+
+static void sendTimingMode() {
+    uint8_t payload[sizeof(payloadTimingMode)];
+    memcpy(payload, payloadTimingMode, sizeof(payload));
+    // altitude is specified in centimeters
+    const int32_t alt = (surveyed.alt + (surveyed.alt < 0 ? -5 : 5)) / 10;
+    const uint32_t accuracy = surveyed.accuracy > 0 ? surveyed.accuracy : 1;
+    memcpy(payload + 4, &surveyed.lat, sizeof(surveyed.lat));
+    memcpy(payload + 8, &surveyed.lon, sizeof(surveyed.lon));
+    memcpy(payload + 12, &alt, sizeof(alt));
+    memcpy(payload + 16, &accuracy, sizeof(accuracy));
+    sendUBX(0x06, 0x3D, sizeof(payload), payload);
+}
+
 static void configureGPS() {
     // transmit configuration stanzas
     if (hasNema)
-        sendUBX(0x06, 0x00, sizeof(payloadDisableNMEA), payloadDisableNMEA);
+        sendPortConfig(baudRate);
     if (!hasClock)
         sendUBX(0x06, 0x01, sizeof(payloadEnableClock), payloadEnableClock);
     if (!hasGpsTime)
         sendUBX(0x06, 0x01, sizeof(payloadEnableGpsTime), payloadEnableGpsTime);
     if (!hasPvt)
         sendUBX(0x06, 0x01, sizeof(payloadEnablePVT), payloadEnablePVT);
+    if (!hasTimePulse)
+        sendUBX(0x06, 0x01, sizeof(payloadEnableTimePulse), payloadEnableTimePulse);
     if (wasReset)
         sendUBX(0x06, 0x24, sizeof(payloadNavConfig), payloadNavConfig);
+    if (surveyState == gps::SURVEY_FIXED && !hasTimingMode)
+        sendTimingMode();
 
     hasNema = false;
     hasClock = false;
     hasGpsTime = false;
     hasPvt = false;
+    hasTimePulse = false;
     wasReset = false;
 }
 
+static void processUbxAck(const uint8_t *payload) {
+    // receiver accepted fixed-position timing mode
+    if (payload[0] == 0x06 && payload[1] == 0x3D)
+        hasTimingMode = true;
+}
+
+static void processUbxNak(const uint8_t *payload) {
+    // receiver does not support timing mode (navigation-only variant), remain in navigation mode
+    if (payload[0] == 0x06 && payload[1] == 0x3D && surveyState == gps::SURVEY_FIXED)
+        surveyState = gps::SURVEY_UNSUPPORTED;
+}
+
+static void initSurvey() {
+    if (GPS_SURVEY_DURATION == 0) {
+        surveyState = gps::SURVEY_DISABLED;
+        return;
+    }
+
+    // use previously surveyed position
+    SurveyRecord record;
+    if (
+        store::load(store::ID_SURVEY, &record, SURVEY_WORDS) &&
+        record.lat >= -900000000 && record.lat <= 900000000 &&
+        record.lon >= -1800000000 && record.lon <= 1800000000
+    ) {
+        surveyed = record;
+        surveyState = gps::SURVEY_FIXED;
+        return;
+    }
+    surveyState = gps::SURVEY_RUNNING;
+}
+
+static void updateSurvey(const uint8_t *payload) {
+    survey.update(
+        *reinterpret_cast<const int32_t*>(payload + 28),
+        *reinterpret_cast<const int32_t*>(payload + 24),
+        *reinterpret_cast<const int32_t*>(payload + 32),
+        *reinterpret_cast<const uint32_t*>(payload + 40),
+        *reinterpret_cast<const uint32_t*>(payload + 44)
+    );
+    if (!survey.converged(GPS_SURVEY_DURATION, 1e-3f * GPS_SURVEY_ACCURACY))
+        return;
+
+    // persist surveyed position and switch receiver to timing mode
+    SurveyRecord record = {};
+    survey.getPosition(record.lat, record.lon, record.alt);
+    record.accuracy = static_cast<uint32_t>(lroundf(1e3f * survey.getAccuracy()));
+    record.duration = survey.getAccepted();
+    store::save(store::ID_SURVEY, &record, SURVEY_WORDS);
+    surveyed = record;
+    surveyState = gps::SURVEY_FIXED;
+}
+
 static void processUbxClock(const uint8_t *payload) {
     // clock status message received, no conf update needed
     hasClock = true;
@@ -534,6 +643,13 @@ static void processUbxGpsTime(const uint8_t *payload) {
     taiOffset = static_cast<signed char>(payload[10]) + 19;
 }
 
+static void processUbxTimePulse(const uint8_t *payload) {
+    // time pulse received, no conf update needed
+    hasTimePulse = true;
+    // record quantization error of the next PPS edge
+    timePulse.update(clock::monotonic::now(), payload);
+}
+
 static const int lutDays365[16] = {
     0, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365
 };
@@ -552,6 +668,10 @@ static void processUbxPVT(const uint8_t *payload) {
     locLat = 1e-7f * static_cast<float>(*reinterpret_cast<const int32_t*>(payload + 28));
     locAlt = 1e-3f * static_cast<float>(*reinterpret_cast<const int32_t*>(payload + 36));
 
+    // survey antenna position from 3D fixes
+    if (surveyState == gps::SURVEY_RUNNING && payload[20] == 3 && (payload[21] & 1))
+        updateSurvey(payload);
+
     // time data must be valid
     if ((payload[11] & 3) != 3)
         return;
@@ -605,3 +725,43 @@ uint32_t gps::taiEpoch() {
 int gps::taiOffset() {
     return ::taiOffset;
 }
+
+bool gps::ppsCorrection(const uint64_t pps, int64_t &correction) {
+    return timePulse.correct(pps, correction);
+}
+
+float gps::qErr() {
+    return timePulse.getQErr();
+}
+
+uint32_t gps::baudRate() {
+    return ::baudRate;
+}
+
+uint32_t gps::rxOverruns() {
+    return rxRing.getOverruns() + fifoOverruns;
+}
+
+gps::SurveyState gps::surveyState() {
+    return ::surveyState;
+}
+
+bool gps::timingMode() {
+    return hasTimingMode;
+}
+
+uint32_t gps::surveyDuration() {
+    return ::surveyState == SURVEY_RUNNING ? survey.getAccepted() : surveyed.duration;
+}
+
+uint32_t gps::surveyTarget() {
+    return GPS_SURVEY_DURATION;
+}
+
+float gps::surveyAccuracy() {
+    if (::surveyState == SURVEY_RUNNING)
+        return survey.getAccuracy();
+    if (::surveyState == SURVEY_DISABLED)
+        return -1;
+    return 1e-3f * static_cast<float>(surveyed.accuracy);
+}
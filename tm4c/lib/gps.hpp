@@ -23,4 +23,30 @@ namespace gps {
     uint64_t taiEpochUpdate();
     uint32_t taiEpoch();
     int taiOffset();
+
+    // UART link status
+    uint32_t baudRate();
+    uint32_t rxOverruns();
+
+    // PPS quantization error correction (UBX-TIM-TP)
+    bool ppsCorrection(uint64_t pps, int64_t &correction);
+    float qErr();
+
+    // survey-in and fixed-position timing mode
+    enum SurveyState : uint8_t {
+        SURVEY_DISABLED,
+        SURVEY_RUNNING,
+        SURVEY_FIXED,
+        SURVEY_UNSUPPORTED
+    };
+
+    SurveyState surveyState();
+    // receiver acknowledged fixed-position timing mode
+    bool timingMode();
+    // averaged fixes (s)
+    uint32_t surveyDuration();
+    // minimum survey-in duration (s)
+    uint32_t surveyTarget();
+    // accuracy of the surveyed position (m, negative if not yet available)
+    float surveyAccuracy();
 }
@@ -467,6 +467,10 @@ uint32_t network::getOverflowTx() {
     return overflowTx;
 }
 
+int network::getTxFree() {
+    return (txTail - txHead - 1) & TX_RING_MASK;
+}
+
 bool network::transmit(const uint8_t *frame, int size, const CallbackTx callback, void *ref) {
     // restrict transmission length
     if (size > MTU)
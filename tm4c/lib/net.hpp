@@ -33,6 +33,12 @@ namespace network {
      */
     uint32_t getOverflowTx();
 
+    /**
+     * Get the number of free segments in the ethernet transmit ring
+     * @return the number of free transmit segments (each segment holds up to 128 bytes of a frame)
+     */
+    int getTxFree();
+
     /**
      * Get the link-level receive timestamp associated with the current callback context.
      * @param stamps array of length 3 that will be populated with
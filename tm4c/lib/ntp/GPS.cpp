@@ -6,18 +6,19 @@
 #include "../gps.hpp"
 
 #include "common.hpp"
+#include "ntp.hpp"
+#include "pll.hpp"
 #include "../run.hpp"
 #include "../clock/capture.hpp"
 #include "../clock/mono.hpp"
 #include "../clock/tai.hpp"
 #include "../clock/util.hpp"
 
+// deadline for the next PPS edge before a pulse is considered missed
+static constexpr uint32_t PPS_TIMEOUT = RUN_SEC + RUN_SEC / 4;
 
 ntp::GPS::GPS() :
-    Source(REF_ID, RPY_SD_MD_REF) {
-    // clear PPS status
-    lastPps = 0;
-    lastPoll = 0;
+    Source(REF_ID, RPY_SD_MD_REF, history, HISTORY_WAN), history{} {
     // set metadata
     version = 4;
     ntpMode = 4;
@@ -27,45 +28,48 @@ ntp::GPS::GPS() :
     minPoll = 0;
     poll = 0;
 
-    // run updates at 16Hz
-    runSleep(RUN_SEC / 16, &run, this);
+    // update on each PPS edge, count missed pulses once per second after the deadline
+    watchdog = runSleep(RUN_SEC, &runWatchdog, this);
+    runDelay(watchdog, PPS_TIMEOUT);
+    clock::capture::onPpsGps(&runPps, this);
 }
 
 ntp::GPS::~GPS() {
+    clock::capture::onPpsGps(nullptr, nullptr);
+    runCancel(nullptr, this);
     Source::~Source();
 }
 
-void ntp::GPS::run(void *ref) {
-    static_cast<GPS*>(ref)->run();
+void ntp::GPS::runPps(void *ref) {
+    static_cast<GPS*>(ref)->pps();
 }
 
-void ntp::GPS::run() {
-    // get pps timestamps
-    uint64_t ppsTime[3];
-    clock::capture::ppsGps(ppsTime);
+void ntp::GPS::runWatchdog(void *ref) {
+    static_cast<GPS*>(ref)->missed();
+}
+
+void ntp::GPS::missed() {
+    // advance reach indicator for the missed pulse
+    reach <<= 1;
+    ++txCount;
+    // update status
+    updateStatus();
+    // coast on the oscillator model while the clock follows this reference
+    if (ntp::refId() == REF_ID || PLL_holdoverState() != PLL_HOLD_NONE)
+        PLL_holdover();
+}
+
+void ntp::GPS::pps() {
+    // push back missed pulse deadline
+    runDelay(watchdog, PPS_TIMEOUT);
 
-    // is pps too old?
-    const uint64_t now = clock::monotonic::now();
-    if (now - ppsTime[0] > 0x140000000ull) {
-        // advance reach indicator if the pulse has been missed
-        if (static_cast<int64_t>(now - lastPoll) > 0x100000000ll) {
-            lastPoll = now;
-            reach <<= 1;
-            ++txCount;
-            // update status
-            updateStatus();
-        }
-        return;
-    }
     // GPS must have time set
     if (gps::taiEpoch() == 0)
         return;
-    // wait for update
-    if (ppsTime[0] == lastPps)
-        return;
-    // record update time
-    lastPoll = now;
-    lastPps = ppsTime[0];
+
+    // get pps timestamps
+    uint64_t ppsTime[3];
+    clock::capture::ppsGps(ppsTime);
 
     // update reach indicator
     reach = (reach << 1) | 1;
@@ -83,6 +87,10 @@ void ntp::GPS::run() {
     auto &sample = advanceFilter();
     // store PPS timestamps
     sample.taiLocal = ppsTime[2];
+    // remove receiver sawtooth error from the edge
+    int64_t qErr;
+    if (gps::ppsCorrection(ppsTime[0], qErr))
+        sample.taiLocal -= qErr;
     // compute TAI offset
     scratch.full = ppsTime[0];
     scratch.full -= gps::taiEpochUpdate();
@@ -93,8 +101,12 @@ void ntp::GPS::run() {
 
     // update filter
     updateFilter();
+    // update stability statistics
+    PLL_updatePps(toFloat(sample.getOffset()));
     // update status
     updateStatus();
+    // update clock without waiting for the next selection poll
+    ntp::requestSelect();
 }
 
 void ntp::GPS::updateStatus() {
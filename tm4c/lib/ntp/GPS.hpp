@@ -8,12 +8,18 @@
 
 namespace ntp {
     class GPS final : public Source {
-        uint64_t lastPoll;
-        uint64_t lastPps;
+        // missed pulse watchdog task
+        void *watchdog;
+        // sample history
+        Sample history[HISTORY_WAN];
 
-        static void run(void *ref);
+        static void runPps(void *ref);
 
-        void run();
+        static void runWatchdog(void *ref);
+
+        void pps();
+
+        void missed();
 
         void updateStatus();
 
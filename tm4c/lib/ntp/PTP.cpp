@@ -0,0 +1,275 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "PTP.hpp"
+
+#include "common.hpp"
+#include "ntp.hpp"
+#include "../net.hpp"
+#include "../run.hpp"
+#include "../clock/mono.hpp"
+#include "../clock/tai.hpp"
+#include "../clock/util.hpp"
+#include "../net/util.hpp"
+#include "../ptp/common.hpp"
+#include "../ptp/manage.hpp"
+#include "../ptp/ptp.hpp"
+
+#include <memory.h>
+
+inline uint64_t avg64(const uint64_t a, const uint64_t b) {
+    return a + (static_cast<int64_t>(b - a) >> 1);
+}
+
+ntp::PTP::PTP() :
+    Source(REF_ID, RPY_SD_MD_REF, history, HISTORY_LAN), history{}, parent{}, parentAddr{},
+    syncRx{}, syncLocal{}, delayLocal{}, delayTx{} {
+    // clear state variables
+    tracking = false;
+    syncCorrection = 0;
+    syncSequence = 0;
+    syncPending = false;
+    syncOrigin = 0;
+    syncValid = false;
+    delayOrigin = 0;
+    delaySequence = 0;
+    delayPending = false;
+    delaySent = false;
+
+    // set metadata
+    version = PTP2_VERSION;
+    ntpMode = 4;
+    precision = NTP_CLK_PREC;
+    refId = REF_ID;
+    // one second delay request interval
+    maxPoll = 0;
+    minPoll = 0;
+    poll = 0;
+
+    // receive timing messages and request the path delay once per second
+    ptp::onSlave(&receive, this);
+    runSleep(RUN_SEC, &run, this);
+}
+
+ntp::PTP::~PTP() {
+    ptp::onSlave(nullptr, nullptr);
+    runCancel(nullptr, this);
+    Source::~Source();
+}
+
+void ntp::PTP::run(void *ref) {
+    static_cast<PTP*>(ref)->run();
+}
+
+void ntp::PTP::receive(void *ref, const ptp::Address &src, const uint8_t *message, const int size) {
+    auto &self = *static_cast<PTP*>(ref);
+    // verify message length
+    if (size < static_cast<int>(sizeof(MessagePTP<PTP2_TIMESTAMP>)))
+        return;
+    const auto &header = *reinterpret_cast<const HEADER_PTP*>(message);
+
+    // only accept messages from the parent master (which may have changed since the last request)
+    auto sender = header.sourceIdentity;
+    sender.portNumber = htons(sender.portNumber);
+    if (!self.tracking || memcmp(&sender, &self.parent.sender, sizeof(sender)) != 0) {
+        self.updateParent();
+        if (!self.tracking || memcmp(&sender, &self.parent.sender, sizeof(sender)) != 0)
+            return;
+    }
+
+    if (header.messageType == PTP2_MT_SYNC)
+        return self.sync(message, size);
+    if (header.messageType == PTP2_MT_FOLLOW_UP)
+        return self.followUp(message, size);
+    if (header.messageType == PTP2_MT_DELAY_RESP)
+        return self.delayResponse(message, size);
+}
+
+void ntp::PTP::txCallback(void *ref, const uint8_t *frame, const int size) {
+    // get precise TX time
+    uint64_t stamps[3];
+    network::getTxTime(stamps);
+
+    // locate request message
+    ptp::Address src, dst;
+    const int offset = ptp::transport::parse(frame, size, src, dst);
+    if (offset < 0)
+        return;
+    const auto &header = *reinterpret_cast<const HEADER_PTP*>(frame + offset);
+
+    // record departure of the outstanding request
+    auto &self = *static_cast<PTP*>(ref);
+    if (!self.delayPending || htons(header.sequenceId) != self.delaySequence)
+        return;
+    memcpy(self.delayTx, stamps, sizeof(stamps));
+    self.delaySent = true;
+}
+
+void ntp::PTP::run() {
+    updateParent();
+
+    // advance reach indicator (a response sets the bit before the next request)
+    reach <<= 1;
+    delayPending = false;
+    updateStatus();
+
+    if (!tracking)
+        return;
+    // arbitrary timescales cannot discipline the TAI clock
+    if ((parent.timeFlags & PTP2_FLAG_PTP_TIMESCALE) == 0)
+        return;
+    // pair the request with a recent sync
+    if (!syncValid || clock::monotonic::now() - syncLocal[0] > SYNC_TIMEOUT)
+        return;
+    sendRequest();
+}
+
+void ntp::PTP::updateParent() {
+    ptp::bmca::DataSet next;
+    ptp::Address addr;
+    const bool found = ptp::bmca::getParent(next, addr);
+
+    // discard timing state of the previous master
+    if (!found || !tracking || memcmp(&next.sender, &parent.sender, sizeof(parent.sender)) != 0) {
+        syncPending = false;
+        syncValid = false;
+        delayPending = false;
+    }
+    tracking = found;
+    if (!found)
+        return;
+    parent = next;
+    parentAddr = addr;
+
+    // distance to the primary reference of the grandmaster
+    stratum = (parent.quality.clockClass <= PTP2_CLK_CLASS_PRI_HOLD) ? 0 : 1;
+    const int accuracy = parent.quality.clockAccuracy - 0x20;
+    rootDispersion = (accuracy >= 0 && accuracy < 17) ? static_cast<uint32_t>(0x1p16f * lutClkAccuracy[accuracy]) : 0;
+    // leap second warning
+    leap = 0;
+    if (parent.timeFlags & PTP2_FLAG_LEAP61)
+        leap = 1;
+    else if (parent.timeFlags & PTP2_FLAG_LEAP59)
+        leap = 2;
+}
+
+void ntp::PTP::updateStatus() {
+    // update status
+    if (reach == 0)
+        lost = true;
+    else if (reach == 0xFFFF)
+        lost = false;
+}
+
+void ntp::PTP::sync(const uint8_t *message, const int size) {
+    // get RX time
+    uint64_t stamps[3];
+    network::getRxTime(stamps);
+
+    const auto &sync = MessagePTP<PTP2_TIMESTAMP>::from(message);
+    const auto correction = fromPtpCorrection(sync.ptp.correctionField);
+    if (sync.ptp.flags & htons(PTP2_FLAG_TWO_STEP)) {
+        // wait for the precise origin time
+        memcpy(syncRx, stamps, sizeof(stamps));
+        syncCorrection = correction;
+        syncSequence = htons(sync.ptp.sequenceId);
+        syncPending = true;
+        return;
+    }
+
+    // one-step sync carries the precise origin time
+    syncOrigin = fromPtpTimestamp(&sync.data) + correction;
+    memcpy(syncLocal, stamps, sizeof(stamps));
+    syncValid = true;
+}
+
+void ntp::PTP::followUp(const uint8_t *message, const int size) {
+    const auto &followup = MessagePTP<PTP2_TIMESTAMP>::from(message);
+    if (!syncPending || htons(followup.ptp.sequenceId) != syncSequence)
+        return;
+    syncPending = false;
+
+    // corrections of both messages apply to the origin time
+    syncOrigin = fromPtpTimestamp(&followup.data) + syncCorrection + fromPtpCorrection(followup.ptp.correctionField);
+    memcpy(syncLocal, syncRx, sizeof(syncRx));
+    syncValid = true;
+}
+
+void ntp::PTP::delayResponse(const uint8_t *message, const int size) {
+    // verify response length
+    if (size < static_cast<int>(sizeof(MessagePTP<PTP2_DELAY_RESP>)))
+        return;
+    const auto &response = MessagePTP<PTP2_DELAY_RESP>::from(message);
+
+    // ignore responses to other slaves
+    const auto &requester = response.data.requestingIdentity;
+    if (memcmp(requester.identity, ptpClockId, sizeof(ptpClockId)) != 0 || htons(requester.portNumber) != 1)
+        return;
+    if (!delayPending || !delaySent || htons(response.ptp.sequenceId) != delaySequence)
+        return;
+    delayPending = false;
+    ++rxCount;
+
+    // the correction of the response is subtracted from the receive time
+    const auto receiveTime = fromPtpTimestamp(&response.data.receiveTimestamp);
+    addSample(receiveTime - fromPtpCorrection(response.ptp.correctionField));
+}
+
+void ntp::PTP::sendRequest() {
+    MessagePTP<PTP2_TIMESTAMP> request = {};
+    initPtpHeader(request.ptp, PTP2_MT_DELAY_REQ, sizeof(request), 0x7F);
+    request.ptp.sequenceId = htons(++delaySequence);
+    toPtpTimestamp(clock::tai::now(), &request.data);
+
+    // pair the request with the latest sync
+    delayOrigin = syncOrigin;
+    memcpy(delayLocal, syncLocal, sizeof(syncLocal));
+    delayPending = true;
+    delaySent = false;
+    ++txCount;
+
+    // transmit request on the transport of the parent master
+    ptp::transport::send(
+        ptp::transport::multicast(parentAddr.transport), true,
+        &request, sizeof(request), &txCallback, this
+    );
+}
+
+void ntp::PTP::addSample(const uint64_t receiveTime) {
+    // mean path delay (use compensated clock for best accuracy)
+    const auto remote = static_cast<int64_t>(receiveTime - delayOrigin);
+    const auto local = static_cast<int64_t>(delayTx[1] - delayLocal[1]);
+    const float delay = 0.5f * toFloat(remote - local);
+    if (delay > MAX_DELAY || delay < -MAX_DELAY)
+        return;
+
+    // update reach indicator
+    reach |= 1;
+    ++rxValid;
+
+    // advance sample buffer
+    auto &sample = advanceFilter();
+    // set TAI reference time
+    sample.taiLocal = avg64(delayLocal[2], delayTx[2]);
+    // compute TAI offset
+    sample.taiRemote = avg64(delayOrigin, receiveTime);
+    sample.delay = delay;
+
+    // report the measurement in the current data set
+    ptp::manage::setCurrent(-sample.getOffset(), delay);
+
+    // update filter
+    updateFilter();
+    // update status
+    updateStatus();
+
+    // update TAI/UTC offset while the clock follows this reference
+    if (ntp::refId() == REF_ID && (parent.timeFlags & PTP2_FLAG_UTC_VALID)) {
+        fixed_32_32 scratch = {};
+        scratch.ipart = parent.utcOffset;
+        clkTaiUtcOffset = scratch.full;
+    }
+    // update clock without waiting for the next selection poll
+    ntp::requestSelect();
+}
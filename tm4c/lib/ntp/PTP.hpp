@@ -0,0 +1,76 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include "Source.hpp"
+#include "../ptp/bmca.hpp"
+#include "../ptp/transport.hpp"
+
+namespace ntp {
+    /**
+     * PTP ordinary clock slave (end-to-end delay mechanism).
+     * Follows the parent master chosen by the BMCA while it outranks the local clock. Each second a Delay_Req is
+     * paired with the latest Sync (and Follow_Up) to produce an offset sample for source selection.
+     */
+    class PTP final : public Source {
+        // sync messages older than this are not paired with a delay request (32.32 fixed point)
+        static constexpr uint64_t SYNC_TIMEOUT = 2ull << 32;
+
+        // sample history
+        Sample history[HISTORY_LAN];
+
+        // parent master
+        ptp::bmca::DataSet parent;
+        ptp::Address parentAddr;
+        bool tracking;
+
+        // two-step sync awaiting its follow-up
+        uint64_t syncRx[3];
+        int64_t syncCorrection;
+        uint16_t syncSequence;
+        bool syncPending;
+        // latest complete sync (corrected origin time and local receive time)
+        uint64_t syncOrigin;
+        uint64_t syncLocal[3];
+        bool syncValid;
+
+        // outstanding delay request and the sync it is paired with
+        uint64_t delayOrigin;
+        uint64_t delayLocal[3];
+        uint64_t delayTx[3];
+        uint16_t delaySequence;
+        bool delayPending;
+        bool delaySent;
+
+        static void run(void *ref);
+
+        static void receive(void *ref, const ptp::Address &src, const uint8_t *message, int size);
+
+        static void txCallback(void *ref, const uint8_t *frame, int size);
+
+        void run();
+
+        void updateParent();
+
+        void updateStatus();
+
+        void sync(const uint8_t *message, int size);
+
+        void followUp(const uint8_t *message, int size);
+
+        void delayResponse(const uint8_t *message, int size);
+
+        void sendRequest();
+
+        void addSample(uint64_t receiveTime);
+
+    public:
+        static constexpr uint32_t REF_ID = 0x00505450u;
+
+        PTP();
+
+        ~PTP();
+    };
+}
@@ -26,8 +26,8 @@ inline uint64_t avg64(const uint64_t a, const uint64_t b) {
     return a + (static_cast<int64_t>(b - a) >> 1);
 }
 
-ntp::Peer::Peer(const uint32_t ipAddr) :
-    Source(ipAddr, RPY_SD_MD_CLIENT),
+ntp::Peer::Peer(const uint32_t ipAddr, Sample *samples, const int depth) :
+    Source(ipAddr, RPY_SD_MD_CLIENT, samples, depth),
     local_tx_hw{}, local_rx_hw{}, macAddr{} {
     // clear state variables
     filterRx = 0;
@@ -124,7 +124,7 @@ void ntp::Peer::updateStatus() {
 
     // adjust poll interval
     if (
-        sampleCount == MAX_HISTORY &&
+        sampleCount >= HISTORY_LAN &&
         (reach & 0xFF) == 0xFF &&
         pollCounter >= 8 &&
         poll < maxPoll
@@ -7,7 +7,7 @@
 #include "Source.hpp"
 
 namespace ntp {
-    class Peer final : public Source {
+    class Peer : public Source {
         // 500 ms (32.32 fixed point)
         static constexpr uint64_t PEER_RESPONSE_TIMEOUT = 1ull << 31;
         static constexpr int PEER_MIN_POLL = 4;
@@ -59,11 +59,37 @@ namespace ntp {
 
         static void txCallback(void *ref, const uint8_t *frame, int size);
 
-    public:
-        explicit Peer(uint32_t ipAddr);
+    protected:
+        /**
+         * Create a new NTP peer
+         * @param ipAddr remote timeserver address
+         * @param samples sample history storage
+         * @param depth sample history depth
+         */
+        Peer(uint32_t ipAddr, Sample *samples, int depth);
 
+    public:
         ~Peer();
 
         void receive(uint8_t *frame, int flen);
     };
+
+    /**
+     * NTP peer with statically sized sample history
+     * @tparam DEPTH sample history depth
+     */
+    template<int DEPTH>
+    class PeerHistory final : public Peer {
+        // sample history
+        Sample history[DEPTH];
+
+    public:
+        explicit PeerHistory(const uint32_t ipAddr) :
+            Peer(ipAddr, history, DEPTH), history{} {}
+    };
+
+    // peer for local area timeservers
+    using PeerLan = PeerHistory<Source::HISTORY_LAN>;
+    // peer for wide area timeservers
+    using PeerWan = PeerHistory<Source::HISTORY_WAN>;
 }
@@ -14,23 +14,19 @@
 
 #include <cmath>
 
+// filter scratch buffers
+static float filterX[ntp::Source::MAX_HISTORY];
+static float filterY[ntp::Source::MAX_HISTORY];
+static float filterW[ntp::Source::MAX_HISTORY];
 
-static void fitLinear(
-    int cnt,
-    const float *x,
-    const float *y,
-    const float *w,
-    float &offset,
-    float &slope,
-    float &offsetVariance,
-    float &slopeVariance
-);
-
-ntp::Source::Source(const uint32_t id_, const uint16_t mode_) :
-    ringSamples{}, id(id_), mode(mode_) {
+ntp::Source::Source(const uint32_t id_, const uint16_t mode_, Sample *samples, const int depth) :
+    ringSamples(samples), ringMask(depth - 1), id(id_), mode(mode_) {
     // sample ring buffer
-    ringPtr = 0;;
+    ringPtr = 0;
     sampleCount = 0;
+    // delay sums
+    delayStale = 0;
+    delayRef = 0;
 
     // samples used in calculations
     usedOffset = 0;
@@ -76,6 +72,8 @@ ntp::Source::Source(const uint32_t id_, const uint16_t mode_) :
     freqSkew = 0;
     // overall score
     score = 0;
+    // root distance
+    distance = 0;
 
     // status flags
     xleave = false;
@@ -95,18 +93,36 @@ ntp::Source::~Source() {
 }
 
 void ntp::Source::applyOffset(const int64_t offset) {
-    for (auto &sample : ringSamples)
-        sample.taiLocal += offset;
+    for (int i = 0; i <= ringMask; ++i)
+        ringSamples[i].taiLocal += offset;
 }
 
 ntp::Source::Sample& ntp::Source::advanceFilter() {
-    ringPtr = (ringPtr + 1) & RING_MASK;
-    if (sampleCount < MAX_HISTORY)
+    ringPtr = (ringPtr + 1) & ringMask;
+    if (sampleCount <= ringMask)
         ++sampleCount;
+    else {
+        // evict oldest sample from delay stats
+        const auto delay = ringSamples[ringPtr].delay - delayRef;
+        delaySum -= delay;
+        delaySumSq -= delay * delay;
+    }
     return ringSamples[ringPtr];
 }
 
 void ntp::Source::updateFilter() {
+    // dispatch to the filter specialized for the history depth
+    if (ringMask == HISTORY_LAN - 1)
+        filter<HISTORY_LAN>();
+    else
+        filter<HISTORY_WAN>();
+}
+
+template<int DEPTH>
+void ntp::Source::filter() {
+    // ring buffer index modulo mask
+    static constexpr int mask = DEPTH - 1;
+
     updateDelay();
 
     const auto &sample = ringSamples[ringPtr];
@@ -116,38 +132,40 @@ void ntp::Source::updateFilter() {
 
     // compute time spanned by samples
     span = static_cast<int>(
-        (sample.taiLocal - ringSamples[(ringPtr - (sampleCount - 1)) & RING_MASK].taiLocal) >> 32
+        (sample.taiLocal - ringSamples[(ringPtr - (sampleCount - 1)) & mask].taiLocal) >> 32
     );
 
     // convert offsets to floats
-    float x[sampleCount];
-    float y[sampleCount];
-    float w[sampleCount];
+    const auto x = filterX;
+    const auto y = filterY;
+    const auto w = filterW;
     const auto lastOffset = ringSamples[ringPtr].getOffset();
     const auto lastLocal = ringSamples[ringPtr].taiLocal;
+    // center offsets in fixed-point prior to conversion
+    int64_t centerOffset = 0;
+    for (int i = 0; i < sampleCount; i++)
+        centerOffset += ringSamples[(ringPtr - i) & mask].getOffset() - lastOffset;
+    centerOffset = lastOffset + centerOffset / sampleCount;
     auto delayVariance = delayStdDev + CLK_NANOS * 1e-9f;
     delayVariance *= delayVariance;
     for (int i = 0; i < sampleCount; i++) {
-        const int k = (ringPtr - i) & RING_MASK;
+        const int k = (ringPtr - i) & mask;
         x[i] = toFloatU(lastLocal - ringSamples[k].taiLocal);
-        y[i] = toFloat(ringSamples[k].getOffset() - lastOffset);
+        y[i] = toFloat(ringSamples[k].getOffset() - centerOffset);
         const auto jitter = ringSamples[k].delay - delayMean;
         w[i] = delayVariance / (delayVariance + jitter * jitter);
     }
 
+    // robust fit if there are sufficient samples
     float offsetVar, freqVar;
-    fitLinear(sampleCount, x, y, w, offsetMean, freqDrift, offsetVar, freqVar);
-    if (sampleCount > 4) {
-        // reweight by offset error if there are sufficient samples
-        offsetVar += CLK_NANOS * 1e-9f * CLK_NANOS * 1e-9f;
-        for (int i = 0; i < sampleCount; i++) {
-            const float error = y[i] - offsetMean - x[i] * freqDrift;
-            w[i] = offsetVar / (offsetVar + error * error);
-            fitLinear(sampleCount, x, y, w, offsetMean, freqDrift, offsetVar, freqVar);
-        }
-    }
+    regression::fitRobust(
+        sampleCount, x, y, w,
+        sampleCount < MIN_REGRESSION_SAMPLES ? 0 : FILTER_PASSES,
+        CLK_NANOS * 1e-9f * CLK_NANOS * 1e-9f,
+        offsetMean, freqDrift, offsetVar, freqVar
+    );
     filteredOffset = lastOffset;// + toFixedPoint(offsetMean);
-    offsetMean += toFloat(lastOffset);
+    offsetMean += toFloat(centerOffset);
     offsetStdDev = std::sqrt(offsetVar);
     freqSkew = std::sqrt(freqVar);
 
@@ -166,36 +184,57 @@ void ntp::Source::updateFilter() {
     score += offsetStdDev;
     this->score = score;
 
+    // set root distance
+    float distance = 0.5f * std::abs(0x1p-16f * static_cast<float>(rootDelay));
+    distance += 0x1p-16f * static_cast<float>(rootDispersion);
+    distance += 0.5f * delayMean;
+    distance += delayStdDev;
+    distance += offsetStdDev;
+    distance += CLK_NANOS * 1e-9f;
+    this->distance = distance;
+
     // set update time
     lastUpdate = clock::monotonic::now();
 }
 
 void ntp::Source::updateDelay() {
-    float delay[sampleCount];
-    for (int i = 0; i < sampleCount; i++) {
-        const int k = (ringPtr - i) & RING_MASK;
-        delay[i] = ringSamples[k].delay;
-    }
+    // accumulate newest sample
+    const auto delay = ringSamples[ringPtr].delay - delayRef;
+    delaySum += delay;
+    delaySumSq += delay * delay;
+    // periodically rebuild sums to prevent accumulation of rounding errors
+    if (++delayStale > ringMask)
+        rebuildDelay();
 
     // compute mean
-    float mean = 0;
-    for (const auto value : delay)
-        mean += value;
-    mean /= static_cast<float>(sampleCount);
+    const auto count = static_cast<float>(sampleCount);
+    const auto mean = delaySum.value() / count;
 
     // compute variance
     float var = 0;
-    for (const auto value : delay) {
-        const auto diff = value - mean;
-        var += diff * diff;
+    if (sampleCount > 1) {
+        var = (delaySumSq.value() - delaySum.value() * mean) / (count - 1.0f);
+        if (var < 0)
+            var = 0;
     }
-    var /= static_cast<float>(sampleCount - 1);
 
     // update fields
-    delayMean = mean;
+    delayMean = delayRef + mean;
     delayStdDev = sqrtf(var);
 }
 
+void ntp::Source::rebuildDelay() {
+    delayRef += delaySum.value() / static_cast<float>(sampleCount);
+    delaySum = regression::Sum();
+    delaySumSq = regression::Sum();
+    for (int i = 0; i < sampleCount; i++) {
+        const auto delay = ringSamples[(ringPtr - i) & ringMask].delay - delayRef;
+        delaySum += delay;
+        delaySumSq += delay * delay;
+    }
+    delayStale = 0;
+}
+
 bool ntp::Source::isSelectable() {
     // determine if the link has been lost
     if (reach == 0 || lost) {
@@ -288,43 +327,3 @@ void ntp::Source::getSourceData(RPY_Source_Data &rpySourceData) const {
     rpySourceData.poll = static_cast<int16_t>(htons(poll));
     rpySourceData.state = htons(state);
 }
-
-static void fitLinear(
-    int cnt,
-    const float *x,
-    const float *y,
-    const float *w,
-    float &offset,
-    float &slope,
-    float &offsetVariance,
-    float &slopeVariance
-) {
-    float scratch[5];
-    for (auto &v : scratch)
-        v = 0;
-
-    for (int i = 0; i < cnt; ++i) {
-        scratch[0] += w[i];
-        scratch[1] += w[i] * x[i];
-        scratch[2] += w[i] * x[i] * x[i];
-
-        scratch[3] += w[i] * y[i];
-        scratch[4] += w[i] * y[i] * x[i];
-    }
-
-    for (int i = 1; i < 5; ++i)
-        scratch[i] /= scratch[0];
-
-    slope = (scratch[4] - scratch[1] * scratch[3]) / (scratch[2] - scratch[1] * scratch[1]);
-    offset = scratch[3] - scratch[1] * slope;
-
-    float mse = 0;
-    for (int i = 0; i < cnt; ++i) {
-        const float error = y[i] - offset - x[i] * slope;
-        mse += w[i] * error * error;
-    }
-    mse /= scratch[0];
-
-    slopeVariance = mse / (scratch[2] - scratch[1] * scratch[1]);
-    offsetVariance = slopeVariance * scratch[2];
-}
@@ -6,16 +6,22 @@
 
 #include <cstdint>
 
+#include "../regression.hpp"
 #include "../chrony/candm.h"
 
 namespace ntp {
     class Source {
-    protected:
-        // maximum number of polling samples
-        static constexpr int MAX_HISTORY = 16;
+    public:
+        // sample history depth for local area timeservers
+        static constexpr int HISTORY_LAN = 16;
 
-        // ring buffer index modulo mask
-        static constexpr int RING_MASK = MAX_HISTORY - 1;
+        // sample history depth for wide area timeservers and local references
+        static constexpr int HISTORY_WAN = 64;
+
+        // maximum sample history depth
+        static constexpr int MAX_HISTORY = HISTORY_WAN;
+
+    protected:
 
         // minimum number of smaples required for linear regression
         static constexpr int MIN_REGRESSION_SAMPLES = 5;
@@ -39,9 +45,20 @@ namespace ntp {
         // maximum frequency skew tolerance
         static constexpr float MAX_FREQ_SKEW = 50e-6f;
 
-        // filter samples
-        Sample ringSamples[MAX_HISTORY];
+        // number of robust reweighting passes for the offset filter
+        static constexpr int FILTER_PASSES = 3;
+
+        // filter samples (storage provided by subclass)
+        Sample *const ringSamples;
+        // ring buffer index modulo mask
+        const uint8_t ringMask;
         uint8_t ringPtr;
+        // samples accumulated since the last delay stats rebuild
+        uint8_t delayStale;
+        // running delay sums relative to the reference delay
+        float delayRef;
+        regression::Sum delaySum;
+        regression::Sum delaySumSq;
 
     protected:
         uint8_t sampleCount;
@@ -90,6 +107,8 @@ namespace ntp {
         float freqSkew;
         // overall score
         float score;
+        // root distance
+        float distance;
 
         // status flags
         bool xleave;
@@ -101,10 +120,22 @@ namespace ntp {
 
         void updateFilter();
 
+        template<int DEPTH>
+        void filter();
+
         void updateDelay();
 
+        void rebuildDelay();
+
     public:
-        Source(uint32_t id_, uint16_t mode_);
+        /**
+         * Create a new time source
+         * @param id_ source identifier
+         * @param mode_ source mode
+         * @param samples sample history storage
+         * @param depth sample history depth (HISTORY_LAN or HISTORY_WAN)
+         */
+        Source(uint32_t id_, uint16_t mode_, Sample *samples, int depth);
 
         ~Source();
 
@@ -168,6 +199,14 @@ namespace ntp {
             state = RPY_SD_ST_SELECTED;
         }
 
+        /**
+         * Mark this source instance as rejected by the selection algorithm.
+         * @param reason source state indicating the reason for rejection
+         */
+        void reject(const uint16_t reason) {
+            state = reason;
+        }
+
         /**
          * Apply offset adjustment to all samples from source.
          * @param offset the offset to apply in (32.32 fixed point)
@@ -199,6 +238,24 @@ namespace ntp {
             return score;
         }
 
+        /**
+         * Get the root distance (half-width of the correctness interval) of this source.
+         * @return the root distance in seconds
+         */
+        [[nodiscard]]
+        auto getDistance() const {
+            return distance;
+        }
+
+        /**
+         * Get the offset jitter of this source.
+         * @return the offset jitter in seconds
+         */
+        [[nodiscard]]
+        auto getJitter() const {
+            return offsetStdDev;
+        }
+
         [[nodiscard]]
         auto getPollingInterval() const {
             return poll;
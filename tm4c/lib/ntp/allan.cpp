@@ -0,0 +1,111 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "allan.hpp"
+
+#include <cmath>
+
+// accumulated terms are halved once this limit is reached (exponential aging)
+static constexpr uint32_t MAX_TERMS = 1u << 16;
+
+/**
+ * Accumulate a squared second difference with exponential aging
+ * @param sum accumulated value
+ * @param count number of accumulated terms
+ * @param value new term
+ */
+static void accumulate(regression::Sum &sum, uint32_t &count, const float value) {
+    sum += value;
+    if (++count < MAX_TERMS)
+        return;
+    // halve the weight of prior terms
+    const float half = 0.5f * sum.value();
+    sum = regression::Sum();
+    sum += half;
+    count >>= 1;
+}
+
+void ntp::Allan::reset() {
+    for (auto &level : levels) {
+        level.sumAdev = regression::Sum();
+        level.sumTdev = regression::Sum();
+        level.cntAdev = 0;
+        level.cntTdev = 0;
+        level.fill = 0;
+        level.head = 0;
+    }
+    for (auto &half : stageHalf)
+        half = false;
+}
+
+void ntp::Allan::update(const int level, const int span, const float point, const float mean) {
+    auto &bin = levels[level];
+    const int head = (bin.head + 1) & (RING - 1);
+    bin.head = head;
+    bin.point[head] = point;
+    bin.mean[head] = mean;
+    if (bin.fill < 3 * span)
+        ++bin.fill;
+
+    // overlapping Allan variance (second difference of phase samples spaced by tau)
+    if (bin.fill > 2 * span) {
+        const float diff = point -
+                           2.0f * bin.point[(head - span) & (RING - 1)] +
+                           bin.point[(head - 2 * span) & (RING - 1)];
+        accumulate(bin.sumAdev, bin.cntAdev, diff * diff);
+    }
+
+    // time variance (second difference of phase averaged over tau)
+    if (bin.fill >= 3 * span) {
+        float diff = 0;
+        for (int i = 0; i < span; ++i) {
+            diff += bin.mean[(head - i) & (RING - 1)];
+            diff -= 2.0f * bin.mean[(head - span - i) & (RING - 1)];
+            diff += bin.mean[(head - 2 * span - i) & (RING - 1)];
+        }
+        diff /= static_cast<float>(span);
+        accumulate(bin.sumTdev, bin.cntTdev, diff * diff);
+    }
+}
+
+void ntp::Allan::push(const float phase) {
+    // work in nanoseconds to keep squared differences well within single-precision range
+    const float point = phase * 1e9f;
+
+    // short tau bins use every sample (fully overlapping)
+    for (int level = 0; level <= OVERLAP_LOG2; ++level)
+        update(level, 1 << level, point, point);
+
+    // longer tau bins use octave-decimated block means
+    float mean = point;
+    for (int stage = 1; stage < STAGES; ++stage) {
+        if (!stageHalf[stage]) {
+            stageMean[stage] = mean;
+            stageHalf[stage] = true;
+            return;
+        }
+        mean = 0.5f * (stageMean[stage] + mean);
+        stageHalf[stage] = false;
+        update(stage + OVERLAP_LOG2, OVERLAP, point, mean);
+    }
+}
+
+uint32_t ntp::Allan::terms(const int level) const {
+    return levels[level].cntAdev;
+}
+
+float ntp::Allan::adev(const int level, const float interval) const {
+    const auto &bin = levels[level];
+    if (bin.cntAdev == 0)
+        return 0;
+    const float tau = ldexpf(interval, level);
+    return 1e-9f * std::sqrt(0.5f * bin.sumAdev.value() / static_cast<float>(bin.cntAdev)) / tau;
+}
+
+float ntp::Allan::tdev(const int level) const {
+    const auto &bin = levels[level];
+    if (bin.cntTdev == 0)
+        return 0;
+    return 1e-9f * std::sqrt(bin.sumTdev.value() / (6.0f * static_cast<float>(bin.cntTdev)));
+}
@@ -0,0 +1,90 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+#include "../regression.hpp"
+
+namespace ntp {
+    /**
+     * Streaming overlapping Allan and time deviation estimator for uniformly spaced phase samples.
+     * Samples are decimated through a cascade of octave stages, so each tau bin uses constant memory and each sample
+     * costs constant work. Each tau bin evaluates OVERLAP overlapping second differences per tau.
+     * A zero-initialized instance is valid.
+     */
+    class Allan {
+    public:
+        // number of octave-spaced tau bins (1 to 2^17 sample intervals)
+        static constexpr int LEVELS = 18;
+
+    private:
+        // overlapping estimates per tau
+        static constexpr int OVERLAP_LOG2 = 2;
+        static constexpr int OVERLAP = 1 << OVERLAP_LOG2;
+        // history ring size (must hold three tau spans)
+        static constexpr int RING = 16;
+        // number of octave decimation stages
+        static constexpr int STAGES = LEVELS - OVERLAP_LOG2;
+
+        struct Level {
+            // phase samples (nanoseconds)
+            float point[RING];
+            // phase block means (nanoseconds)
+            float mean[RING];
+            // accumulated squared second differences
+            regression::Sum sumAdev;
+            regression::Sum sumTdev;
+            uint32_t cntAdev;
+            uint32_t cntTdev;
+            uint16_t fill;
+            uint8_t head;
+        };
+
+        // tau bins
+        Level levels[LEVELS];
+        // pending half-block means for each decimation stage
+        float stageMean[STAGES];
+        bool stageHalf[STAGES];
+
+        void update(int level, int span, float point, float mean);
+
+    public:
+        /**
+         * Reset the estimator
+         */
+        void reset();
+
+        /**
+         * Add a phase sample
+         * @param phase phase offset in seconds
+         */
+        void push(float phase);
+
+        /**
+         * Get the number of accumulated terms for a tau bin
+         * @param level tau bin (tau = 2^level sample intervals)
+         * @return number of accumulated terms
+         */
+        [[nodiscard]]
+        uint32_t terms(int level) const;
+
+        /**
+         * Get the overlapping Allan deviation for a tau bin
+         * @param level tau bin (tau = 2^level sample intervals)
+         * @param interval sample interval in seconds
+         * @return Allan deviation (zero if no terms have been accumulated)
+         */
+        [[nodiscard]]
+        float adev(int level, float interval) const;
+
+        /**
+         * Get the time deviation for a tau bin
+         * @param level tau bin (tau = 2^level sample intervals)
+         * @return time deviation in seconds (zero if no terms have been accumulated)
+         */
+        [[nodiscard]]
+        float tdev(int level) const;
+    };
+}
@@ -0,0 +1,102 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "holdover.hpp"
+
+#include <cmath>
+
+// frequency wander assumed without enough samples (1 ppb)
+static constexpr float WANDER_PRIOR = 1e-9f;
+// minimum regression weight for a wander estimate (bins)
+static constexpr float MIN_WANDER_BINS = 4.0f;
+
+void ntp::Holdover::reset() {
+    *this = {};
+}
+
+void ntp::Holdover::update(const float correction) {
+    binSum += correction;
+    if (++binCount < BIN_SIZE)
+        return;
+    const float mean = binSum / static_cast<float>(BIN_SIZE);
+    binSum = 0;
+    binCount = 0;
+
+    // first bin sets the reference to keep the sums small
+    if (s0 == 0)
+        ref = mean;
+    const float y = mean - ref;
+
+    // shift existing bins back by one bin interval
+    s2 += s0 - 2.0f * s1;
+    s1 -= s0;
+    sty -= sy;
+    // exponential forgetting
+    constexpr float decay = 1.0f - 1.0f / REG_BINS;
+    s0 *= decay;
+    s1 *= decay;
+    s2 *= decay;
+    sy *= decay;
+    sty *= decay;
+    syy *= decay;
+    // add the new bin at t = 0
+    s0 += 1.0f;
+    sy += y;
+    syy += y * y;
+}
+
+void ntp::Holdover::start(const uint32_t now, const float correction, const float offsetRms) {
+    active = true;
+    startTime = now;
+    frequency = correction;
+    aging = getAging();
+    phaseError = offsetRms;
+    freqError = WANDER_SCALE * getWander();
+    // standard error of the regression slope (no smaller than the prior)
+    agingError = AGING_PRIOR;
+    if (s0 >= MIN_BINS) {
+        const float det = s0 * s2 - s1 * s1;
+        const float slopeError = det > 0 ? freqError * std::sqrt(s0 / det) / static_cast<float>(BIN_SIZE) : 0;
+        if (slopeError > agingError)
+            agingError = slopeError;
+    }
+}
+
+float ntp::Holdover::getCorrection(const uint32_t now) const {
+    const auto elapsed = static_cast<float>(now - startTime);
+    return frequency + aging * elapsed;
+}
+
+float ntp::Holdover::getError(const uint32_t now) const {
+    const auto elapsed = static_cast<float>(now - startTime);
+    return phaseError + elapsed * (freqError + 0.5f * agingError * elapsed);
+}
+
+float ntp::Holdover::getAging() const {
+    if (s0 < MIN_BINS)
+        return 0;
+    const float det = s0 * s2 - s1 * s1;
+    if (det <= 0)
+        return 0;
+    return (s0 * sty - s1 * sy) / det / static_cast<float>(BIN_SIZE);
+}
+
+float ntp::Holdover::getWander() const {
+    if (s0 < MIN_WANDER_BINS)
+        return WANDER_PRIOR;
+    // residual variance about the fitted trend
+    const float det = s0 * s2 - s1 * s1;
+    float var;
+    if (det > 0) {
+        const float slope = (s0 * sty - s1 * sy) / det;
+        const float intercept = (sy - slope * s1) / s0;
+        var = (syy - intercept * sy - slope * sty) / s0;
+    }
+    else {
+        const float mean = sy / s0;
+        var = syy / s0 - mean * mean;
+    }
+    const float wander = var > 0 ? std::sqrt(var) : 0;
+    return wander < MIN_WANDER ? MIN_WANDER : wander;
+}
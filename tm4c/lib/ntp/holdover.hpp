@@ -0,0 +1,109 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace ntp {
+    /**
+     * Holdover model for the disciplined oscillator.
+     * While locked, the PLL frequency correction (net of temperature compensation) is averaged into bins and fitted
+     * with an exponentially weighted linear regression to learn the oscillator aging rate and the wander of the
+     * correction about that trend. On loss of the reference the correction is frozen and extrapolated along the aging
+     * trend, and the accumulated time error is bounded by the offset at entry plus the integrated frequency uncertainty.
+     * A zero-initialized instance is valid.
+     */
+    class Holdover {
+        // frequency samples per regression bin (s)
+        static constexpr int BIN_SIZE = 64;
+        // regression time constant (bins)
+        static constexpr float REG_BINS = 1350.0f;
+        // minimum regression weight for an aging estimate (bins)
+        static constexpr float MIN_BINS = 256.0f;
+        // aging uncertainty assumed without an estimate (per second, 1 ppb/day)
+        static constexpr float AGING_PRIOR = 1e-9f / 86400.0f;
+        // minimum frequency wander (white FM floor of the correction)
+        static constexpr float MIN_WANDER = 1e-12f;
+        // frequency uncertainty relative to the wander (two standard deviations of the difference of two samples)
+        static constexpr float WANDER_SCALE = 2.83f;
+
+        // reference frequency for the regression (first bin mean)
+        float ref;
+        // current bin accumulator
+        float binSum;
+        int binCount;
+        // exponentially weighted regression sums (time in bins relative to the latest bin)
+        float s0, s1, s2, sy, sty, syy;
+        // holdover state
+        bool active;
+        uint32_t startTime;
+        float frequency;
+        float aging;
+        float phaseError;
+        float freqError;
+        float agingError;
+
+    public:
+        /**
+         * Discard the learned model and leave holdover
+         */
+        void reset();
+
+        /**
+         * Add a frequency correction sample while locked to the reference
+         * @param correction frequency correction net of temperature compensation (one sample per second)
+         */
+        void update(float correction);
+
+        /**
+         * Enter holdover
+         * @param now monotonic time (s)
+         * @param correction frequency correction in effect at entry (net of temperature compensation)
+         * @param offsetRms rms time error at entry (s)
+         */
+        void start(uint32_t now, float correction, float offsetRms);
+
+        /**
+         * Leave holdover
+         */
+        void stop() {
+            active = false;
+        }
+
+        /**
+         * Get the predicted frequency correction (net of temperature compensation)
+         * @param now monotonic time (s)
+         * @return predicted correction
+         */
+        [[nodiscard]] float getCorrection(uint32_t now) const;
+
+        /**
+         * Get the estimated accumulated time error
+         * @param now monotonic time (s)
+         * @return time error bound (s)
+         */
+        [[nodiscard]] float getError(uint32_t now) const;
+
+        /**
+         * Get the estimated aging rate
+         * @return fractional frequency change per second (zero without an estimate)
+         */
+        [[nodiscard]] float getAging() const;
+
+        /**
+         * Get the wander of the frequency correction about the aging trend
+         * @return rms frequency wander
+         */
+        [[nodiscard]] float getWander() const;
+
+        [[nodiscard]] bool isActive() const {
+            return active;
+        }
+
+        [[nodiscard]] uint32_t getStart() const {
+            return startTime;
+        }
+    };
+}
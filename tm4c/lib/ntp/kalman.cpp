@@ -0,0 +1,61 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "kalman.hpp"
+
+#include <cmath>
+
+void ntp::Kalman::reset() {
+    phase = 0;
+    freq = 0;
+    p00 = 0;
+    p01 = 0;
+    p11 = 0;
+    ready = false;
+}
+
+void ntp::Kalman::step(const float offset) {
+    phase -= offset;
+}
+
+void ntp::Kalman::update(const float interval, const float control, const float offset, const float stdDev) {
+    float var = stdDev * stdDev;
+    if (var < MIN_MEAS_VAR)
+        var = MIN_MEAS_VAR;
+
+    // initialize state from first measurement
+    if (!ready) {
+        phase = offset;
+        freq = control;
+        p00 = var;
+        p01 = 0;
+        p11 = INIT_FREQ_VAR;
+        ready = true;
+        return;
+    }
+
+    // predict state (phase advances by the uncorrected frequency error)
+    const float dt = interval;
+    phase += (freq - control) * dt;
+    p00 += dt * (2.0f * p01 + dt * p11) + NOISE_PHASE * dt + NOISE_FREQ * dt * dt * dt / 3.0f;
+    p01 += dt * p11 + NOISE_FREQ * dt * dt / 2.0f;
+    p11 += NOISE_FREQ * dt;
+
+    // measurement update
+    const float innov = offset - phase;
+    const float norm = 1.0f / (p00 + var);
+    const float k0 = p00 * norm;
+    const float k1 = p01 * norm;
+    phase += k0 * innov;
+    freq += k1 * innov;
+
+    // covariance update
+    p11 -= k1 * p01;
+    p01 -= k1 * p00;
+    p00 -= k0 * p00;
+}
+
+float ntp::Kalman::getPhaseStdDev() const {
+    return std::sqrt(p00);
+}
@@ -0,0 +1,80 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+namespace ntp {
+    /**
+     * Two-state (phase, frequency) Kalman filter for clock discipline.
+     * The phase state is the offset of the reference relative to the local clock in seconds,
+     * and the frequency state is the fractional frequency error of the free-running clock.
+     * A zero-initialized instance is valid and waits for its first measurement.
+     */
+    class Kalman {
+        // white frequency noise spectral density (s^2/s)
+        static constexpr float NOISE_PHASE = 1e-18f;
+        // random-walk frequency noise spectral density (1/s)
+        static constexpr float NOISE_FREQ = 1e-22f;
+        // initial frequency uncertainty (variance)
+        static constexpr float INIT_FREQ_VAR = 1e-10f;
+        // minimum measurement variance
+        static constexpr float MIN_MEAS_VAR = 1e-18f;
+
+        // state estimate
+        float phase;
+        float freq;
+        // state covariance
+        float p00;
+        float p01;
+        float p11;
+        // filter has been initialized
+        bool ready;
+
+    public:
+        /**
+         * Reset the filter to its initial state
+         */
+        void reset();
+
+        /**
+         * Apply a step correction to the local clock phase
+         * @param offset phase step applied to the local clock in seconds
+         */
+        void step(float offset);
+
+        /**
+         * Update the filter with a new offset measurement
+         * @param interval elapsed time since the previous update in seconds
+         * @param control frequency trim applied to the clock over the elapsed interval
+         * @param offset measured offset in seconds
+         * @param stdDev standard deviation of the measured offset in seconds
+         */
+        void update(float interval, float control, float offset, float stdDev);
+
+        /**
+         * Get the estimated phase offset
+         * @return estimated offset in seconds
+         */
+        [[nodiscard]]
+        float getPhase() const {
+            return phase;
+        }
+
+        /**
+         * Get the estimated frequency error of the free-running clock
+         * @return estimated frequency error
+         */
+        [[nodiscard]]
+        float getFrequency() const {
+            return freq;
+        }
+
+        /**
+         * Get the standard deviation of the phase estimate
+         * @return phase uncertainty in seconds
+         */
+        [[nodiscard]]
+        float getPhaseStdDev() const;
+    };
+}
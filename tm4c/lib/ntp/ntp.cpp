@@ -7,7 +7,9 @@
 #include "common.hpp"
 #include "GPS.hpp"
 #include "Peer.hpp"
+#include "PTP.hpp"
 #include "pll.hpp"
+#include "select.hpp"
 
 #include "../led.hpp"
 #include "../net.hpp"
@@ -16,15 +18,19 @@
 #include "../chrony/util.hpp"
 #include "../clock/comp.hpp"
 #include "../clock/tai.hpp"
+#include "../clock/util.hpp"
 #include "../net/dhcp.hpp"
 #include "../net/dns.hpp"
+#include "../net/ip.hpp"
 #include "../net/util.hpp"
 
+#include <cmath>
 #include <memory.h>
 #include <memory>
 
-#define MAX_NTP_PEERS (8)
-#define MAX_NTP_SRCS (9)
+#define MAX_NTP_PEERS_LAN (4)
+#define MAX_NTP_PEERS_WAN (6)
+#define MAX_NTP_SRCS (10)
 
 #define NTP_POOL_FQDN ("pool.ntp.org")
 
@@ -33,8 +39,12 @@ static constexpr uint32_t SRC_UPDT_INTV = RUN_SEC / 16; // 16 Hz
 
 // static allocation for GPS source
 static char rawGps[sizeof(ntp::GPS)] [[gnu::aligned(8)]];
-// static allocation for Peers
-static char rawPeers[sizeof(ntp::Peer) * MAX_NTP_PEERS] [[gnu::aligned(8)]];
+// static allocation for PTP source
+static char rawPtp[sizeof(ntp::PTP)] [[gnu::aligned(8)]];
+// static allocation for local area Peers
+static char rawPeersLan[sizeof(ntp::PeerLan) * MAX_NTP_PEERS_LAN] [[gnu::aligned(8)]];
+// static allocation for wide area Peers
+static char rawPeersWan[sizeof(ntp::PeerWan) * MAX_NTP_PEERS_WAN] [[gnu::aligned(8)]];
 // allocate new peer
 static ntp::Source* newPeer(uint32_t ipAddr);
 // deallocate peer
@@ -44,6 +54,7 @@ static ntp::Source *sources[MAX_NTP_SRCS];
 static ntp::Source *selectedSource = nullptr;
 static volatile uint32_t cntSources = 0;
 static volatile uint64_t lastUpdate = 0;
+static void *taskSelect;
 
 // aggregate NTP state
 static volatile int leapIndicator;
@@ -94,9 +105,12 @@ void ntp::init() {
     // initialize GPS reference and register it as a source
     auto srcGps = reinterpret_cast<ntp::GPS*>(rawGps);
     sources[cntSources++] = new(srcGps) ntp::GPS();
+    // initialize PTP slave and register it as a source
+    auto srcPtp = reinterpret_cast<ntp::PTP*>(rawPtp);
+    sources[cntSources++] = new(srcPtp) ntp::PTP();
 
     // update source selection at 16 Hz
-    runSleep(SRC_UPDT_INTV, runSelect, nullptr);
+    taskSelect = runSleep(SRC_UPDT_INTV, runSelect, nullptr);
     // fill empty slots every 16 seconds
     runSleep(DNS_UPDT_INTV, runDnsFill, nullptr);
 }
@@ -105,6 +119,11 @@ uint32_t ntp::refId() {
     return ::refId;
 }
 
+void ntp::requestSelect() {
+    if (taskSelect != nullptr)
+        runDelay(taskSelect, 0);
+}
+
 static void ntpTxCallback(void *ref, const uint8_t *frame, const int size) {
     // retrieve hardware transmit time
     uint64_t stamps[3];
@@ -249,22 +268,52 @@ static void runSelect(void *ref) {
         }
     }
 
-    // select best source
-    selectedSource = nullptr;
+    // gather selectable sources
+    ntp::Source *selectable[MAX_NTP_SRCS];
+    ntp::Source *reference = nullptr;
+    int count = 0;
     for (uint32_t i = 0; i < cntSources; i++) {
         if (!sources[i]->isSelectable())
             continue;
-        if (selectedSource == nullptr) {
-            selectedSource = sources[i];
-            continue;
-        }
-        if (sources[i]->getScore() < selectedSource->getScore()) {
-            selectedSource = sources[i];
-        }
+        if (reference == nullptr || sources[i]->getScore() < reference->getScore())
+            reference = sources[i];
+        selectable[count++] = sources[i];
+    }
+
+    // select and combine sources relative to the best scoring source
+    ntp::select::Candidate candidates[MAX_NTP_SRCS];
+    const auto refOffset = reference ? reference->getFilteredOffset() : 0;
+    for (int i = 0; i < count; i++) {
+        auto &cand = candidates[i];
+        cand.offset = toFloat(selectable[i]->getFilteredOffset() - refOffset);
+        cand.distance = selectable[i]->getDistance();
+        cand.jitter = selectable[i]->getJitter();
+        cand.prefer = selectable[i]->isReference();
+    }
+    float offset = 0, jitter = 0;
+    const int best = count ? ntp::select::run(candidates, count, offset, jitter) : -1;
+    for (int i = 0; i < count; i++) {
+        if (candidates[i].status == ntp::select::STATUS_FALSETICKER)
+            selectable[i]->reject(RPY_SD_ST_FALSETICKER);
+        else if (candidates[i].status == ntp::select::STATUS_OUTLIER)
+            selectable[i]->reject(RPY_SD_ST_UNSELECTED);
+    }
+
+    // coast on the holdover prediction until the reference returns or the time error budget is exhausted
+    selectedSource = nullptr;
+    if (
+        PLL_holdoverState() == PLL_HOLD_ACTIVE &&
+        (best < 0 || !selectable[best]->isReference() || selectable[best]->getLastUpdate() == lastUpdate)
+    ) {
+        refId = ntp::GPS::REF_ID;
+        clockStratum = 1;
+        rootDelay = 0;
+        rootDispersion = static_cast<uint32_t>(0x1p16f * PLL_holdoverError());
+        return;
     }
 
     // indicate complete loss of tracking
-    if (selectedSource == nullptr) {
+    if (best < 0) {
         refId = 0;
         clockStratum = 16;
         leapIndicator = 3;
@@ -274,39 +323,61 @@ static void runSelect(void *ref) {
     }
 
     // sanity check source and check for update
-    const auto source = selectedSource;
+    const auto source = selectable[best];
+    selectedSource = source;
     source->select();
     if (lastUpdate == source->getLastUpdate())
         return;
     lastUpdate = source->getLastUpdate();
 
+    // system jitter combines the jitter of the system peer with the selection jitter
+    const auto peerJitter = source->getJitter();
+    jitter = sqrtf(peerJitter * peerJitter + jitter * jitter);
+
     // set status
     refId = source->getId();
     clockStratum = source->getStratum() + 1;
     leapIndicator = source->getLeapIndicator();
     rootDelay = source->getRootDelay() + static_cast<uint32_t>(0x1p16f * source->getDelayMean());
-    rootDispersion = source->getRootDispersion() + static_cast<uint32_t>(0x1p16f * source->getDelayStdDev());
+    rootDispersion = source->getRootDispersion() + static_cast<uint32_t>(0x1p16f * (source->getDelayStdDev() + jitter));
 
-    // update offset compensation
-    PLL_updateOffset(source->getPollingInterval(), source->getFilteredOffset());
+    // update offset compensation using the combined offset
+    PLL_updateOffset(source->getPollingInterval(), refOffset + toFixedPoint(offset), jitter);
     // update frequency compensation
     PLL_updateDrift(source->getPollingInterval(), PLL_offsetCorr());
 }
 
-static ntp::Source* newPeer(const uint32_t ipAddr) {
-    const auto peerSlots = reinterpret_cast<ntp::Peer*>(rawPeers);
-    for (int i = 0; i < MAX_NTP_PEERS; i++) {
+template<typename T>
+static ntp::Source* newPeer(char *rawSlots, const int cntSlots, const uint32_t ipAddr) {
+    const auto peerSlots = reinterpret_cast<T*>(rawSlots);
+    for (int i = 0; i < cntSlots; i++) {
         const auto slot = peerSlots + i;
         if (slot->isAllocated())
             continue;
         // append to source list
-        sources[cntSources++] = new(slot) ntp::Peer(ipAddr);
+        sources[cntSources++] = new(slot) T(ipAddr);
         // return instance
         return slot;
     }
     return nullptr;
 }
 
+static ntp::Source* newPeer(const uint32_t ipAddr) {
+    // wide area timeservers require a deeper sample history (a full pool borrows a slot from the other pool)
+    ntp::Source *peer;
+    if (IPv4_testSubnet(ipSubnet, ipAddress, ipAddr)) {
+        peer = newPeer<ntp::PeerWan>(rawPeersWan, MAX_NTP_PEERS_WAN, ipAddr);
+        if (peer == nullptr)
+            peer = newPeer<ntp::PeerLan>(rawPeersLan, MAX_NTP_PEERS_LAN, ipAddr);
+    }
+    else {
+        peer = newPeer<ntp::PeerLan>(rawPeersLan, MAX_NTP_PEERS_LAN, ipAddr);
+        if (peer == nullptr)
+            peer = newPeer<ntp::PeerWan>(rawPeersWan, MAX_NTP_PEERS_WAN, ipAddr);
+    }
+    return peer;
+}
+
 static void deletePeer(ntp::Source *peer) {
     // deselect source if selected
     if (peer == selectedSource)
@@ -326,7 +397,11 @@ static void deletePeer(ntp::Source *peer) {
         sources[i] = sources[i + 1];
     sources[cntSources] = nullptr;
     // destroy  peer
-    reinterpret_cast<ntp::Peer*>(peer)->~Peer();
+    const auto addr = reinterpret_cast<char*>(peer);
+    if (addr >= rawPeersLan && addr < rawPeersLan + sizeof(rawPeersLan))
+        std::destroy_at(static_cast<ntp::PeerLan*>(peer));
+    else
+        std::destroy_at(static_cast<ntp::PeerWan*>(peer));
 }
 
 static void ntpDnsCallback(void *ref, const uint32_t addr) {
@@ -545,7 +620,7 @@ static uint16_t chronycTracking(CMD_Reply *cmdReply, const CMD_Request *cmdReque
     cmdReply->data.tracking.ref_id = refId;
     cmdReply->data.tracking.stratum = htons(clockStratum);
     cmdReply->data.tracking.leap_status = htons(leapIndicator);
-    if (refId == ntp::GPS::REF_ID) {
+    if (refId == ntp::GPS::REF_ID || refId == ntp::PTP::REF_ID) {
         cmdReply->data.tracking.ip_addr.family = htons(IPADDR_UNSPEC);
         cmdReply->data.tracking.ip_addr.addr.in4 = refId;
     }
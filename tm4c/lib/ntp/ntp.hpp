@@ -10,4 +10,9 @@ namespace ntp {
     void init();
 
     uint32_t refId();
+
+    /**
+     * Run source selection and clock update immediately (e.g. after a reference sample)
+     */
+    void requestSelect();
 }
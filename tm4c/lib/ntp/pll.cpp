@@ -4,9 +4,15 @@
 
 #include "pll.hpp"
 
+#include "allan.hpp"
+#include "holdover.hpp"
+#include "kalman.hpp"
 #include "tcmp.hpp"
 #include "../format.hpp"
+#include "../regression.hpp"
+#include "../store.hpp"
 #include "../clock/comp.hpp"
+#include "../clock/mono.hpp"
 #include "../clock/tai.hpp"
 
 #include <cmath>
@@ -16,16 +22,59 @@
 static constexpr float PLL_STATS_ALPHA = 0x1p-4f;
 // maximum allowed frequecny triming (250 ppm)
 static constexpr float PLL_MAX_FREQ_TRIM = 250e-6f;
-// offset hard alignment threshold (39.06 ms)
+// offset hard alignment threshold (3.906 ms)
 static constexpr int64_t PLL_OFFSET_HARD_ALIGN = 0x01000000ll;
+// hard alignment threshold allowance relative to the reference jitter
+static constexpr float PLL_HARD_ALIGN_JITTER = 8.0f;
 // unity rate threshold (1 ppm)
 static constexpr float PLL_OFFSET_CORR_BASIS = 1e-6f;
+// reference jitter at which the tracking rate is halved (30 us)
+static constexpr float PLL_JITTER_BASIS = 30e-6f;
 // rate ceiling (dampens oscillation)
 static constexpr float PLL_OFFSET_CORR_MAX = 0x1p-1f;
 // rate floor (dampens oscillation)
 static constexpr float PLL_OFFSET_CORR_MIN = 0x1p-3f;
 // integration rate relative to proportional coefficient
 static constexpr float PLL_OFFSET_INT_RATE = 0x1p-5f;
+// Kalman phase steering time constant relative to update interval
+static constexpr float PLL_KALMAN_STEER = 4.0f;
+// acquisition proportional rate
+static constexpr float PLL_ACQ_RATE = 0x1p-1f;
+// acquisition integration rate relative to proportional coefficient
+static constexpr float PLL_ACQ_INT_RATE = 0x1p-3f;
+// acquisition Kalman phase steering time constant relative to update interval
+static constexpr float PLL_ACQ_STEER = 1.0f;
+// lock threshold for offset rms (100 ns)
+static constexpr float PLL_LOCK_RMS = 100e-9f;
+// lock threshold for offset rms relative to the jitter of polled network references
+static constexpr float PLL_LOCK_JITTER = 2.0f;
+// minimum number of updates before lock is declared
+static constexpr int PLL_LOCK_COUNT = 16;
+// loop state save interval (seconds)
+static constexpr uint32_t PLL_SAVE_INTV = 3600;
+// maximum offset rms for saving loop state (1 us)
+static constexpr float PLL_SAVE_RMS = 1e-6f;
+// upper limit of a plausible restored TAI-UTC offset (seconds)
+static constexpr int32_t PLL_MAX_TAI_OFFSET = 100;
+
+#ifndef PLL_HOLDOVER_BUDGET
+// holdover time error budget (ns)
+#define PLL_HOLDOVER_BUDGET 10000
+#endif
+static constexpr float PLL_HOLD_BUDGET = 1e-9f * PLL_HOLDOVER_BUDGET;
+
+// persisted loop state
+struct PllState {
+    // PLL integral term
+    float integral;
+    // total frequency correction (TAI trim plus temperature compensation)
+    float frequency;
+    // compensated clock trim
+    int32_t compTrim;
+    // TAI-UTC offset (seconds)
+    int32_t taiOffset;
+};
+static constexpr int PLL_STATE_WORDS = sizeof(PllState) / sizeof(uint32_t);
 
 // offset statistics
 static volatile float offsetLast;
@@ -50,10 +99,89 @@ static volatile float offsetProportion;
 // PLL integral terms
 static volatile float offsetIntegral;
 
+#ifdef PLL_KALMAN
+// Kalman filter discipline state
+static ntp::Kalman kalman;
+#endif
+
+// oscillator model for holdover
+static ntp::Holdover holdover;
+static volatile bool holdoverExpired;
+
+// last loop state save
+static uint32_t stateSaved;
+// loop state was restored at boot
+static bool warmStart;
+
+// lock detection
+static volatile bool locked;
+static volatile uint32_t lockTime;
+static uint32_t acquireStart;
+static int acquireCount;
+
+// stability of the GPS PPS offset and the PLL phase
+static ntp::Allan allanPps;
+static ntp::Allan allanPll;
+static int allanInterval;
+
+// rounding residuals for compensated statistics
+static volatile float offsetMeanRes;
+static volatile float offsetVarRes;
+static volatile float offsetMSRes;
+static volatile float driftMeanRes;
+static volatile float driftVarRes;
+static volatile float driftMSRes;
+static volatile float offsetIntegralRes;
+
+/**
+ * Update a compensated exponential moving average
+ * @param value current average
+ * @param residual accumulated rounding error
+ * @param sample new sample
+ */
+static void updateAverage(volatile float &value, volatile float &residual, const float sample) {
+    regression::accumulate(value, residual, (sample - value) * PLL_STATS_ALPHA);
+}
+
 void PLL_init() {
+    // restore loop state from previous run
+    PllState state;
+    if (
+        store::load(store::ID_PLL, &state, PLL_STATE_WORDS) &&
+        fabsf(state.integral) < PLL_MAX_FREQ_TRIM
+    ) {
+        warmStart = true;
+        offsetIntegral = state.integral;
+        driftFreq = state.frequency;
+        clock::compensated::setTrim(state.compTrim);
+        // the proportional correction is transient, so the TAI trim resumes from the integral alone
+        clock::tai::setTrim(static_cast<int32_t>(0x1p32f * state.integral));
+        // keep the last known TAI-UTC offset until a reference reports it
+        if (state.taiOffset > 0 && state.taiOffset < PLL_MAX_TAI_OFFSET)
+            clkTaiUtcOffset = static_cast<uint64_t>(state.taiOffset) << 32;
+    }
+
     tcmp::init();
 }
 
+/**
+ * Update lock detection after an offset update
+ * @param interval log2 update interval of the reference
+ * @param stdDev jitter of the reference in seconds
+ */
+static void updateLock(const int interval, const float stdDev) {
+    if (locked)
+        return;
+    // polled network references settle no closer than their own jitter
+    // (the jitter of a 1 Hz reference is inflated while the clock slews during acquisition)
+    const float limit = interval > 0 ? fmaxf(PLL_LOCK_RMS, PLL_LOCK_JITTER * stdDev) : PLL_LOCK_RMS;
+    if (++acquireCount < PLL_LOCK_COUNT || offsetRms >= limit)
+        return;
+    // switch to tracking gains
+    locked = true;
+    lockTime = clock::monotonic::seconds() - acquireStart;
+}
+
 
 // from ntp.c
 void ntpApplyOffset(int64_t offset);
@@ -63,16 +191,40 @@ static void ntpSetTaiClock(const int64_t offset) {
     ntpApplyOffset(offset);
 }
 
-void PLL_updateOffset(const int interval, const int64_t offset) {
-    // apply hard correction to TAI clock for large offsets
-    if((offset > PLL_OFFSET_HARD_ALIGN) || (offset < -PLL_OFFSET_HARD_ALIGN)) {
+void PLL_updateOffset(const int interval, const int64_t offset, const float stdDev) {
+    // the reference has returned
+    holdover.stop();
+    holdoverExpired = false;
+
+    // apply hard correction to TAI clock for large offsets (beyond the jitter of the reference)
+    const int64_t hardAlign = PLL_OFFSET_HARD_ALIGN + static_cast<int64_t>(0x1p32f * PLL_HARD_ALIGN_JITTER * stdDev);
+    if((offset > hardAlign) || (offset < -hardAlign)) {
         ntpSetTaiClock(offset);
         offsetMS = 0;
+        // restart acquisition
+        if (locked) {
+            locked = false;
+            acquireStart = clock::monotonic::seconds();
+        }
+        acquireCount = 0;
+        allanPps.reset();
+        allanPll.reset();
+#ifdef PLL_KALMAN
+        kalman.step(0x1p-32f * static_cast<float>(offset));
+#endif
         return;
     }
 
     const float fltOffset = 0x1p-32f * static_cast<float>(static_cast<int32_t>(offset));
     offsetLast = fltOffset;
+
+    // update stability statistics (restart if the update interval changes)
+    if (interval != allanInterval) {
+        allanInterval = interval;
+        allanPll.reset();
+    }
+    allanPll.push(fltOffset);
+
     if(offsetMS == 0) {
         // initialize stats
         offsetMean = fltOffset;
@@ -80,49 +232,131 @@ void PLL_updateOffset(const int interval, const int64_t offset) {
         offsetMS = offsetVar;
         offsetRms = fabsf(fltOffset);
         offsetStdDev = fabsf(fltOffset);
+        offsetMeanRes = 0;
+        offsetVarRes = 0;
+        offsetMSRes = 0;
     } else {
         // update stats
         float diff = fltOffset - offsetMean;
-        offsetVar += ((diff * diff) - offsetVar) * PLL_STATS_ALPHA;
-        offsetMS += ((fltOffset * fltOffset) - offsetMS) * PLL_STATS_ALPHA;
-        offsetMean += diff * PLL_STATS_ALPHA;
+        updateAverage(offsetVar, offsetVarRes, diff * diff);
+        updateAverage(offsetMS, offsetMSRes, fltOffset * fltOffset);
+        updateAverage(offsetMean, offsetMeanRes, fltOffset);
         offsetStdDev = sqrtf(offsetVar);
         offsetRms = sqrtf(offsetMS);
     }
 
-    // compute proportional rate
-    float rate = offsetRms / PLL_OFFSET_CORR_BASIS;
+#ifdef PLL_KALMAN
+    // update state estimate using the total trim (temperature and TAI) applied over the previous interval
+    const float dt = ldexpf(1.0f, interval);
+    const float comp = 0x1p-32f * static_cast<float>(clock::compensated::getTrim());
+    const float control = comp + 0x1p-32f * static_cast<float>(clock::tai::getTrim());
+    kalman.update(dt, control, fltOffset, stdDev);
+    // steer out the phase estimate on top of the frequency estimate (net of temperature compensation)
+    const float steer = locked ? PLL_KALMAN_STEER : PLL_ACQ_STEER;
+    offsetProportion = kalman.getPhase() / (steer * dt);
+    offsetIntegral = kalman.getFrequency() - comp;
+#else
+    // compute proportional rate (accelerated during acquisition)
+    float rate = locked ? offsetRms / PLL_OFFSET_CORR_BASIS : PLL_ACQ_RATE;
     // limit proportional rate
     if(rate > PLL_OFFSET_CORR_MAX) rate = PLL_OFFSET_CORR_MAX;
     if(rate < PLL_OFFSET_CORR_MIN) rate = PLL_OFFSET_CORR_MIN;
+    // average out the jitter of noisy references while locked
+    if (locked)
+        rate *= PLL_JITTER_BASIS / (PLL_JITTER_BASIS + stdDev);
     // adjust rate to match polling interval
     rate *= 0x1p-16f * static_cast<float>(1u << (16 - interval));
     // update offset compensation
     offsetProportion = fltOffset * rate;
-    offsetIntegral += offsetProportion * PLL_OFFSET_INT_RATE;
+    const float intRate = locked ? PLL_OFFSET_INT_RATE : PLL_ACQ_INT_RATE;
+    regression::accumulate(offsetIntegral, offsetIntegralRes, offsetProportion * intRate);
     // limit integration range
-    if(offsetIntegral >  PLL_MAX_FREQ_TRIM) offsetIntegral =  PLL_MAX_FREQ_TRIM;
-    if(offsetIntegral < -PLL_MAX_FREQ_TRIM) offsetIntegral = -PLL_MAX_FREQ_TRIM;
+    if(offsetIntegral >  PLL_MAX_FREQ_TRIM) {
+        offsetIntegral =  PLL_MAX_FREQ_TRIM;
+        offsetIntegralRes = 0;
+    }
+    if(offsetIntegral < -PLL_MAX_FREQ_TRIM) {
+        offsetIntegral = -PLL_MAX_FREQ_TRIM;
+        offsetIntegralRes = 0;
+    }
+#endif
     // limit correction range
     float trim = offsetProportion + offsetIntegral;
     if(trim >  PLL_MAX_FREQ_TRIM) trim =  PLL_MAX_FREQ_TRIM;
     if(trim < -PLL_MAX_FREQ_TRIM) trim = -PLL_MAX_FREQ_TRIM;
     clock::tai::setTrim(static_cast<int32_t>(0x1p32f * trim));
+
+    updateLock(interval, stdDev);
+}
+
+PllHoldover PLL_holdover() {
+    const uint32_t now = clock::monotonic::seconds();
+    if (!holdover.isActive()) {
+        // holdover requires a model learned while locked
+        if (!locked)
+            return PLL_HOLD_NONE;
+        // freeze the integral and drop the proportional correction
+        holdover.start(now, offsetIntegral, offsetRms);
+        offsetProportion = 0;
+    }
+
+    // extrapolate the frequency correction along the aging trend
+    float trim = holdover.getCorrection(now);
+    if(trim >  PLL_MAX_FREQ_TRIM) trim =  PLL_MAX_FREQ_TRIM;
+    if(trim < -PLL_MAX_FREQ_TRIM) trim = -PLL_MAX_FREQ_TRIM;
+    clock::tai::setTrim(static_cast<int32_t>(0x1p32f * trim));
+
+    // check the time error budget
+    if (holdover.getError(now) > PLL_HOLD_BUDGET)
+        holdoverExpired = true;
+    return PLL_holdoverState();
+}
+
+PllHoldover PLL_holdoverState() {
+    if (!holdover.isActive())
+        return PLL_HOLD_NONE;
+    return holdoverExpired ? PLL_HOLD_EXPIRED : PLL_HOLD_ACTIVE;
+}
+
+float PLL_holdoverError() {
+    if (!holdover.isActive())
+        return 0;
+    return holdover.getError(clock::monotonic::seconds());
+}
+
+void PLL_updatePps(const float offset) {
+    allanPps.push(offset);
 }
 
 void PLL_updateDrift(int interval, const float drift) {
     // update stats
     driftLast = drift;
     const float diff = drift - driftMean;
-    driftVar += ((diff * diff) - driftVar) * PLL_STATS_ALPHA;
-    driftMS += ((drift * drift) - driftMS) * PLL_STATS_ALPHA;
-    driftMean += diff * PLL_STATS_ALPHA;
+    updateAverage(driftVar, driftVarRes, diff * diff);
+    updateAverage(driftMS, driftMSRes, drift * drift);
+    updateAverage(driftMean, driftMeanRes, drift);
     driftStdDev = sqrtf(driftVar);
     driftRms = sqrtf(driftMS);
 
     // update temperature compensation
     driftFreq = drift + (0x1p-32f * static_cast<float>(clock::compensated::getTrim()));
     tcmp::update(driftFreq, 100e-9f / (100e-9f + driftStdDev + fabsf(diff)));
+
+    // learn the holdover model from the GPS reference (one update per second)
+    if (locked && interval == 0)
+        holdover.update(offsetIntegral);
+
+    // persist loop state while locked
+    const uint32_t now = clock::monotonic::seconds();
+    if (locked && now - stateSaved > PLL_SAVE_INTV && offsetRms < PLL_SAVE_RMS) {
+        stateSaved = now;
+        PllState state = {};
+        state.integral = offsetIntegral;
+        state.frequency = driftFreq;
+        state.compTrim = clock::compensated::getTrim();
+        state.taiOffset = static_cast<int32_t>(clkTaiUtcOffset >> 32);
+        store::save(store::ID_PLL, &state, PLL_STATE_WORDS);
+    }
 }
 
 unsigned PLL_status(char *buffer) {
@@ -154,7 +388,19 @@ unsigned PLL_status(char *buffer) {
     tmp[fmtFloat(offsetIntegral * 1e6f, 12, 4, tmp)] = 0;
     end = append(end, "  - pll i: ");
     end = append(end, tmp);
-    end = append(end, " ppm\n\n");
+    end = append(end, " ppm\n");
+
+    end = append(end, "  - start: ");
+    end = append(end, warmStart ? "warm\n" : "cold\n");
+
+    end = append(end, "  - lock:  ");
+    if (locked) {
+        tmp[toBase(lockTime, 10, tmp)] = 0;
+        end = append(end, tmp);
+        end = append(end, " s\n\n");
+    }
+    else
+        end = append(end, "acquiring\n\n");
 
 
     end = append(end, "drift status:\n");
@@ -174,11 +420,95 @@ unsigned PLL_status(char *buffer) {
     end = append(end, tmp);
     end = append(end, " ppm\n\n");
 
+
+    end = append(end, "holdover status:\n");
+
+    static constexpr const char *holdStates[] = {"tracking\n", "active\n", "expired\n"};
+    end = append(end, "  - state:  ");
+    end = append(end, holdStates[PLL_holdoverState()]);
+
+    if (holdover.isActive()) {
+        tmp[toBase(clock::monotonic::seconds() - holdover.getStart(), 10, tmp)] = 0;
+        end = append(end, "  - time:   ");
+        end = append(end, tmp);
+        end = append(end, " s\n");
+    }
+
+    tmp[fmtFloat(PLL_holdoverError() * 1e6f, 12, 4, tmp)] = 0;
+    end = append(end, "  - error:  ");
+    end = append(end, tmp);
+    end = append(end, " us\n");
+
+    tmp[fmtFloat(PLL_HOLD_BUDGET * 1e6f, 12, 4, tmp)] = 0;
+    end = append(end, "  - budget: ");
+    end = append(end, tmp);
+    end = append(end, " us\n");
+
+    tmp[fmtFloat(holdover.getAging() * 86400e9f, 12, 4, tmp)] = 0;
+    end = append(end, "  - aging:  ");
+    end = append(end, tmp);
+    end = append(end, " ppb/day\n");
+
+    tmp[fmtFloat(holdover.getWander() * 1e9f, 12, 4, tmp)] = 0;
+    end = append(end, "  - wander: ");
+    end = append(end, tmp);
+    end = append(end, " ppb\n\n");
+
     end += tcmp::status(end);
 
     return end - buffer;
 }
 
+/**
+ * Write a stability table to a string buffer
+ * @param end string buffer
+ * @param title table title
+ * @param allan stability estimator
+ * @param interval sample interval in log2 seconds
+ * @return pointer to immediately after last character written
+ */
+static char* stabilityTable(char *end, const char *title, const ntp::Allan &allan, const int interval) {
+    char tmp[32];
+
+    end = append(end, title);
+    end = append(end, "\n      tau adev (1e-12)  tdev (ns)\n");
+    const float sampleInterval = ldexpf(1.0f, interval);
+    for (int level = 0; level < ntp::Allan::LEVELS; ++level) {
+        if (allan.terms(level) == 0)
+            break;
+        end = append(end, "  ");
+        end += toDec(1u << (level + interval), 7, ' ', end);
+        tmp[fmtFloat(allan.adev(level, sampleInterval) * 1e12f, 13, 3, tmp)] = 0;
+        end = append(end, tmp);
+        tmp[fmtFloat(allan.tdev(level) * 1e9f, 11, 3, tmp)] = 0;
+        end = append(end, tmp);
+        *end++ = '\n';
+    }
+    return end;
+}
+
+unsigned PLL_stability(char *buffer) {
+    char *end = buffer;
+    end = stabilityTable(end, "pps stability:", allanPps, 0);
+    *end++ = '\n';
+    end = stabilityTable(end, "pll stability:", allanPll, allanInterval);
+    return end - buffer;
+}
+
+float PLL_adev(const int tau) {
+    const int level = tau - allanInterval;
+    if (level < 0 || level >= ntp::Allan::LEVELS)
+        return 0;
+    return allanPll.adev(level, ldexpf(1.0f, allanInterval));
+}
+
+float PLL_tdev(const int tau) {
+    const int level = tau - allanInterval;
+    if (level < 0 || level >= ntp::Allan::LEVELS)
+        return 0;
+    return allanPll.tdev(level);
+}
+
 // offset stats
 float PLL_offsetLast() { return offsetLast; }
 float PLL_offsetMean() { return offsetMean; }
@@ -188,6 +518,11 @@ float PLL_offsetProp() { return offsetProportion; }
 float PLL_offsetInt() { return offsetIntegral; }
 float PLL_offsetCorr() { return 0x1p-32f * static_cast<float>(clock::tai::getTrim()); }
 
+// lock stats
+bool PLL_locked() { return locked; }
+bool PLL_warmStart() { return warmStart; }
+int PLL_lockTime() { return locked ? static_cast<int>(lockTime) : -1; }
+
 // drift stats
 float PLL_driftLast() { return driftLast; }
 float PLL_driftMean() { return driftMean; }
@@ -6,15 +6,30 @@
 
 #include <cstdint>
 
+/**
+ * Holdover state of the clock discipline
+ */
+enum PllHoldover {
+    // tracking a reference (or never locked)
+    PLL_HOLD_NONE,
+    // coasting on the oscillator model within the time error budget
+    PLL_HOLD_ACTIVE,
+    // coasting on the oscillator model beyond the time error budget
+    PLL_HOLD_EXPIRED
+};
 
+/**
+ * Initialize the PLL and temperature compensation, restoring loop state saved by a previous run if available.
+ */
 void PLL_init();
 
 /**
  * Update the TAI offset correction PLL.
  * @param interval the current update interval in log2 seconds
  * @param offset the most recent offset sample
+ * @param stdDev the standard deviation of the offset sample in seconds
  */
-void PLL_updateOffset(int interval, int64_t offset);
+void PLL_updateOffset(int interval, int64_t offset, float stdDev);
 
 /**
  * Update the frequency drift correction PLL.
@@ -23,6 +38,32 @@ void PLL_updateOffset(int interval, int64_t offset);
  */
 void PLL_updateDrift(int interval, float drift);
 
+/**
+ * Enter or continue holdover after a missed GPS PPS edge.
+ * The PLL integral is frozen and extrapolated along the learned aging trend while temperature compensation continues.
+ * Holdover ends with the next call to PLL_updateOffset().
+ * @return the holdover state
+ */
+PllHoldover PLL_holdover();
+
+/**
+ * Get the holdover state
+ * @return the holdover state
+ */
+PllHoldover PLL_holdoverState();
+
+/**
+ * Get the estimated accumulated time error while in holdover.
+ * @return time error bound in seconds (zero when not in holdover)
+ */
+float PLL_holdoverError();
+
+/**
+ * Update the GPS PPS stability statistics.
+ * @param offset the most recent GPS PPS offset in seconds (one sample per second)
+ */
+void PLL_updatePps(float offset);
+
 /**
  * Write human readable status to buffer
  * @param buffer destination
@@ -30,6 +71,22 @@ void PLL_updateDrift(int interval, float drift);
  */
 unsigned PLL_status(char *buffer);
 
+/**
+ * Write human readable stability (Allan and time deviation) tables to buffer
+ * @param buffer destination
+ * @return number of bytes written
+ */
+unsigned PLL_stability(char *buffer);
+
+// lock stats
+bool PLL_locked();
+bool PLL_warmStart();
+int PLL_lockTime();
+
+// stability stats
+float PLL_adev(int tau);
+float PLL_tdev(int tau);
+
 // offset stats
 float PLL_offsetLast();
 float PLL_offsetMean();
@@ -0,0 +1,177 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "select.hpp"
+
+#include <cmath>
+
+struct Edge {
+    float value;
+    int type;
+};
+
+/**
+ * Find the intersection of the majority clique of correctness intervals
+ * @param candidates selection candidates
+ * @param count number of candidates
+ * @param low lower bound of the intersection
+ * @param high upper bound of the intersection
+ * @return true if a majority clique exists
+ */
+static bool intersect(const ntp::select::Candidate *candidates, const int count, float &low, float &high) {
+    // build sorted edge list (lower edge, midpoint, upper edge)
+    Edge edges[3 * ntp::select::MAX_CANDIDATES];
+    int cnt = 0;
+    for (int i = 0; i < count; ++i) {
+        const auto &cand = candidates[i];
+        const Edge add[3] = {
+            {cand.offset - cand.distance, -1},
+            {cand.offset, 0},
+            {cand.offset + cand.distance, 1}
+        };
+        for (const auto &edge : add) {
+            int j = cnt++;
+            while (j > 0 && (
+                edges[j - 1].value > edge.value ||
+                (edges[j - 1].value == edge.value && edges[j - 1].type > edge.type)
+            )) {
+                edges[j] = edges[j - 1];
+                --j;
+            }
+            edges[j] = edge;
+        }
+    }
+
+    // allow an increasing number of falsetickers until a majority clique is found
+    for (int allow = 0; 2 * allow < count; ++allow) {
+        int depth = 0, found = 0;
+        for (int i = 0; i < cnt; ++i) {
+            depth -= edges[i].type;
+            low = edges[i].value;
+            if (depth >= count - allow)
+                break;
+            if (edges[i].type == 0)
+                ++found;
+        }
+        depth = 0;
+        for (int i = cnt - 1; i >= 0; --i) {
+            depth += edges[i].type;
+            high = edges[i].value;
+            if (depth >= count - allow)
+                break;
+            if (edges[i].type == 0)
+                ++found;
+        }
+        if (found <= allow && low < high)
+            return true;
+    }
+    return false;
+}
+
+int ntp::select::run(Candidate *candidates, int count, float &offset, float &jitter) {
+    if (count > MAX_CANDIDATES)
+        count = MAX_CANDIDATES;
+
+    // identify truechimers
+    float low, high;
+    const bool clique = intersect(candidates, count, low, high);
+    int survivors = 0;
+    for (int i = 0; i < count; ++i) {
+        auto &cand = candidates[i];
+        cand.status = STATUS_FALSETICKER;
+        if (
+            cand.prefer || (
+                clique &&
+                cand.offset + cand.distance >= low &&
+                cand.offset - cand.distance <= high
+            )
+        ) {
+            cand.status = STATUS_SURVIVOR;
+            ++survivors;
+        }
+    }
+    if (survivors == 0)
+        return -1;
+
+    // discard outliers with the largest selection jitter
+    while (survivors > MIN_SURVIVORS) {
+        int worst = -1;
+        float maxJitter = 0, minJitter = INFINITY;
+        for (int i = 0; i < count; ++i) {
+            const auto &cand = candidates[i];
+            if (cand.status != STATUS_SURVIVOR)
+                continue;
+            if (cand.jitter < minJitter)
+                minJitter = cand.jitter;
+            // never discard a preferred source
+            if (cand.prefer)
+                continue;
+            // selection jitter weighted by the distance of the other survivors
+            float sel = 0, norm = 0;
+            for (int j = 0; j < count; ++j) {
+                if (j == i || candidates[j].status != STATUS_SURVIVOR)
+                    continue;
+                const float diff = candidates[j].offset - cand.offset;
+                const float weight = 1.0f / (candidates[j].distance * candidates[j].distance);
+                sel += weight * diff * diff;
+                norm += weight;
+            }
+            sel = std::sqrt(sel / norm);
+            if (sel > maxJitter) {
+                maxJitter = sel;
+                worst = i;
+            }
+        }
+        if (worst < 0 || maxJitter <= minJitter)
+            break;
+        candidates[worst].status = STATUS_OUTLIER;
+        --survivors;
+    }
+
+    // select system peer (preferred sources take precedence, then lowest distance)
+    int best = -1;
+    for (int i = 0; i < count; ++i) {
+        const auto &cand = candidates[i];
+        if (cand.status != STATUS_SURVIVOR)
+            continue;
+        if (
+            best < 0 ||
+            (cand.prefer && !candidates[best].prefer) ||
+            (cand.prefer == candidates[best].prefer && cand.distance < candidates[best].distance)
+        )
+            best = i;
+    }
+
+    // preferred source is used exclusively (no selection jitter)
+    if (candidates[best].prefer) {
+        offset = candidates[best].offset;
+        jitter = 0;
+        return best;
+    }
+
+    // combine survivors
+    float norm = 0, mean = 0;
+    for (int i = 0; i < count; ++i) {
+        const auto &cand = candidates[i];
+        if (cand.status != STATUS_SURVIVOR)
+            continue;
+        const float weight = 1.0f / (cand.distance * cand.distance);
+        norm += weight;
+        mean += weight * cand.offset;
+    }
+    mean /= norm;
+
+    float var = 0;
+    for (int i = 0; i < count; ++i) {
+        const auto &cand = candidates[i];
+        if (cand.status != STATUS_SURVIVOR)
+            continue;
+        const float diff = cand.offset - mean;
+        var += diff * diff / (cand.distance * cand.distance);
+    }
+
+    offset = mean;
+    jitter = std::sqrt(var / norm);
+    return best;
+}
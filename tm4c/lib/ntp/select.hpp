@@ -0,0 +1,47 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace ntp::select {
+    // maximum number of selection candidates
+    static constexpr int MAX_CANDIDATES = 16;
+    // minimum number of sources retained by clustering
+    static constexpr int MIN_SURVIVORS = 3;
+
+    // candidate interval does not intersect the majority clique
+    static constexpr uint8_t STATUS_FALSETICKER = 0;
+    // candidate was discarded by clustering
+    static constexpr uint8_t STATUS_OUTLIER = 1;
+    // candidate contributes to the combined offset
+    static constexpr uint8_t STATUS_SURVIVOR = 2;
+
+    struct Candidate {
+        // clock offset relative to a common reference (seconds)
+        float offset;
+        // root distance (seconds)
+        float distance;
+        // offset jitter (seconds)
+        float jitter;
+        // preferred source (always treated as a truechimer)
+        bool prefer;
+        // selection result
+        uint8_t status;
+    };
+
+    /**
+     * Run the RFC 5905 selection pipeline over a set of candidates.
+     * Correctness intervals (offset +/- distance) are intersected to find the majority clique,
+     * the truechimers are clustered to discard outliers, and the survivors are combined using
+     * inverse-square distance weights. A preferred survivor takes precedence over the combination.
+     * @param candidates selection candidates (status is updated)
+     * @param count number of candidates (at most MAX_CANDIDATES)
+     * @param offset combined offset of the survivors
+     * @param jitter selection jitter of the survivors (zero if a preferred source is used exclusively)
+     * @return index of the system peer or -1 if no majority clique exists
+     */
+    int run(Candidate *candidates, int count, float &offset, float &jitter);
+}
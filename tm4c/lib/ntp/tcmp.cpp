@@ -3,10 +3,13 @@
 //
 
 #include "tcmp.hpp"
+#include "tmodel.hpp"
 
 #include "../delay.hpp"
 #include "../format.hpp"
+#include "../regression.hpp"
 #include "../run.hpp"
+#include "../store.hpp"
 #include "../../hw/adc.h"
 #include "../../hw/eeprom.h"
 #include "../clock/capture.hpp"
@@ -15,29 +18,27 @@
 
 #include <cmath>
 
-#define INTV_REGR (1u << (24 - 14)) // 16384 Hz
-
 #define TCMP_SAVE_INTV (3600) // save state every hour
 
-#define SOM_EEPROM_BASE (0x0020)
+#define SOM_EEPROM_BASE (0x0020) // legacy location (migrated to record store)
 #define SOM_NODE_DIM (3)
 #define SOM_NODE_CNT (16)
-#define SOM_FILL_OFF (0.2f)
-#define SOM_FILL_REG (4.0f)
+#define SOM_WORDS (SOM_NODE_CNT * SOM_NODE_DIM)
 #define SOM_RATE (0x1p-12f)
+#define SOM_PRIOR (16.0f) // equivalent samples per SOM node weight (zero disables prior)
 
-#define REG_DIM_COEF (3)
+#define REG_MIN_FILL (64.0f)
 #define REG_MIN_RMSE (250e-9f)
+#define REG_RESTORE_RMSE (25e-9f) // live fit quality required to replace a restored polynomial
+
+// persisted polynomial (reference point, coefficients, fill and rmse)
+#define TCMP_WORDS (ntp::TempModel::DIM + 4)
 
 
-// sample ring size
-static constexpr int RING_SIZE = 256;
-// sample ring mask
-static constexpr int RING_MASK = RING_SIZE - 1;
-// ring position
-static int ringPos = 0;
-// ring buffer
-static float tempRing[RING_SIZE];
+// temperature regression window size
+static constexpr int WINDOW_SIZE = 256;
+// temperature regression window
+static regression::Window<WINDOW_SIZE> tempWindow;
 static volatile float tempValue;
 static volatile float tempNoise;
 static int initCounter;
@@ -45,91 +46,55 @@ static int initCounter;
 static volatile uint32_t tcmpSaved;
 static volatile float tcmpValue;
 
-static volatile float tcmpMean[SOM_NODE_DIM];
-static volatile float tcmpCoeff[REG_DIM_COEF];
+// published compensation polynomial
+static volatile float tcmpRef[2];
+static volatile float tcmpCoeff[ntp::TempModel::DIM];
+static volatile float tcmpFill;
 static volatile float tcmpRmse;
 
+// temperature compensation model
+static ntp::TempModel model;
+static float priorFill;
+// polynomial restored from previous run
+static bool restored;
+
 // SOM filter for compensation samples
 static float somNode[SOM_NODE_CNT][SOM_NODE_DIM];
 static float somResidual[SOM_NODE_CNT][SOM_NODE_DIM];
 static float somNW[SOM_NODE_CNT];
 
-// regression step counter
-static uint32_t regressionStep = 0;
-
 static void loadSom();
 static void saveSom();
 static void seedSom(float temp, float comp);
 static void updateSom(float temp, float comp, float alpha);
-static void runRegression(void *ref);
-
-static void computeMean(const float *data);
-static void fitQuadratic(const float *data);
-static void computeMSE(const float *data);
+static void updatePrior();
+static void publishModel();
+static void restoreModel();
 
 /**
- * Estimate temperature correction using quadratic regressor
+ * Estimate temperature correction using the published polynomial
  * @param temp current temperature in Celsius
  * @return estimated correction value
  */
 static float tcmpEstimate(float temp);
 
-// update mean and standard deviation
-static void runTemperature([[maybe_unused]] void *ref) {
-    // update temperature measurement
-    const auto temp = clock::capture::temperature();
-    const auto head = (ringPos + 1) & RING_MASK;
-    tempRing[head] = temp;
-    ringPos = head;
-}
-
 /**
  * Update the current temperature compensation value.
  * @param ref unused context argument
  */
-static void runCompensation(void *ref) {
-    // wait for ring to fill with valid data
-    if (initCounter < 68) {
+static void runCompensation([[maybe_unused]] void *ref) {
+    // update temperature measurement
+    tempWindow.push(clock::capture::temperature());
+
+    // wait for window to fill with valid data
+    if (initCounter < WINDOW_SIZE + 16) {
         ++initCounter;
         return;
     }
 
-    // constant terms
-    static constexpr auto cc = static_cast<float>(RING_SIZE);
-    static constexpr auto xc_ = 0.5f * cc * (cc - 1.0f);
-    static constexpr auto xx_ = 2.0f * (cc - 0.5f) * xc_ / 3.0f;
-    static constexpr auto xc = xc_ / cc;
-    static constexpr auto xx = xx_ / cc;
-
-    // dynamic terms
-    float yc = 0, yx = 0;
-    const auto head = ringPos;
-    for (int i = 0; i < RING_SIZE; ++i) {
-        const auto x = static_cast<float>(i);
-        const auto y = tempRing[(head - i) & RING_MASK];
-        yc += y;
-        yx += y * x;
-    }
-    yc /= cc;
-    yx /= cc;
-
-    // compute offset and slope
-    const auto slope = (yx - yc * xc) / (xx - xc * xc);
-    const auto offset = yc - xc * slope;
-
-    // compute mean-squared error
-    float mse = 0;
-    for (int i = 0; i < RING_SIZE; ++i) {
-        const auto x = static_cast<float>(i);
-        const auto y = tempRing[(head - i) & RING_MASK];
-        const float error = y - offset - x * slope;
-        mse += error * error;
-    }
-    mse /= cc;
-
-    // compute variance
-    const auto slopeVariance = mse / (xx - xc * xc);
-    const auto offsetVariance = slopeVariance * xx;
+    // fit temperature trend
+    float offset, slope, offsetVariance, slopeVariance;
+    tempWindow.fit(offset, slope, offsetVariance, slopeVariance);
 
     // update temperature compensation
     const auto trim = static_cast<int32_t>(0x1p32f * tcmpEstimate(offset));
@@ -142,12 +107,23 @@ static void runCompensation(void *ref) {
 
 void tcmp::init() {
     loadSom();
-    if (std::isfinite(somNode[0][0]))
-        runSleep(INTV_REGR, runRegression, nullptr);
+    // restore compensation from the SOM prior
+    updatePrior();
+    publishModel();
+    // prefer the polynomial published by the previous run
+    restoreModel();
+
+    // seed compensation immediately rather than waiting for the temperature window
+    if (restored || tcmpFill >= REG_MIN_FILL) {
+        const float temp = clock::capture::temperature();
+        const auto trim = static_cast<int32_t>(0x1p32f * tcmpEstimate(temp));
+        clock::compensated::setTrim(trim);
+        tcmpValue = 0x1p-32f * static_cast<float>(trim);
+        tempValue = temp;
+    }
 
     // schedule tasks
-    runPeriodic(RUN_SEC / 16, runTemperature, nullptr);
-    runPeriodic(RUN_SEC / 4, runCompensation, nullptr);
+    runPeriodic(RUN_SEC / 16, runCompensation, nullptr);
 }
 
 float tcmp::temp() {
@@ -165,16 +141,11 @@ void tcmp::update(const float target, const float weight) {
     if (now - tcmpSaved > TCMP_SAVE_INTV) {
         tcmpSaved = now;
         saveSom();
+        updatePrior();
     }
 
-    if (regressionStep == 0) {
-        // start regression computation
-        runSleep(INTV_REGR, runRegression, nullptr);
-    }
-    else {
-        // re-start regression computation
-        regressionStep = 0;
-    }
+    model.update(tempValue, target, weight);
+    publishModel();
 }
 
 unsigned tcmp::status(char *buffer) {
@@ -193,7 +164,7 @@ unsigned tcmp::status(char *buffer) {
     end = append(end, tmp);
     end = append(end, " C\n");
 
-    tmp[fmtFloat(tcmpMean[2], 12, 4, tmp)] = 0;
+    tmp[fmtFloat(tcmpFill, 12, 4, tmp)] = 0;
     end = append(end, "  - fill:    ");
     end = append(end, tmp);
     end = append(end, "\n");
@@ -203,30 +174,25 @@ unsigned tcmp::status(char *buffer) {
     end = append(end, tmp);
     end = append(end, " ppm\n");
 
-    tmp[fmtFloat(tcmpMean[0], 12, 4, tmp)] = 0;
-    end = append(end, "  - mean[0]: ");
+    tmp[fmtFloat(tcmpRef[0], 12, 4, tmp)] = 0;
+    end = append(end, "  - ref[0]:  ");
     end = append(end, tmp);
     end = append(end, " C\n");
 
-    tmp[fmtFloat(tcmpMean[1] * 1e6f, 12, 4, tmp)] = 0;
-    end = append(end, "  - mean[1]: ");
+    tmp[fmtFloat(tcmpRef[1] * 1e6f, 12, 4, tmp)] = 0;
+    end = append(end, "  - ref[1]:  ");
     end = append(end, tmp);
     end = append(end, " ppm\n");
 
-    tmp[fmtFloat(tcmpCoeff[0] * 1e6f, 12, 4, tmp)] = 0;
-    end = append(end, "  - coef[0]: ");
-    end = append(end, tmp);
-    end = append(end, " ppm\n");
-
-    tmp[fmtFloat(tcmpCoeff[1] * 1e6f, 12, 4, tmp)] = 0;
-    end = append(end, "  - coef[1]: ");
-    end = append(end, tmp);
-    end = append(end, " ppm/C\n");
-
-    tmp[fmtFloat(tcmpCoeff[2] * 1e6f, 12, 4, tmp)] = 0;
-    end = append(end, "  - coef[2]: ");
-    end = append(end, tmp);
-    end = append(end, " ppm/C^2\n");
+    static constexpr const char *coefUnits[] = {" ppm\n", " ppm/C\n", " ppm/C^2\n", " ppm/C^3\n"};
+    for (int i = 0; i < ntp::TempModel::DIM; i++) {
+        tmp[fmtFloat(tcmpCoeff[i] * 1e6f, 12, 4, tmp)] = 0;
+        end = append(end, "  - coef[");
+        *end++ = static_cast<char>('0' + i);
+        end = append(end, "]: ");
+        end = append(end, tmp);
+        end = append(end, coefUnits[i]);
+    }
 
     tmp[fmtFloat(tcmpValue * 1e6f, 12, 4, tmp)] = 0;
     end = append(end, "  - curr:    ");
@@ -241,23 +207,31 @@ static void loadSom() {
     for (int i = 0; i < SOM_NODE_CNT; i++)
         somNW[i] = std::exp(-2.0f * static_cast<float>(i * i));
 
-    auto ptr = reinterpret_cast<uint32_t*>(somNode);
-    const auto end = ptr + (sizeof(somNode) / sizeof(uint32_t));
-
     // load SOM data
+    if (store::load(store::ID_SOM, somNode, SOM_WORDS))
+        return;
+
+    // migrate SOM data from legacy location
+    auto ptr = reinterpret_cast<uint32_t*>(somNode);
+    const auto end = ptr + SOM_WORDS;
     EEPROM_seek(SOM_EEPROM_BASE);
     while (ptr < end)
         *ptr++ = EEPROM_read();
 }
 
 static void saveSom() {
-    auto ptr = reinterpret_cast<uint32_t*>(somNode);
-    const auto end = ptr + (sizeof(somNode) / sizeof(uint32_t));
-
-    // load SOM data
-    EEPROM_seek(SOM_EEPROM_BASE);
-    while (ptr < end)
-        EEPROM_write(*(ptr++));
+    // save SOM data
+    store::save(store::ID_SOM, somNode, SOM_WORDS);
+
+    // save published compensation polynomial
+    float record[TCMP_WORDS];
+    record[0] = tcmpRef[0];
+    record[1] = tcmpRef[1];
+    for (int i = 0; i < ntp::TempModel::DIM; i++)
+        record[2 + i] = tcmpCoeff[i];
+    record[TCMP_WORDS - 2] = tcmpFill;
+    record[TCMP_WORDS - 1] = tcmpRmse;
+    store::save(store::ID_TCMP, record, TCMP_WORDS);
 }
 
 static void seedSom(const float temp, const float comp) {
@@ -269,12 +243,6 @@ static void seedSom(const float temp, const float comp) {
     }
 }
 
-inline void accumulate(float &accumulator, float &residual, const float delta) {
-    const auto initial = accumulator;
-    accumulator += residual + delta;
-    residual += delta - (accumulator - initial);
-}
-
 static void updateSom(const float temp, const float comp, float alpha) {
     // initialize som nodes if necessary
     if (!std::isfinite(somNode[0][0])) {
@@ -300,135 +268,85 @@ static void updateSom(const float temp, const float comp, float alpha) {
         // compute node alpha
         const float w = alpha * somNW[std::abs(i - best)];
         // update node weights
-        accumulate(somNode[i][0], somResidual[i][0], (temp - somNode[i][0]) * w);
-        accumulate(somNode[i][1], somResidual[i][1], (comp - somNode[i][1]) * w);
-        accumulate(somNode[i][2], somResidual[i][2], (1.0f - somNode[i][2]) * w);
+        regression::accumulate(somNode[i][0], somResidual[i][0], (temp - somNode[i][0]) * w);
+        regression::accumulate(somNode[i][1], somResidual[i][1], (comp - somNode[i][1]) * w);
+        regression::accumulate(somNode[i][2], somResidual[i][2], (1.0f - somNode[i][2]) * w);
     }
 }
 
-// regression scratch variables
-static float mse;
-static float mean[SOM_NODE_DIM];
-static float coef[REG_DIM_COEF];
-float scratch[SOM_NODE_CNT][SOM_NODE_DIM];
+static void updatePrior() {
+    if (SOM_PRIOR <= 0 || !std::isfinite(somNode[0][0]))
+        return;
 
-static int step0() {
-    // compute initial mean
-    computeMean(somNode[0]);
-    return 0;
+    // use SOM nodes as a density prior for the regression
+    priorFill = 0;
+    for (int i = 0; i < SOM_NODE_CNT; i++)
+        priorFill += SOM_PRIOR * somNode[i][2];
+    model.setPrior(somNode[0], SOM_NODE_CNT, SOM_NODE_DIM, SOM_PRIOR);
 }
 
-static int step1() {
-    // require sufficient data
-    if (mean[2] < SOM_FILL_OFF)
-        return 1;
-
-    // require sufficient data
-    if (mean[2] < SOM_FILL_REG) {
-        // only update means
-        tcmpMean[0] = mean[0];
-        tcmpMean[1] = mean[1];
-        tcmpMean[2] = mean[2];
-        return 2;
+static void restoreModel() {
+    float record[TCMP_WORDS];
+    if (!store::load(store::ID_TCMP, record, TCMP_WORDS))
+        return;
+    // reject incomplete or corrupt polynomials
+    for (const auto value : record) {
+        if (!std::isfinite(value))
+            return;
     }
+    if (record[TCMP_WORDS - 2] < REG_MIN_FILL || record[TCMP_WORDS - 1] > REG_MIN_RMSE)
+        return;
 
-    return 0;
-}
-
-static int step2() {
-    // compute initial fit
-    fitQuadratic(somNode[0]);
-    return 0;
-}
-
-static int step3() {
-    // compute residual error
-    computeMSE(somNode[0]);
-    return 0;
+    tcmpRef[0] = record[0];
+    tcmpRef[1] = record[1];
+    for (int i = 0; i < ntp::TempModel::DIM; i++)
+        tcmpCoeff[i] = record[2 + i];
+    tcmpFill = record[TCMP_WORDS - 2];
+    tcmpRmse = record[TCMP_WORDS - 1];
+    restored = true;
 }
 
-static int step4() {
-    // reweigh outliers
-    for (int i = 0; i < SOM_NODE_CNT; i++) {
-        const float x = (scratch[i][0] = somNode[i][0]) - mean[0];
-        float y = (scratch[i][1] = somNode[i][1]) - mean[1];
-        y -= coef[0];
-        y -= x * coef[1];
-        y -= x * x * coef[2];
-        scratch[i][2] = somNode[i][2] * std::exp(-0.25f * y * y / mse);
+static void publishModel() {
+    // retain restored polynomial until the live fit has settled
+    if (restored) {
+        if (model.getWeight() < REG_MIN_FILL || model.getRmse() > REG_RESTORE_RMSE)
+            return;
+        restored = false;
     }
-    return 0;
-}
-
-static int step5() {
-    // compute final mean
-    computeMean(scratch[0]);
-    return 0;
-}
 
-static int step6() {
-    // compute final fit
-    fitQuadratic(scratch[0]);
-    return 0;
-}
+    const float fill = model.getWeight() + priorFill;
+    tcmpFill = fill;
+    tcmpRmse = model.getRmse();
 
-static int step7() {
-    // compute residual error
-    computeMSE(scratch[0]);
-    return 0;
-}
+    // require sufficient data
+    if (fill < 1.0f)
+        return;
 
-static int step8() {
-    // update residual error
-    tcmpRmse = std::sqrt(mse);
+    // only update offset
+    if (fill < REG_MIN_FILL) {
+        tcmpRef[0] = model.getTempRef();
+        tcmpRef[1] = model.getValueRef();
+        tcmpCoeff[0] = model.getCoef(0);
+        for (int i = 1; i < ntp::TempModel::DIM; i++)
+            tcmpCoeff[i] = 0;
+        return;
+    }
 
     // quality check fit
     if (tcmpRmse <= REG_MIN_RMSE) {
-        // update means
-        tcmpMean[0] = mean[0];
-        tcmpMean[1] = mean[1];
-        tcmpMean[2] = mean[2];
-        // update coefficients
-        tcmpCoeff[0] = coef[0];
-        tcmpCoeff[1] = coef[1];
-        tcmpCoeff[2] = coef[2];
-    }
-    return 0;
-}
-
-#define STEP_CNT (9)
-typedef int (*RegressionStep)();
-static constexpr RegressionStep steps[STEP_CNT] = {
-    step0,
-    step1,
-    step2,
-    step3,
-    step4,
-    step5,
-    step6,
-    step7,
-    step8
-};
-
-static void runRegression(void *ref) {
-    if (
-        regressionStep >= STEP_CNT ||
-        (*(steps[regressionStep]))() != 0
-    ) {
-        runCancel(runRegression, nullptr);
-        regressionStep = 0;
-    }
-    else {
-        ++regressionStep;
+        tcmpRef[0] = model.getTempRef();
+        tcmpRef[1] = model.getValueRef();
+        for (int i = 0; i < ntp::TempModel::DIM; i++)
+            tcmpCoeff[i] = model.getCoef(i);
     }
 }
 
 static float tcmpEstimate(const float temp) {
-    const float x = temp - tcmpMean[0];
-    float y = tcmpCoeff[0];
-    y += x * tcmpCoeff[1];
-    y += x * x * tcmpCoeff[2];
-    return y + tcmpMean[1];
+    const float x = temp - tcmpRef[0];
+    float y = tcmpCoeff[ntp::TempModel::DIM - 1];
+    for (int i = ntp::TempModel::DIM - 2; i >= 0; i--)
+        y = y * x + tcmpCoeff[i];
+    return y + tcmpRef[1];
 }
 
 unsigned statusSom(char *buffer) {
@@ -450,98 +368,3 @@ unsigned statusSom(char *buffer) {
 
     return end - buffer;
 }
-
-static void computeMean(const float *data) {
-    // compute means
-    mean[0] = 0;
-    mean[1] = 0;
-    mean[2] = 0;
-    for (int i = 0; i < SOM_NODE_CNT; i++) {
-        mean[0] += data[0] * data[2];
-        mean[1] += data[1] * data[2];
-        mean[2] += data[2];
-        data += SOM_NODE_DIM;
-    }
-    mean[0] /= mean[2];
-    mean[1] /= mean[2];
-}
-
-static void fitQuadratic(const float *data) {
-    // compute equation matrix
-    float xx[REG_DIM_COEF][REG_DIM_COEF + 1] = {0};
-    for (int i = 0; i < SOM_NODE_CNT; i++) {
-        const float x = data[0] - mean[0];
-        const float y = data[1] - mean[1];
-        float z = data[2];
-        data += SOM_NODE_DIM;
-
-        // constant terms
-        xx[2][2] += z;
-        xx[2][3] += z * y;
-
-        // linear terms
-        z *= x;
-        xx[1][2] += z;
-        xx[1][3] += z * y;
-
-        // quadratic terms
-        z *= x;
-        xx[0][2] += z;
-        xx[0][3] += z * y;
-
-        // cubic terms
-        z *= x;
-        xx[0][1] += z;
-
-        // quartic terms
-        z *= x;
-        xx[0][0] += z;
-    }
-    // fill remaining cells using matrix symmetry
-    xx[1][0] = xx[0][1];
-    xx[1][1] = xx[0][2];
-    xx[2][0] = xx[0][2];
-    xx[2][1] = xx[1][2];
-
-    // row-echelon reduction
-    {
-        const float f = xx[1][0] / xx[0][0];
-        xx[1][1] -= f * xx[0][1];
-        xx[1][2] -= f * xx[0][2];
-        xx[1][3] -= f * xx[0][3];
-    }
-
-    // row-echelon reduction
-    {
-        const float f = xx[2][0] / xx[0][0];
-        xx[2][1] -= f * xx[0][1];
-        xx[2][2] -= f * xx[0][2];
-        xx[2][3] -= f * xx[0][3];
-    }
-
-    // row-echelon reduction
-    {
-        const float f = xx[2][1] / xx[1][1];
-        xx[2][2] -= f * xx[1][2];
-        xx[2][3] -= f * xx[1][3];
-    }
-
-    // compute coefficients
-    coef[0] = xx[2][3] / xx[2][2];
-    coef[1] = (xx[1][3] - xx[1][2] * coef[0]) / xx[1][1];
-    coef[2] = (xx[0][3] - xx[0][2] * coef[0] - xx[0][1] * coef[1]) / xx[0][0];
-}
-
-static void computeMSE(const float *data) {
-    float acc = 0;
-    for (int i = 0; i < SOM_NODE_CNT; i++) {
-        float x = data[0] - mean[0];
-        float y = data[1] - mean[1];
-        y -= coef[0];
-        y -= x * coef[1];
-        y -= x * x * coef[2];
-        acc += y * y * data[2];
-        data += SOM_NODE_DIM;
-    }
-    mse = acc / mean[2];
-}
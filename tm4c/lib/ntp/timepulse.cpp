@@ -0,0 +1,46 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "timepulse.hpp"
+
+#include <cstring>
+
+// TIM-TP flags: quantization error is invalid
+static constexpr uint8_t FLAG_QERR_INVALID = 0x10;
+// maximum delay from report to PPS edge (one second)
+static constexpr uint64_t MAX_LEAD = 1ull << 32;
+// correction scale (picoseconds to 32.32 fixed-point)
+static constexpr float QERR_SCALE = 0x1p32f * 1e-12f;
+
+void ntp::TimePulse::update(const uint64_t now, const uint8_t *payload) {
+    uint8_t flags;
+    memcpy(&qErr, payload + 8, sizeof(qErr));
+    memcpy(&flags, payload + 14, sizeof(flags));
+
+    // an unmatched report was not followed by a PPS edge
+    if (pending)
+        ++countMissed;
+
+    received = now;
+    pending = (flags & FLAG_QERR_INVALID) == 0;
+}
+
+bool ntp::TimePulse::correct(const uint64_t pps, int64_t &correction) {
+    if (!pending)
+        return false;
+
+    // report must precede the edge by less than one second
+    const uint64_t lead = pps - received;
+    if (static_cast<int64_t>(lead) <= 0)
+        return false;
+    pending = false;
+    if (lead >= MAX_LEAD) {
+        ++countMissed;
+        return false;
+    }
+
+    correction = static_cast<int64_t>(QERR_SCALE * static_cast<float>(qErr));
+    ++countMatched;
+    return true;
+}
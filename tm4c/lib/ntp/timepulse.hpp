@@ -0,0 +1,62 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace ntp {
+    /**
+     * GPS PPS quantization error (sawtooth) correction using UBX-TIM-TP.
+     * The receiver reports the quantization error of each PPS edge in a TIM-TP message sent ahead of the edge.
+     * Each report is matched to the first PPS capture within one second after it is received.
+     * A zero-initialized instance is valid.
+     */
+    class TimePulse {
+        // monotonic time the most recent report was received
+        uint64_t received;
+        // quantization error of the reported edge (ps)
+        int32_t qErr;
+        // most recent report is valid and has not been matched
+        bool pending;
+        // match statistics
+        uint32_t countMatched;
+        uint32_t countMissed;
+
+    public:
+        // UBX-TIM-TP payload size
+        static constexpr int PAYLOAD_SIZE = 16;
+
+        /**
+         * Record a UBX-TIM-TP report
+         * @param now monotonic time the message was received
+         * @param payload message payload (PAYLOAD_SIZE bytes)
+         */
+        void update(uint64_t now, const uint8_t *payload);
+
+        /**
+         * Get the quantization error correction for a PPS capture
+         * @param pps monotonic time of the PPS capture
+         * @param correction receives the 32.32 fixed-point error to subtract from the capture
+         * @return true if a report was matched to the capture
+         */
+        bool correct(uint64_t pps, int64_t &correction);
+
+        /**
+         * Get the quantization error of the most recent report
+         * @return quantization error in seconds
+         */
+        [[nodiscard]] float getQErr() const {
+            return 1e-12f * static_cast<float>(qErr);
+        }
+
+        [[nodiscard]] uint32_t getMatched() const {
+            return countMatched;
+        }
+
+        [[nodiscard]] uint32_t getMissed() const {
+            return countMissed;
+        }
+    };
+}
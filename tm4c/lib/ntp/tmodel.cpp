@@ -0,0 +1,194 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "tmodel.hpp"
+
+#include <cmath>
+
+using ntp::TempModel;
+
+/**
+ * Compute the polynomial basis for a normalized temperature
+ * @param x normalized temperature
+ * @param basis destination for the basis values
+ */
+static void computeBasis(const float x, float *basis) {
+    basis[0] = 1;
+    for (int i = 1; i < TempModel::DIM; ++i)
+        basis[i] = basis[i - 1] * x;
+}
+
+void TempModel::reset() {
+    for (int i = 0; i < DIM; ++i) {
+        for (int j = 0; j < DIM; ++j)
+            priorInfo[i][j] = 0;
+        priorMoment[i] = 0;
+    }
+    ready = false;
+}
+
+void TempModel::init(const float temp, const float value) {
+    tempRef = temp;
+    valueRef = value;
+    for (int i = 0; i < DIM; ++i) {
+        for (int j = 0; j < DIM; ++j)
+            info[i][j] = 0;
+        moment[i] = 0;
+        coef[i] = 0;
+    }
+    weight = 0;
+    error = 0;
+    errorWeight = 0;
+    ready = true;
+}
+
+void TempModel::update(const float temp, const float value, const float weight) {
+    if (!ready)
+        init(temp, value);
+
+    float basis[DIM];
+    computeBasis((temp - tempRef) * TEMP_SCALE, basis);
+    const float y = (value - valueRef) * VALUE_SCALE;
+
+    // prediction error
+    float pred = 0;
+    for (int i = 0; i < DIM; ++i)
+        pred += coef[i] * basis[i];
+    const float diff = y - pred;
+
+    // de-weight outliers once the residual variance has been established
+    float w = weight;
+    if (this->weight >= MIN_ROBUST) {
+        float var = error / errorWeight;
+        if (var < MIN_VAR)
+            var = MIN_VAR;
+        w /= 1.0f + (diff * diff) / (OUTLIER * OUTLIER * var);
+    }
+
+    // exponentially weighted update of the normal equations
+    constexpr float decay = 1.0f - FORGET;
+    for (int i = 0; i < DIM; ++i) {
+        const float wb = w * basis[i];
+        for (int j = 0; j <= i; ++j)
+            info[i][j] = info[i][j] * decay + wb * basis[j];
+        moment[i] = moment[i] * decay + wb * y;
+    }
+    this->weight = this->weight * decay + w;
+
+    // track recent prediction error
+    constexpr float decayError = 1.0f - FORGET_ERROR;
+    error = error * decayError + w * diff * diff;
+    errorWeight = errorWeight * decayError + w;
+
+    solve();
+}
+
+void TempModel::setPrior(const float *points, const int count, const int stride, const float scale) {
+    // initialize reference point from the weighted mean of the prior
+    if (!ready) {
+        float sumW = 0, sumT = 0, sumV = 0;
+        for (int k = 0; k < count; ++k) {
+            const float *point = points + k * stride;
+            sumW += point[2];
+            sumT += point[2] * point[0];
+            sumV += point[2] * point[1];
+        }
+        if (!(sumW > 0))
+            return;
+        init(sumT / sumW, sumV / sumW);
+    }
+
+    for (int i = 0; i < DIM; ++i) {
+        for (int j = 0; j < DIM; ++j)
+            priorInfo[i][j] = 0;
+        priorMoment[i] = 0;
+    }
+    for (int k = 0; k < count; ++k) {
+        const float *point = points + k * stride;
+        const float w = scale * point[2];
+        if (!(w > 0))
+            continue;
+        float basis[DIM];
+        computeBasis((point[0] - tempRef) * TEMP_SCALE, basis);
+        const float y = (point[1] - valueRef) * VALUE_SCALE;
+        for (int i = 0; i < DIM; ++i) {
+            const float wb = w * basis[i];
+            for (int j = 0; j <= i; ++j)
+                priorInfo[i][j] += wb * basis[j];
+            priorMoment[i] += wb * y;
+        }
+    }
+
+    solve();
+}
+
+void TempModel::solve() {
+    // regularized normal equations (lower triangle)
+    float chol[DIM][DIM];
+    float rhs[DIM];
+    for (int i = 0; i < DIM; ++i) {
+        for (int j = 0; j <= i; ++j)
+            chol[i][j] = info[i][j] + priorInfo[i][j];
+        chol[i][i] += RIDGE;
+        rhs[i] = moment[i] + priorMoment[i] + RIDGE * coef[i];
+    }
+
+    // Cholesky decomposition
+    for (int i = 0; i < DIM; ++i) {
+        for (int j = 0; j <= i; ++j) {
+            float sum = chol[i][j];
+            for (int k = 0; k < j; ++k)
+                sum -= chol[i][k] * chol[j][k];
+            if (i == j) {
+                // retain previous coefficients if the system is not positive definite
+                if (!(sum > 0))
+                    return;
+                chol[i][i] = std::sqrt(sum);
+            }
+            else {
+                chol[i][j] = sum / chol[j][j];
+            }
+        }
+    }
+
+    // forward substitution
+    for (int i = 0; i < DIM; ++i) {
+        float sum = rhs[i];
+        for (int k = 0; k < i; ++k)
+            sum -= chol[i][k] * rhs[k];
+        rhs[i] = sum / chol[i][i];
+    }
+
+    // back substitution
+    for (int i = DIM - 1; i >= 0; --i) {
+        float sum = rhs[i];
+        for (int k = i + 1; k < DIM; ++k)
+            sum -= chol[k][i] * rhs[k];
+        rhs[i] = sum / chol[i][i];
+    }
+
+    for (int i = 0; i < DIM; ++i)
+        coef[i] = rhs[i];
+}
+
+float TempModel::estimate(const float temp) const {
+    const float x = (temp - tempRef) * TEMP_SCALE;
+    float y = coef[DIM - 1];
+    for (int i = DIM - 2; i >= 0; --i)
+        y = y * x + coef[i];
+    return valueRef + y / VALUE_SCALE;
+}
+
+float TempModel::getCoef(const int index) const {
+    float value = coef[index] / VALUE_SCALE;
+    for (int i = 0; i < index; ++i)
+        value *= TEMP_SCALE;
+    return value;
+}
+
+float TempModel::getRmse() const {
+    if (!(errorWeight > 0))
+        return 0;
+    return std::sqrt(error / errorWeight) / VALUE_SCALE;
+}
@@ -0,0 +1,141 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+namespace ntp {
+    /**
+     * Exponentially weighted least-squares polynomial model of frequency correction versus temperature.
+     * The weighted information matrix and target moments are updated recursively, so each sample costs
+     * constant work and the coefficients are refreshed immediately. Samples with large prediction errors
+     * are de-weighted with a Cauchy weight function. An optional prior (e.g. a density summary of past
+     * samples) is added to the information matrix when solving, which prevents covariance wind-up
+     * while the temperature is steady and retains the shape of the curve outside the recent range.
+     * A zero-initialized instance is valid and waits for its first sample.
+     */
+    class TempModel {
+    public:
+        // polynomial order (quadratic by default, cubic with TCMP_CUBIC)
+#ifdef TCMP_CUBIC
+        static constexpr int ORDER = 3;
+#else
+        static constexpr int ORDER = 2;
+#endif
+        // number of coefficients
+        static constexpr int DIM = ORDER + 1;
+
+    private:
+        // temperature normalization (1 / 16 C)
+        static constexpr float TEMP_SCALE = 0x1p-4f;
+        // frequency normalization (ppm)
+        static constexpr float VALUE_SCALE = 1e6f;
+        // forgetting rate per sample (effective memory of 16384 samples)
+        static constexpr float FORGET = 0x1p-14f;
+        // forgetting rate of the prediction error estimate (effective memory of 256 samples)
+        static constexpr float FORGET_ERROR = 0x1p-8f;
+        // regularization weight toward the previous coefficients
+        static constexpr float RIDGE = 0x1p-10f;
+        // residual threshold for outlier de-weighting (standard deviations)
+        static constexpr float OUTLIER = 3.0f;
+        // minimum residual variance (ppm^2)
+        static constexpr float MIN_VAR = 1e-4f;
+        // minimum sample weight before outliers are de-weighted
+        static constexpr float MIN_ROBUST = 16.0f;
+
+        // normalization origin
+        float tempRef;
+        float valueRef;
+        // weighted information matrix and target moments
+        float info[DIM][DIM];
+        float moment[DIM];
+        // prior information matrix and target moments
+        float priorInfo[DIM][DIM];
+        float priorMoment[DIM];
+        // normalized coefficients
+        float coef[DIM];
+        // effective sample weight
+        float weight;
+        // weighted sum of squared prediction errors
+        float error;
+        float errorWeight;
+        // model has been initialized
+        bool ready;
+
+        void init(float temp, float value);
+        void solve();
+
+    public:
+        /**
+         * Reset the model to its initial state
+         */
+        void reset();
+
+        /**
+         * Update the model with a new sample
+         * @param temp temperature in Celsius
+         * @param value frequency correction
+         * @param weight relative confidence in the sample (0 to 1)
+         */
+        void update(float temp, float value, float weight);
+
+        /**
+         * Replace the prior with a set of weighted points
+         * @param points rows of (temperature in Celsius, frequency correction, relative weight)
+         * @param count number of rows
+         * @param stride number of values per row (at least three)
+         * @param scale equivalent number of samples for a point with unit weight
+         */
+        void setPrior(const float *points, int count, int stride, float scale);
+
+        /**
+         * Estimate the frequency correction for a temperature
+         * @param temp temperature in Celsius
+         * @return estimated frequency correction
+         */
+        [[nodiscard]]
+        float estimate(float temp) const;
+
+        /**
+         * Get a polynomial coefficient relative to the reference point
+         * @param index coefficient order
+         * @return coefficient (frequency per Celsius^index)
+         */
+        [[nodiscard]]
+        float getCoef(int index) const;
+
+        /**
+         * Get the reference temperature of the polynomial
+         * @return reference temperature in Celsius
+         */
+        [[nodiscard]]
+        float getTempRef() const {
+            return tempRef;
+        }
+
+        /**
+         * Get the reference frequency correction of the polynomial
+         * @return reference frequency correction
+         */
+        [[nodiscard]]
+        float getValueRef() const {
+            return valueRef;
+        }
+
+        /**
+         * Get the effective number of samples in the model
+         * @return effective sample weight
+         */
+        [[nodiscard]]
+        float getWeight() const {
+            return weight;
+        }
+
+        /**
+         * Get the root-mean-square prediction error of the model
+         * @return prediction error (frequency)
+         */
+        [[nodiscard]]
+        float getRmse() const;
+    };
+}
@@ -0,0 +1,393 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "bmca.hpp"
+
+#include "profile.hpp"
+#include "../format.hpp"
+#include "../run.hpp"
+#include "../clock/mono.hpp"
+#include "../clock/tai.hpp"
+#include "../net/util.hpp"
+#include "../ntp/GPS.hpp"
+#include "../ntp/ntp.hpp"
+#include "../ntp/PTP.hpp"
+#include "../ntp/pll.hpp"
+
+#include <memory.h>
+
+#ifndef PTP_PRIORITY1
+// priority1 of the local clock (lower is better)
+#define PTP_PRIORITY1 (128)
+#endif
+
+#ifndef PTP_PRIORITY2
+// priority2 of the local clock (lower is better)
+#define PTP_PRIORITY2 (128)
+#endif
+
+// foreign master records (IEEE 1588 requires at least five)
+static constexpr int FOREIGN_MASTERS = 8;
+// announce intervals spanned by the qualification window (FOREIGN_MASTER_TIME_WINDOW)
+static constexpr int FOREIGN_WINDOW = 4;
+// announce flags carried in the time properties data set
+static constexpr uint16_t TIME_FLAGS =
+    PTP2_FLAG_LEAP61 | PTP2_FLAG_LEAP59 | PTP2_FLAG_UTC_VALID |
+    PTP2_FLAG_PTP_TIMESCALE | PTP2_FLAG_TIME_TRACEABLE | PTP2_FLAG_FREQ_TRACEABLE;
+// state decision rate (log2 Hz)
+static constexpr int TICK_LOG = 4;
+// supported range of foreign announce intervals (log2 s)
+static constexpr int8_t MIN_LOG_INTV = -7;
+static constexpr int8_t MAX_LOG_INTV = 6;
+
+struct Foreign {
+    ptp::bmca::DataSet data;
+    ptp::Address addr;
+    // monotonic time of the preceding and the latest announce
+    uint64_t previous;
+    uint64_t last;
+    int8_t logInterval;
+    bool valid;
+};
+
+static Foreign foreign[FOREIGN_MASTERS];
+static PTP2_PORT_STATE portState;
+static uint64_t listenEnd;
+// best qualified foreign master
+static int best;
+
+// statistics
+static uint32_t cntAnnounce;
+static uint32_t cntDropped;
+static uint32_t cntChanges;
+
+static void runTick(void *ref);
+
+/**
+ * Convert a log2 interval to a span of monotonic time
+ * @param logInterval log2 interval
+ * @return interval in 32.32 fixed point format
+ */
+static uint64_t toSpan(const int8_t logInterval) {
+    return logInterval < 0 ? (1ull << 32) >> -logInterval : (1ull << 32) << logInterval;
+}
+
+void ptp::bmca::init() {
+    reset();
+    runPeriodic(RUN_SEC >> TICK_LOG, runTick, nullptr);
+}
+
+void ptp::bmca::reset() {
+    memset(foreign, 0, sizeof(foreign));
+    best = -1;
+    // listen for other masters before claiming the domain
+    portState = PTP2_PS_LISTENING;
+    listenEnd = clock::monotonic::now() + ptp::bmca::ANNOUNCE_TIMEOUT * toSpan(profile::active().logAnnounce);
+}
+
+/**
+ * Check if a foreign master has announced itself often enough to take part in the comparison
+ * @param entry foreign master record
+ * @return true if two announce messages were received within the qualification window
+ */
+static bool isQualified(const Foreign &entry) {
+    if (!entry.valid || entry.previous == 0)
+        return false;
+    return entry.last - entry.previous <= FOREIGN_WINDOW * toSpan(entry.logInterval);
+}
+
+/**
+ * Expire silent foreign masters and update the port state
+ */
+static void decide() {
+    const uint64_t now = clock::monotonic::now();
+    best = -1;
+    for (int i = 0; i < FOREIGN_MASTERS; ++i) {
+        auto &entry = foreign[i];
+        if (entry.valid && now - entry.last > ptp::bmca::ANNOUNCE_TIMEOUT * toSpan(entry.logInterval))
+            entry.valid = false;
+        if (!isQualified(entry))
+            continue;
+        if (best < 0 || ptp::bmca::compare(entry.data, foreign[best].data) < 0)
+            best = i;
+    }
+
+    ptp::bmca::DataSet local;
+    ptp::bmca::getLocal(local);
+    PTP2_PORT_STATE next = PTP2_PS_MASTER;
+    // the local clock is a grandmaster (clockClass 1 to 127) and only follows a better master as a
+    // disciplining source once source selection has chosen it
+    if (best >= 0 && ptp::bmca::compare(foreign[best].data, local) < 0)
+        next = (ntp::refId() == ntp::PTP::REF_ID) ? PTP2_PS_SLAVE : PTP2_PS_PASSIVE;
+    else if (portState == PTP2_PS_LISTENING && static_cast<int64_t>(now - listenEnd) < 0)
+        next = PTP2_PS_LISTENING;
+
+    if (next != portState) {
+        portState = next;
+        ++cntChanges;
+    }
+}
+
+static void runTick(void *ref) {
+    decide();
+}
+
+/**
+ * Locate the record of a foreign master
+ * @param data data set from the announce message
+ * @return matching record or a record to replace (null if the table is full of better masters)
+ */
+static Foreign* findForeign(const ptp::bmca::DataSet &data) {
+    Foreign *free = nullptr;
+    Foreign *worst = nullptr;
+    for (auto &entry : foreign) {
+        if (!entry.valid) {
+            if (free == nullptr)
+                free = &entry;
+            continue;
+        }
+        if (memcmp(&entry.data.sender, &data.sender, sizeof(data.sender)) == 0)
+            return &entry;
+        if (worst == nullptr || ptp::bmca::compare(entry.data, worst->data) > 0)
+            worst = &entry;
+    }
+    if (free != nullptr)
+        return free;
+    // replace the worst master with a better one
+    if (ptp::bmca::compare(data, worst->data) < 0) {
+        worst->valid = false;
+        return worst;
+    }
+    return nullptr;
+}
+
+void ptp::bmca::process(const Address &src, const uint8_t *message, const int size) {
+    // verify message length
+    if (size < static_cast<int>(sizeof(MessagePTP<PTP2_ANNOUNCE>)))
+        return;
+    const auto &announce = MessagePTP<PTP2_ANNOUNCE>::from(message);
+    // discard announce messages that have passed through too many boundary clocks
+    const uint16_t stepsRemoved = htons(announce.data.stepsRemoved);
+    if (stepsRemoved >= 255)
+        return;
+    ++cntAnnounce;
+
+    DataSet data = {};
+    data.priority1 = announce.data.grandMasterPriority;
+    data.quality = announce.data.grandMasterClockQuality;
+    data.quality.offsetScaledLogVariance = htons(data.quality.offsetScaledLogVariance);
+    data.priority2 = announce.data.grandMasterPriority2;
+    memcpy(data.identity, announce.data.grandMasterIdentity, sizeof(data.identity));
+    data.stepsRemoved = stepsRemoved;
+    data.timeSource = announce.data.timeSource;
+    data.sender = announce.ptp.sourceIdentity;
+    data.sender.portNumber = htons(data.sender.portNumber);
+    data.timeFlags = htons(announce.ptp.flags) & TIME_FLAGS;
+    data.utcOffset = static_cast<int16_t>(htons(announce.data.currentUtcOffset));
+
+    const auto entry = findForeign(data);
+    if (entry == nullptr) {
+        ++cntDropped;
+        return;
+    }
+    if (!entry->valid) {
+        entry->previous = 0;
+        entry->last = 0;
+    }
+
+    // record the announce
+    auto logInterval = static_cast<int8_t>(announce.ptp.logMessageInterval);
+    if (logInterval < MIN_LOG_INTV)
+        logInterval = MIN_LOG_INTV;
+    if (logInterval > MAX_LOG_INTV)
+        logInterval = MAX_LOG_INTV;
+    entry->data = data;
+    entry->addr = src;
+    entry->previous = entry->last;
+    entry->last = clock::monotonic::now();
+    entry->logInterval = logInterval;
+    entry->valid = true;
+
+    decide();
+}
+
+int ptp::bmca::compare(const DataSet &a, const DataSet &b) {
+    // different grandmasters are ranked by their data sets
+    const int gm = memcmp(a.identity, b.identity, sizeof(a.identity));
+    if (gm != 0) {
+        if (a.priority1 != b.priority1)
+            return a.priority1 - b.priority1;
+        if (a.quality.clockClass != b.quality.clockClass)
+            return a.quality.clockClass - b.quality.clockClass;
+        if (a.quality.clockAccuracy != b.quality.clockAccuracy)
+            return a.quality.clockAccuracy - b.quality.clockAccuracy;
+        if (a.quality.offsetScaledLogVariance != b.quality.offsetScaledLogVariance)
+            return a.quality.offsetScaledLogVariance - b.quality.offsetScaledLogVariance;
+        if (a.priority2 != b.priority2)
+            return a.priority2 - b.priority2;
+        return gm;
+    }
+
+    // paths to the same grandmaster are ranked by length, then by the sender identity
+    if (a.stepsRemoved != b.stepsRemoved)
+        return a.stepsRemoved - b.stepsRemoved;
+    const int sender = memcmp(a.sender.identity, b.sender.identity, sizeof(a.sender.identity));
+    if (sender != 0)
+        return sender;
+    return a.sender.portNumber - b.sender.portNumber;
+}
+
+void ptp::bmca::getLocal(DataSet &local) {
+    memset(&local, 0, sizeof(local));
+    local.priority1 = PTP_PRIORITY1;
+    local.priority2 = PTP_PRIORITY2;
+    memcpy(local.identity, ptpClockId, sizeof(local.identity));
+    memcpy(local.sender.identity, ptpClockId, sizeof(local.sender.identity));
+    local.sender.portNumber = 1;
+
+    // signal holdover and loss of the primary reference through the clock class
+    const auto refId = ntp::refId();
+    if (refId == ntp::GPS::REF_ID)
+        local.timeSource = PTP2_TSRC_GPS;
+    else if (refId == ntp::PTP::REF_ID)
+        local.timeSource = PTP2_TSRC_PTP;
+    else
+        local.timeSource = PTP2_TSRC_NTP;
+    local.utcOffset = static_cast<int16_t>(clkTaiUtcOffset >> 32);
+    local.timeFlags = PTP2_FLAG_PTP_TIMESCALE;
+    if (refId != 0)
+        local.timeFlags |= PTP2_FLAG_UTC_VALID;
+    auto &quality = local.quality;
+    const auto holdover = PLL_holdoverState();
+    if (holdover == PLL_HOLD_ACTIVE) {
+        const float error = PLL_holdoverError();
+        quality.clockClass = PTP2_CLK_CLASS_PRI_HOLD;
+        quality.clockAccuracy = toPtpClkAccuracy(error);
+        quality.offsetScaledLogVariance = toPtpLogVariance(error);
+        return;
+    }
+    const bool primary = refId == ntp::GPS::REF_ID && holdover == PLL_HOLD_NONE;
+    quality.clockClass = primary ? PTP2_CLK_CLASS_PRIMARY : PTP2_CLK_CLASS_PRI_FAIL;
+    if (primary)
+        local.timeFlags |= PTP2_FLAG_TIME_TRACEABLE | PTP2_FLAG_FREQ_TRACEABLE;
+    if (refId != 0) {
+        const float error = PLL_offsetRms();
+        quality.clockAccuracy = toPtpClkAccuracy(error);
+        quality.offsetScaledLogVariance = toPtpLogVariance(error);
+    }
+    else {
+        quality.clockAccuracy = 0x31;
+        quality.offsetScaledLogVariance = 0xFFFF;
+    }
+}
+
+bool ptp::bmca::getBest(DataSet &data) {
+    if (best < 0)
+        return false;
+    data = foreign[best].data;
+    return true;
+}
+
+bool ptp::bmca::getParent(DataSet &parent, Address &addr) {
+    if (best < 0 || portState == PTP2_PS_MASTER || portState == PTP2_PS_LISTENING)
+        return false;
+    parent = foreign[best].data;
+    addr = foreign[best].addr;
+    return true;
+}
+
+PTP2_PORT_STATE ptp::bmca::getState() {
+    return portState;
+}
+
+bool ptp::bmca::isMaster() {
+    return portState == PTP2_PS_MASTER;
+}
+
+/**
+ * Append the grandmaster fields of a data set
+ * @param end destination for the text
+ * @param data data set
+ * @return new end of the text
+ */
+static char* appendDataSet(char *end, const ptp::bmca::DataSet &data) {
+    char tmp[32];
+    end = toHexBytes(end, data.identity, sizeof(data.identity));
+    tmp[toBase(data.priority1, 10, tmp)] = 0;
+    end = append(end, " (");
+    end = append(end, tmp);
+    tmp[toBase(data.quality.clockClass, 10, tmp)] = 0;
+    end = append(end, "/");
+    end = append(end, tmp);
+    tmp[toHex(data.quality.clockAccuracy, 2, '0', tmp)] = 0;
+    end = append(end, "/0x");
+    end = append(end, tmp);
+    tmp[toHex(data.quality.offsetScaledLogVariance, 4, '0', tmp)] = 0;
+    end = append(end, "/0x");
+    end = append(end, tmp);
+    tmp[toBase(data.priority2, 10, tmp)] = 0;
+    end = append(end, "/");
+    end = append(end, tmp);
+    tmp[toBase(data.stepsRemoved, 10, tmp)] = 0;
+    end = append(end, ", steps ");
+    end = append(end, tmp);
+    end = append(end, ")\n");
+    return end;
+}
+
+unsigned ptp::bmca::status(char *buffer) {
+    static constexpr const char *STATES[] = {
+        "unknown", "initializing", "faulty", "disabled", "listening",
+        "pre-master", "master", "passive", "uncalibrated", "slave"
+    };
+    char tmp[32];
+    char *end = buffer;
+
+    end = append(end, "bmca status:\n");
+
+    end = append(end, "  - state:     ");
+    end = append(end, STATES[portState]);
+    end = append(end, "\n");
+
+    DataSet local;
+    getLocal(local);
+    end = append(end, "  - local:     ");
+    end = appendDataSet(end, local);
+
+    int valid = 0;
+    int qualified = 0;
+    for (const auto &entry : foreign) {
+        if (entry.valid)
+            ++valid;
+        if (isQualified(entry))
+            ++qualified;
+    }
+    tmp[toBase(valid, 10, tmp)] = 0;
+    end = append(end, "  - foreign:   ");
+    end = append(end, tmp);
+    tmp[toBase(qualified, 10, tmp)] = 0;
+    end = append(end, " (");
+    end = append(end, tmp);
+    end = append(end, " qualified)\n");
+
+    if (best >= 0) {
+        end = append(end, "  - best:      ");
+        end = appendDataSet(end, foreign[best].data);
+    }
+
+    tmp[toBase(cntAnnounce, 10, tmp)] = 0;
+    end = append(end, "  - announce:  ");
+    end = append(end, tmp);
+    tmp[toBase(cntDropped, 10, tmp)] = 0;
+    end = append(end, " received, ");
+    end = append(end, tmp);
+    end = append(end, " dropped\n");
+
+    tmp[toBase(cntChanges, 10, tmp)] = 0;
+    end = append(end, "  - changes:   ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    return end - buffer;
+}
@@ -0,0 +1,107 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+#include "common.hpp"
+#include "transport.hpp"
+
+/**
+ * Best master clock algorithm (IEEE 1588 clause 9.3).
+ * Announce messages from other masters in the domain are kept in a foreign master table. The best qualified
+ * foreign master is compared against the local clock and the port moves to PASSIVE while it is outranked.
+ * The port returns to MASTER once the announce receipt timeout of every better master has expired.
+ * While the clock is disciplined by the outranking master (ntp::PTP) the port is reported as SLAVE.
+ */
+namespace ptp::bmca {
+    // announce intervals without an announce before a foreign master expires (announceReceiptTimeout)
+    static constexpr int ANNOUNCE_TIMEOUT = 3;
+
+    /**
+     * Grandmaster data set used for comparison
+     */
+    struct DataSet {
+        uint8_t priority1;
+        // clock quality (offsetScaledLogVariance in host byte-order)
+        PTP2_CLK_QUALITY quality;
+        uint8_t priority2;
+        uint8_t identity[8];
+        uint16_t stepsRemoved;
+        uint8_t timeSource;
+        // port identity of the announcing clock (host byte-order port number)
+        PTP2_SRC_IDENT sender;
+        // time properties (PTP2_FLAGS leap, UTC and traceability bits in host byte-order)
+        uint16_t timeFlags;
+        // TAI-UTC offset in seconds
+        int16_t utcOffset;
+    };
+
+    /**
+     * Clear the foreign master table and start the state decision task
+     */
+    void init();
+
+    /**
+     * Clear the foreign master table and listen for other masters (e.g. after a profile change)
+     */
+    void reset();
+
+    /**
+     * Process an announce message
+     * @param src source address of the message
+     * @param message PTP message (header and body)
+     * @param size size of the message
+     */
+    void process(const Address &src, const uint8_t *message, int size);
+
+    /**
+     * Compare two data sets
+     * @param a first data set
+     * @param b second data set
+     * @return negative if a is better than b, positive if b is better than a, zero if they are equal
+     */
+    int compare(const DataSet &a, const DataSet &b);
+
+    /**
+     * Get the data set of the local clock with the quality derived from the current reference state
+     * @param local data set to populate
+     */
+    void getLocal(DataSet &local);
+
+    /**
+     * Get the best qualified foreign master
+     * @param best data set to populate
+     * @return false if there is no qualified foreign master
+     */
+    bool getBest(DataSet &best);
+
+    /**
+     * Get the parent master while a better foreign master outranks the local clock
+     * @param parent data set to populate
+     * @param addr receives the address of the parent master
+     * @return false if the local clock is the grandmaster
+     */
+    bool getParent(DataSet &parent, Address &addr);
+
+    /**
+     * Get the current port state
+     * @return port state
+     */
+    PTP2_PORT_STATE getState();
+
+    /**
+     * Check if the port is the master of the domain
+     * @return true if the port is in the MASTER state
+     */
+    bool isMaster();
+
+    /**
+     * Write current status of the best master clock algorithm to a buffer
+     * @param buffer destination for status information
+     * @return number of bytes written to buffer
+     */
+    unsigned status(char *buffer);
+}
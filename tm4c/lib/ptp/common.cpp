@@ -3,9 +3,13 @@
 //
 
 #include "common.hpp"
+#include "profile.hpp"
 #include "../clock/util.hpp"
 #include "../net/util.hpp"
 
+#include <cmath>
+#include <memory.h>
+
 // lut for PTP clock accuracy codes
 const float lutClkAccuracy[17] = {
         25e-9f, 100e-9f, 250e-9f, 1e-6f,
@@ -18,6 +22,41 @@ const float lutClkAccuracy[17] = {
 // IEEE 802.1AS broadcast MAC address (01:80:C2:00:00:0E)
 const uint8_t gPtpMac[6] = { 0x01, 0x80, 0xC2, 0x00, 0x00, 0x0E };
 
+// IEEE 1588 layer-2 multicast MAC address (01:1B:19:00:00:00)
+const uint8_t ptpMac[6] = { 0x01, 0x1B, 0x19, 0x00, 0x00, 0x00 };
+
+
+void initPtpHeader(HEADER_PTP &header, const PTP2_MTYPE type, const int size, const int8_t logInterval) {
+    header.versionPTP = PTP2_VERSION;
+    header.messageType = type;
+    header.messageLength = htons(size);
+    const auto &profile = ptp::profile::active();
+    header.transportSpecific = profile.sdoId;
+    header.domainNumber = profile.domain;
+    memcpy(header.sourceIdentity.identity, ptpClockId, sizeof(ptpClockId));
+    header.sourceIdentity.portNumber = htons(1);
+    header.logMessageInterval = logInterval;
+    switch (type) {
+        case PTP2_MT_SYNC:
+            header.controlField = PTP2_CTRL_SYNC;
+            break;
+        case PTP2_MT_DELAY_REQ:
+            header.controlField = PTP2_CTRL_DELAY_REQ;
+            break;
+        case PTP2_MT_FOLLOW_UP:
+            header.controlField = PTP2_CTRL_FOLLOW_UP;
+            break;
+        case PTP2_MT_DELAY_RESP:
+            header.controlField = PTP2_CTRL_DELAY_RESP;
+            break;
+        case PTP2_MT_MANAGEMENT:
+            header.controlField = PTP2_CTRL_MANAGEMENT;
+            break;
+        default:
+            header.controlField = PTP2_CTRL_OTHER;
+            break;
+    }
+}
 
 void toPtpTimestamp(uint64_t ts, PTP2_TIMESTAMP *tsPtp) {
     auto &scratch = reinterpret_cast<fixed_32_32&>(ts);
@@ -37,6 +76,22 @@ uint64_t fromPtpTimestamp(const PTP2_TIMESTAMP *tsPtp) {
     return scratch.full;
 }
 
+int64_t fromPtpCorrection(const uint64_t correction) {
+    // split into whole seconds to keep the fraction conversion within 64 bits
+    const int64_t nanos = static_cast<int64_t>(htonll(correction)) >> 16;
+    const int64_t seconds = nanos / 1000000000;
+    const int64_t remainder = nanos - seconds * 1000000000;
+    return (seconds << 32) + (remainder << 32) / 1000000000;
+}
+
+uint64_t toPtpCorrection(const int64_t interval) {
+    // whole seconds and the fraction are scaled separately to stay within 64 bits
+    const int64_t seconds = interval >> 32;
+    const uint64_t fraction = static_cast<uint32_t>(interval);
+    const int64_t scaled = seconds * (1000000000ll << 16) + static_cast<int64_t>((fraction * 1000000000u) >> 16);
+    return htonll(static_cast<uint64_t>(scaled));
+}
+
 uint32_t toPtpClkAccuracy(const float rmsError) {
     // check accuracy thresholds
     for(int i = 0; i < 17; i++) {
@@ -46,3 +101,15 @@ uint32_t toPtpClkAccuracy(const float rmsError) {
     // greater than 10s
     return 0x31;
 }
+
+uint16_t toPtpLogVariance(const float rmsError) {
+    if (!(rmsError > 0))
+        return 0;
+    // log2 of the variance in seconds squared
+    const float scaled = 0x8000 + 512.0f * log2f(rmsError);
+    if (scaled < 0)
+        return 0;
+    if (scaled > 0xFFFE)
+        return 0xFFFE;
+    return static_cast<uint16_t>(scaled);
+}
@@ -10,8 +10,15 @@
 #include "../net/eth.hpp"
 
 #define PTP2_VERSION (2)
+// domain of the default profile
 #define PTP2_DOMAIN (1)
 
+// UDP ports for event and general messages (IEEE 1588 Annex D)
+constexpr uint16_t PTP2_PORT_EVENT = 319;
+constexpr uint16_t PTP2_PORT_GENERAL = 320;
+// primary multicast group for UDP/IPv4 (224.0.1.129, network byte-order)
+constexpr uint32_t PTP2_MCAST_PRIMARY = 0x810100E0u;
+
 
 // PTP message types
 enum PTP2_MTYPE {
@@ -28,6 +35,41 @@ enum PTP2_MTYPE {
     PTP2_MT_MANAGEMENT
 };
 
+// PTP header flags (host byte-order, flagField octet 0 in the upper byte)
+enum PTP2_FLAGS {
+    PTP2_FLAG_LEAP61         = 0x0001,
+    PTP2_FLAG_LEAP59         = 0x0002,
+    PTP2_FLAG_UTC_VALID      = 0x0004,
+    PTP2_FLAG_PTP_TIMESCALE  = 0x0008,
+    PTP2_FLAG_TIME_TRACEABLE = 0x0010,
+    PTP2_FLAG_FREQ_TRACEABLE = 0x0020,
+    PTP2_FLAG_TWO_STEP       = 0x0200,
+    PTP2_FLAG_UNICAST        = 0x0400
+};
+
+// PTP version 1 control field values
+enum PTP2_CONTROL {
+    PTP2_CTRL_SYNC       = 0,
+    PTP2_CTRL_DELAY_REQ  = 1,
+    PTP2_CTRL_FOLLOW_UP  = 2,
+    PTP2_CTRL_DELAY_RESP = 3,
+    PTP2_CTRL_MANAGEMENT = 4,
+    PTP2_CTRL_OTHER      = 5
+};
+
+// PTP port states
+enum PTP2_PORT_STATE {
+    PTP2_PS_INITIALIZING = 1,
+    PTP2_PS_FAULTY       = 2,
+    PTP2_PS_DISABLED     = 3,
+    PTP2_PS_LISTENING    = 4,
+    PTP2_PS_PRE_MASTER   = 5,
+    PTP2_PS_MASTER       = 6,
+    PTP2_PS_PASSIVE      = 7,
+    PTP2_PS_UNCALIBRATED = 8,
+    PTP2_PS_SLAVE        = 9
+};
+
 enum PTP2_CLK_CLASS {
     PTP2_CLK_CLASS_PRIMARY  = 6,
     PTP2_CLK_CLASS_PRI_HOLD = 7,
@@ -46,6 +88,43 @@ enum PTP2_TSRC {
     PTP2_TSRC_INTERNAL = 0xA0
 };
 
+// management actions (IEEE 1588 15.4.1.6)
+enum PTP2_MGMT_ACTION {
+    PTP2_MA_GET         = 0,
+    PTP2_MA_SET         = 1,
+    PTP2_MA_RESPONSE    = 2,
+    PTP2_MA_COMMAND     = 3,
+    PTP2_MA_ACKNOWLEDGE = 4
+};
+
+// management IDs (IEEE 1588 15.5.2.3)
+enum PTP2_MGMT_ID {
+    PTP2_MID_NULL_MANAGEMENT   = 0x0000,
+    PTP2_MID_DEFAULT_DATA_SET  = 0x2000,
+    PTP2_MID_CURRENT_DATA_SET  = 0x2001,
+    PTP2_MID_PARENT_DATA_SET   = 0x2002,
+    PTP2_MID_TIME_PROPERTIES   = 0x2003,
+    PTP2_MID_PORT_DATA_SET     = 0x2004,
+    // linuxptp port statistics (implementation-specific)
+    PTP2_MID_PORT_STATS_NP     = 0xC005
+};
+
+// management error IDs (IEEE 1588 15.5.4.1.4)
+enum PTP2_MGMT_ERROR {
+    PTP2_ME_RESPONSE_TOO_BIG = 0x0001,
+    PTP2_ME_NO_SUCH_ID       = 0x0002,
+    PTP2_ME_WRONG_LENGTH     = 0x0003,
+    PTP2_ME_WRONG_VALUE      = 0x0004,
+    PTP2_ME_NOT_SETABLE      = 0x0005,
+    PTP2_ME_NOT_SUPPORTED    = 0x0006
+};
+
+// delay mechanisms (IEEE 1588 8.2.5.4.4)
+enum PTP2_DELAY_MECH {
+    PTP2_DM_E2E = 1,
+    PTP2_DM_P2P = 2
+};
+
 struct [[gnu::packed]] PTP2_SRC_IDENT {
     uint8_t identity[8];
     uint16_t portNumber;
@@ -80,14 +159,20 @@ struct [[gnu::packed]] HEADER_PTP {
 
 static_assert(sizeof(HEADER_PTP) == 34, "HEADER_PTP must be 34 bytes");
 
-constexpr int PTP2_MIN_SIZE = sizeof(HeaderEthernet) + sizeof(HEADER_PTP);
+struct [[gnu::packed]] PTP2_CLK_QUALITY {
+    uint8_t clockClass;
+    uint8_t clockAccuracy;
+    uint16_t offsetScaledLogVariance;
+};
+
+static_assert(sizeof(PTP2_CLK_QUALITY) == 4, "PTP2_CLK_QUALITY must be 4 bytes");
 
 struct [[gnu::packed]] PTP2_ANNOUNCE {
     PTP2_TIMESTAMP originTimestamp;
     uint16_t currentUtcOffset;
     uint8_t reserved;
     uint8_t grandMasterPriority;
-    uint32_t grandMasterClockQuality;
+    PTP2_CLK_QUALITY grandMasterClockQuality;
     uint8_t grandMasterPriority2;
     uint8_t grandMasterIdentity[8];
     uint16_t stepsRemoved;
@@ -124,24 +209,201 @@ struct [[gnu::packed]] PTP2_PDELAY_FOLLOW_UP {
 
 static_assert(sizeof(PTP2_PDELAY_RESP) == 20, "PTP2_PDELAY_FOLLOW_UP must be 34 bytes");
 
-template <typename T>
-struct PacketPTP {
-    static constexpr int DATA_OFFSET = sizeof(HeaderEthernet) + sizeof(HEADER_PTP);
+// PTP TLV types
+enum PTP2_TTYPE {
+    PTP2_TT_MANAGEMENT          = 0x0001,
+    PTP2_TT_MANAGEMENT_STATUS   = 0x0002,
+    PTP2_TT_ORGANIZATION_EXT    = 0x0003,
+    PTP2_TT_REQUEST_UNICAST     = 0x0004,
+    PTP2_TT_GRANT_UNICAST       = 0x0005,
+    PTP2_TT_CANCEL_UNICAST      = 0x0006,
+    PTP2_TT_ACK_CANCEL_UNICAST  = 0x0007,
+    PTP2_TT_PATH_TRACE          = 0x0008
+};
+
+struct [[gnu::packed]] PTP2_TLV_HEAD {
+    uint16_t tlvType;
+    uint16_t lengthField;
+};
+
+static_assert(sizeof(PTP2_TLV_HEAD) == 4, "PTP2_TLV_HEAD must be 4 bytes");
+
+struct [[gnu::packed]] PTP2_SIGNALING {
+    PTP2_SRC_IDENT targetPortIdentity;
+};
+
+static_assert(sizeof(PTP2_SIGNALING) == 10, "PTP2_SIGNALING must be 10 bytes");
+
+// REQUEST_UNICAST_TRANSMISSION
+struct [[gnu::packed]] PTP2_TLV_REQUEST_UNICAST {
+    PTP2_TLV_HEAD head;
+    uint8_t messageType; // upper nibble
+    int8_t logInterMessagePeriod;
+    uint32_t durationField;
+};
+
+static_assert(sizeof(PTP2_TLV_REQUEST_UNICAST) == 10, "PTP2_TLV_REQUEST_UNICAST must be 10 bytes");
+
+// GRANT_UNICAST_TRANSMISSION
+struct [[gnu::packed]] PTP2_TLV_GRANT_UNICAST {
+    PTP2_TLV_HEAD head;
+    uint8_t messageType; // upper nibble
+    int8_t logInterMessagePeriod;
+    uint32_t durationField;
+    uint8_t reserved;
+    uint8_t renewalInvited;
+};
+
+static_assert(sizeof(PTP2_TLV_GRANT_UNICAST) == 12, "PTP2_TLV_GRANT_UNICAST must be 12 bytes");
+
+// CANCEL_UNICAST_TRANSMISSION and ACKNOWLEDGE_CANCEL_UNICAST_TRANSMISSION
+struct [[gnu::packed]] PTP2_TLV_CANCEL_UNICAST {
+    PTP2_TLV_HEAD head;
+    uint8_t messageType; // upper nibble
+    uint8_t reserved;
+};
+
+static_assert(sizeof(PTP2_TLV_CANCEL_UNICAST) == 6, "PTP2_TLV_CANCEL_UNICAST must be 6 bytes");
+
+// PATH_TRACE with a single entry (IEEE 802.1AS 10.6.3.3)
+struct [[gnu::packed]] PTP2_TLV_PATH_TRACE {
+    PTP2_TLV_HEAD head;
+    uint8_t pathSequence[8];
+};
+
+static_assert(sizeof(PTP2_TLV_PATH_TRACE) == 12, "PTP2_TLV_PATH_TRACE must be 12 bytes");
+
+// Follow_Up information TLV (IEEE 802.1AS 11.4.4.3)
+struct [[gnu::packed]] PTP2_TLV_FOLLOW_UP_INFO {
+    PTP2_TLV_HEAD head;
+    uint8_t organizationId[3];
+    uint8_t organizationSubType[3];
+    int32_t cumulativeScaledRateOffset;
+    uint16_t gmTimeBaseIndicator;
+    uint8_t lastGmPhaseChange[12];
+    int32_t scaledLastGmFreqChange;
+};
+
+static_assert(sizeof(PTP2_TLV_FOLLOW_UP_INFO) == 32, "PTP2_TLV_FOLLOW_UP_INFO must be 32 bytes");
+
+// management message body (IEEE 1588 15.4.1)
+struct [[gnu::packed]] PTP2_MANAGEMENT {
+    PTP2_SRC_IDENT targetPortIdentity;
+    uint8_t startingBoundaryHops;
+    uint8_t boundaryHops;
+    uint8_t actionField; // lower nibble
+    uint8_t reserved;
+};
 
-    HeaderEthernet eth;
+static_assert(sizeof(PTP2_MANAGEMENT) == 14, "PTP2_MANAGEMENT must be 14 bytes");
+
+// MANAGEMENT TLV (data field follows)
+struct [[gnu::packed]] PTP2_TLV_MANAGEMENT {
+    PTP2_TLV_HEAD head;
+    uint16_t managementId;
+};
+
+static_assert(sizeof(PTP2_TLV_MANAGEMENT) == 6, "PTP2_TLV_MANAGEMENT must be 6 bytes");
+
+// MANAGEMENT_ERROR_STATUS TLV (without display data)
+struct [[gnu::packed]] PTP2_TLV_MANAGEMENT_ERROR {
+    PTP2_TLV_HEAD head;
+    uint16_t managementErrorId;
+    uint16_t managementId;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(PTP2_TLV_MANAGEMENT_ERROR) == 12, "PTP2_TLV_MANAGEMENT_ERROR must be 12 bytes");
+
+// DEFAULT_DATA_SET (IEEE 1588 15.5.3.3.1)
+struct [[gnu::packed]] PTP2_DEFAULT_DS {
+    uint8_t flags; // bit 0 two-step, bit 1 slave only
+    uint8_t reserved0;
+    uint16_t numberPorts;
+    uint8_t priority1;
+    PTP2_CLK_QUALITY clockQuality;
+    uint8_t priority2;
+    uint8_t clockIdentity[8];
+    uint8_t domainNumber;
+    uint8_t reserved1;
+};
+
+static_assert(sizeof(PTP2_DEFAULT_DS) == 20, "PTP2_DEFAULT_DS must be 20 bytes");
+
+// CURRENT_DATA_SET (IEEE 1588 15.5.3.4.1)
+struct [[gnu::packed]] PTP2_CURRENT_DS {
+    uint16_t stepsRemoved;
+    // nanoseconds scaled by 2^16
+    int64_t offsetFromMaster;
+    int64_t meanPathDelay;
+};
+
+static_assert(sizeof(PTP2_CURRENT_DS) == 18, "PTP2_CURRENT_DS must be 18 bytes");
+
+// PARENT_DATA_SET (IEEE 1588 15.5.3.5.1)
+struct [[gnu::packed]] PTP2_PARENT_DS {
+    PTP2_SRC_IDENT parentPortIdentity;
+    uint8_t parentStats;
+    uint8_t reserved;
+    uint16_t observedParentOffsetScaledLogVariance;
+    int32_t observedParentClockPhaseChangeRate;
+    uint8_t grandmasterPriority1;
+    PTP2_CLK_QUALITY grandmasterClockQuality;
+    uint8_t grandmasterPriority2;
+    uint8_t grandmasterIdentity[8];
+};
+
+static_assert(sizeof(PTP2_PARENT_DS) == 32, "PTP2_PARENT_DS must be 32 bytes");
+
+// TIME_PROPERTIES_DATA_SET (IEEE 1588 15.5.3.6.1)
+struct [[gnu::packed]] PTP2_TIME_PROPERTIES_DS {
+    int16_t currentUtcOffset;
+    uint8_t flags; // PTP2_FLAGS leap, UTC and traceability bits
+    uint8_t timeSource;
+};
+
+static_assert(sizeof(PTP2_TIME_PROPERTIES_DS) == 4, "PTP2_TIME_PROPERTIES_DS must be 4 bytes");
+
+// PORT_DATA_SET (IEEE 1588 15.5.3.7.1)
+struct [[gnu::packed]] PTP2_PORT_DS {
+    PTP2_SRC_IDENT portIdentity;
+    uint8_t portState;
+    int8_t logMinDelayReqInterval;
+    int64_t peerMeanPathDelay;
+    int8_t logAnnounceInterval;
+    uint8_t announceReceiptTimeout;
+    int8_t logSyncInterval;
+    uint8_t delayMechanism;
+    int8_t logMinPdelayReqInterval;
+    uint8_t versionNumber; // lower nibble
+};
+
+static_assert(sizeof(PTP2_PORT_DS) == 26, "PTP2_PORT_DS must be 26 bytes");
+
+// linuxptp PORT_STATS_NP (message counters are little-endian)
+struct [[gnu::packed]] PTP2_PORT_STATS_NP {
+    PTP2_SRC_IDENT portIdentity;
+    uint64_t rxMsgType[16];
+    uint64_t txMsgType[16];
+};
+
+static_assert(sizeof(PTP2_PORT_STATS_NP) == 266, "PTP2_PORT_STATS_NP must be 266 bytes");
+
+template <typename T>
+struct [[gnu::packed]] MessagePTP {
     HEADER_PTP ptp;
     T data;
 
-    static auto& from(void *frame) {
-        return *static_cast<PacketPTP<T>*>(frame);
+    static auto& from(void *message) {
+        return *static_cast<MessagePTP<T>*>(message);
     }
 
-    static auto& from(const void *frame) {
-        return *static_cast<const PacketPTP<T>*>(frame);
+    static auto& from(const void *message) {
+        return *static_cast<const MessagePTP<T>*>(message);
     }
 };
 
-static_assert(offsetof(PacketPTP<uint64_t>, data) == PacketPTP<uint64_t>::DATA_OFFSET, "PacketPTP.data is misaligned");
+static_assert(offsetof(MessagePTP<uint64_t>, data) == sizeof(HEADER_PTP), "MessagePTP.data is misaligned");
 
 
 // lut for PTP clock accuracy codes
@@ -150,9 +412,21 @@ extern const float lutClkAccuracy[17];
 // IEEE 802.1AS broadcast MAC address (01:80:C2:00:00:0E)
 extern const uint8_t gPtpMac[6];
 
+// IEEE 1588 layer-2 multicast MAC address (01:1B:19:00:00:00)
+extern const uint8_t ptpMac[6];
+
 // ID for the local clock
 extern uint8_t ptpClockId[8];
 
+/**
+ * Initialize the common header of an outbound PTP message (domain and majorSdoId follow the active profile)
+ * @param header header to initialize
+ * @param type message type
+ * @param size total message size (header and body)
+ * @param logInterval log2 message interval
+ */
+void initPtpHeader(HEADER_PTP &header, PTP2_MTYPE type, int size, int8_t logInterval);
+
 /**
  * Convert fixed-point 64-bit timestamp to PTP timestamp
  * @param ts fixed-point timestamp
@@ -167,9 +441,30 @@ void toPtpTimestamp(uint64_t ts, PTP2_TIMESTAMP *tsPtp);
  */
 uint64_t fromPtpTimestamp(const PTP2_TIMESTAMP *tsPtp);
 
+/**
+ * Convert a PTP correction field to a fixed-point 64-bit interval
+ * @param correction correction field (network byte-order, nanoseconds scaled by 2^16)
+ * @return signed fixed-point 64-bit interval
+ */
+int64_t fromPtpCorrection(uint64_t correction);
+
+/**
+ * Convert a fixed-point 64-bit interval to a PTP time interval
+ * @param interval signed fixed-point 64-bit interval
+ * @return time interval (network byte-order, nanoseconds scaled by 2^16)
+ */
+uint64_t toPtpCorrection(int64_t interval);
+
 /**
  * Translate clock RMS error into PTP accuracy code
  * @param rmsError
  * @return PTP accuracy code
  */
 uint32_t toPtpClkAccuracy(float rmsError);
+
+/**
+ * Translate clock RMS error into the PTP offsetScaledLogVariance
+ * @param rmsError
+ * @return scaled log2 variance (2^8 units, offset by 0x8000)
+ */
+uint16_t toPtpLogVariance(float rmsError);
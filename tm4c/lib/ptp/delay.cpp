@@ -0,0 +1,215 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "delay.hpp"
+
+#include "bmca.hpp"
+#include "../format.hpp"
+#include "../net.hpp"
+#include "../run.hpp"
+#include "../clock/mono.hpp"
+#include "../net/util.hpp"
+
+#ifndef PTP_DELAY_QUEUE
+// number of pending delay requests (power of two)
+#define PTP_DELAY_QUEUE (64)
+#endif
+
+static_assert((PTP_DELAY_QUEUE & (PTP_DELAY_QUEUE - 1)) == 0, "PTP_DELAY_QUEUE must be a power of two");
+
+static constexpr int QUEUE_MASK = PTP_DELAY_QUEUE - 1;
+// responses transmitted per task execution
+static constexpr int BATCH = 8;
+// transmit ring segments left free for multicast sync and announce messages (on top of the reserve)
+static constexpr int TX_FLOOR = ptp::transport::TX_RESERVE + 8;
+// back-off while the transmit ring is at the floor (about the wire time of a batch of responses)
+static constexpr uint32_t BACKOFF = RUN_SEC >> 14;
+// retry interval of the back-off task when it is not postponed
+static constexpr uint32_t RETRY_IDLE = RUN_SEC;
+// update rate for the latency statistics
+static constexpr float LATENCY_RATE = 1.0f / 64.0f;
+
+// compact delay request record
+struct Request {
+    ptp::Address dst;
+    PTP2_SRC_IDENT requester;
+    // network byte-order
+    uint16_t sequenceId;
+    uint16_t flags;
+    uint64_t correctionField;
+    int8_t logInterval;
+    // receive time (monotonic and TAI)
+    uint64_t rxMono;
+    uint64_t rxTime;
+};
+
+// ring of pending requests (free-running indices)
+static Request queue[PTP_DELAY_QUEUE];
+static uint32_t head;
+static uint32_t tail;
+static void *taskRespond;
+static void *taskRetry;
+
+// queue statistics
+static uint32_t cntQueued;
+static uint32_t cntSent;
+static uint32_t cntDropped;
+static uint32_t cntFailed;
+static uint32_t cntDeferred;
+static int depthPeak;
+static float latencyMean;
+static float latencyMax;
+
+static void runRespond(void *ref);
+static void runRetry(void *ref);
+
+void ptp::delay::init() {
+    head = 0;
+    tail = 0;
+    taskRespond = runWait(runRespond, nullptr);
+    taskRetry = runSleep(RETRY_IDLE, runRetry, nullptr);
+}
+
+bool ptp::delay::enqueue(const Address &dst, const HEADER_PTP &request, const uint64_t *stamps, const int8_t logInterval) {
+    if (head - tail >= PTP_DELAY_QUEUE) {
+        ++cntDropped;
+        return false;
+    }
+
+    auto &entry = queue[head & QUEUE_MASK];
+    entry.dst = dst;
+    entry.requester = request.sourceIdentity;
+    entry.sequenceId = request.sequenceId;
+    entry.flags = request.flags & htons(PTP2_FLAG_UNICAST);
+    entry.correctionField = request.correctionField;
+    entry.logInterval = logInterval;
+    entry.rxMono = stamps[0];
+    entry.rxTime = stamps[2];
+    ++head;
+    ++cntQueued;
+
+    const int depth = static_cast<int>(head - tail);
+    if (depth > depthPeak)
+        depthPeak = depth;
+
+    // responses are sent after the receive task has processed all pending frames
+    runWake(taskRespond);
+    return true;
+}
+
+/**
+ * Transmit the response to a queued delay request
+ * @param entry delay request record
+ * @return true if the response was added to the transmit buffer
+ */
+static bool respond(const Request &entry) {
+    MessagePTP<PTP2_DELAY_RESP> response = {};
+    initPtpHeader(response.ptp, PTP2_MT_DELAY_RESP, sizeof(response), entry.logInterval);
+    response.ptp.flags = entry.flags;
+    response.ptp.correctionField = entry.correctionField;
+    response.ptp.sequenceId = entry.sequenceId;
+    // copy source identity
+    response.data.requestingIdentity = entry.requester;
+    // set RX time
+    toPtpTimestamp(entry.rxTime, &response.data.receiveTimestamp);
+
+    // transmit response
+    return ptp::transport::send(entry.dst, false, &response, sizeof(response));
+}
+
+static void runRespond(void *ref) {
+    // only the master answers delay requests
+    if (!ptp::bmca::isMaster()) {
+        tail = head;
+        return;
+    }
+
+    const auto now = clock::monotonic::now();
+    int sent = 0;
+    while (tail != head && sent < BATCH) {
+        // leave room for multicast messages and other responses (resume once transmissions have completed)
+        if (network::getTxFree() <= TX_FLOOR) {
+            ++cntDeferred;
+            runDelay(taskRetry, BACKOFF);
+            return;
+        }
+        const auto &entry = queue[tail & QUEUE_MASK];
+        ++tail;
+        // the request cannot be answered (e.g. no IP address for a UDP response)
+        if (!respond(entry)) {
+            ++cntFailed;
+            continue;
+        }
+        ++sent;
+        ++cntSent;
+
+        // receive to transmit latency
+        const float latency = 0x1p-32f * static_cast<float>(static_cast<int64_t>(now - entry.rxMono));
+        latencyMean += (latency - latencyMean) * LATENCY_RATE;
+        if (latency > latencyMax)
+            latencyMax = latency;
+    }
+
+    // yield to other tasks before the next batch
+    if (tail != head)
+        runWake(taskRespond);
+}
+
+static void runRetry(void *ref) {
+    if (tail != head)
+        runWake(taskRespond);
+}
+
+unsigned ptp::delay::status(char *buffer) {
+    char tmp[32];
+    char *end = buffer;
+
+    end = append(end, "delay status:\n");
+
+    tmp[toBase(head - tail, 10, tmp)] = 0;
+    end = append(end, "  - queue:     ");
+    end = append(end, tmp);
+    end = append(end, " (peak ");
+    tmp[toBase(depthPeak, 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, " / ");
+    tmp[toBase(PTP_DELAY_QUEUE, 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, ")\n");
+
+    tmp[toBase(cntQueued, 10, tmp)] = 0;
+    end = append(end, "  - requests:  ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(cntSent, 10, tmp)] = 0;
+    end = append(end, "  - responses: ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(cntDropped, 10, tmp)] = 0;
+    end = append(end, "  - dropped:   ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(cntFailed, 10, tmp)] = 0;
+    end = append(end, "  - failed:    ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(cntDeferred, 10, tmp)] = 0;
+    end = append(end, "  - deferred:  ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[fmtFloat(1e6f * latencyMean, 0, 3, tmp)] = 0;
+    end = append(end, "  - wait:      ");
+    end = append(end, tmp);
+    tmp[fmtFloat(1e6f * latencyMax, 0, 3, tmp)] = 0;
+    end = append(end, " us mean, ");
+    end = append(end, tmp);
+    end = append(end, " us max\n");
+
+    return end - buffer;
+}
@@ -0,0 +1,41 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+#include "common.hpp"
+#include "transport.hpp"
+
+/**
+ * Delay request-response mechanism (IEEE 1588 clause 11.3).
+ * Received Delay_Req messages are reduced to compact records in a bounded queue. A waiting task drains the queue in
+ * batches while the transmit ring has room above the space kept for multicast messages, so a burst of requests
+ * cannot starve Sync and Announce transmission; at the floor it backs off briefly instead of polling the ring.
+ * Requests that do not fit in the queue or whose response cannot be sent are dropped and counted.
+ */
+namespace ptp::delay {
+    /**
+     * Initialize the request queue and start the response task
+     */
+    void init();
+
+    /**
+     * Queue the response to a delay request
+     * @param dst destination of the response
+     * @param request header of the delay request
+     * @param stamps receive timestamps of the request (monotonic, compensated, TAI)
+     * @param logInterval log2 interval to report in the response
+     * @return false if the queue was full and the request was dropped
+     */
+    bool enqueue(const Address &dst, const HEADER_PTP &request, const uint64_t *stamps, int8_t logInterval);
+
+    /**
+     * Write current status of the delay response queue to a buffer
+     * @param buffer destination for status information
+     * @return number of bytes written to buffer
+     */
+    unsigned status(char *buffer);
+}
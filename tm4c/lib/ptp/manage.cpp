@@ -0,0 +1,241 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "manage.hpp"
+
+#include "bmca.hpp"
+#include "common.hpp"
+#include "profile.hpp"
+#include "ptp.hpp"
+#include "../net/util.hpp"
+
+#include <memory.h>
+
+// offset of the management TLV within a message
+static constexpr int TLV_OFFSET = sizeof(MessagePTP<PTP2_MANAGEMENT>);
+// largest data field of a response
+static constexpr int MAX_DATA = sizeof(PTP2_PORT_STATS_NP);
+// port number of the local clock
+static constexpr uint16_t PORT_NUMBER = 1;
+
+// latest measurement of the parent master
+static int64_t currentOffset;
+static float currentDelay;
+
+// request statistics
+static uint32_t cntAnswered;
+static uint32_t cntRefused;
+
+void ptp::manage::setCurrent(const int64_t offset, const float delay) {
+    currentOffset = offset;
+    currentDelay = delay;
+}
+
+uint32_t ptp::manage::getCount(const bool refused) {
+    return refused ? cntRefused : cntAnswered;
+}
+
+/**
+ * Check if a management message is addressed to this port
+ * @param target target port identity of the message
+ * @return true for wildcards and the identity of this port
+ */
+static bool isTarget(const PTP2_SRC_IDENT &target) {
+    static constexpr uint8_t wildcard[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    if (memcmp(target.identity, wildcard, 8) != 0 && memcmp(target.identity, ptpClockId, 8) != 0)
+        return false;
+    const auto port = htons(target.portNumber);
+    return port == 0xFFFF || port == PORT_NUMBER;
+}
+
+/**
+ * Set the port identity of the local clock
+ * @param identity destination
+ */
+static void setPortIdentity(PTP2_SRC_IDENT &identity) {
+    memcpy(identity.identity, ptpClockId, sizeof(identity.identity));
+    identity.portNumber = htons(PORT_NUMBER);
+}
+
+/**
+ * Get the data set of the grandmaster (the parent master or the local clock)
+ * @param grandmaster data set to populate
+ * @return true if a foreign master is the parent
+ */
+static bool getGrandmaster(ptp::bmca::DataSet &grandmaster) {
+    ptp::Address addr;
+    if (ptp::bmca::getParent(grandmaster, addr))
+        return true;
+    ptp::bmca::getLocal(grandmaster);
+    return false;
+}
+
+static int encodeDefault(uint8_t *data) {
+    ptp::bmca::DataSet local;
+    ptp::bmca::getLocal(local);
+
+    auto &ds = *reinterpret_cast<PTP2_DEFAULT_DS*>(data);
+    // ordinary clock (two-step unless follow-up messages are suppressed)
+    ds.flags = ptp::isOneStep() ? 0x00 : 0x01;
+    ds.numberPorts = htons(1);
+    ds.priority1 = local.priority1;
+    ds.clockQuality = local.quality;
+    ds.clockQuality.offsetScaledLogVariance = htons(local.quality.offsetScaledLogVariance);
+    ds.priority2 = local.priority2;
+    memcpy(ds.clockIdentity, ptpClockId, sizeof(ds.clockIdentity));
+    ds.domainNumber = ptp::profile::active().domain;
+    return sizeof(ds);
+}
+
+static int encodeCurrent(uint8_t *data) {
+    auto &ds = *reinterpret_cast<PTP2_CURRENT_DS*>(data);
+    ptp::bmca::DataSet parent;
+    if (getGrandmaster(parent)) {
+        ds.stepsRemoved = htons(parent.stepsRemoved + 1);
+        ds.offsetFromMaster = static_cast<int64_t>(toPtpCorrection(currentOffset));
+        ds.meanPathDelay = static_cast<int64_t>(toPtpCorrection(static_cast<int64_t>(0x1p32f * currentDelay)));
+    }
+    return sizeof(ds);
+}
+
+static int encodeParent(uint8_t *data) {
+    auto &ds = *reinterpret_cast<PTP2_PARENT_DS*>(data);
+    ptp::bmca::DataSet grandmaster;
+    if (getGrandmaster(grandmaster)) {
+        ds.parentPortIdentity = grandmaster.sender;
+        ds.parentPortIdentity.portNumber = htons(grandmaster.sender.portNumber);
+    }
+    else
+        setPortIdentity(ds.parentPortIdentity);
+    // parent statistics are not computed
+    ds.observedParentOffsetScaledLogVariance = htons(0xFFFF);
+    ds.observedParentClockPhaseChangeRate = htonl(0x7FFFFFFF);
+    ds.grandmasterPriority1 = grandmaster.priority1;
+    ds.grandmasterClockQuality = grandmaster.quality;
+    ds.grandmasterClockQuality.offsetScaledLogVariance = htons(grandmaster.quality.offsetScaledLogVariance);
+    ds.grandmasterPriority2 = grandmaster.priority2;
+    memcpy(ds.grandmasterIdentity, grandmaster.identity, sizeof(ds.grandmasterIdentity));
+    return sizeof(ds);
+}
+
+static int encodeTimeProperties(uint8_t *data) {
+    auto &ds = *reinterpret_cast<PTP2_TIME_PROPERTIES_DS*>(data);
+    ptp::bmca::DataSet grandmaster;
+    getGrandmaster(grandmaster);
+    ds.currentUtcOffset = static_cast<int16_t>(htons(grandmaster.utcOffset));
+    // leap, UTC and traceability bits occupy the second octet of the announce flags
+    ds.flags = grandmaster.timeFlags & 0xFF;
+    ds.timeSource = grandmaster.timeSource;
+    return sizeof(ds);
+}
+
+static int encodePort(uint8_t *data) {
+    const auto &active = ptp::profile::active();
+    auto &ds = *reinterpret_cast<PTP2_PORT_DS*>(data);
+    setPortIdentity(ds.portIdentity);
+    ds.portState = ptp::bmca::getState();
+    ds.logMinDelayReqInterval = active.logDelay;
+    ds.logAnnounceInterval = active.logAnnounce;
+    ds.announceReceiptTimeout = ptp::bmca::ANNOUNCE_TIMEOUT;
+    ds.logSyncInterval = active.logSync;
+    ds.delayMechanism = PTP2_DM_E2E;
+    ds.versionNumber = PTP2_VERSION;
+    return sizeof(ds);
+}
+
+static int encodePortStats(uint8_t *data) {
+    auto &ds = *reinterpret_cast<PTP2_PORT_STATS_NP*>(data);
+    setPortIdentity(ds.portIdentity);
+    // counters are little-endian (native byte-order of the target)
+    for (int type = 0; type < 16; ++type) {
+        ds.rxMsgType[type] = ptp::transport::getCount(type, false);
+        ds.txMsgType[type] = ptp::transport::getCount(type, true);
+    }
+    return sizeof(ds);
+}
+
+void ptp::manage::process(const Address &replyTo, const uint8_t *message, const int size) {
+    // verify message length
+    if (size < TLV_OFFSET + static_cast<int>(sizeof(PTP2_TLV_MANAGEMENT)))
+        return;
+    const auto &request = MessagePTP<PTP2_MANAGEMENT>::from(message);
+    const auto &tlv = *reinterpret_cast<const PTP2_TLV_MANAGEMENT*>(message + TLV_OFFSET);
+    if (htons(tlv.head.tlvType) != PTP2_TT_MANAGEMENT)
+        return;
+    if (TLV_OFFSET + static_cast<int>(sizeof(tlv.head)) + htons(tlv.head.lengthField) > size)
+        return;
+    if (!isTarget(request.data.targetPortIdentity))
+        return;
+    // responses and acknowledgements from other clocks
+    const auto action = request.data.actionField & 0xF;
+    if (action != PTP2_MA_GET && action != PTP2_MA_SET && action != PTP2_MA_COMMAND)
+        return;
+
+    uint8_t buffer[TLV_OFFSET + sizeof(PTP2_TLV_MANAGEMENT) + MAX_DATA];
+    memset(buffer, 0, sizeof(buffer));
+    auto &response = MessagePTP<PTP2_MANAGEMENT>::from(buffer);
+    response.data.targetPortIdentity = request.ptp.sourceIdentity;
+    response.data.startingBoundaryHops = request.data.startingBoundaryHops - request.data.boundaryHops;
+    response.data.boundaryHops = response.data.startingBoundaryHops;
+    response.data.actionField = action == PTP2_MA_COMMAND ? PTP2_MA_ACKNOWLEDGE : PTP2_MA_RESPONSE;
+
+    // encode the requested data set
+    const auto id = htons(tlv.managementId);
+    auto data = buffer + TLV_OFFSET + sizeof(PTP2_TLV_MANAGEMENT);
+    int length = -1;
+    switch (id) {
+        case PTP2_MID_NULL_MANAGEMENT:
+            length = 0;
+            break;
+        case PTP2_MID_DEFAULT_DATA_SET:
+            length = encodeDefault(data);
+            break;
+        case PTP2_MID_CURRENT_DATA_SET:
+            length = encodeCurrent(data);
+            break;
+        case PTP2_MID_PARENT_DATA_SET:
+            length = encodeParent(data);
+            break;
+        case PTP2_MID_TIME_PROPERTIES:
+            length = encodeTimeProperties(data);
+            break;
+        case PTP2_MID_PORT_DATA_SET:
+            length = encodePort(data);
+            break;
+        case PTP2_MID_PORT_STATS_NP:
+            length = encodePortStats(data);
+            break;
+        default:
+            break;
+    }
+
+    int tlvSize;
+    // data sets are read-only (NULL_MANAGEMENT is valid for every action)
+    if (length >= 0 && (action == PTP2_MA_GET || id == PTP2_MID_NULL_MANAGEMENT)) {
+        auto &result = *reinterpret_cast<PTP2_TLV_MANAGEMENT*>(buffer + TLV_OFFSET);
+        result.head.tlvType = htons(PTP2_TT_MANAGEMENT);
+        result.head.lengthField = htons(sizeof(result.managementId) + length);
+        result.managementId = tlv.managementId;
+        tlvSize = static_cast<int>(sizeof(result)) + length;
+        ++cntAnswered;
+    }
+    else {
+        auto &error = *reinterpret_cast<PTP2_TLV_MANAGEMENT_ERROR*>(buffer + TLV_OFFSET);
+        memset(&error, 0, sizeof(error));
+        error.head.tlvType = htons(PTP2_TT_MANAGEMENT_STATUS);
+        error.head.lengthField = htons(sizeof(error) - sizeof(error.head));
+        error.managementErrorId = htons(length < 0 ? PTP2_ME_NO_SUCH_ID : PTP2_ME_NOT_SUPPORTED);
+        error.managementId = tlv.managementId;
+        tlvSize = sizeof(error);
+        ++cntRefused;
+    }
+
+    const int responseSize = TLV_OFFSET + tlvSize;
+    initPtpHeader(response.ptp, PTP2_MT_MANAGEMENT, responseSize, 0x7F);
+    response.ptp.flags = request.ptp.flags & htons(PTP2_FLAG_UNICAST);
+    response.ptp.sequenceId = request.ptp.sequenceId;
+
+    // transmit response
+    transport::send(replyTo, false, buffer, responseSize);
+}
@@ -0,0 +1,39 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+#include "transport.hpp"
+
+/**
+ * Management messages (IEEE 1588 clause 15).
+ * GET requests for the default, current, parent, time properties and port data sets are answered from the live
+ * state of the port, as is the linuxptp PORT_STATS_NP request for the per message type counters, so the clock can
+ * be monitored with `pmc`. SET and COMMAND requests are refused with a NOT_SUPPORTED error status.
+ */
+namespace ptp::manage {
+    /**
+     * Process a management message
+     * @param replyTo destination of the response
+     * @param message PTP message (header and body)
+     * @param size size of the message
+     */
+    void process(const Address &replyTo, const uint8_t *message, int size);
+
+    /**
+     * Record the latest measurement of the parent master for the current data set
+     * @param offset offset from the master (local minus master, 32.32 fixed point)
+     * @param delay mean path delay in seconds
+     */
+    void setCurrent(int64_t offset, float delay);
+
+    /**
+     * Get the number of management requests answered and refused
+     * @param refused true for refused requests (error status responses)
+     * @return request count
+     */
+    uint32_t getCount(bool refused);
+}
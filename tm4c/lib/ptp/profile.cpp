@@ -0,0 +1,60 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "profile.hpp"
+
+#include "common.hpp"
+#include "transport.hpp"
+
+#include <cstring>
+
+#ifndef PTP_TRANSPORTS
+// transports used for multicast messages by the default profile
+#define PTP_TRANSPORTS (ptp::TRANSPORT_L2 | ptp::TRANSPORT_UDP)
+#endif
+
+#ifdef PTP_ONE_STEP
+// the default profile sends one-step sync
+static constexpr bool DEFAULT_ONE_STEP = true;
+#else
+// the default profile is always two-step
+static constexpr bool DEFAULT_ONE_STEP = false;
+#endif
+
+static constexpr ptp::Profile PROFILES[ptp::PROFILE_COUNT] = {
+    // 1 s announce, 16 Hz sync
+    {"default", PTP2_DOMAIN, 0, 0, -4, 0, PTP_TRANSPORTS, {0x01, 0x1B, 0x19, 0x00, 0x00, 0x00}, DEFAULT_ONE_STEP},
+    // 1 s announce, 8 Hz sync, layer-2 only
+    {"gptp", 0, ptp::profile::SDO_GPTP, 0, -3, 0, ptp::TRANSPORT_L2, {0x01, 0x80, 0xC2, 0x00, 0x00, 0x0E}, false},
+    // 8 Hz announce, 128 Hz sync, layer-2 forwardable address
+    {"telecom", 24, 0, -3, -7, -7, ptp::TRANSPORT_L2, {0x01, 0x1B, 0x19, 0x00, 0x00, 0x00}, true},
+};
+
+static ptp::ProfileId activeProfile = ptp::PROFILE_DEFAULT;
+
+const ptp::Profile& ptp::profile::active() {
+    return PROFILES[activeProfile];
+}
+
+ptp::ProfileId ptp::profile::activeId() {
+    return activeProfile;
+}
+
+const ptp::Profile& ptp::profile::get(const ProfileId id) {
+    return PROFILES[id];
+}
+
+int ptp::profile::find(const char *name, const int length) {
+    for (int i = 0; i < PROFILE_COUNT; ++i) {
+        const auto pname = PROFILES[i].name;
+        if (static_cast<int>(strlen(pname)) == length && strncmp(pname, name, length) == 0)
+            return i;
+    }
+    return -1;
+}
+
+void ptp::profile::select(const ProfileId id) {
+    if (id < PROFILE_COUNT)
+        activeProfile = id;
+}
@@ -0,0 +1,84 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace ptp {
+    /**
+     * Parameters of the multicast PTP service
+     */
+    struct Profile {
+        // name used for selection and status
+        const char *name;
+        // domain number of all messages
+        uint8_t domain;
+        // majorSdoId (transportSpecific) of all messages
+        uint8_t sdoId;
+        // log2 intervals of multicast messages
+        int8_t logAnnounce;
+        int8_t logSync;
+        // log2 delay request interval reported in multicast Delay_Resp messages
+        int8_t logDelay;
+        // transports used for multicast messages
+        uint8_t transports;
+        // layer-2 multicast address
+        uint8_t mac[6];
+        // one-step sync permitted (follow-up suppressed while the predicted origin timestamp is accurate)
+        bool oneStep;
+    };
+
+    /**
+     * Built-in profiles
+     */
+    enum ProfileId : uint8_t {
+        // IEEE 1588 default delay request-response profile
+        PROFILE_DEFAULT = 0,
+        // IEEE 802.1AS generalized PTP
+        PROFILE_GPTP = 1,
+        // ITU-T G.8275.1 style layer-2 profile with high-rate sync
+        PROFILE_TELECOM = 2,
+        // number of profiles
+        PROFILE_COUNT = 3
+    };
+}
+
+namespace ptp::profile {
+    // majorSdoId of IEEE 802.1AS messages
+    static constexpr uint8_t SDO_GPTP = 1;
+
+    /**
+     * Get the active profile
+     * @return active profile parameters
+     */
+    const Profile& active();
+
+    /**
+     * Get the identifier of the active profile
+     * @return active profile identifier
+     */
+    ProfileId activeId();
+
+    /**
+     * Get the parameters of a profile
+     * @param id profile identifier
+     * @return profile parameters
+     */
+    const Profile& get(ProfileId id);
+
+    /**
+     * Find a profile by name
+     * @param name profile name (need not be null-terminated)
+     * @param length length of the name
+     * @return profile identifier or -1 if there is no such profile
+     */
+    int find(const char *name, int length);
+
+    /**
+     * Change the active profile (message scheduling is updated by the PTP server)
+     * @param id profile identifier
+     */
+    void select(ProfileId id);
+}
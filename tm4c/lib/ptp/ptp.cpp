@@ -4,193 +4,463 @@
 
 #include "ptp.hpp"
 
+#include "bmca.hpp"
 #include "common.hpp"
+#include "delay.hpp"
+#include "manage.hpp"
+#include "profile.hpp"
+#include "transport.hpp"
+#include "unicast.hpp"
+#include "../format.hpp"
 #include "../led.hpp"
 #include "../net.hpp"
 #include "../run.hpp"
+#include "../store.hpp"
+#include "../clock/mono.hpp"
 #include "../clock/tai.hpp"
 #include "../net/util.hpp"
-#include "../ntp/GPS.hpp"
-#include "../ntp/ntp.hpp"
-#include "../ntp/pll.hpp"
 
-#include <algorithm>
+#include <cmath>
 #include <memory.h>
 
-
-#define PTP2_ANNC_LOG_INTV (0) // 1 s
-#define PTP2_SYNC_LOG_INTV (-4) // 16 Hz
+#ifndef PTP_ONE_STEP_BOUND
+// largest origin timestamp error (ns) for one-step sync (0 disables one-step sync)
+// (just over one 40 ns tick of the hardware timestamp clock)
+#define PTP_ONE_STEP_BOUND (50)
+#endif
+
+
+// transports in order of transmission
+static constexpr ptp::Transport TRANSPORTS[] = {ptp::TRANSPORT_L2, ptp::TRANSPORT_UDP};
+static constexpr int TRANSPORT_COUNT = sizeof(TRANSPORTS) / sizeof(TRANSPORTS[0]);
+// update rate for the sync departure statistics
+static constexpr float JITTER_RATE = 1.0f / 64.0f;
+// free segments of an idle transmit ring
+static constexpr int TX_IDLE = 127;
+// update rate of the predicted queue to wire latency
+static constexpr float PREDICT_RATE = 1.0f / 8.0f;
+// latency measurements beyond this limit are not used for prediction (seconds)
+static constexpr float PREDICT_LIMIT = 1e-3f;
+// origin timestamp error bound for one-step sync (seconds)
+static constexpr float ONE_STEP_BOUND = 1e-9f * PTP_ONE_STEP_BOUND;
+// consecutive sync messages within the bound required for one-step sync
+static constexpr int ONE_STEP_QUALIFY = 32;
+// upper limits of the origin timestamp error histogram bins (seconds)
+static constexpr float ERROR_BINS[] = {20e-9f, 50e-9f, 100e-9f, 200e-9f, 500e-9f, 1e-6f, 10e-6f};
+static constexpr const char *ERROR_LABELS[] = {"<20ns ", "<50ns ", "<100ns ", "<200ns ", "<500ns ", "<1us ", "<10us ", "more "};
+static constexpr int ERROR_BIN_COUNT = sizeof(ERROR_LABELS) / sizeof(ERROR_LABELS[0]);
 
 uint8_t ptpClockId[8];
-static volatile uint32_t seqId;
-
-static void processDelayRequest(const uint8_t *frame, int size);
-static void processPDelayRequest(const uint8_t *frame, int size);
+static volatile uint16_t seqAnnounce;
+static volatile uint16_t seqSync;
+static void *taskAnnounce;
+static void *taskSync;
+
+// handler for messages from the parent master
+static ptp::CallbackSlave slaveCallback;
+static void *slaveRef;
+
+// multicast messages withheld by admission control
+static uint32_t skipAnnounce;
+static uint32_t skipSync;
+
+// sync departure statistics (monotonic clock)
+static uint64_t syncQueued;
+static uint64_t syncDeparted;
+static uint16_t syncPending;
+static bool syncMeasure;
+static float jitterMS;
+static float jitterMax;
+static float latencyMean;
+static float latencyMax;
+
+// precision sync (origin timestamps aimed at the predicted departure of each transmission)
+static uint64_t syncOrigin[TRANSPORT_COUNT];
+static float syncPredict[TRANSPORT_COUNT];
+static uint8_t syncTrack;
+static bool oneStep;
+static int oneStepRun;
+static uint32_t cntOneStep;
+static uint32_t cntRevert;
+// origin timestamp error statistics
+static float originMS;
+static float originMax;
+static uint32_t originBins[ERROR_BIN_COUNT];
+
+// overrides the weak reference in net.cpp and handles the UDP ports
+void PTP_process(uint8_t *frame, int size);
+static void processDelayRequest(const ptp::Address &src, const ptp::Address &dst, const HEADER_PTP &request, int size);
+static void processPDelayRequest(const ptp::Address &src, const ptp::Address &dst, const HEADER_PTP &request, int size);
+
+static void runAnnounce(void *ref);
+static void runSync(void *ref);
 
-static void sendAnnounce(void *ref);
-static void sendSync(void *ref);
+/**
+ * Convert a log2 message interval to a scheduler interval
+ * @param logInterval log2 message interval
+ * @return interval in 8.24 fixed point format
+ */
+static uint32_t toInterval(const int8_t logInterval) {
+    return logInterval < 0 ? RUN_SEC >> -logInterval : RUN_SEC << logInterval;
+}
 
 void ptp::init() {
     // set clock ID to MAC address
     getMAC(ptpClockId + 2);
 
-    // schedule periodic message transmission
-    runSleep(RUN_SEC >> -PTP2_ANNC_LOG_INTV, sendAnnounce, nullptr);
-    runSleep(RUN_SEC >> -PTP2_SYNC_LOG_INTV, sendSync, nullptr);
+    // restore the selected profile
+    uint32_t record;
+    if (store::load(store::ID_PTP, &record, 1) && record < PROFILE_COUNT)
+        profile::select(static_cast<ProfileId>(record));
+
+    // listen for UDP event and general messages
+    UDP_register(PTP2_PORT_EVENT, PTP_process);
+    UDP_register(PTP2_PORT_GENERAL, PTP_process);
+    // unicast negotiation
+    ptp::unicast::init();
+    // master selection
+    ptp::bmca::init();
+    // delay request queue
+    ptp::delay::init();
+
+    // schedule periodic message transmission at the exact profile rates
+    const auto &active = profile::active();
+    taskAnnounce = runPeriodic(toInterval(active.logAnnounce), runAnnounce, nullptr);
+    taskSync = runPeriodic(toInterval(active.logSync), runSync, nullptr);
+}
+
+bool ptp::setProfile(const char *name, const int length) {
+    const int id = profile::find(name, length);
+    if (id < 0)
+        return false;
+    // reselecting the active profile must not disturb the port
+    if (id == profile::activeId())
+        return true;
+    profile::select(static_cast<ProfileId>(id));
+
+    // reschedule periodic messages
+    const auto &active = profile::active();
+    runAdjust(taskAnnounce, toInterval(active.logAnnounce));
+    runAdjust(taskSync, toInterval(active.logSync));
+    // masters of the previous domain no longer apply
+    bmca::reset();
+
+    // restart sync departure statistics
+    syncMeasure = false;
+    syncDeparted = 0;
+    jitterMS = 0;
+    jitterMax = 0;
+    latencyMean = 0;
+    latencyMax = 0;
+    // restart precision sync
+    memset(syncPredict, 0, sizeof(syncPredict));
+    syncTrack = 0;
+    oneStep = false;
+    oneStepRun = 0;
+    originMS = 0;
+    originMax = 0;
+    memset(originBins, 0, sizeof(originBins));
+
+    // persist the selection
+    const uint32_t record = id;
+    store::save(store::ID_PTP, &record, 1);
+    return true;
+}
+
+void ptp::onSlave(const CallbackSlave callback, void *ref) {
+    slaveCallback = callback;
+    slaveRef = ref;
+}
+
+/**
+ * Count the transports used for multicast messages
+ * @return number of multicast transports of the active profile
+ */
+static int countMulticast() {
+    int count = 0;
+    for (const auto transport : TRANSPORTS) {
+        if (ptp::profile::active().transports & transport)
+            ++count;
+    }
+    return count;
+}
+
+/**
+ * Send a message to the multicast address of every enabled transport
+ * @param event true for event messages
+ * @param message PTP message
+ * @param size message size
+ * @param callback transmit completion callback
+ */
+static void sendMulticast(const bool event, const void *message, const int size, const network::CallbackTx callback) {
+    for (const auto transport : TRANSPORTS) {
+        if (ptp::profile::active().transports & transport)
+            ptp::transport::send(ptp::transport::multicast(transport), event, message, size, callback, nullptr);
+    }
 }
 
 /**
- * Handles raw ethernet PTP frames
+ * Select the destination of a response
+ * @param src source address of the request
+ * @param dst destination address of the request
+ * @return the multicast group for UDP multicast requests, otherwise the requester
+ */
+static const ptp::Address& replyTo(const ptp::Address &src, const ptp::Address &dst) {
+    if (dst.transport == ptp::TRANSPORT_UDP && ptp::transport::isMulticast(dst))
+        return dst;
+    return src;
+}
+
+/**
+ * Handles PTP frames from the layer-2 and UDP/IPv4 transports
  * @param frame
  * @param size
  */
 void PTP_process(uint8_t *frame, const int size) {
-    auto &packet = PacketPTP<char>::from(frame);
+    ptp::Address src, dst;
+    const int offset = ptp::transport::parse(frame, size, src, dst);
+    if (offset < 0)
+        return;
+    const auto &header = *reinterpret_cast<const HEADER_PTP*>(frame + offset);
 
     // ignore anything we sent ourselves
-    if (isMyMAC(packet.eth.macSrc) == 0)
+    if (isMyMAC(src.mac) == 0)
+        return;
+    // ignore messages for other hosts
+    if (!ptp::transport::isLocal(dst))
         return;
-    // ignore unsupported versions
-    if (packet.ptp.versionPTP != 2)
+    // ignore unsupported versions and other domains
+    if (header.versionPTP != 2 || header.domainNumber != ptp::profile::active().domain)
         return;
-    // flip mac address for reply
-    copyMAC(packet.eth.macDst, packet.eth.macSrc);
 
     // indicate time-server activity
     LED_act0();
-
-    if (packet.ptp.messageType == PTP2_MT_DELAY_REQ)
-        return processDelayRequest(frame, size);
-    if (packet.ptp.messageType == PTP2_MT_PDELAY_REQ)
-        return processPDelayRequest(frame, size);
+    ptp::transport::countRx(header.messageType);
+
+    if (header.messageType == PTP2_MT_DELAY_REQ)
+        return processDelayRequest(src, dst, header, size - offset);
+    if (header.messageType == PTP2_MT_PDELAY_REQ)
+        return processPDelayRequest(src, dst, header, size - offset);
+    if (header.messageType == PTP2_MT_SIGNALING)
+        return ptp::unicast::process(src, frame + offset, size - offset);
+    if (header.messageType == PTP2_MT_ANNOUNCE)
+        return ptp::bmca::process(src, frame + offset, size - offset);
+    if (header.messageType == PTP2_MT_MANAGEMENT)
+        return ptp::manage::process(replyTo(src, dst), frame + offset, size - offset);
+
+    // timing messages from other masters
+    if (
+        slaveCallback != nullptr && (
+            header.messageType == PTP2_MT_SYNC ||
+            header.messageType == PTP2_MT_FOLLOW_UP ||
+            header.messageType == PTP2_MT_DELAY_RESP
+        )
+    )
+        (*slaveCallback)(slaveRef, src, frame + offset, size - offset);
 }
 
-static void processDelayRequest(const uint8_t *frame, int size) {
+static void processDelayRequest(const ptp::Address &src, const ptp::Address &dst, const HEADER_PTP &request, const int size) {
+    // only the master answers delay requests
+    if (!ptp::bmca::isMaster())
+        return;
     // verify request length
-    if (size < static_cast<int>(PTP2_MIN_SIZE + sizeof(PTP2_TIMESTAMP)))
+    if (size < static_cast<int>(sizeof(HEADER_PTP) + sizeof(PTP2_TIMESTAMP)))
         return;
 
-    // copy and resize frame
-    constexpr int txSize = PTP2_MIN_SIZE + sizeof(PTP2_DELAY_RESP);
-    uint8_t txFrame[txSize] = {};
-    memcpy(txFrame, frame, std::min(size, txSize));
-
-    // map headers
-    auto &response = PacketPTP<PTP2_DELAY_RESP>::from(txFrame);
-
-    // copy source identity
-    response.data.requestingIdentity = response.ptp.sourceIdentity;
-    // set RX time
+    // get RX time
     uint64_t stamps[3];
     network::getRxTime(stamps);
-    toPtpTimestamp(stamps[2], &(response.data.receiveTimestamp));
-
-    // PTP header
-    response.ptp.versionPTP = PTP2_VERSION;
-    response.ptp.messageType = PTP2_MT_DELAY_RESP;
-    response.ptp.messageLength = htons(sizeof(HEADER_PTP) + sizeof(PTP2_DELAY_RESP));
-    memcpy(response.ptp.sourceIdentity.identity, ptpClockId, sizeof(ptpClockId));
-    response.ptp.sourceIdentity.portNumber = 0;
-    response.ptp.domainNumber = PTP2_DOMAIN;
-    response.ptp.logMessageInterval = 0;
 
-    // transmit response
-    network::transmit(txFrame, txSize);
+    // report the granted request interval to unicast slaves
+    const bool unicast = request.flags & htons(PTP2_FLAG_UNICAST);
+    const auto logDelay = ptp::profile::active().logDelay;
+    const auto logInterval = unicast ? ptp::unicast::delayInterval(request.sourceIdentity, logDelay) : logDelay;
+    // the response is sent by the delay response task
+    ptp::delay::enqueue(replyTo(src, dst), request, stamps, logInterval);
 }
 
-static void peerDelayRespFollowup(void *ref, const uint8_t *frame, int size) {
+static void peerDelayRespFollowup(void *ref, const uint8_t *frame, const int size) {
     // get precise TX time
     uint64_t stamps[3];
     network::getTxTime(stamps);
 
-    // copy and resize frame
-    constexpr int txSize = PTP2_MIN_SIZE + sizeof(PTP2_PDELAY_FOLLOW_UP);
-    uint8_t txFrame[txSize] = {};
-    memcpy(txFrame, frame, std::min(size, txSize));
-
-    // map headers
-    auto &response = PacketPTP<PTP2_PDELAY_FOLLOW_UP>::from(txFrame);
+    // locate response message
+    ptp::Address src, dst;
+    const int offset = ptp::transport::parse(frame, size, src, dst);
+    if (offset < 0)
+        return;
+    const auto &response = MessagePTP<PTP2_PDELAY_RESP>::from(frame + offset);
 
-    // set followup fields
-    response.ptp.messageType = PTP2_MT_PDELAY_FOLLOW_UP;
-    response.ptp.messageLength = htons(sizeof(HEADER_PTP) + sizeof(PTP2_PDELAY_FOLLOW_UP));
-    toPtpTimestamp(stamps[2], &(response.data.responseTimestamp));
+    MessagePTP<PTP2_PDELAY_FOLLOW_UP> followup = {};
+    initPtpHeader(followup.ptp, PTP2_MT_PDELAY_FOLLOW_UP, sizeof(followup), response.ptp.logMessageInterval);
+    followup.ptp.flags = response.ptp.flags & htons(PTP2_FLAG_UNICAST);
+    followup.ptp.sequenceId = response.ptp.sequenceId;
+    followup.data.requestingIdentity = response.data.requestingIdentity;
+    toPtpTimestamp(stamps[2], &followup.data.responseTimestamp);
 
-    // transmit request
-    network::transmit(txFrame, txSize);
+    // transmit followup
+    ptp::transport::send(dst, false, &followup, sizeof(followup));
 }
 
-static void processPDelayRequest(const uint8_t *frame, int size) {
+static void processPDelayRequest(const ptp::Address &src, const ptp::Address &dst, const HEADER_PTP &request, const int size) {
     // verify request length
-    if (size < static_cast<int>(PTP2_MIN_SIZE + sizeof(PTP2_PDELAY_REQ)))
+    if (size < static_cast<int>(sizeof(HEADER_PTP) + sizeof(PTP2_PDELAY_REQ)))
         return;
 
-    // copy and resize frame
-    constexpr int txSize = PTP2_MIN_SIZE + sizeof(PTP2_PDELAY_RESP);
-    uint8_t txFrame[txSize] = {};
-    memcpy(txFrame, frame, std::min(size, txSize));
-
-    // map headers
-    auto &response = PacketPTP<PTP2_PDELAY_RESP>::from(txFrame);
-
-    // copy source identity
-    response.data.requestingIdentity = response.ptp.sourceIdentity;
-    // set RX time
+    // get RX time
     uint64_t stamps[3];
     network::getRxTime(stamps);
-    toPtpTimestamp(stamps[2], &(response.data.receiveTimestamp));
 
-    // PTP header
-    response.ptp.versionPTP = PTP2_VERSION;
-    response.ptp.messageType = PTP2_MT_PDELAY_RESP;
-    response.ptp.messageLength = htons(sizeof(HEADER_PTP) + sizeof(PTP2_PDELAY_RESP));
-    memcpy(response.ptp.sourceIdentity.identity, ptpClockId, sizeof(ptpClockId));
-    response.ptp.sourceIdentity.portNumber = 0;
-    response.ptp.domainNumber = PTP2_DOMAIN;
-    response.ptp.logMessageInterval = 0;
+    MessagePTP<PTP2_PDELAY_RESP> response = {};
+    initPtpHeader(response.ptp, PTP2_MT_PDELAY_RESP, sizeof(response), 0x7F);
+    response.ptp.flags = htons(PTP2_FLAG_TWO_STEP) | (request.flags & htons(PTP2_FLAG_UNICAST));
+    response.ptp.sequenceId = request.sequenceId;
+    // copy source identity
+    response.data.requestingIdentity = request.sourceIdentity;
+    // set RX time
+    toPtpTimestamp(stamps[2], &response.data.receiveTimestamp);
 
     // transmit response
-    network::transmit(txFrame, txSize, peerDelayRespFollowup, nullptr);
-}
-
-static void sendAnnounce(void *ref) {
-    // allocate and clear frame buffer
-    constexpr int size = PTP2_MIN_SIZE + sizeof(PTP2_ANNOUNCE);
-    uint8_t frame[size] = {};
-
-    // map headers
-    auto &announce = PacketPTP<PTP2_ANNOUNCE>::from(frame);
-
-    // IEEE 802.1AS
-    announce.eth.ethType = ETHTYPE_PTP;
-    copyMAC(announce.eth.macDst, gPtpMac);
-
-    // PTP header
-    announce.ptp.versionPTP = PTP2_VERSION;
-    announce.ptp.messageType = PTP2_MT_ANNOUNCE;
-    announce.ptp.messageLength = htons(sizeof(HEADER_PTP) + sizeof(PTP2_ANNOUNCE));
-    memcpy(announce.ptp.sourceIdentity.identity, ptpClockId, sizeof(ptpClockId));
-    announce.ptp.sourceIdentity.portNumber = 0;
-    announce.ptp.domainNumber = PTP2_DOMAIN;
-    announce.ptp.logMessageInterval = PTP2_ANNC_LOG_INTV;
-    announce.ptp.sequenceId = htons(seqId++);
-
-    // PTP Announce
-    const auto refId = ntp::refId();
-    announce.data.timeSource = (refId == ntp::GPS::REF_ID) ? PTP2_TSRC_GPS : PTP2_TSRC_NTP;
-    announce.data.currentUtcOffset = (clkTaiUtcOffset >> 32);
-    memcpy(announce.data.grandMasterIdentity, ptpClockId, sizeof(ptpClockId));
-    announce.data.grandMasterPriority = 0;
-    announce.data.grandMasterPriority2 = 0;
+    ptp::transport::send(replyTo(src, dst), true, &response, sizeof(response), peerDelayRespFollowup, nullptr);
+}
+
+/**
+ * Build an announce message from the current reference state
+ * @param announce message to populate
+ * @param logInterval log2 announce interval
+ * @param sequenceId announce sequence number
+ */
+static void buildAnnounce(MessagePTP<PTP2_ANNOUNCE> &announce, const int8_t logInterval, const uint16_t sequenceId) {
+    initPtpHeader(announce.ptp, PTP2_MT_ANNOUNCE, sizeof(announce), logInterval);
+    announce.ptp.sequenceId = htons(sequenceId);
+
+    // PTP Announce (grandmaster data set from the current reference state)
+    ptp::bmca::DataSet local;
+    ptp::bmca::getLocal(local);
+    announce.data.timeSource = local.timeSource;
+    announce.data.currentUtcOffset = htons(local.utcOffset);
+    memcpy(announce.data.grandMasterIdentity, local.identity, sizeof(local.identity));
+    announce.data.grandMasterPriority = local.priority1;
+    announce.data.grandMasterPriority2 = local.priority2;
     announce.data.stepsRemoved = 0;
-    if (refId != 0)
-        announce.data.grandMasterClockQuality = toPtpClkAccuracy(PLL_offsetRms());
-    else
-        announce.data.grandMasterClockQuality = 0x31;
+    announce.data.grandMasterClockQuality = local.quality;
+    announce.data.grandMasterClockQuality.offsetScaledLogVariance = htons(local.quality.offsetScaledLogVariance);
+    announce.ptp.flags = htons(local.timeFlags);
     toPtpTimestamp(clock::tai::now(), &announce.data.originTimestamp);
+}
+
+static void runAnnounce(void *ref) {
+    // only the master announces itself
+    if (!ptp::bmca::isMaster())
+        return;
+    // leave the transmit ring reserve for responses
+    if (!ptp::transport::admit(countMulticast())) {
+        ++skipAnnounce;
+        return;
+    }
+
+    uint8_t message[sizeof(MessagePTP<PTP2_ANNOUNCE>) + sizeof(PTP2_TLV_PATH_TRACE)] = {};
+    auto &announce = MessagePTP<PTP2_ANNOUNCE>::from(message);
+    const auto &active = ptp::profile::active();
+    buildAnnounce(announce, active.logAnnounce, seqAnnounce++);
+
+    // IEEE 802.1AS announce messages carry the path trace
+    int size = sizeof(announce);
+    if (active.sdoId == ptp::profile::SDO_GPTP) {
+        auto &tlv = *reinterpret_cast<PTP2_TLV_PATH_TRACE*>(message + size);
+        tlv.head.tlvType = htons(PTP2_TT_PATH_TRACE);
+        tlv.head.lengthField = htons(sizeof(tlv.pathSequence));
+        memcpy(tlv.pathSequence, ptpClockId, sizeof(ptpClockId));
+        size += sizeof(tlv);
+        announce.ptp.messageLength = htons(size);
+    }
+
+    // transmit announce message
+    sendMulticast(false, message, size, nullptr);
+}
+
+bool ptp::sendAnnounce(const Address &dst, const int8_t logInterval, const uint16_t sequenceId) {
+    MessagePTP<PTP2_ANNOUNCE> announce = {};
+    buildAnnounce(announce, logInterval, sequenceId);
+    announce.ptp.flags |= htons(PTP2_FLAG_UNICAST);
+
+    // transmit announce message
+    return transport::send(dst, false, &announce, sizeof(announce));
+}
+
+/**
+ * Update the departure statistics with the first transmission of a multicast sync
+ * @param departed monotonic TX time of the sync message
+ */
+static void measureSync(const uint64_t departed) {
+    // queue to wire latency
+    const float latency = 0x1p-32f * static_cast<float>(static_cast<int64_t>(departed - syncQueued));
+    latencyMean += (latency - latencyMean) * JITTER_RATE;
+    if (latency > latencyMax)
+        latencyMax = latency;
+
+    // departure interval error (sync messages withheld by admission control span several intervals)
+    if (syncDeparted != 0) {
+        const float period = 0x1p-24f * static_cast<float>(toInterval(ptp::profile::active().logSync));
+        const float elapsed = 0x1p-32f * static_cast<float>(static_cast<int64_t>(departed - syncDeparted));
+        const float error = elapsed - period * roundf(elapsed / period);
+        jitterMS += (error * error - jitterMS) * JITTER_RATE;
+        if (fabsf(error) > jitterMax)
+            jitterMax = fabsf(error);
+    }
+    syncDeparted = departed;
+}
+
+/**
+ * Get the index of a transport in the order of transmission
+ * @param transport transport mapping
+ * @return index of the transport
+ */
+static int indexOf(const ptp::Transport transport) {
+    for (int i = 0; i < TRANSPORT_COUNT; ++i) {
+        if (TRANSPORTS[i] == transport)
+            return i;
+    }
+    return 0;
+}
 
-    // transmit announce frame
-    network::transmit(frame, size);
+/**
+ * Compare the origin timestamp of a multicast sync with its hardware transmit timestamp
+ * @param index transport index of the transmission
+ * @param stamps hardware transmit timestamps (monotonic, compensated, TAI)
+ */
+static void measureOrigin(const int index, const uint64_t *stamps) {
+    // origin timestamp error
+    const float error = 0x1p-32f * static_cast<float>(static_cast<int64_t>(syncOrigin[index] - stamps[2]));
+    const float magnitude = fabsf(error);
+    originMS += (error * error - originMS) * JITTER_RATE;
+    if (magnitude > originMax)
+        originMax = magnitude;
+    int bin = 0;
+    while (bin < ERROR_BIN_COUNT - 1 && magnitude >= ERROR_BINS[bin])
+        ++bin;
+    ++originBins[bin];
+
+    // suppress follow-up messages once the error has remained within the bound
+    if (magnitude <= ONE_STEP_BOUND) {
+        if (++oneStepRun >= ONE_STEP_QUALIFY && ONE_STEP_BOUND > 0 && ptp::profile::active().oneStep)
+            oneStep = true;
+    }
+    else {
+        if (oneStep)
+            ++cntRevert;
+        oneStep = false;
+        oneStepRun = 0;
+    }
+
+    // queue to wire latency of this transmission (the first measurement seeds the prediction)
+    const float latency = 0x1p-32f * static_cast<float>(static_cast<int64_t>(stamps[0] - syncQueued));
+    if (latency > 0 && latency < PREDICT_LIMIT) {
+        if (syncPredict[index] == 0)
+            syncPredict[index] = latency;
+        else
+            syncPredict[index] += (latency - syncPredict[index]) * PREDICT_RATE;
+    }
 }
 
 static void syncFollowup(void *ref, const uint8_t *frame, const int size) {
@@ -198,45 +468,209 @@ static void syncFollowup(void *ref, const uint8_t *frame, const int size) {
     uint64_t stamps[3];
     network::getTxTime(stamps);
 
-    // copy frame
-    uint8_t txFrame[size];
-    memcpy(txFrame, frame, size);
-
-    // map headers
-    auto &followup = PacketPTP<PTP2_TIMESTAMP>::from(txFrame);
+    // locate sync message
+    ptp::Address src, dst;
+    const int offset = ptp::transport::parse(frame, size, src, dst);
+    if (offset < 0)
+        return;
+    const auto &sync = MessagePTP<PTP2_TIMESTAMP>::from(frame + offset);
+    const bool unicast = sync.ptp.flags & htons(PTP2_FLAG_UNICAST);
+    if (!unicast && htons(sync.ptp.sequenceId) == syncPending) {
+        if (syncMeasure) {
+            syncMeasure = false;
+            measureSync(stamps[0]);
+        }
+        if (syncTrack & dst.transport) {
+            syncTrack &= ~dst.transport;
+            measureOrigin(indexOf(dst.transport), stamps);
+        }
+    }
+    // one-step sync messages carry the origin timestamp
+    if (!(sync.ptp.flags & htons(PTP2_FLAG_TWO_STEP)))
+        return;
 
-    // set followup fields
-    followup.ptp.messageType = PTP2_MT_FOLLOW_UP;
+    uint8_t message[sizeof(MessagePTP<PTP2_TIMESTAMP>) + sizeof(PTP2_TLV_FOLLOW_UP_INFO)] = {};
+    auto &followup = MessagePTP<PTP2_TIMESTAMP>::from(message);
+    int length = sizeof(followup);
+    initPtpHeader(followup.ptp, PTP2_MT_FOLLOW_UP, length, sync.ptp.logMessageInterval);
+    followup.ptp.flags = sync.ptp.flags & htons(PTP2_FLAG_UNICAST);
+    followup.ptp.sequenceId = sync.ptp.sequenceId;
     toPtpTimestamp(stamps[2], &followup.data);
 
-    // transmit request
-    network::transmit(txFrame, size);
+    // IEEE 802.1AS follow-up messages carry the rate ratio (zero for the grandmaster)
+    if (sync.ptp.transportSpecific == ptp::profile::SDO_GPTP) {
+        auto &tlv = *reinterpret_cast<PTP2_TLV_FOLLOW_UP_INFO*>(message + length);
+        tlv.head.tlvType = htons(PTP2_TT_ORGANIZATION_EXT);
+        tlv.head.lengthField = htons(sizeof(tlv) - sizeof(tlv.head));
+        tlv.organizationId[0] = 0x00;
+        tlv.organizationId[1] = 0x80;
+        tlv.organizationId[2] = 0xC2;
+        tlv.organizationSubType[2] = 1;
+        length += sizeof(tlv);
+        followup.ptp.messageLength = htons(length);
+    }
+
+    // transmit followup to the destination of the sync message
+    ptp::transport::send(dst, false, message, length);
 }
 
-static void sendSync(void *ref) {
-    // allocate and clear frame buffer
-    constexpr int size = PTP2_MIN_SIZE + sizeof(PTP2_TIMESTAMP);
-    uint8_t frame[size] = {};
+/**
+ * Build a two-step sync message with a preliminary origin timestamp
+ * @param sync message to populate
+ * @param logInterval log2 sync interval
+ * @param sequenceId sync sequence number
+ */
+static void buildSync(MessagePTP<PTP2_TIMESTAMP> &sync, const int8_t logInterval, const uint16_t sequenceId) {
+    initPtpHeader(sync.ptp, PTP2_MT_SYNC, sizeof(sync), logInterval);
+    sync.ptp.flags = htons(PTP2_FLAG_TWO_STEP);
+    sync.ptp.sequenceId = htons(sequenceId);
 
-    // map headers
-    auto &sync = PacketPTP<PTP2_TIMESTAMP>::from(frame);
+    // set preliminary timestamp
+    toPtpTimestamp(clock::tai::now(), &sync.data);
+}
 
-    // IEEE 802.1AS
-    sync.eth.ethType = ETHTYPE_PTP;
-    copyMAC(sync.eth.macDst, gPtpMac);
+static void runSync(void *ref) {
+    if (!ptp::bmca::isMaster())
+        return;
+    // the departure of a sync queued behind other frames cannot be predicted
+    const bool idle = network::getTxFree() >= TX_IDLE;
+    const bool single = oneStep && idle;
+    // leave the transmit ring reserve for responses (each two-step sync is followed by a follow-up)
+    if (!ptp::transport::admit((single ? 1 : 2) * countMulticast())) {
+        ++skipSync;
+        return;
+    }
+
+    const auto &active = ptp::profile::active();
+    MessagePTP<PTP2_TIMESTAMP> sync = {};
+    buildSync(sync, active.logSync, seqSync);
+    if (single) {
+        sync.ptp.flags = 0;
+        ++cntOneStep;
+    }
+
+    // measure the departure of the first transmission and the origin error of every transmission
+    syncQueued = clock::monotonic::now();
+    const auto queued = clock::tai::now();
+    syncPending = seqSync++;
+    syncMeasure = true;
+    syncTrack = idle ? active.transports : 0;
+
+    // transmit sync message with the origin timestamp aimed at the predicted departure
+    for (int i = 0; i < TRANSPORT_COUNT; ++i) {
+        if (!(active.transports & TRANSPORTS[i]))
+            continue;
+        syncOrigin[i] = queued + static_cast<int64_t>(0x1p32f * syncPredict[i]);
+        toPtpTimestamp(syncOrigin[i], &sync.data);
+        ptp::transport::send(ptp::transport::multicast(TRANSPORTS[i]), true, &sync, sizeof(sync), syncFollowup);
+    }
+}
 
-    sync.ptp.versionPTP = PTP2_VERSION;
-    sync.ptp.messageType = PTP2_MT_SYNC;
-    sync.ptp.messageLength = htons(sizeof(HEADER_PTP) + sizeof(PTP2_TIMESTAMP));
-    memcpy(sync.ptp.sourceIdentity.identity, ptpClockId, sizeof(ptpClockId));
-    sync.ptp.sourceIdentity.portNumber = 0;
-    sync.ptp.domainNumber = PTP2_DOMAIN;
-    sync.ptp.logMessageInterval = PTP2_SYNC_LOG_INTV;
-    sync.ptp.sequenceId = htons(seqId++);
+bool ptp::sendSync(const Address &dst, const int8_t logInterval, const uint16_t sequenceId) {
+    MessagePTP<PTP2_TIMESTAMP> sync = {};
+    buildSync(sync, logInterval, sequenceId);
+    sync.ptp.flags |= htons(PTP2_FLAG_UNICAST);
 
-    // set preliminary timestamp
-    toPtpTimestamp(clock::tai::now(), &sync.data);
+    // transmit sync message
+    return transport::send(dst, true, &sync, sizeof(sync), syncFollowup, nullptr);
+}
+
+bool ptp::isOneStep() {
+    return oneStep;
+}
 
-    // transmit sync frame
-    network::transmit(frame, size, syncFollowup, nullptr);
+unsigned ptp::status(char *buffer) {
+    char tmp[32];
+    char *end = buffer;
+
+    end = append(end, "ptp status:\n");
+
+    const auto &active = profile::active();
+    end = append(end, "  - profile:   ");
+    end = append(end, active.name);
+    tmp[toBase(active.domain, 10, tmp)] = 0;
+    end = append(end, " (domain ");
+    end = append(end, tmp);
+    end = append(end, ")\n");
+
+    end = append(end, "  - clock id:  ");
+    end = toHexBytes(end, ptpClockId, sizeof(ptpClockId));
+    end = append(end, "\n");
+
+    tmp[toBase(seqSync, 10, tmp)] = 0;
+    end = append(end, "  - sync:      ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(seqAnnounce, 10, tmp)] = 0;
+    end = append(end, "  - announce:  ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(skipSync, 10, tmp)] = 0;
+    end = append(end, "  - skipped:   ");
+    end = append(end, tmp);
+    end = append(end, " sync, ");
+    tmp[toBase(skipAnnounce, 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, " announce\n");
+
+    // sync departure interval error and queue to wire latency
+    tmp[fmtFloat(1e6f * sqrtf(jitterMS), 0, 3, tmp)] = 0;
+    end = append(end, "  - jitter:    ");
+    end = append(end, tmp);
+    tmp[fmtFloat(1e6f * jitterMax, 0, 3, tmp)] = 0;
+    end = append(end, " us rms, ");
+    end = append(end, tmp);
+    end = append(end, " us max\n");
+
+    tmp[fmtFloat(1e6f * latencyMean, 0, 3, tmp)] = 0;
+    end = append(end, "  - latency:   ");
+    end = append(end, tmp);
+    tmp[fmtFloat(1e6f * latencyMax, 0, 3, tmp)] = 0;
+    end = append(end, " us mean, ");
+    end = append(end, tmp);
+    end = append(end, " us max\n");
+
+    // origin timestamp error of precision sync messages
+    tmp[fmtFloat(1e9f * sqrtf(originMS), 0, 1, tmp)] = 0;
+    end = append(end, "  - origin:    ");
+    end = append(end, tmp);
+    tmp[fmtFloat(1e9f * originMax, 0, 1, tmp)] = 0;
+    end = append(end, " ns rms, ");
+    end = append(end, tmp);
+    end = append(end, " ns max\n");
+
+    end = append(end, "  - error:     ");
+    for (int i = 0; i < ERROR_BIN_COUNT; ++i) {
+        if (i > 0)
+            end = append(end, ", ");
+        end = append(end, ERROR_LABELS[i]);
+        tmp[toBase(originBins[i], 10, tmp)] = 0;
+        end = append(end, tmp);
+    }
+    end = append(end, "\n");
+
+    tmp[toBase(cntOneStep, 10, tmp)] = 0;
+    end = append(end, "  - one-step:  ");
+    end = append(end, oneStep ? "on" : "off");
+    end = append(end, " (");
+    end = append(end, tmp);
+    end = append(end, " sync, ");
+    tmp[toBase(cntRevert, 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, " reverted)\n");
+
+    tmp[toBase(manage::getCount(false), 10, tmp)] = 0;
+    end = append(end, "  - manage:    ");
+    end = append(end, tmp);
+    end = append(end, " answered, ");
+    tmp[toBase(manage::getCount(true), 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, " refused\n");
+
+    end += bmca::status(end);
+    end += unicast::status(end);
+    end += delay::status(end);
+    return end - buffer;
 }
@@ -4,6 +4,64 @@
 
 #pragma once
 
+#include "transport.hpp"
+
 namespace ptp {
+    /**
+     * Handler for Sync, Follow_Up and Delay_Resp messages received from other masters
+     * @param ref pointer to reference data
+     * @param src source address of the message
+     * @param message PTP message (header and body)
+     * @param size size of the message
+     */
+    using CallbackSlave = void (*)(void *ref, const Address &src, const uint8_t *message, int size);
+
     void init();
+
+    /**
+     * Register the handler for timing messages from other masters (e.g. the PTP slave source)
+     * @param callback handler to invoke (null to unregister)
+     * @param ref pointer to reference data for callback
+     */
+    void onSlave(CallbackSlave callback, void *ref);
+
+    /**
+     * Select the active profile, reschedule periodic messages, restart master selection and persist the selection.
+     * Selecting the profile that is already active has no effect.
+     * @param name profile name (need not be null-terminated)
+     * @param length length of the name
+     * @return false if there is no such profile
+     */
+    bool setProfile(const char *name, int length);
+
+    /**
+     * Transmit a unicast announce message
+     * @param dst destination address
+     * @param logInterval log2 announce interval
+     * @param sequenceId announce sequence number for the destination
+     * @return true if the message was added to the transmit buffer
+     */
+    bool sendAnnounce(const Address &dst, int8_t logInterval, uint16_t sequenceId);
+
+    /**
+     * Transmit a unicast two-step sync message (the follow-up is sent on completion)
+     * @param dst destination address
+     * @param logInterval log2 sync interval
+     * @param sequenceId sync sequence number for the destination
+     * @return true if the message was added to the transmit buffer
+     */
+    bool sendSync(const Address &dst, int8_t logInterval, uint16_t sequenceId);
+
+    /**
+     * Check if multicast sync messages are currently sent as one-step messages (without follow-up)
+     * @return true if follow-up messages are suppressed
+     */
+    bool isOneStep();
+
+    /**
+     * Write current status of the PTP server to a buffer
+     * @param buffer destination for status information
+     * @return number of bytes written to buffer
+     */
+    unsigned status(char *buffer);
 }
@@ -0,0 +1,152 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "transport.hpp"
+
+#include "common.hpp"
+#include "profile.hpp"
+#include "../net/util.hpp"
+
+#include <memory.h>
+
+// multicast time-to-live (IEEE 1588 Annex D, restricted to the local segment)
+static constexpr uint8_t MCAST_TTL = 1;
+
+// messages received and transmitted by message type
+static uint32_t cntRx[16];
+static uint32_t cntTx[16];
+
+int ptp::transport::parse(const uint8_t *frame, const int size, Address &src, Address &dst) {
+    const auto &packet = FrameUdp4::from(frame);
+    if (size < static_cast<int>(sizeof(HeaderEthernet) + sizeof(HEADER_PTP)))
+        return -1;
+
+    copyMAC(src.mac, packet.eth.macSrc);
+    copyMAC(dst.mac, packet.eth.macDst);
+    src.ip = 0;
+    dst.ip = 0;
+
+    // layer-2 transport
+    if (packet.eth.ethType == ETHTYPE_PTP) {
+        src.transport = TRANSPORT_L2;
+        dst.transport = TRANSPORT_L2;
+        return sizeof(HeaderEthernet);
+    }
+
+    // UDP/IPv4 transport
+    if (size < static_cast<int>(sizeof(FrameUdp4) + sizeof(HEADER_PTP)))
+        return -1;
+    if (packet.eth.ethType != ETHTYPE_IP4 || packet.ip4.proto != IP_PROTO_UDP)
+        return -1;
+    if (packet.ip4.head.VER != 4 || packet.ip4.head.IHL != 5)
+        return -1;
+    const auto port = htons(packet.udp.portDst);
+    if (port != PTP2_PORT_EVENT && port != PTP2_PORT_GENERAL)
+        return -1;
+    src.transport = TRANSPORT_UDP;
+    dst.transport = TRANSPORT_UDP;
+    src.ip = packet.ip4.src;
+    dst.ip = packet.ip4.dst;
+    return sizeof(FrameUdp4);
+}
+
+ptp::Address ptp::transport::multicast(const Transport transport) {
+    Address addr = {};
+    addr.transport = transport;
+    if (transport == TRANSPORT_UDP) {
+        addr.ip = PTP2_MCAST_PRIMARY;
+        IPv4_macMulticast(addr.mac, addr.ip);
+    }
+    else
+        copyMAC(addr.mac, profile::active().mac);
+    return addr;
+}
+
+bool ptp::transport::isMulticast(const Address &addr) {
+    if (addr.transport == TRANSPORT_UDP)
+        return (addr.ip & 0xF0) == 0xE0;
+    return addr.mac[0] & 1;
+}
+
+bool ptp::transport::isLocal(const Address &addr) {
+    if (isMulticast(addr))
+        return true;
+    if (addr.transport == TRANSPORT_UDP)
+        return addr.ip == ipAddress;
+    return isMyMAC(addr.mac) == 0;
+}
+
+bool ptp::transport::admit(const int frames) {
+    return network::getTxFree() - frames >= TX_RESERVE;
+}
+
+void ptp::transport::countRx(const int type) {
+    ++cntRx[type & 0xF];
+}
+
+uint32_t ptp::transport::getCount(const int type, const bool tx) {
+    return tx ? cntTx[type & 0xF] : cntRx[type & 0xF];
+}
+
+/**
+ * Queue a frame and count the transmitted message
+ * @param frame complete frame
+ * @param size frame size
+ * @param message PTP message within the frame
+ * @param callback function to invoke with the complete frame when transmission is complete
+ * @param ref pointer to reference data for callback
+ * @return true if the frame was added to the transmit buffer
+ */
+static bool transmit(
+    const uint8_t *frame, const int size, const void *message,
+    const network::CallbackTx callback, void *ref
+) {
+    if (!network::transmit(frame, size, callback, ref))
+        return false;
+    ++cntTx[static_cast<const HEADER_PTP*>(message)->messageType];
+    return true;
+}
+
+bool ptp::transport::send(
+    const Address &dst, const bool event, const void *message, const int size,
+    const network::CallbackTx callback, void *ref
+) {
+    uint8_t frame[MAX_HEADER + size];
+    memset(frame, 0, sizeof(frame));
+    auto &packet = FrameUdp4::from(frame);
+    copyMAC(packet.eth.macDst, dst.mac);
+
+    // layer-2 transport
+    if (dst.transport == TRANSPORT_L2) {
+        packet.eth.ethType = ETHTYPE_PTP;
+        memcpy(frame + sizeof(HeaderEthernet), message, size);
+        return transmit(frame, static_cast<int>(sizeof(HeaderEthernet)) + size, message, callback, ref);
+    }
+
+    // UDP/IPv4 transport requires an address
+    if (ipAddress == 0)
+        return false;
+
+    // IPv4 header
+    IPv4_init(frame);
+    packet.ip4.src = ipAddress;
+    packet.ip4.dst = dst.ip;
+    packet.ip4.proto = IP_PROTO_UDP;
+    if (isMulticast(dst)) {
+        IPv4_setMulticast(frame, dst.ip);
+        packet.ip4.ttl = MCAST_TTL;
+    }
+
+    // UDP header
+    const uint16_t port = htons(event ? PTP2_PORT_EVENT : PTP2_PORT_GENERAL);
+    packet.udp.portSrc = port;
+    packet.udp.portDst = port;
+
+    // finalize frame
+    const int flen = static_cast<int>(sizeof(FrameUdp4)) + size;
+    memcpy(frame + sizeof(FrameUdp4), message, size);
+    UDP_finalize(frame, flen);
+    IPv4_finalize(frame, flen);
+    return transmit(frame, flen, message, callback, ref);
+}
@@ -0,0 +1,107 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+#include "../net.hpp"
+#include "../net/udp.hpp"
+
+namespace ptp {
+    /**
+     * PTP transport mappings
+     */
+    enum Transport : uint8_t {
+        // IEEE 802.3 ethernet (IEEE 1588 Annex F)
+        TRANSPORT_L2 = 1,
+        // UDP/IPv4 (IEEE 1588 Annex D)
+        TRANSPORT_UDP = 2
+    };
+
+    /**
+     * Link and network address of a PTP port
+     */
+    struct Address {
+        Transport transport;
+        // MAC address
+        uint8_t mac[6];
+        // IPv4 address (network byte-order, UDP transport only)
+        uint32_t ip;
+    };
+}
+
+namespace ptp::transport {
+    // largest link and network header preceding a PTP message
+    static constexpr int MAX_HEADER = sizeof(FrameUdp4);
+    // transmit ring segments kept free for responses (NTP, Delay_Resp, etc.)
+    static constexpr int TX_RESERVE = 32;
+
+    /**
+     * Locate the PTP message within an ethernet frame
+     * @param frame ethernet frame
+     * @param size frame size
+     * @param src receives the source address
+     * @param dst receives the destination address
+     * @return offset of the PTP message within the frame or -1 if the frame does not contain a PTP message
+     */
+    int parse(const uint8_t *frame, int size, Address &src, Address &dst);
+
+    /**
+     * Get the multicast address of a transport for the active profile
+     * @param transport transport mapping
+     * @return multicast address
+     */
+    Address multicast(Transport transport);
+
+    /**
+     * Check if an address is a multicast address
+     * @param addr address to check
+     * @return true if the address is a multicast address
+     */
+    bool isMulticast(const Address &addr);
+
+    /**
+     * Check if an address is the unicast address of this port or a multicast address
+     * @param addr destination address of a received message
+     * @return true if the message should be processed
+     */
+    bool isLocal(const Address &addr);
+
+    /**
+     * Check if periodic messages may be queued without exhausting the transmit ring reserve
+     * @param frames number of frames to be queued
+     * @return true if the frames may be queued
+     */
+    bool admit(int frames);
+
+    /**
+     * Count a received message in the per message type statistics
+     * @param type message type
+     */
+    void countRx(int type);
+
+    /**
+     * Get the number of messages of a type received or transmitted
+     * @param type message type
+     * @param tx true for transmitted messages, false for received messages
+     * @return message count
+     */
+    uint32_t getCount(int type, bool tx);
+
+    /**
+     * Transmit a PTP message
+     * @param dst destination address
+     * @param event true for event messages (UDP port 319), false for general messages (UDP port 320)
+     * @param message PTP message (header and body)
+     * @param size size of the message
+     * @param callback function to invoke with the complete frame when transmission is complete
+     * @param ref pointer to reference data for callback
+     * @return true if the frame was added to the transmit buffer
+     */
+    bool send(
+        const Address &dst, bool event, const void *message, int size,
+        network::CallbackTx callback = nullptr, void *ref = nullptr
+    );
+}
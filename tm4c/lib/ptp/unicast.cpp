@@ -0,0 +1,470 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "unicast.hpp"
+
+#include "bmca.hpp"
+#include "ptp.hpp"
+#include "../format.hpp"
+#include "../net.hpp"
+#include "../run.hpp"
+#include "../net/util.hpp"
+
+#include <memory.h>
+
+#ifndef PTP_UNICAST_SLAVES
+// size of the slave table
+#define PTP_UNICAST_SLAVES (128)
+#endif
+
+#ifndef PTP_UNICAST_RATE
+// aggregate message rate available to unicast grants (messages per second)
+#define PTP_UNICAST_RATE (2048)
+#endif
+
+// transmission task rate (log2 Hz)
+static constexpr int TICK_LOG = 7;
+// longest grant duration (s)
+static constexpr uint32_t MAX_DURATION = 1000;
+// maximum number of TLVs answered per signaling message
+static constexpr int MAX_TLVS = 4;
+// message rate units (1/16 messages per second)
+static constexpr int RATE_LOG = 4;
+
+enum GrantType {
+    GRANT_ANNOUNCE,
+    GRANT_SYNC,
+    GRANT_DELAY_RESP,
+    GRANT_COUNT
+};
+
+// PTP message type and supported interval range of each grant type
+static constexpr struct {
+    PTP2_MTYPE messageType;
+    int8_t minLog;
+    int8_t maxLog;
+} GRANT_INFO[GRANT_COUNT] = {
+    {PTP2_MT_ANNOUNCE, -3, RATE_LOG},
+    {PTP2_MT_SYNC, -TICK_LOG, RATE_LOG},
+    {PTP2_MT_DELAY_RESP, -TICK_LOG, RATE_LOG},
+};
+
+enum RefuseReason {
+    REFUSE_TABLE,
+    REFUSE_RATE,
+    REFUSE_INTERVAL,
+    REFUSE_TYPE,
+    REFUSE_COUNT
+};
+
+struct Grant {
+    // tick of expiration
+    uint32_t expire;
+    // tick of the next transmission
+    uint32_t next;
+    uint16_t sequence;
+    int8_t logInterval;
+    bool active;
+};
+
+struct Slave {
+    PTP2_SRC_IDENT identity;
+    ptp::Address addr;
+    Grant grants[GRANT_COUNT];
+};
+
+static Slave slaves[PTP_UNICAST_SLAVES];
+static uint32_t tick;
+static int cursor;
+static uint32_t load;
+static uint16_t seqSignaling;
+
+// statistics
+static uint32_t cntGranted;
+static uint32_t cntRefused[REFUSE_COUNT];
+static uint32_t cntCancelled;
+static uint32_t cntExpired;
+static uint32_t cntDeferred;
+static uint32_t cntTxFailed;
+static int maxBurst;
+
+static void runTick(void *ref);
+
+void ptp::unicast::init() {
+    memset(slaves, 0, sizeof(slaves));
+    runPeriodic(RUN_SEC >> TICK_LOG, runTick, nullptr);
+}
+
+/**
+ * Get the message rate of a grant
+ * @param logInterval log2 message interval
+ * @return message rate (1/16 messages per second)
+ */
+static uint32_t grantRate(const int8_t logInterval) {
+    return 1u << (RATE_LOG - logInterval);
+}
+
+/**
+ * Get the message interval of a grant
+ * @param logInterval log2 message interval
+ * @return message interval (ticks)
+ */
+static uint32_t grantTicks(const int8_t logInterval) {
+    return 1u << (TICK_LOG + logInterval);
+}
+
+static bool isActive(const Slave &slave) {
+    for (const auto &grant : slave.grants) {
+        if (grant.active)
+            return true;
+    }
+    return false;
+}
+
+static Slave* findSlave(const PTP2_SRC_IDENT &identity) {
+    for (auto &slave : slaves) {
+        if (isActive(slave) && memcmp(&slave.identity, &identity, sizeof(identity)) == 0)
+            return &slave;
+    }
+    return nullptr;
+}
+
+static Slave* allocSlave() {
+    for (auto &slave : slaves) {
+        if (!isActive(slave))
+            return &slave;
+    }
+    return nullptr;
+}
+
+static void release(Grant &grant) {
+    grant.active = false;
+    load -= grantRate(grant.logInterval);
+}
+
+/**
+ * Process a REQUEST_UNICAST_TRANSMISSION TLV
+ * @param src source address of the request
+ * @param identity source port identity of the slave
+ * @param request request TLV
+ * @param grant GRANT_UNICAST_TRANSMISSION TLV to populate
+ */
+static void processRequest(
+    const ptp::Address &src, const PTP2_SRC_IDENT &identity,
+    const PTP2_TLV_REQUEST_UNICAST &request, PTP2_TLV_GRANT_UNICAST &grant
+) {
+    grant.head.tlvType = htons(PTP2_TT_GRANT_UNICAST);
+    grant.head.lengthField = htons(sizeof(grant) - sizeof(grant.head));
+    grant.messageType = request.messageType & 0xF0;
+    grant.logInterMessagePeriod = request.logInterMessagePeriod;
+    grant.durationField = 0;
+    grant.renewalInvited = 0;
+
+    // locate grant type
+    const int type = request.messageType >> 4;
+    int index = 0;
+    while (index < GRANT_COUNT && GRANT_INFO[index].messageType != type)
+        ++index;
+    if (index == GRANT_COUNT) {
+        ++cntRefused[REFUSE_TYPE];
+        return;
+    }
+
+    // validate interval
+    const auto logInterval = request.logInterMessagePeriod;
+    if (logInterval < GRANT_INFO[index].minLog || logInterval > GRANT_INFO[index].maxLog) {
+        ++cntRefused[REFUSE_INTERVAL];
+        return;
+    }
+
+    // a zero duration requests nothing
+    const uint32_t duration = htonl(request.durationField);
+    if (duration == 0)
+        return;
+
+    // locate slave entry
+    auto slave = findSlave(identity);
+    if (slave == nullptr) {
+        slave = allocSlave();
+        if (slave == nullptr) {
+            ++cntRefused[REFUSE_TABLE];
+            return;
+        }
+        memset(slave, 0, sizeof(Slave));
+        slave->identity = identity;
+    }
+    auto &entry = slave->grants[index];
+
+    // admission control (a renewal replaces the previous rate)
+    const uint32_t prior = entry.active ? grantRate(entry.logInterval) : 0;
+    const uint32_t rate = grantRate(logInterval);
+    if (load - prior + rate > (PTP_UNICAST_RATE << RATE_LOG)) {
+        ++cntRefused[REFUSE_RATE];
+        return;
+    }
+
+    // spread the transmissions of new grants across the interval
+    const uint32_t interval = grantTicks(logInterval);
+    if (!entry.active || entry.logInterval != logInterval) {
+        const auto slot = static_cast<uint32_t>(slave - slaves);
+        entry.next = tick + 1 + (slot * interval) / PTP_UNICAST_SLAVES;
+    }
+
+    load += rate - prior;
+    const uint32_t granted = duration < MAX_DURATION ? duration : MAX_DURATION;
+    entry.expire = tick + (granted << TICK_LOG);
+    entry.logInterval = logInterval;
+    entry.active = true;
+    slave->addr = src;
+    ++cntGranted;
+
+    grant.durationField = htonl(granted);
+    grant.renewalInvited = 1;
+}
+
+/**
+ * Process a CANCEL_UNICAST_TRANSMISSION TLV
+ * @param identity source port identity of the slave
+ * @param cancel cancel TLV
+ * @param ack ACKNOWLEDGE_CANCEL_UNICAST_TRANSMISSION TLV to populate
+ */
+static void processCancel(const PTP2_SRC_IDENT &identity, const PTP2_TLV_CANCEL_UNICAST &cancel, PTP2_TLV_CANCEL_UNICAST &ack) {
+    ack.head.tlvType = htons(PTP2_TT_ACK_CANCEL_UNICAST);
+    ack.head.lengthField = htons(sizeof(ack) - sizeof(ack.head));
+    ack.messageType = cancel.messageType & 0xF0;
+    ack.reserved = 0;
+
+    const auto slave = findSlave(identity);
+    if (slave == nullptr)
+        return;
+    const int type = cancel.messageType >> 4;
+    for (int i = 0; i < GRANT_COUNT; ++i) {
+        auto &grant = slave->grants[i];
+        if (GRANT_INFO[i].messageType == type && grant.active) {
+            release(grant);
+            ++cntCancelled;
+        }
+    }
+}
+
+void ptp::unicast::process(const Address &src, const uint8_t *message, int size) {
+    constexpr int headSize = sizeof(HEADER_PTP) + sizeof(PTP2_SIGNALING);
+    if (size < headSize)
+        return;
+    const auto &request = MessagePTP<PTP2_SIGNALING>::from(message);
+    // ignore padding beyond the message
+    const int length = htons(request.ptp.messageLength);
+    if (length < size)
+        size = length;
+    // must target this clock or all clocks
+    const auto &target = request.data.targetPortIdentity;
+    bool wildcard = true;
+    for (const auto byte : target.identity)
+        wildcard &= byte == 0xFF;
+    if (!wildcard && memcmp(target.identity, ptpClockId, sizeof(ptpClockId)) != 0)
+        return;
+
+    // reserved fields are transmitted as zero
+    uint8_t buffer[headSize + MAX_TLVS * sizeof(PTP2_TLV_GRANT_UNICAST)] = {};
+    int offset = headSize;
+    int count = 0;
+    for (int ptr = headSize; ptr + static_cast<int>(sizeof(PTP2_TLV_HEAD)) <= size && count < MAX_TLVS;) {
+        const auto &head = *reinterpret_cast<const PTP2_TLV_HEAD*>(message + ptr);
+        const int tlvSize = static_cast<int>(sizeof(PTP2_TLV_HEAD)) + htons(head.lengthField);
+        if (ptr + tlvSize > size)
+            break;
+
+        const auto tlvType = htons(head.tlvType);
+        if (tlvType == PTP2_TT_REQUEST_UNICAST && tlvSize >= static_cast<int>(sizeof(PTP2_TLV_REQUEST_UNICAST))) {
+            auto &grant = *reinterpret_cast<PTP2_TLV_GRANT_UNICAST*>(buffer + offset);
+            processRequest(src, request.ptp.sourceIdentity, *reinterpret_cast<const PTP2_TLV_REQUEST_UNICAST*>(&head), grant);
+            offset += sizeof(grant);
+            ++count;
+        }
+        else if (tlvType == PTP2_TT_CANCEL_UNICAST && tlvSize >= static_cast<int>(sizeof(PTP2_TLV_CANCEL_UNICAST))) {
+            auto &ack = *reinterpret_cast<PTP2_TLV_CANCEL_UNICAST*>(buffer + offset);
+            processCancel(request.ptp.sourceIdentity, *reinterpret_cast<const PTP2_TLV_CANCEL_UNICAST*>(&head), ack);
+            offset += sizeof(ack);
+            ++count;
+        }
+        ptr += tlvSize;
+    }
+    if (count == 0)
+        return;
+
+    // signaling response
+    auto &response = MessagePTP<PTP2_SIGNALING>::from(buffer);
+    initPtpHeader(response.ptp, PTP2_MT_SIGNALING, offset, 0x7F);
+    response.ptp.flags = htons(PTP2_FLAG_UNICAST);
+    response.ptp.sequenceId = htons(seqSignaling++);
+    response.data.targetPortIdentity = request.ptp.sourceIdentity;
+    transport::send(src, false, buffer, offset);
+}
+
+int8_t ptp::unicast::delayInterval(const PTP2_SRC_IDENT &identity, const int8_t fallback) {
+    const auto slave = findSlave(identity);
+    if (slave == nullptr || !slave->grants[GRANT_DELAY_RESP].active)
+        return fallback;
+    return slave->grants[GRANT_DELAY_RESP].logInterval;
+}
+
+static void runTick(void *ref) {
+    const uint32_t now = ++tick;
+    // leave room in the transmit ring for follow-ups and other traffic
+    const int budget = network::getTxFree() - ptp::transport::TX_RESERVE;
+    // grants are served only while the port is the master of the domain
+    const bool master = ptp::bmca::isMaster();
+    int sent = 0;
+    int next = -1;
+
+    // resume where the previous burst was cut short
+    for (int i = 0; i < PTP_UNICAST_SLAVES; ++i) {
+        const int index = (cursor + i) % PTP_UNICAST_SLAVES;
+        auto &slave = slaves[index];
+        for (int type = 0; type < GRANT_COUNT; ++type) {
+            auto &grant = slave.grants[type];
+            if (!grant.active)
+                continue;
+            if (static_cast<int32_t>(now - grant.expire) >= 0) {
+                release(grant);
+                ++cntExpired;
+                continue;
+            }
+            if (!master || type == GRANT_DELAY_RESP || static_cast<int32_t>(now - grant.next) < 0)
+                continue;
+
+            // defer the remainder of the burst to the next tick
+            if (sent >= budget) {
+                if (next < 0)
+                    next = index;
+                ++cntDeferred;
+                continue;
+            }
+
+            const bool queued = (type == GRANT_SYNC) ?
+                ptp::sendSync(slave.addr, grant.logInterval, grant.sequence) :
+                ptp::sendAnnounce(slave.addr, grant.logInterval, grant.sequence);
+            if (!queued)
+                ++cntTxFailed;
+            ++grant.sequence;
+            ++sent;
+
+            // keep the exact rate but do not catch up on missed intervals
+            grant.next += grantTicks(grant.logInterval);
+            if (static_cast<int32_t>(now - grant.next) >= 0)
+                grant.next = now + 1;
+        }
+    }
+    if (next >= 0)
+        cursor = next;
+    if (sent > maxBurst)
+        maxBurst = sent;
+}
+
+int ptp::unicast::getActive() {
+    int count = 0;
+    for (const auto &slave : slaves) {
+        if (isActive(slave))
+            ++count;
+    }
+    return count;
+}
+
+uint32_t ptp::unicast::getRefused() {
+    uint32_t total = 0;
+    for (const auto count : cntRefused)
+        total += count;
+    return total;
+}
+
+unsigned ptp::unicast::status(char *buffer) {
+    char tmp[32];
+    char *end = buffer;
+
+    int grants[GRANT_COUNT] = {};
+    for (const auto &slave : slaves) {
+        for (int type = 0; type < GRANT_COUNT; ++type) {
+            if (slave.grants[type].active)
+                ++grants[type];
+        }
+    }
+
+    end = append(end, "unicast status:\n");
+
+    tmp[toBase(getActive(), 10, tmp)] = 0;
+    end = append(end, "  - slaves:    ");
+    end = append(end, tmp);
+    end = append(end, " / ");
+    tmp[toBase(PTP_UNICAST_SLAVES, 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    end = append(end, "  - grants:    ");
+    tmp[toBase(grants[GRANT_ANNOUNCE], 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, " announce, ");
+    tmp[toBase(grants[GRANT_SYNC], 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, " sync, ");
+    tmp[toBase(grants[GRANT_DELAY_RESP], 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, " delay\n");
+
+    tmp[fmtFloat(static_cast<float>(load) / (1 << RATE_LOG), 0, 1, tmp)] = 0;
+    end = append(end, "  - load:      ");
+    end = append(end, tmp);
+    end = append(end, " / ");
+    tmp[toBase(PTP_UNICAST_RATE, 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, " msg/s\n");
+
+    tmp[toBase(cntGranted, 10, tmp)] = 0;
+    end = append(end, "  - granted:   ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(getRefused(), 10, tmp)] = 0;
+    end = append(end, "  - refused:   ");
+    end = append(end, tmp);
+    end = append(end, " (table ");
+    tmp[toBase(cntRefused[REFUSE_TABLE], 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, ", rate ");
+    tmp[toBase(cntRefused[REFUSE_RATE], 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, ", interval ");
+    tmp[toBase(cntRefused[REFUSE_INTERVAL], 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, ", type ");
+    tmp[toBase(cntRefused[REFUSE_TYPE], 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, ")\n");
+
+    tmp[toBase(cntCancelled, 10, tmp)] = 0;
+    end = append(end, "  - cancelled: ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(cntExpired, 10, tmp)] = 0;
+    end = append(end, "  - expired:   ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(cntDeferred, 10, tmp)] = 0;
+    end = append(end, "  - deferred:  ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(cntTxFailed, 10, tmp)] = 0;
+    end = append(end, "  - tx failed: ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(maxBurst, 10, tmp)] = 0;
+    end = append(end, "  - max burst: ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    return end - buffer;
+}
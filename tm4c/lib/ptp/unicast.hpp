@@ -0,0 +1,58 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+#include "common.hpp"
+#include "transport.hpp"
+
+/**
+ * Unicast message negotiation (IEEE 1588 clause 16.1).
+ * Slaves request Announce, Sync and Delay_Resp service with REQUEST_UNICAST_TRANSMISSION TLVs. Each slave holds a
+ * fixed table entry with its own grant durations and message intervals, and a periodic task transmits the due
+ * messages in bursts that are limited by the free space in the transmit ring.
+ */
+namespace ptp::unicast {
+    /**
+     * Initialize the slave table and start the transmission task
+     */
+    void init();
+
+    /**
+     * Process a signaling message
+     * @param src source address of the message
+     * @param message PTP message (header and body)
+     * @param size size of the message
+     */
+    void process(const Address &src, const uint8_t *message, int size);
+
+    /**
+     * Get the granted Delay_Resp interval of a slave
+     * @param identity source port identity of the slave
+     * @param fallback interval to use without a grant
+     * @return log2 interval to report in Delay_Resp messages
+     */
+    int8_t delayInterval(const PTP2_SRC_IDENT &identity, int8_t fallback);
+
+    /**
+     * Get the number of slaves with at least one active grant
+     * @return active slave count
+     */
+    int getActive();
+
+    /**
+     * Get the number of refused grant requests
+     * @return refused request count
+     */
+    uint32_t getRefused();
+
+    /**
+     * Write current status of the unicast service to a buffer
+     * @param buffer destination for status information
+     * @return number of bytes written to buffer
+     */
+    unsigned status(char *buffer);
+}
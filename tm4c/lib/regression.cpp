@@ -0,0 +1,136 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "regression.hpp"
+
+/**
+ * Solve the weighted linear fit from sums accumulated relative to a reference sample
+ * and compute the fit variance
+ * @param sums accumulated sums (w, wx, wxx, wy, wxy) relative to the reference sample
+ * @param xr reference sample position
+ * @param yr reference sample value
+ */
+static void solveLinear(
+    const float *sums,
+    const float xr,
+    const float yr,
+    const int cnt,
+    const float *x,
+    const float *y,
+    const float *w,
+    float &offset,
+    float &slope,
+    float &offsetVariance,
+    float &slopeVariance
+) {
+    const float norm = 1.0f / sums[0];
+    const float xc = sums[1] * norm;
+    const float xx = sums[2] * norm;
+    const float yc = sums[3] * norm;
+    const float yx = sums[4] * norm;
+    const float xv = xx - xc * xc;
+
+    slope = (yx - xc * yc) / xv;
+    const float oc = yc - xc * slope;
+    offset = oc + (yr - xr * slope);
+
+    regression::Sum mse;
+    for (int i = 0; i < cnt; ++i) {
+        const float error = (y[i] - yr) - oc - (x[i] - xr) * slope;
+        mse += w[i] * error * error;
+    }
+
+    // variance at x = 0
+    const float xo = xc + xr;
+    slopeVariance = mse.value() * norm / xv;
+    offsetVariance = slopeVariance * (xv + xo * xo);
+}
+
+/**
+ * Accumulate the weighted sums of a sample relative to a reference sample
+ */
+static void accumulateLinear(
+    regression::Sum *sums,
+    const float w,
+    const float x,
+    const float y
+) {
+    const float wx = w * x;
+    sums[0] += w;
+    sums[1] += wx;
+    sums[2] += wx * x;
+    sums[3] += w * y;
+    sums[4] += wx * y;
+}
+
+/**
+ * Finalize the weighted sums and solve the linear fit
+ */
+static void finishLinear(
+    const regression::Sum *acc,
+    const float xr,
+    const float yr,
+    const int cnt,
+    const float *x,
+    const float *y,
+    const float *w,
+    float &offset,
+    float &slope,
+    float &offsetVariance,
+    float &slopeVariance
+) {
+    float sums[5];
+    for (int i = 0; i < 5; ++i)
+        sums[i] = acc[i].value();
+    solveLinear(sums, xr, yr, cnt, x, y, w, offset, slope, offsetVariance, slopeVariance);
+}
+
+void regression::fitLinear(
+    const int cnt,
+    const float *x,
+    const float *y,
+    const float *w,
+    float &offset,
+    float &slope,
+    float &offsetVariance,
+    float &slopeVariance
+) {
+    // accumulate relative to the middle sample to avoid cancellation
+    const float xr = x[cnt >> 1];
+    const float yr = y[cnt >> 1];
+    Sum sums[5];
+    for (int i = 0; i < cnt; ++i)
+        accumulateLinear(sums, w[i], x[i] - xr, y[i] - yr);
+    finishLinear(sums, xr, yr, cnt, x, y, w, offset, slope, offsetVariance, slopeVariance);
+}
+
+void regression::fitRobust(
+    const int cnt,
+    const float *x,
+    const float *y,
+    float *w,
+    const int passes,
+    const float floor,
+    float &offset,
+    float &slope,
+    float &offsetVariance,
+    float &slopeVariance
+) {
+    fitLinear(cnt, x, y, w, offset, slope, offsetVariance, slopeVariance);
+    for (int pass = 0; pass < passes; ++pass) {
+        // reweight all samples using the previous fit
+        const float var = offsetVariance + floor;
+        const float xr = x[cnt >> 1];
+        const float yr = offset + xr * slope;
+        Sum sums[5];
+        for (int i = 0; i < cnt; ++i) {
+            const float dx = x[i] - xr;
+            const float dy = y[i] - yr;
+            const float error = dy - dx * slope;
+            w[i] = var / (var + error * error);
+            accumulateLinear(sums, w[i], dx, dy);
+        }
+        finishLinear(sums, xr, yr, cnt, x, y, w, offset, slope, offsetVariance, slopeVariance);
+    }
+}
@@ -0,0 +1,315 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace regression {
+    /**
+     * Add a value to a compensated accumulator.
+     * The residual carries the rounding error of previous additions so that long runs of small
+     * increments are not lost to the 24-bit mantissa of the accumulator.
+     * @param accumulator accumulated value
+     * @param residual accumulated rounding error
+     * @param delta value to add
+     */
+    template<typename T>
+    inline void accumulate(T &accumulator, T &residual, const float delta) {
+        const float initial = accumulator;
+        accumulator = initial + (residual + delta);
+        residual = residual + (delta - (accumulator - initial));
+    }
+
+    /**
+     * Compensated (Neumaier) summation using only single-precision arithmetic.
+     */
+    class Sum {
+        float sum;
+        float comp;
+
+    public:
+        Sum() : sum(0), comp(0) {}
+
+        /**
+         * Add a value to the sum
+         * @param value value to add
+         */
+        void add(const float value) {
+            const float next = sum + value;
+            if (__builtin_fabsf(sum) >= __builtin_fabsf(value))
+                comp += (sum - next) + value;
+            else
+                comp += (value - next) + sum;
+            sum = next;
+        }
+
+        Sum& operator+=(const float value) {
+            add(value);
+            return *this;
+        }
+
+        Sum& operator-=(const float value) {
+            add(-value);
+            return *this;
+        }
+
+        /**
+         * Get the compensated sum
+         * @return the compensated sum
+         */
+        [[nodiscard]]
+        float value() const {
+            return sum + comp;
+        }
+    };
+
+    /**
+     * Compute the weighted least-squares linear fit of a sample set
+     * @param cnt number of samples
+     * @param x sample positions
+     * @param y sample values
+     * @param w sample weights
+     * @param offset fitted value at x = 0
+     * @param slope fitted change in y per unit of x
+     * @param offsetVariance variance of the offset estimate
+     * @param slopeVariance variance of the slope estimate
+     */
+    void fitLinear(
+        int cnt,
+        const float *x,
+        const float *y,
+        const float *w,
+        float &offset,
+        float &slope,
+        float &offsetVariance,
+        float &slopeVariance
+    );
+
+    /**
+     * Compute a robust linear fit of a sample set using iteratively reweighted least-squares.
+     * Each pass replaces all sample weights at once with v / (v + e^2), where e is the sample residual
+     * and v is the offset variance of the previous pass plus the variance floor.
+     * @param cnt number of samples
+     * @param x sample positions
+     * @param y sample values
+     * @param w initial sample weights (returns final sample weights)
+     * @param passes number of reweighting passes
+     * @param floor minimum variance used for reweighting
+     * @param offset fitted value at x = 0
+     * @param slope fitted change in y per unit of x
+     * @param offsetVariance variance of the offset estimate
+     * @param slopeVariance variance of the slope estimate
+     */
+    void fitRobust(
+        int cnt,
+        const float *x,
+        const float *y,
+        float *w,
+        int passes,
+        float floor,
+        float &offset,
+        float &slope,
+        float &offsetVariance,
+        float &slopeVariance
+    );
+
+    /**
+     * Sliding-window linear regression over evenly spaced samples.
+     * Samples are indexed by age (0 = newest sample) and the window sums are updated recursively,
+     * so each new sample costs constant time. The sums are periodically rebuilt from the raw samples
+     * to prevent accumulation of rounding errors.
+     * @tparam SIZE window length (must be a power of two)
+     */
+    template<int SIZE>
+    class Window {
+        static_assert(SIZE > 1 && (SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two");
+
+        static constexpr int MASK = SIZE - 1;
+
+        // raw sample ring
+        float ring[SIZE];
+        // reference value subtracted from samples prior to accumulation
+        float bias;
+        // sum of samples
+        float sum0;
+        // sum of samples weighted by age
+        float sum1;
+        // sum of squared samples
+        float sum2;
+        // ring position of newest sample
+        int pos;
+        // number of valid samples
+        int count;
+        // samples accumulated since the last rebuild
+        int stale;
+
+        /**
+         * Rebuild the window sums from the raw samples.
+         */
+        void rebuild() {
+            bias += sum0 / static_cast<float>(count);
+            sum0 = 0;
+            sum1 = 0;
+            sum2 = 0;
+            for (int i = 0; i < count; ++i) {
+                const float y = ring[(pos - i) & MASK] - bias;
+                sum0 += y;
+                sum1 += y * static_cast<float>(i);
+                sum2 += y * y;
+            }
+            stale = 0;
+        }
+
+    public:
+        Window() : ring{}, bias(0), sum0(0), sum1(0), sum2(0), pos(0), count(0), stale(0) {}
+
+        /**
+         * Get the number of samples in the window
+         * @return number of samples in the window
+         */
+        [[nodiscard]]
+        int size() const {
+            return count;
+        }
+
+        /**
+         * Add a sample to the window, evicting the oldest sample if the window is full
+         * @param value new sample
+         */
+        void push(const float value) {
+            if (count == 0)
+                bias = value;
+
+            pos = (pos + 1) & MASK;
+            const float y = value - bias;
+            if (count < SIZE) {
+                // advance the age of all samples
+                sum1 += sum0;
+                ++count;
+            }
+            else {
+                // advance the age of all samples and evict the oldest sample
+                const float old = ring[pos] - bias;
+                sum1 += sum0 - static_cast<float>(SIZE) * old;
+                sum0 -= old;
+                sum2 -= old * old;
+            }
+            ring[pos] = value;
+            sum0 += y;
+            sum2 += y * y;
+
+            if (++stale >= SIZE)
+                rebuild();
+        }
+
+        /**
+         * Compute the least-squares linear fit of the window
+         * @param offset fitted value of the newest sample
+         * @param slope fitted change per sample of age
+         * @param offsetVariance variance of the offset estimate
+         * @param slopeVariance variance of the slope estimate
+         */
+        void fit(float &offset, float &slope, float &offsetVariance, float &slopeVariance) const {
+            // constant terms
+            const auto cc = static_cast<float>(count);
+            const float xc = 0.5f * (cc - 1.0f);
+            const float xx = (cc - 1.0f) * (2.0f * cc - 1.0f) / 6.0f;
+            const float xv = (cc * cc - 1.0f) / 12.0f;
+
+            // dynamic terms
+            const float yc = sum0 / cc;
+            const float yx = sum1 / cc - yc * xc;
+
+            // compute offset and slope
+            slope = yx / xv;
+            offset = yc - xc * slope + bias;
+
+            // compute mean-squared error
+            float mse = sum2 / cc - yc * yc - slope * yx;
+            if (mse < 0)
+                mse = 0;
+
+            // compute variance
+            slopeVariance = mse / xv;
+            offsetVariance = slopeVariance * xx;
+        }
+    };
+
+    /**
+     * Sliding-window linear regression over free-running 32-bit timer captures.
+     * The window sums are maintained in wrapping 64-bit integer arithmetic. The fitted slope is
+     * invariant to the integer wrap-around, so the result is exact and the sums never need rebuilding.
+     * @tparam SIZE window length (must be a power of two)
+     */
+    template<int SIZE>
+    class TimerWindow {
+        static_assert(SIZE > 1 && (SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two");
+
+        static constexpr int MASK = SIZE - 1;
+
+        // raw capture ring
+        uint32_t ring[SIZE];
+        // unwrapped value of the newest capture
+        uint64_t head;
+        // sum of unwrapped captures
+        uint64_t sum0;
+        // sum of unwrapped captures weighted by age
+        uint64_t sum1;
+        // ring position of newest capture
+        int pos;
+        // number of valid captures
+        int count;
+
+    public:
+        TimerWindow() : ring{}, head(0), sum0(0), sum1(0), pos(0), count(0) {}
+
+        /**
+         * Get the number of captures in the window
+         * @return number of captures in the window
+         */
+        [[nodiscard]]
+        int size() const {
+            return count;
+        }
+
+        /**
+         * Add a capture to the window, evicting the oldest capture if the window is full
+         * (the window must span less than 2^32 timer ticks)
+         * @param raw raw timer value
+         */
+        void push(const uint32_t raw) {
+            const uint32_t last = ring[pos];
+            pos = (pos + 1) & MASK;
+            if (count < SIZE) {
+                // advance the age of all captures
+                sum1 += sum0;
+                ++count;
+            }
+            else {
+                // advance the age of all captures and evict the oldest capture
+                const uint64_t old = head - static_cast<uint32_t>(last - ring[pos]);
+                sum1 += sum0 - SIZE * old;
+                sum0 -= old;
+            }
+            head += static_cast<uint32_t>(raw - last);
+            ring[pos] = raw;
+            sum0 += head;
+        }
+
+        /**
+         * Compute the least-squares interval between captures
+         * @return mean interval between captures in timer ticks
+         */
+        [[nodiscard]]
+        float period() const {
+            const auto cc = static_cast<uint64_t>(count);
+            // scaled covariance of capture time and age
+            const auto cov = static_cast<int64_t>(cc * sum1 - ((cc * (cc - 1)) >> 1) * sum0);
+            // scaled variance of age
+            const auto var = (cc * cc * (cc * cc - 1)) / 12;
+            return -static_cast<float>(cov) / static_cast<float>(var);
+        }
+    };
+}
@@ -162,6 +162,19 @@ public:
      */
     void insert();
 
+    /**
+     * Postpone the next run of the task.
+     * @param delay delay in 8.24 fixed point format
+     */
+    void delay(const uint32_t delay) {
+        // only sleeping and periodic tasks are queued by run time
+        if (schedule != Sleep && schedule != Periodic)
+            return;
+        pop();
+        runNext = clock::monotonic::raw() + toMonoRaw(delay);
+        insert();
+    }
+
     /**
      * Set the run or sleep interval.
      * @param interval the new run or sleep interval
@@ -403,6 +416,10 @@ void runAdjust(void *taskHandle, const uint32_t interval) {
     static_cast<Task*>(taskHandle)->setInterval(interval);
 }
 
+void runDelay(void *taskHandle, const uint32_t delay) {
+    static_cast<Task*>(taskHandle)->delay(delay);
+}
+
 void runWake(void *taskHandle) {
     static_cast<Task*>(taskHandle)->wake();
     taskUpdate = true;
@@ -60,6 +60,14 @@ void* runPeriodic(uint32_t interval, RunCall callback, void *ref);
  */
 void runAdjust(void *taskHandle, uint32_t interval);
 
+/**
+ * Postpone the next execution of a sleeping or periodic task (e.g. to push back a watchdog deadline).
+ * Must not be called from an interrupt handler or by the task being postponed.
+ * @param taskHandle the task to postpone
+ * @param delay delay from now in 8.24 fixed point format (16 second maximum, uses monotonic clock)
+ */
+void runDelay(void *taskHandle, uint32_t delay);
+
 /**
  * Wake a waiting task
  * @param taskHandle the waiting task to wake
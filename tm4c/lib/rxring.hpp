@@ -0,0 +1,101 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Single-producer single-consumer receive ring with burst hand-off.
+ * The producer (an ISR) appends bytes and commits them in bursts, so the consumer is only woken once the line goes
+ * idle at the end of a message burst or once the backlog reaches half of the ring.
+ * Committed bytes are exposed to the consumer as contiguous spans, allowing payloads to be parsed in place.
+ * A zero-initialized instance is valid.
+ * @tparam SIZE ring size in bytes (must be a power of two)
+ */
+template<int SIZE>
+class RxRing {
+    static_assert((SIZE & (SIZE - 1)) == 0, "RxRing size must be a power of two");
+    static constexpr int MASK = SIZE - 1;
+    // backlog that wakes the consumer without an idle line
+    static constexpr int WAKE_LEVEL = SIZE / 2;
+
+    uint8_t buffer[SIZE];
+    // producer position (not yet visible to consumer)
+    int fill;
+    // committed position
+    volatile int head;
+    // consumer position
+    volatile int tail;
+    // bytes dropped due to a full ring
+    volatile uint32_t overruns;
+
+public:
+    /**
+     * Append a received byte (producer only)
+     * @param byte received byte
+     */
+    void put(const uint8_t byte) {
+        if (((fill + 1) & MASK) == tail) {
+            ++overruns;
+            return;
+        }
+        buffer[fill] = byte;
+        fill = (fill + 1) & MASK;
+    }
+
+    /**
+     * Publish appended bytes to the consumer (producer only)
+     * @param idle true if the line has gone idle (end of a message burst)
+     * @return true if the consumer should be woken
+     */
+    bool commit(const bool idle) {
+        head = fill;
+        return (idle && fill != tail) || ((fill - tail) & MASK) >= WAKE_LEVEL;
+    }
+
+    /**
+     * Get the number of committed bytes waiting to be consumed
+     * @return number of bytes
+     */
+    [[nodiscard]] int available() const {
+        return (head - tail) & MASK;
+    }
+
+    /**
+     * Get a committed byte without consuming it
+     * @param offset position relative to the consumer position (must be less than available())
+     * @return byte value
+     */
+    [[nodiscard]] uint8_t peek(const int offset) const {
+        return buffer[(tail + offset) & MASK];
+    }
+
+    /**
+     * Get a contiguous view of committed bytes
+     * @param offset position relative to the consumer position
+     * @param length required length
+     * @return pointer to the bytes or nullptr if the span wraps around the end of the ring
+     */
+    [[nodiscard]] const uint8_t * span(const int offset, const int length) const {
+        const int start = (tail + offset) & MASK;
+        return start + length <= SIZE ? buffer + start : nullptr;
+    }
+
+    /**
+     * Release consumed bytes
+     * @param count number of bytes (must not exceed available())
+     */
+    void consume(const int count) {
+        tail = (tail + count) & MASK;
+    }
+
+    /**
+     * Get the number of bytes dropped due to a full ring
+     * @return overrun count
+     */
+    [[nodiscard]] uint32_t getOverruns() const {
+        return overruns;
+    }
+};
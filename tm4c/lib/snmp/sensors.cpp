@@ -92,6 +92,11 @@ static int getPllOffsetCorr() {
     return lroundf(PLL_offsetCorr() * 1e10f);
 }
 
+// PLL lock getters
+static int getPllLocked() {
+    return PLL_locked() ? 1 : 2;
+}
+
 // PLL drift getters
 static int getPllDriftLast() {
     return lroundf(PLL_driftLast() * 1e10f);
@@ -117,6 +122,31 @@ static int getPllDriftFreq() {
     return lroundf(PLL_driftFreq() * 1e10f);
 }
 
+// PLL stability getters
+static int getPllAdev1() {
+    return lroundf(PLL_adev(0) * 1e15f);
+}
+
+static int getPllAdev64() {
+    return lroundf(PLL_adev(6) * 1e15f);
+}
+
+static int getPllAdev4096() {
+    return lroundf(PLL_adev(12) * 1e15f);
+}
+
+static int getPllTdev1() {
+    return lroundf(PLL_tdev(0) * 1e12f);
+}
+
+static int getPllTdev64() {
+    return lroundf(PLL_tdev(6) * 1e12f);
+}
+
+static int getPllTdev4096() {
+    return lroundf(PLL_tdev(12) * 1e12f);
+}
+
 
 // SNMP Sensor Registry
 static constexpr struct SnmpSensor {
@@ -148,7 +178,17 @@ static constexpr struct SnmpSensor {
     {"pll.drift.rms", "s/s", OID_SENSOR_TYPE_OTHER, OID_SENSOR_SCALE_1E_6, 4, getPllDriftRms},
     {"pll.drift.stddev", "s/s", OID_SENSOR_TYPE_OTHER, OID_SENSOR_SCALE_1E_6, 4, getPllDriftStdDev},
     {"pll.drift.corr", "s/s", OID_SENSOR_TYPE_OTHER, OID_SENSOR_SCALE_1E_6, 4, getPllDriftCorr},
-    {"pll.drift.freq", "s/s", OID_SENSOR_TYPE_OTHER, OID_SENSOR_SCALE_1E_6, 4, getPllDriftFreq}
+    {"pll.drift.freq", "s/s", OID_SENSOR_TYPE_OTHER, OID_SENSOR_SCALE_1E_6, 4, getPllDriftFreq},
+    // PLL stability stats
+    {"pll.adev.1s", "s/s", OID_SENSOR_TYPE_OTHER, OID_SENSOR_SCALE_1E_12, 3, getPllAdev1},
+    {"pll.adev.64s", "s/s", OID_SENSOR_TYPE_OTHER, OID_SENSOR_SCALE_1E_12, 3, getPllAdev64},
+    {"pll.adev.4096s", "s/s", OID_SENSOR_TYPE_OTHER, OID_SENSOR_SCALE_1E_12, 3, getPllAdev4096},
+    {"pll.tdev.1s", "s", OID_SENSOR_TYPE_OTHER, OID_SENSOR_SCALE_1E_9, 3, getPllTdev1},
+    {"pll.tdev.64s", "s", OID_SENSOR_TYPE_OTHER, OID_SENSOR_SCALE_1E_9, 3, getPllTdev64},
+    {"pll.tdev.4096s", "s", OID_SENSOR_TYPE_OTHER, OID_SENSOR_SCALE_1E_9, 3, getPllTdev4096},
+    // PLL lock status (appended to keep the index of existing sensors)
+    {"pll.locked", "", OID_SENSOR_TYPE_BOOL, OID_SENSOR_SCALE_1, 0, getPllLocked},
+    {"pll.lockTime", "s", OID_SENSOR_TYPE_OTHER, OID_SENSOR_SCALE_1, 0, PLL_lockTime}
 };
 
 constexpr int SENSOR_CNT = std::size(snmpSensors);
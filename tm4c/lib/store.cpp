@@ -0,0 +1,318 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "store.hpp"
+
+#include "format.hpp"
+#include "run.hpp"
+#include "../hw/eeprom.h"
+
+#include <cstring>
+
+// record ring location (word addresses, blocks 0-7 are reserved)
+static constexpr int STORE_BASE = 0x0080;
+static constexpr int STORE_END = 0x0600;
+static constexpr int STORE_RING = STORE_END - STORE_BASE;
+// record header marker
+static constexpr uint32_t STORE_MAGIC = 0x5354;
+// record overhead (header, sequence and CRC words)
+static constexpr int STORE_OVERHEAD = 3;
+// write task interval (one word per execution)
+static constexpr uint32_t STORE_INTV = RUN_SEC / 256;
+
+struct Location {
+    // newest sequence number
+    uint32_t sequence;
+    // ring offset of record
+    uint16_t offset;
+    // total record size (words)
+    uint8_t size;
+    // record is present
+    bool valid;
+};
+
+struct Staging {
+    uint32_t data[store::MAX_WORDS];
+    uint8_t words;
+    bool pending;
+};
+
+// newest copy of each record
+static Location records[store::ID_COUNT];
+// records waiting to be written
+static Staging staging[store::ID_COUNT];
+// record being written
+static uint32_t active[store::MAX_WORDS + STORE_OVERHEAD];
+static int activeId;
+static int activeSize;
+static int activeOffset;
+static int activeIndex;
+// ring state
+static int head;
+static uint32_t sequence;
+static bool writing;
+// write statistics
+static uint32_t recordsWritten;
+static uint32_t wordsWritten;
+
+static void runWrite(void *ref);
+
+/**
+ * Compute the CRC-32 (IEEE 802.3) of a word sequence
+ * @param data words to check
+ * @param count number of words
+ * @return CRC value
+ */
+static uint32_t crc32(const uint32_t *data, const int count) {
+    uint32_t crc = ~0u;
+    for (int i = 0; i < count; ++i) {
+        crc ^= data[i];
+        for (int j = 0; j < 32; ++j)
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1u));
+    }
+    return ~crc;
+}
+
+static uint32_t makeHeader(const int id, const int words) {
+    return (STORE_MAGIC << 16) | (id << 8) | words;
+}
+
+static int wrap(const int offset) {
+    return offset < STORE_RING ? offset : offset - STORE_RING;
+}
+
+/**
+ * Read a word from the ring
+ * @param offset ring offset (may exceed the ring length by less than one ring)
+ * @return word value
+ */
+static uint32_t readWord(const int offset) {
+    EEPROM_seek(STORE_BASE + wrap(offset));
+    return EEPROM_read();
+}
+
+/**
+ * Check if a ring span overlaps the newest copy of any record
+ * @param offset ring offset of span
+ * @param size span length (words)
+ * @return index of overlapped record or -1 if none
+ */
+static int findOverlap(const int offset, const int size) {
+    for (int id = 0; id < store::ID_COUNT; ++id) {
+        const auto &loc = records[id];
+        if (!loc.valid)
+            continue;
+        // spans may wrap around the end of the ring
+        if (wrap(loc.offset + STORE_RING - offset) < size || wrap(offset + STORE_RING - loc.offset) < loc.size)
+            return id;
+    }
+    return -1;
+}
+
+/**
+ * Locate space for a new record at or after the write head without overwriting the newest copy of any record
+ * @param size record length (words)
+ * @return ring offset for record
+ */
+static int allocate(const int size) {
+    int offset = head;
+    for (int i = 0; i < store::ID_COUNT; ++i) {
+        const int id = findOverlap(offset, size);
+        if (id < 0)
+            break;
+        offset = wrap(records[id].offset + records[id].size);
+    }
+    return offset;
+}
+
+void store::init() {
+    for (auto &loc : records)
+        loc.valid = false;
+
+    // scan ring for valid records
+    uint32_t buffer[MAX_WORDS + STORE_OVERHEAD];
+    bool found = false;
+    int offset = 0;
+    while (offset < STORE_RING) {
+        const uint32_t header = readWord(offset);
+        const int id = static_cast<int>((header >> 8) & 0xFF);
+        const int words = static_cast<int>(header & 0xFF);
+        const int size = words + STORE_OVERHEAD;
+        if ((header >> 16) != STORE_MAGIC || id >= ID_COUNT || words > MAX_WORDS) {
+            ++offset;
+            continue;
+        }
+
+        buffer[0] = header;
+        for (int i = 1; i < size; ++i)
+            buffer[i] = readWord(offset + i);
+        if (crc32(buffer, size - 1) != buffer[size - 1]) {
+            ++offset;
+            continue;
+        }
+
+        // retain newest copy of record
+        const uint32_t seq = buffer[1];
+        auto &loc = records[id];
+        if (!loc.valid || static_cast<int32_t>(seq - loc.sequence) > 0) {
+            loc.sequence = seq;
+            loc.offset = offset;
+            loc.size = size;
+            loc.valid = true;
+        }
+        // advance write head past newest record
+        if (!found || static_cast<int32_t>(seq - sequence) >= 0) {
+            sequence = seq;
+            head = wrap(offset + size);
+            found = true;
+        }
+        offset += size;
+    }
+
+    if (found)
+        ++sequence;
+    else {
+        head = 0;
+        sequence = 0;
+    }
+}
+
+bool store::load(const int id, void *data, const int words) {
+    if (id < 0 || id >= ID_COUNT)
+        return false;
+    const auto &loc = records[id];
+    if (!loc.valid || loc.size != words + STORE_OVERHEAD)
+        return false;
+
+    auto ptr = static_cast<uint32_t*>(data);
+    for (int i = 0; i < words; ++i)
+        ptr[i] = readWord(loc.offset + 2 + i);
+    return true;
+}
+
+bool store::save(const int id, const void *data, const int words) {
+    if (id < 0 || id >= ID_COUNT || words < 0 || words > MAX_WORDS)
+        return false;
+
+    auto &stage = staging[id];
+    memcpy(stage.data, data, words * sizeof(uint32_t));
+    stage.words = words;
+    stage.pending = true;
+
+    // start write task
+    if (!writing) {
+        writing = true;
+        runSleep(STORE_INTV, runWrite, nullptr);
+    }
+    return true;
+}
+
+bool store::busy() {
+    return writing;
+}
+
+/**
+ * Prepare the next staged record for writing
+ * @return false if no records are staged
+ */
+static bool startRecord() {
+    // service records in round-robin order
+    for (int i = 1; i <= store::ID_COUNT; ++i) {
+        const int id = (activeId + i) % store::ID_COUNT;
+        auto &stage = staging[id];
+        if (!stage.pending)
+            continue;
+
+        const int words = stage.words;
+        active[0] = makeHeader(id, words);
+        active[1] = sequence++;
+        memcpy(active + 2, stage.data, words * sizeof(uint32_t));
+        active[words + 2] = crc32(active, words + 2);
+        stage.pending = false;
+
+        activeId = id;
+        activeSize = words + STORE_OVERHEAD;
+        activeOffset = allocate(activeSize);
+        activeIndex = 0;
+        return true;
+    }
+    return false;
+}
+
+static void runWrite([[maybe_unused]] void *ref) {
+    if (activeIndex >= activeSize && !startRecord()) {
+        runCancel(runWrite, nullptr);
+        writing = false;
+        return;
+    }
+
+    // write one word per execution to limit blocking
+    EEPROM_seek(STORE_BASE + wrap(activeOffset + activeIndex));
+    EEPROM_write(active[activeIndex]);
+    ++wordsWritten;
+    if (++activeIndex < activeSize)
+        return;
+
+    // record is complete
+    auto &loc = records[activeId];
+    loc.sequence = active[1];
+    loc.offset = activeOffset;
+    loc.size = activeSize;
+    loc.valid = true;
+    head = wrap(activeOffset + activeSize);
+    ++recordsWritten;
+}
+
+unsigned store::status(char *buffer) {
+    char tmp[32];
+    char *end = buffer;
+
+    end = append(end, "store status:\n");
+
+    tmp[toBase(head, 10, tmp)] = 0;
+    end = append(end, "  - head:     ");
+    end = append(end, tmp);
+    end = append(end, " / ");
+    tmp[toBase(STORE_RING, 10, tmp)] = 0;
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(sequence, 10, tmp)] = 0;
+    end = append(end, "  - sequence: ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(recordsWritten, 10, tmp)] = 0;
+    end = append(end, "  - records:  ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(wordsWritten, 10, tmp)] = 0;
+    end = append(end, "  - words:    ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    for (int id = 0; id < ID_COUNT; ++id) {
+        const auto &loc = records[id];
+        end = append(end, "  - record ");
+        *end++ = static_cast<char>('0' + id);
+        end = append(end, ": ");
+        if (!loc.valid) {
+            end = append(end, "none\n");
+            continue;
+        }
+        tmp[toBase(loc.sequence, 10, tmp)] = 0;
+        end = append(end, "seq ");
+        end = append(end, tmp);
+        tmp[toBase(loc.offset, 10, tmp)] = 0;
+        end = append(end, ", offset ");
+        end = append(end, tmp);
+        tmp[toBase(loc.size, 10, tmp)] = 0;
+        end = append(end, ", size ");
+        end = append(end, tmp);
+        end = append(end, "\n");
+    }
+
+    return end - buffer;
+}
@@ -0,0 +1,64 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Log-structured record store in EEPROM.
+ * Records are appended round-robin to a ring of EEPROM words, so writes are spread evenly over the ring.
+ * Each record carries a sequence number and a CRC, and the newest valid copy of each record is located
+ * by scanning the ring at startup. A record that is interrupted by a reset is discarded in favor of the
+ * previous copy. Saved records are staged in RAM and written incrementally by a scheduler task.
+ */
+namespace store {
+    // record identifiers
+    static constexpr int ID_SOM = 0;
+    static constexpr int ID_TCMP = 1;
+    static constexpr int ID_PLL = 2;
+    static constexpr int ID_SURVEY = 3;
+    static constexpr int ID_PTP = 4;
+    // number of record identifiers
+    static constexpr int ID_COUNT = 5;
+    // maximum record payload (words)
+    static constexpr int MAX_WORDS = 48;
+
+    /**
+     * Locate the newest copy of each record (must be called after EEPROM initialization)
+     */
+    void init();
+
+    /**
+     * Load the newest copy of a record
+     * @param id record identifier
+     * @param data destination for record payload
+     * @param words payload size (32-bit words)
+     * @return true if a record of the requested size was found
+     */
+    bool load(int id, void *data, int words);
+
+    /**
+     * Stage a record to be written to EEPROM.
+     * The payload is copied immediately and replaces any unwritten copy of the same record.
+     * @param id record identifier
+     * @param data record payload
+     * @param words payload size (32-bit words)
+     * @return true if the record was staged
+     */
+    bool save(int id, const void *data, int words);
+
+    /**
+     * Check if staged records are waiting to be written
+     * @return true if a write is in progress
+     */
+    bool busy();
+
+    /**
+     * Write current status of the record store to a buffer
+     * @param buffer destination for status information
+     * @return number of bytes written to buffer
+     */
+    unsigned status(char *buffer);
+}
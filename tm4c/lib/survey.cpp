@@ -0,0 +1,92 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "survey.hpp"
+
+#include <cmath>
+
+// meters per 1e-7 degree of latitude (spherical approximation, only used for local offsets)
+static constexpr float SCALE_LAT = 111319.49f * 1e-7f;
+// meters per millimeter
+static constexpr float SCALE_ALT = 1e-3f;
+// radians per 1e-7 degree
+static constexpr float RAD_PER_E7DEG = 3.14159265f / 180e7f;
+// maximum lag-one correlation of block means (limits variance inflation to 19x)
+static constexpr float MAX_CORRELATION = 0.9f;
+
+void gps::Survey::reset() {
+    *this = {};
+}
+
+bool gps::Survey::update(
+    const int32_t lat, const int32_t lon, const int32_t alt, const uint32_t hAcc, const uint32_t vAcc
+) {
+    if (hAcc > MAX_HACC || vAcc > MAX_VACC) {
+        ++rejected;
+        return false;
+    }
+
+    // first fix sets the local reference frame
+    if (accepted == 0) {
+        refLat = lat;
+        refLon = lon;
+        refAlt = alt;
+        scaleLon = SCALE_LAT * cosf(RAD_PER_E7DEG * static_cast<float>(lat));
+    }
+    ++accepted;
+
+    blockSum[0] += SCALE_LAT * static_cast<float>(lat - refLat);
+    blockSum[1] += scaleLon * static_cast<float>(lon - refLon);
+    blockSum[2] += SCALE_ALT * static_cast<float>(alt - refAlt);
+    if (++blockCount < BLOCK_SIZE)
+        return true;
+
+    // fold block mean into running statistics
+    ++blocks;
+    for (int i = 0; i < 3; i++) {
+        const float value = blockSum[i] / static_cast<float>(BLOCK_SIZE);
+        const float delta = value - mean[i];
+        mean[i] += delta / static_cast<float>(blocks);
+        m2[i] += delta * (value - mean[i]);
+        if (blocks > 1) {
+            const float diff = value - prev[i];
+            d2[i] += diff * diff;
+        }
+        prev[i] = value;
+        blockSum[i] = 0;
+    }
+    blockCount = 0;
+    return true;
+}
+
+bool gps::Survey::converged(const uint32_t minDuration, const float limit) const {
+    if (accepted < minDuration)
+        return false;
+    const float accuracy = getAccuracy();
+    return accuracy >= 0 && accuracy <= limit;
+}
+
+float gps::Survey::getAccuracy() const {
+    if (blocks < MIN_BLOCKS)
+        return -1;
+    const float n = static_cast<float>(blocks);
+    float total = 0;
+    for (int i = 0; i < 3; i++) {
+        const float var = m2[i] / (n - 1);
+        if (var <= 0)
+            continue;
+        // lag-one correlation from the mean squared successive difference (2 var (1 - r))
+        float r = 1.0f - 0.5f * (d2[i] / (n - 1)) / var;
+        r = r < 0 ? 0 : (r > MAX_CORRELATION ? MAX_CORRELATION : r);
+        // standard error of the mean of correlated block means
+        total += (var / n) * (1 + r) / (1 - r);
+    }
+    return sqrtf(total);
+}
+
+void gps::Survey::getPosition(int32_t &lat, int32_t &lon, int32_t &alt) const {
+    lat = refLat + static_cast<int32_t>(lroundf(mean[0] / SCALE_LAT));
+    lon = refLon + (scaleLon > 0 ? static_cast<int32_t>(lroundf(mean[1] / scaleLon)) : 0);
+    alt = refAlt + static_cast<int32_t>(lroundf(mean[2] / SCALE_ALT));
+}
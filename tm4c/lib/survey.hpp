@@ -0,0 +1,96 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace gps {
+    /**
+     * Position survey-in for fixed-position timing mode.
+     * Position fixes are averaged in a local north/east/up frame relative to the first accepted fix.
+     * Consecutive fixes are strongly correlated (multipath and atmospheric errors wander over minutes), so the
+     * accuracy of the average is estimated from the scatter of block means rather than of individual fixes, inflated by
+     * the lag-one correlation of consecutive block means.
+     * A zero-initialized instance is valid.
+     */
+    class Survey {
+        // reference position (first accepted fix)
+        int32_t refLat, refLon, refAlt;
+        // meters per 1e-7 degree of longitude at the reference latitude
+        float scaleLon;
+        // current block accumulator (meters relative to reference)
+        float blockSum[3];
+        int blockCount;
+        // running mean and sum of squared deviations of the block means
+        float mean[3];
+        float m2[3];
+        // previous block mean and sum of squared differences of consecutive block means
+        float prev[3];
+        float d2[3];
+        uint32_t blocks;
+        // fix statistics
+        uint32_t accepted;
+        uint32_t rejected;
+
+    public:
+        // fixes per block
+        static constexpr int BLOCK_SIZE = 300;
+        // minimum number of blocks for an accuracy estimate
+        static constexpr int MIN_BLOCKS = 8;
+        // maximum reported horizontal and vertical accuracy of an accepted fix (mm)
+        static constexpr uint32_t MAX_HACC = 10000;
+        static constexpr uint32_t MAX_VACC = 20000;
+
+        /**
+         * Discard all fixes and restart the survey
+         */
+        void reset();
+
+        /**
+         * Add a position fix to the survey
+         * @param lat latitude (1e-7 deg)
+         * @param lon longitude (1e-7 deg)
+         * @param alt height above ellipsoid (mm)
+         * @param hAcc horizontal accuracy estimate (mm)
+         * @param vAcc vertical accuracy estimate (mm)
+         * @return true if the fix was accepted
+         */
+        bool update(int32_t lat, int32_t lon, int32_t alt, uint32_t hAcc, uint32_t vAcc);
+
+        /**
+         * Check if the survey has converged
+         * @param minDuration minimum number of accepted fixes (s at one fix per second)
+         * @param limit required accuracy of the average position (m)
+         * @return true if the surveyed position is ready to be used
+         */
+        [[nodiscard]] bool converged(uint32_t minDuration, float limit) const;
+
+        /**
+         * Get the 3D standard error of the average position
+         * @return accuracy estimate (m) or a negative value if too few blocks have been completed
+         */
+        [[nodiscard]] float getAccuracy() const;
+
+        /**
+         * Get the average position of the completed blocks
+         * @param lat receives latitude (1e-7 deg)
+         * @param lon receives longitude (1e-7 deg)
+         * @param alt receives height above ellipsoid (mm)
+         */
+        void getPosition(int32_t &lat, int32_t &lon, int32_t &alt) const;
+
+        [[nodiscard]] uint32_t getAccepted() const {
+            return accepted;
+        }
+
+        [[nodiscard]] uint32_t getRejected() const {
+            return rejected;
+        }
+
+        [[nodiscard]] uint32_t getBlocks() const {
+            return blocks;
+        }
+    };
+}
@@ -0,0 +1,287 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+#include "rxring.hpp"
+
+/**
+ * Table-driven streaming parser for u-blox UBX and NMEA messages.
+ * Bytes are examined once as they arrive and the UBX checksum is accumulated incrementally. Registered messages
+ * are dispatched with a direct view of their payload in the receive ring, or a copy if the payload wraps around the
+ * end of the ring. Frames with bad checksums are skipped by resynchronizing on the following byte.
+ */
+namespace ubx {
+    // frame sync characters
+    static constexpr uint8_t SYNC_1 = 0xB5;
+    static constexpr uint8_t SYNC_2 = 0x62;
+    // frame header size (sync, class, id and length)
+    static constexpr int HEADER_SIZE = 6;
+    // maximum accepted payload size
+    static constexpr int MAX_PAYLOAD = 256;
+    // maximum NMEA sentence length (including the leading '$')
+    static constexpr int MAX_NMEA = 96;
+
+    /**
+     * UBX message handler
+     * @param payload message payload (only valid for the duration of the call, not necessarily word aligned)
+     */
+    typedef void (*Handler)(const uint8_t *payload);
+
+    /**
+     * NMEA sentence handler
+     * @param sentence sentence text starting with '$' (only valid for the duration of the call, not terminated)
+     * @param length sentence length excluding the checksum
+     */
+    typedef void (*NmeaHandler)(const char *sentence, int length);
+
+    struct Message {
+        uint8_t msgClass;
+        uint8_t msgId;
+        uint16_t length;
+        Handler handler;
+    };
+
+    /**
+     * Check that a message registry contains each class and id at most once
+     * @param table message registry
+     * @return true if the registry is unambiguous
+     */
+    template<int N>
+    constexpr bool isUnique(const Message (&table)[N]) {
+        for (int i = 0; i < N; i++) {
+            for (int j = i + 1; j < N; j++) {
+                if (table[i].msgClass == table[j].msgClass && table[i].msgId == table[j].msgId)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    class Parser {
+        enum State : uint8_t {
+            IDLE,
+            UBX_SYNC,
+            UBX_HEADER,
+            UBX_PAYLOAD,
+            UBX_CHECK,
+            NMEA_BODY,
+            NMEA_CHECK
+        };
+
+        // message registry
+        const Message *table;
+        int tableSize;
+        NmeaHandler nmea;
+
+        // current frame (offset relative to the ring consumer position)
+        int pos;
+        int length;
+        const Message *entry;
+        uint8_t chkA, chkB;
+        State state;
+
+        // payload copy for frames that wrap around the end of the ring
+        uint8_t scratch[MAX_PAYLOAD];
+
+        // statistics
+        uint32_t countFrames;
+        uint32_t countUnknown;
+        uint32_t countErrors;
+        uint32_t countCopied;
+
+        static int fromHex(const uint8_t c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            return -1;
+        }
+
+        const Message * lookup(const uint8_t msgClass, const uint8_t msgId) const {
+            for (int i = 0; i < tableSize; i++) {
+                const auto &msg = table[i];
+                if (msg.msgClass == msgClass && msg.msgId == msgId)
+                    return msg.length == length ? &msg : nullptr;
+            }
+            return nullptr;
+        }
+
+        template<int SIZE>
+        const uint8_t * view(const RxRing<SIZE> &ring, const int offset, const int count) {
+            const uint8_t *ptr = ring.span(offset, count);
+            if (ptr != nullptr)
+                return ptr;
+            // payload wraps around the end of the ring
+            for (int i = 0; i < count; i++)
+                scratch[i] = ring.peek(offset + i);
+            ++countCopied;
+            return scratch;
+        }
+
+        // discard the current frame start and rescan from the following byte (returns bytes released)
+        template<int SIZE>
+        int resync(RxRing<SIZE> &ring) {
+            if (state != IDLE)
+                ++countErrors;
+            ring.consume(1);
+            pos = 0;
+            state = IDLE;
+            return 1;
+        }
+
+        // release a completed frame (returns bytes released)
+        template<int SIZE>
+        int complete(RxRing<SIZE> &ring) {
+            const int count = pos;
+            ring.consume(count);
+            pos = 0;
+            state = IDLE;
+            return count;
+        }
+
+    public:
+        /**
+         * Create a parser for a message registry
+         * @param table registered UBX messages
+         * @param nmea handler for valid NMEA sentences (may be null)
+         */
+        template<int N>
+        constexpr Parser(const Message (&table)[N], const NmeaHandler nmea) :
+            table(table), tableSize(N), nmea(nmea), pos(0), length(0), entry(nullptr), chkA(0), chkB(0),
+            state(IDLE), scratch{}, countFrames(0), countUnknown(0), countErrors(0), countCopied(0) {}
+
+        /**
+         * Parse committed bytes in a receive ring.
+         * Completed and invalid frames are released from the ring while a partial frame is retained until more bytes
+         * are committed.
+         * @param ring receive ring
+         */
+        template<int SIZE>
+        void parse(RxRing<SIZE> &ring) {
+            int count = ring.available();
+            while (pos < count) {
+                const uint8_t byte = ring.peek(pos++);
+                switch (state) {
+                    case IDLE:
+                        if (byte == SYNC_1)
+                            state = UBX_SYNC;
+                        else if (byte == '$') {
+                            chkA = 0;
+                            state = NMEA_BODY;
+                        }
+                        else
+                            count -= resync(ring);
+                        break;
+
+                    case UBX_SYNC:
+                        if (byte != SYNC_2) {
+                            count -= resync(ring);
+                            break;
+                        }
+                        chkA = 0;
+                        chkB = 0;
+                        state = UBX_HEADER;
+                        break;
+
+                    case UBX_HEADER:
+                        chkA += byte;
+                        chkB += chkA;
+                        if (pos < HEADER_SIZE)
+                            break;
+                        length = ring.peek(4) | (ring.peek(5) << 8);
+                        if (length > MAX_PAYLOAD) {
+                            count -= resync(ring);
+                            break;
+                        }
+                        entry = lookup(ring.peek(2), ring.peek(3));
+                        state = length > 0 ? UBX_PAYLOAD : UBX_CHECK;
+                        break;
+
+                    case UBX_PAYLOAD: {
+                        // accumulate checksum over the available part of the payload in one pass
+                        const int start = pos - 1;
+                        const int end = count < HEADER_SIZE + length ? count : HEADER_SIZE + length;
+                        const uint8_t *ptr = ring.span(start, end - start);
+                        uint8_t a = chkA, b = chkB;
+                        if (ptr != nullptr) {
+                            for (int i = 0; i < end - start; i++) {
+                                a += ptr[i];
+                                b += a;
+                            }
+                        }
+                        else {
+                            for (int i = start; i < end; i++) {
+                                a += ring.peek(i);
+                                b += a;
+                            }
+                        }
+                        chkA = a;
+                        chkB = b;
+                        pos = end;
+                        if (pos == HEADER_SIZE + length)
+                            state = UBX_CHECK;
+                        break;
+                    }
+
+                    case UBX_CHECK:
+                        if (pos == HEADER_SIZE + length + 1) {
+                            if (byte != chkA)
+                                count -= resync(ring);
+                            break;
+                        }
+                        if (byte != chkB) {
+                            count -= resync(ring);
+                            break;
+                        }
+                        ++countFrames;
+                        if (entry != nullptr)
+                            (*entry->handler)(view(ring, HEADER_SIZE, length));
+                        else
+                            ++countUnknown;
+                        count -= complete(ring);
+                        break;
+
+                    case NMEA_BODY:
+                        if (byte == '*') {
+                            length = pos - 1;
+                            state = NMEA_CHECK;
+                        }
+                        else if (byte < 0x20 || byte > 0x7E || pos > MAX_NMEA)
+                            count -= resync(ring);
+                        else
+                            chkA ^= byte;
+                        break;
+
+                    case NMEA_CHECK:
+                        if (fromHex(byte) < 0) {
+                            count -= resync(ring);
+                            break;
+                        }
+                        if (pos < length + 3)
+                            break;
+                        if (((fromHex(ring.peek(length + 1)) << 4) | fromHex(byte)) != chkA) {
+                            count -= resync(ring);
+                            break;
+                        }
+                        ++countFrames;
+                        if (nmea != nullptr)
+                            (*nmea)(reinterpret_cast<const char*>(view(ring, 0, length)), length);
+                        count -= complete(ring);
+                        break;
+                }
+            }
+        }
+
+        // number of frames with valid checksums
+        [[nodiscard]] uint32_t getFrames() const { return countFrames; }
+        // number of valid frames that are not registered
+        [[nodiscard]] uint32_t getUnknown() const { return countUnknown; }
+        // number of discarded partial or corrupt frames
+        [[nodiscard]] uint32_t getErrors() const { return countErrors; }
+        // number of payloads copied because they wrapped around the end of the ring
+        [[nodiscard]] uint32_t getCopied() const { return countCopied; }
+    };
+}
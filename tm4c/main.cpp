@@ -15,6 +15,7 @@
 #include "lib/net.hpp"
 #include "lib/random.hpp"
 #include "lib/run.hpp"
+#include "lib/store.hpp"
 #include "lib/clock/clock.hpp"
 #include "lib/ntp/ntp.hpp"
 #include "lib/ptp/ptp.hpp"
@@ -42,6 +43,7 @@ int main() {
     random::init();
     // initialize EEPROM
     EEPROM_init();
+    store::init();
     // initialize GPS
     gps::init();
     // initialize networking
@@ -0,0 +1,330 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "sim.hpp"
+
+#include "../hw/eeprom.h"
+#include "../lib/gps.hpp"
+#include "../lib/run.hpp"
+#include "../lib/clock/capture.hpp"
+#include "../lib/clock/clock.hpp"
+#include "../lib/clock/comp.hpp"
+#include "../lib/clock/mono.hpp"
+#include "../lib/clock/tai.hpp"
+#include "../lib/clock/util.hpp"
+#include "../lib/net/ip.hpp"
+#include "../lib/ntp/timepulse.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+
+// EEPROM size in 32-bit words (6 KiB)
+static constexpr int EEPROM_WORDS = 1536;
+
+// true time
+static uint64_t simTrue;
+// monotonic clock phase error relative to true time
+static double simPhase;
+// oscillator fractional frequency error
+static double simFreq;
+
+// temperature sensor reading
+static float simTemp;
+// GPS PPS timestamps
+static uint64_t ppsStamp[3];
+// consumer of GPS PPS timestamps
+static RunCall ppsHandler;
+static void *ppsHandlerRef;
+// GPS timing state
+static uint32_t gpsEpoch;
+static uint64_t gpsEpochUpdate;
+static ntp::TimePulse gpsTimePulse;
+
+// EEPROM contents
+static uint32_t eepromData[EEPROM_WORDS];
+static int eepromAddr;
+static bool eepromInit;
+
+uint64_t sim::now() {
+    return simTrue;
+}
+
+void sim::advance(const uint64_t time) {
+    simPhase += simFreq * toSeconds(static_cast<int64_t>(time - simTrue));
+    simTrue = time;
+}
+
+void sim::setFrequency(const double freq) {
+    simFreq = freq;
+}
+
+uint64_t sim::monoExact() {
+    return simTrue + toFixed(simPhase);
+}
+
+uint64_t sim::trueFromMono(const uint64_t mono) {
+    const auto delta = static_cast<int64_t>(mono - monoExact());
+    if (delta <= 0)
+        return simTrue;
+    // allow for timer quantization
+    return simTrue + toFixed(toSeconds(delta) / (1.0 + simFreq) + CLK_NANOS * 1e-9);
+}
+
+void sim::setTemperature(const float temp) {
+    simTemp = temp;
+}
+
+void sim::pulse() {
+    const uint64_t mono = clock::monotonic::now();
+
+    // frequency compensated clock
+    uint32_t rem = 0;
+    ppsStamp[0] = mono;
+    ppsStamp[1] = ppsStamp[0] +
+                  corrFracRem(clkCompRate, ppsStamp[0] - clkCompRef, rem) +
+                  clkCompOffset;
+
+    // TAI disciplined clock
+    ppsStamp[2] = ppsStamp[1] +
+                  corrFracRem(clkTaiRate, ppsStamp[1] - clkTaiRef, rem) +
+                  clkTaiOffset;
+
+    // hand off to the GPS reference (PPS worker task)
+    if (ppsHandler != nullptr)
+        (*ppsHandler)(ppsHandlerRef);
+}
+
+void sim::timeMessage(const uint32_t epoch) {
+    gpsEpoch = epoch;
+    gpsEpochUpdate = clock::monotonic::now();
+}
+
+void sim::timePulse(const double qErr) {
+    // UBX-TIM-TP payload with quantization error in picoseconds
+    uint8_t payload[ntp::TimePulse::PAYLOAD_SIZE] = {};
+    const auto ps = static_cast<int32_t>(std::lround(qErr * 1e12));
+    memcpy(payload + 8, &ps, sizeof(ps));
+    gpsTimePulse.update(clock::monotonic::now(), payload);
+}
+
+bool sim::loadEeprom(const char *path) {
+    const auto file = fopen(path, "rb");
+    if (file == nullptr)
+        return false;
+    const auto count = fread(eepromData, sizeof(uint32_t), EEPROM_WORDS, file);
+    fclose(file);
+    eepromInit = true;
+    return count == EEPROM_WORDS;
+}
+
+bool sim::saveEeprom(const char *path) {
+    const auto file = fopen(path, "wb");
+    if (file == nullptr)
+        return false;
+    const auto count = fwrite(eepromData, sizeof(uint32_t), EEPROM_WORDS, file);
+    fclose(file);
+    return count == EEPROM_WORDS;
+}
+
+
+// simulated monotonic clock (quantized to the timer resolution)
+
+uint32_t clock::monotonic::seconds() {
+    return now() >> 32;
+}
+
+uint64_t clock::monotonic::now() {
+    fixed_32_32 scratch = {};
+    scratch.full = sim::monoExact();
+    const auto ticks = static_cast<uint32_t>((static_cast<uint64_t>(scratch.fpart) * CLK_FREQ) >> 32);
+    scratch.fpart = nanosToFrac(ticks * CLK_NANOS);
+    return scratch.full;
+}
+
+
+// frequency compensated clock (mirrors lib/clock/comp.cpp)
+
+volatile uint64_t clkCompOffset = 0;
+volatile uint64_t clkCompRef = 0;
+volatile int32_t clkCompRate = 0;
+static volatile uint32_t clkCompRem = 0;
+
+uint64_t clock::compensated::now() {
+    // get monotonic time
+    const uint64_t clkMono = monotonic::now();
+    // translate to compensated domain
+    int64_t scratch = static_cast<int32_t>(clkMono - clkCompRef);
+    scratch *= clkCompRate;
+    return clkMono + clkCompOffset + static_cast<int32_t>(scratch >> 32);
+}
+
+uint64_t clock::compensated::fromMono(uint64_t ts) {
+    ts += corrValue(clkCompRate, static_cast<int64_t>(ts - clkCompRef));
+    ts += clkCompOffset;
+    return ts;
+}
+
+static void runClkComp([[maybe_unused]] void *ref) {
+    // prepare update values
+    const uint64_t now = clock::monotonic::now();
+    const int32_t offset = corrFracRem(clkCompRate, now - clkCompRef, clkCompRem);
+
+    // apply update
+    clkCompRef = now;
+    clkCompOffset += offset;
+}
+
+void clock::compensated::setTrim(const int32_t rate) {
+    // prepare compensation update
+    const uint64_t now = monotonic::now();
+    const uint64_t offset = clkCompOffset + corrFracRem(clkCompRate, now - clkCompRef, clkCompRem);
+
+    // apply update
+    clkCompRate = rate;
+    clkCompRef = now;
+    clkCompOffset = offset;
+}
+
+int32_t clock::compensated::getTrim() {
+    return clkCompRate;
+}
+
+
+// TAI disciplined clock (mirrors lib/clock/tai.cpp)
+
+volatile uint64_t clkTaiUtcOffset = 0;
+
+volatile uint64_t clkTaiOffset = 0;
+volatile uint64_t clkTaiRef = 0;
+volatile int32_t clkTaiRate = 0;
+static volatile uint32_t clkTaiRem = 0;
+
+static void runClkTai([[maybe_unused]] void *ref) {
+    // prepare update values
+    const uint64_t now = clock::compensated::now();
+    const int32_t offset = corrFracRem(clkTaiRate, now - clkTaiRef, clkTaiRem);
+
+    // apply update
+    clkTaiRef = now;
+    clkTaiOffset += offset;
+}
+
+void sim::initClock() {
+    // schedule clock domain updates
+    runSleep(RUN_SEC / 4, runClkComp, nullptr);
+    runSleep(RUN_SEC / 4, runClkTai, nullptr);
+}
+
+uint64_t clock::tai::now() {
+    uint32_t rem = 0;
+    // get monotonic time
+    uint64_t ts = monotonic::now();
+    // translate to compensated domain
+    ts += corrFracRem(clkCompRate, ts - clkCompRef, rem);
+    ts += clkCompOffset;
+    // translate to TAI domain
+    ts += corrFracRem(clkTaiRate, ts - clkTaiRef, rem);
+    ts += clkTaiOffset;
+    return ts;
+}
+
+uint64_t clock::tai::fromMono(uint64_t ts) {
+    // translate to compensated domain
+    ts += corrValue(clkCompRate, static_cast<int64_t>(ts - clkCompRef));
+    ts += clkCompOffset;
+    // translate to TAI domain
+    ts += corrValue(clkTaiRate, static_cast<int64_t>(ts - clkTaiRef));
+    ts += clkTaiOffset;
+    return ts;
+}
+
+void clock::tai::setTrim(const int32_t trim) {
+    // prepare update values
+    const uint64_t now = compensated::now();
+    const int32_t offset = corrFracRem(clkTaiRate, now - clkTaiRef, clkTaiRem);
+
+    // apply update
+    clkTaiRef = now;
+    clkTaiRate = trim;
+    clkTaiOffset += offset;
+}
+
+int32_t clock::tai::getTrim() {
+    return clkTaiRate;
+}
+
+void clock::tai::adjust(const int64_t delta) {
+    clkTaiOffset += delta;
+}
+
+
+// timestamp capture
+
+float clock::capture::temperature() {
+    return simTemp;
+}
+
+void clock::capture::ppsGps(uint64_t *tsResult) {
+    tsResult[0] = ppsStamp[0];
+    tsResult[1] = ppsStamp[1];
+    tsResult[2] = ppsStamp[2];
+}
+
+void clock::capture::onPpsGps(const RunCall callback, void *ref) {
+    ppsHandler = callback;
+    ppsHandlerRef = ref;
+}
+
+
+// GPS receiver
+
+uint64_t gps::taiEpochUpdate() {
+    return gpsEpochUpdate;
+}
+
+uint32_t gps::taiEpoch() {
+    return gpsEpoch;
+}
+
+int gps::taiOffset() {
+    return sim::TAI_OFFSET;
+}
+
+bool gps::ppsCorrection(const uint64_t pps, int64_t &correction) {
+    return gpsTimePulse.correct(pps, correction);
+}
+
+float gps::qErr() {
+    return gpsTimePulse.getQErr();
+}
+
+
+// network interface
+
+volatile uint32_t ipAddress = 0;
+
+
+// EEPROM (erased state reads as all ones)
+
+void EEPROM_seek(const uint32_t addr) {
+    if (!eepromInit) {
+        eepromInit = true;
+        for (auto &word : eepromData)
+            word = -1;
+    }
+    eepromAddr = static_cast<int>(addr) % EEPROM_WORDS;
+}
+
+uint32_t EEPROM_read() {
+    const auto word = eepromData[eepromAddr];
+    eepromAddr = (eepromAddr + 1) % EEPROM_WORDS;
+    return word;
+}
+
+void EEPROM_write(const uint32_t data) {
+    eepromData[eepromAddr] = data;
+    eepromAddr = (eepromAddr + 1) % EEPROM_WORDS;
+}
@@ -0,0 +1,23 @@
+#!/bin/sh
+# Compare the time error accumulated during a GPS outage with the holdover prediction.
+# usage: holdover.sh SIMULATOR [options...]
+set -e
+
+sim="$1"
+shift
+
+# one hour outage after half a day of lock
+out=$("$sim" --duration 46800 --seed 1 --pps-outage 43200 --pps-outage-length 3600 "$@")
+
+error=$(echo "$out" | sed -n 's/^holdover error: *\([^ ]*\) s (predicted \([^ ]*\) s).*/\1/p')
+predicted=$(echo "$out" | sed -n 's/^holdover error: *\([^ ]*\) s (predicted \([^ ]*\) s).*/\2/p')
+beyond=$(echo "$out" | sed -n 's/^holdover time: *[0-9]* s (\([0-9]*\) s beyond prediction).*/\1/p')
+expired=$(echo "$out" | sed -n 's/^holdover expired: *\([0-9]*\) s.*/\1/p')
+
+echo "holdover error:     ${error:-none} s"
+echo "predicted error:    ${predicted:-none} s"
+echo "beyond prediction:  ${beyond:-none} s"
+echo "budget exhausted:   ${expired:-never} s"
+# the prediction must bound the actual error without being uselessly pessimistic
+[ -n "$error" ] && [ -n "$predicted" ] && [ "$beyond" -eq 0 ] && [ -n "$expired" ] &&
+    awk -v e="$error" -v p="$predicted" 'BEGIN { exit !(p >= e && p <= 20 * e) }'
@@ -0,0 +1,354 @@
+/**
+ * Closed-loop GPSDO simulator
+ * Runs the clock discipline (PLL), temperature compensation (tcmp), source filtering and selection code against a
+ * simulated oscillator, temperature profile, GPS PPS signal and NTP peers.
+ */
+
+#include "noise.hpp"
+#include "oscillator.hpp"
+#include "sim.hpp"
+#include "stats.hpp"
+#include "thermal.hpp"
+
+#include "../lib/run.hpp"
+#include "../lib/store.hpp"
+#include "../lib/clock/comp.hpp"
+#include "../lib/clock/tai.hpp"
+#include "../lib/ntp/pll.hpp"
+#include "../lib/ntp/tcmp.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// oscillator and temperature update interval (1/16 second)
+static constexpr uint64_t STEP = 1ull << 28;
+static constexpr double STEP_SEC = 0x1p-4;
+// GPS timing message lead time before each PPS edge (1/2 second)
+static constexpr uint64_t MSG_LEAD = 1ull << 31;
+
+// simulation parameters
+static double duration = 86400;
+static double seed = 1;
+static double settleLimit = 1e-6;
+static double traceEvery = 1;
+static double gpsFix = 30;
+static double ppsJitter = 5e-9;
+static double ppsSaw = 21e-9;
+static double ppsSawRate = 0.01;
+static double ppsQErr = 1;
+static double ppsOutage = 0;
+static double ppsOutageLength = 0;
+static double ntpPeers = 0;
+static double ntpJitter = 200e-6;
+static const char *tracePath = nullptr;
+static const char *eepromPath = nullptr;
+static bool printStatus = false;
+
+static sim::Oscillator osc;
+static sim::Thermal thermal;
+
+static const struct {
+    const char *name;
+    double *value;
+    const char *help;
+} options[] = {
+    {"duration", &duration, "simulated duration (s)"},
+    {"seed", &seed, "random seed"},
+    {"settle", &settleLimit, "settling threshold for the TAI offset (s)"},
+    {"trace-every", &traceEvery, "trace output interval (s)"},
+    {"gps-fix", &gpsFix, "GPS time to first fix (s)"},
+    {"pps-jitter", &ppsJitter, "PPS white jitter (s)"},
+    {"pps-saw", &ppsSaw, "PPS sawtooth quantization span (s)"},
+    {"pps-saw-rate", &ppsSawRate, "PPS sawtooth drift rate (cycles/s)"},
+    {"pps-qerr", &ppsQErr, "receiver reports PPS quantization error (UBX-TIM-TP)"},
+    {"pps-outage", &ppsOutage, "start of GPS signal outage (s)"},
+    {"pps-outage-length", &ppsOutageLength, "length of GPS signal outage (s)"},
+    {"ntp-peers", &ntpPeers, "number of wide area NTP peers"},
+    {"ntp-jitter", &ntpJitter, "NTP peer offset jitter (s)"},
+    {"osc-offset", &osc.offset, "oscillator frequency offset"},
+    {"osc-aging", &osc.aging, "oscillator aging (per day)"},
+    {"osc-tempco", &osc.tempco1, "oscillator linear temperature coefficient (per C)"},
+    {"osc-tempco2", &osc.tempco2, "oscillator quadratic temperature coefficient (per C^2)"},
+    {"osc-wfm", &osc.whiteFM, "white FM noise (ADEV at 1 s)"},
+    {"osc-ffm", &osc.flickerFM, "flicker FM noise (ADEV floor)"},
+    {"osc-rwfm", &osc.walkFM, "random-walk FM noise (ADEV at 1 s)"},
+    {"temp-base", &thermal.base, "mean ambient temperature (C)"},
+    {"temp-swing", &thermal.swing, "ambient temperature swing amplitude (C)"},
+    {"temp-period", &thermal.period, "ambient temperature swing period (s)"},
+    {"temp-walk", &thermal.walkRate, "ambient temperature random walk (C/sqrt(s))"},
+    {"temp-step", &thermal.step, "ambient temperature step change (C)"},
+    {"temp-step-time", &thermal.stepTime, "ambient temperature step change time (s)"},
+    {"temp-lag", &thermal.lag, "oscillator thermal time constant (s)"},
+    {"temp-noise", &thermal.sensorNoise, "temperature sensor noise (C)"},
+};
+
+/**
+ * Compute the receiver quantization (sawtooth) error of a GPS PPS edge
+ * @param pulse pulse number
+ * @param sawPhase initial sawtooth phase
+ * @return quantization error in seconds
+ */
+static double ppsSawtooth(const uint64_t pulse, const double sawPhase) {
+    if (ppsSaw <= 0)
+        return 0;
+    const double saw = sawPhase + ppsSawRate * static_cast<double>(pulse);
+    return ppsSaw * (saw - std::floor(saw) - 0.5);
+}
+
+/**
+ * Compute the timing error of a GPS PPS edge
+ * @param pulse pulse number
+ * @param sawPhase initial sawtooth phase
+ * @return edge offset relative to the true second in seconds
+ */
+static double ppsEdge(const uint64_t pulse, const double sawPhase) {
+    // white jitter and receiver sawtooth quantization
+    return ppsJitter * sim::noise::gauss() + ppsSawtooth(pulse, sawPhase);
+}
+
+/**
+ * Check if a pulse falls into the simulated GPS signal outage
+ * @param pulse pulse number
+ * @return true if neither the pulse nor its timing messages are received
+ */
+static bool isOutage(const uint64_t pulse) {
+    const auto time = static_cast<double>(pulse);
+    return time >= ppsOutage && time < ppsOutage + ppsOutageLength;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [options]\n", name);
+    fprintf(stderr, "  --trace FILE          write CSV trace to FILE\n");
+    fprintf(stderr, "  --eeprom FILE         load and save simulated EEPROM contents\n");
+    fprintf(stderr, "  --status              print PLL status at the end of the run\n");
+    for (const auto &option : options)
+        fprintf(stderr, "  --%-20s%s [%g]\n", option.name, option.help, *option.value);
+}
+
+static bool parseArgs(const int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0)
+            return false;
+        arg += 2;
+        if (strcmp(arg, "status") == 0) {
+            printStatus = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+            return false;
+        const char *value = argv[++i];
+        if (strcmp(arg, "trace") == 0) {
+            tracePath = value;
+            continue;
+        }
+        if (strcmp(arg, "eeprom") == 0) {
+            eepromPath = value;
+            continue;
+        }
+        bool found = false;
+        for (const auto &option : options) {
+            if (strcmp(arg, option.name) == 0) {
+                char *end;
+                *option.value = strtod(value, &end);
+                found = *end == 0;
+                break;
+            }
+        }
+        if (!found)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (!parseArgs(argc, argv)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *trace = nullptr;
+    if (tracePath != nullptr) {
+        trace = fopen(tracePath, "w");
+        if (trace == nullptr) {
+            fprintf(stderr, "failed to open %s\n", tracePath);
+            return 1;
+        }
+        fprintf(trace, "time,temp,offset,freq,comp_freq,tcmp,pll_offset,pll_corr\n");
+    }
+    if (eepromPath != nullptr)
+        sim::loadEeprom(eepromPath);
+
+    // initial conditions
+    sim::noise::seed(static_cast<uint64_t>(seed));
+    double temp = thermal.update(0);
+    double freq = osc.step(STEP_SEC, temp);
+    sim::setTemperature(thermal.sensor());
+    sim::setFrequency(freq);
+
+    // start firmware tasks
+    initScheduler();
+    store::init();
+    sim::initClock();
+    sim::initNtp(static_cast<int>(ntpPeers), ntpJitter);
+
+    // recorded series (1 Hz)
+    std::vector<double> offsets, freqs, compFreqs;
+    // holdover error compared to the prediction
+    int holdTime = 0, holdExpired = -1, holdViolations = 0;
+    double holdError = 0, holdPredicted = 0;
+    const auto end = static_cast<uint64_t>(sim::toFixed(duration));
+    const double sawPhase = sim::noise::uniform();
+    const auto firstPulse = static_cast<uint64_t>(std::ceil(gpsFix));
+    uint64_t pulse = firstPulse;
+    uint64_t pulseTime = (pulse << 32) + sim::toFixed(ppsEdge(pulse, sawPhase));
+    uint64_t msgTime = (pulse << 32) - MSG_LEAD;
+    uint64_t gridNext = STEP;
+
+    enum { GRID, MESSAGE, PULSE, TASK } event;
+    for (;;) {
+        // locate next event
+        uint64_t next = gridNext;
+        event = GRID;
+        if (static_cast<int64_t>(msgTime - next) < 0) {
+            next = msgTime;
+            event = MESSAGE;
+        }
+        if (static_cast<int64_t>(pulseTime - next) < 0) {
+            next = pulseTime;
+            event = PULSE;
+        }
+        uint64_t due;
+        if (sim::nextTask(due)) {
+            const auto taskTime = sim::trueFromMono(due);
+            if (static_cast<int64_t>(taskTime - next) < 0) {
+                next = taskTime;
+                event = TASK;
+            }
+        }
+        if (next > end)
+            break;
+        sim::advance(next);
+
+        switch (event) {
+            case GRID: {
+                gridNext += STEP;
+                // record state at one second intervals
+                if ((next & 0xFFFFFFFFull) == 0) {
+                    const auto sec = next >> 32;
+                    const auto tai = clock::tai::fromMono(sim::monoExact());
+                    const double offset = sim::toSeconds(static_cast<int64_t>(tai - ((sim::TAI_START + sec) << 32)));
+                    const double comp = 0x1p-32 * clock::compensated::getTrim();
+                    const double trim = 0x1p-32 * clock::tai::getTrim();
+                    const double freqTai = (1 + freq) * (1 + comp) * (1 + trim) - 1;
+                    const double freqComp = (1 + freq) * (1 + comp) - 1;
+                    offsets.push_back(offset);
+                    freqs.push_back(freqTai);
+                    compFreqs.push_back(freqComp);
+                    if (const auto state = PLL_holdoverState(); state != PLL_HOLD_NONE) {
+                        const double predicted = PLL_holdoverError();
+                        if (state == PLL_HOLD_EXPIRED && holdExpired < 0)
+                            holdExpired = holdTime;
+                        if (std::fabs(offset) > predicted)
+                            ++holdViolations;
+                        holdError = std::fmax(holdError, std::fabs(offset));
+                        holdPredicted = std::fmax(holdPredicted, predicted);
+                        ++holdTime;
+                    }
+                    if (trace != nullptr && std::fmod(static_cast<double>(sec), traceEvery) == 0) {
+                        fprintf(
+                            trace, "%llu,%.4f,%.6e,%.6e,%.6e,%.6e,%.6e,%.6e\n",
+                            static_cast<unsigned long long>(sec), temp, offset, freqTai, freqComp,
+                            tcmp::get(), PLL_offsetLast(), PLL_offsetCorr()
+                        );
+                    }
+                }
+                // advance temperature and oscillator models
+                temp = thermal.update(STEP_SEC);
+                freq = osc.step(STEP_SEC, temp);
+                sim::setTemperature(thermal.sensor());
+                sim::setFrequency(freq);
+                break;
+            }
+            case MESSAGE:
+                // timing message for the upcoming pulse
+                if (!isOutage(pulse)) {
+                    sim::timeMessage(sim::TAI_START + pulse - 1);
+                    if (ppsQErr != 0)
+                        sim::timePulse(ppsSawtooth(pulse, sawPhase));
+                }
+                msgTime = ((pulse + 1) << 32) - MSG_LEAD;
+                break;
+            case PULSE:
+                if (!isOutage(pulse))
+                    sim::pulse();
+                ++pulse;
+                pulseTime = (pulse << 32) + sim::toFixed(ppsEdge(pulse, sawPhase));
+                break;
+            case TASK:
+                sim::runTask();
+                break;
+        }
+    }
+
+    if (trace != nullptr)
+        fclose(trace);
+    if (eepromPath != nullptr && !sim::saveEeprom(eepromPath))
+        fprintf(stderr, "failed to save %s\n", eepromPath);
+
+    // settling time (last excursion beyond the settling threshold)
+    const int count = static_cast<int>(offsets.size());
+    int settled = 0;
+    for (int i = 0; i < count; ++i) {
+        if (std::fabs(offsets[i]) > settleLimit)
+            settled = i + 1;
+    }
+
+    // steady-state statistics over the second half of the run
+    const int half = count / 2;
+    const double *offsetTail = offsets.data() + half;
+    const int tail = count - half;
+
+    printf("simulated duration:  %.0f s\n", duration);
+    if (settled < count)
+        printf("settling time:       %d s (|offset| < %.3e s)\n", settled, settleLimit);
+    else
+        printf("settling time:       not settled (|offset| < %.3e s)\n", settleLimit);
+    if (PLL_locked())
+        printf("time to lock:        %d s (%s start)\n", PLL_lockTime(), PLL_warmStart() ? "warm" : "cold");
+    else
+        printf("time to lock:        not locked (%s start)\n", PLL_warmStart() ? "warm" : "cold");
+    printf("missed pulses:       %u\n", sim::missedPulses());
+    if (holdTime > 0) {
+        printf("holdover time:       %d s (%d s beyond prediction)\n", holdTime, holdViolations);
+        printf("holdover error:      %.4e s (predicted %.4e s)\n", holdError, holdPredicted);
+        if (holdExpired >= 0)
+            printf("holdover expired:    %d s\n", holdExpired);
+    }
+    printf("offset rms:          %.4e s\n", sim::stats::rms(offsetTail, tail));
+    printf("offset peak:         %.4e s\n", sim::stats::peak(offsetTail, tail));
+    printf("frequency rms:       %.4e\n", sim::stats::rms(freqs.data() + half, tail));
+    printf("tcmp residual rms:   %.4e\n", sim::stats::rms(compFreqs.data() + half, tail));
+    printf("\n%10s %12s %12s\n", "tau (s)", "adev", "tdev (s)");
+    for (int factor = 1; 3 * factor <= tail; factor <<= 1) {
+        printf(
+            "%10d %12.4e %12.4e\n", factor,
+            sim::stats::adev(offsetTail, tail, 1, factor),
+            sim::stats::tdev(offsetTail, tail, factor)
+        );
+    }
+
+    if (printStatus) {
+        static char buffer[4096];
+        buffer[PLL_status(buffer)] = 0;
+        printf("\n%s", buffer);
+        buffer[PLL_stability(buffer)] = 0;
+        printf("\n%s", buffer);
+        buffer[store::status(buffer)] = 0;
+        printf("\n%s", buffer);
+    }
+    return 0;
+}
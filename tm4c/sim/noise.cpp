@@ -0,0 +1,25 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "noise.hpp"
+
+#include <random>
+
+static std::mt19937_64 generator;
+static std::uniform_real_distribution<double> distUniform;
+static std::normal_distribution<double> distGauss;
+
+void sim::noise::seed(const uint64_t seed) {
+    generator.seed(seed);
+    distUniform.reset();
+    distGauss.reset();
+}
+
+double sim::noise::uniform() {
+    return distUniform(generator);
+}
+
+double sim::noise::gauss() {
+    return distGauss(generator);
+}
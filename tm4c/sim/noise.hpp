@@ -0,0 +1,27 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace sim::noise {
+    /**
+     * Seed the random number generator
+     * @param seed random seed
+     */
+    void seed(uint64_t seed);
+
+    /**
+     * Draw a uniformly distributed random value
+     * @return random value in the range [0, 1)
+     */
+    double uniform();
+
+    /**
+     * Draw a normally distributed random value
+     * @return random value with zero mean and unit variance
+     */
+    double gauss();
+}
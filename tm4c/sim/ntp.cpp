@@ -0,0 +1,196 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "noise.hpp"
+#include "sim.hpp"
+
+#include "../lib/run.hpp"
+#include "../lib/clock/tai.hpp"
+#include "../lib/clock/util.hpp"
+#include "../lib/net/util.hpp"
+#include "../lib/ntp/GPS.hpp"
+#include "../lib/ntp/ntp.hpp"
+#include "../lib/ntp/pll.hpp"
+#include "../lib/ntp/select.hpp"
+
+#include <cmath>
+#include <new>
+
+// source selection interval (matches lib/ntp/ntp.cpp)
+static constexpr uint32_t SRC_UPDT_INTV = RUN_SEC / 16; // 16 Hz
+
+// maximum number of simulated NTP peers
+static constexpr int MAX_SIM_PEERS = 4;
+static constexpr int MAX_SIM_SRCS = MAX_SIM_PEERS + 1;
+
+namespace {
+    /**
+     * Simulated wide area NTP peer
+     * Samples the true TAI time with white offset noise at a fixed polling interval.
+     */
+    class SimPeer final : public ntp::Source {
+        // polling interval (log2 seconds)
+        static constexpr int PEER_POLL = 4;
+        // minimum round-trip delay (seconds)
+        static constexpr double PEER_DELAY = 20e-3;
+
+        // sample history
+        Sample history[HISTORY_WAN];
+        // offset noise (seconds)
+        const double jitter;
+
+        static void run(void *ref) {
+            static_cast<SimPeer*>(ref)->update();
+        }
+
+        void update();
+
+    public:
+        SimPeer(const uint32_t addr, const double jitter_) :
+            Source(addr, RPY_SD_MD_CLIENT, history, HISTORY_WAN), history{}, jitter(jitter_) {
+            // set metadata
+            version = 4;
+            ntpMode = 4;
+            stratum = 1;
+            minPoll = PEER_POLL;
+            maxPoll = PEER_POLL;
+            poll = PEER_POLL;
+            runSleep(RUN_SEC << PEER_POLL, &run, this);
+        }
+    };
+}
+
+void SimPeer::update() {
+    // update reach indicator
+    reach = (reach << 1) | 1;
+    ++rxCount;
+    ++rxValid;
+    ++txCount;
+    if (reach & 0xF)
+        lost = false;
+
+    // sample the true TAI time through a jittery network path
+    auto &sample = advanceFilter();
+    sample.taiLocal = clock::tai::now();
+    sample.taiRemote = (static_cast<uint64_t>(sim::TAI_START) << 32) + sim::now();
+    sample.taiRemote += sim::toFixed(jitter * sim::noise::gauss());
+    sample.delay = static_cast<float>(PEER_DELAY + jitter * std::fabs(sim::noise::gauss()));
+    updateFilter();
+}
+
+// static allocation for GPS source
+static char rawGps[sizeof(ntp::GPS)] [[gnu::aligned(8)]];
+// static allocation for peers
+static char rawPeers[sizeof(SimPeer) * MAX_SIM_PEERS] [[gnu::aligned(8)]];
+static ntp::Source *sources[MAX_SIM_SRCS];
+static int cntSources;
+static ntp::Source *gps;
+static uint64_t lastUpdate;
+static void *taskSelect;
+static uint32_t refId;
+
+// called by PLL for hard TAI adjustments
+void ntpApplyOffset(const int64_t offset) {
+    for (int i = 0; i < cntSources; i++)
+        sources[i]->applyOffset(offset);
+}
+
+/**
+ * Source selection and clock update (mirrors runSelect() in lib/ntp/ntp.cpp)
+ * @param ref unused
+ */
+static void runSelect([[maybe_unused]] void *ref) {
+    // gather selectable sources
+    ntp::Source *selectable[MAX_SIM_SRCS];
+    ntp::Source *reference = nullptr;
+    int count = 0;
+    for (int i = 0; i < cntSources; i++) {
+        if (!sources[i]->isSelectable())
+            continue;
+        if (reference == nullptr || sources[i]->getScore() < reference->getScore())
+            reference = sources[i];
+        selectable[count++] = sources[i];
+    }
+
+    // select and combine sources relative to the best scoring source
+    ntp::select::Candidate candidates[MAX_SIM_SRCS];
+    const auto refOffset = reference ? reference->getFilteredOffset() : 0;
+    for (int i = 0; i < count; i++) {
+        auto &cand = candidates[i];
+        cand.offset = toFloat(selectable[i]->getFilteredOffset() - refOffset);
+        cand.distance = selectable[i]->getDistance();
+        cand.jitter = selectable[i]->getJitter();
+        cand.prefer = selectable[i]->isReference();
+    }
+    float offset = 0, jitter = 0;
+    const int best = count ? ntp::select::run(candidates, count, offset, jitter) : -1;
+    for (int i = 0; i < count; i++) {
+        if (candidates[i].status == ntp::select::STATUS_FALSETICKER)
+            selectable[i]->reject(RPY_SD_ST_FALSETICKER);
+        else if (candidates[i].status == ntp::select::STATUS_OUTLIER)
+            selectable[i]->reject(RPY_SD_ST_UNSELECTED);
+    }
+
+    // coast on the holdover prediction until the reference returns or the time error budget is exhausted
+    if (
+        PLL_holdoverState() == PLL_HOLD_ACTIVE &&
+        (best < 0 || !selectable[best]->isReference() || selectable[best]->getLastUpdate() == lastUpdate)
+    ) {
+        refId = ntp::GPS::REF_ID;
+        return;
+    }
+    if (best < 0) {
+        refId = 0;
+        return;
+    }
+
+    const auto source = selectable[best];
+    source->select();
+    if (lastUpdate == source->getLastUpdate())
+        return;
+    lastUpdate = source->getLastUpdate();
+    refId = source->getId();
+
+    // system jitter combines the jitter of the system peer with the selection jitter
+    const auto peerJitter = source->getJitter();
+    jitter = sqrtf(peerJitter * peerJitter + jitter * jitter);
+
+    // update offset compensation using the combined offset
+    PLL_updateOffset(source->getPollingInterval(), refOffset + toFixedPoint(offset), jitter);
+    // update frequency compensation
+    PLL_updateDrift(source->getPollingInterval(), PLL_offsetCorr());
+}
+
+uint32_t sim::missedPulses() {
+    RPY_NTPData data = {};
+    gps->getNtpData(data);
+    return htonl(data.total_tx_count) - htonl(data.total_rx_count);
+}
+
+void sim::initNtp(int peers, const double jitter) {
+    PLL_init();
+
+    // initialize GPS reference
+    gps = new(rawGps) ntp::GPS();
+    sources[cntSources++] = gps;
+
+    // initialize NTP peers
+    if (peers > MAX_SIM_PEERS)
+        peers = MAX_SIM_PEERS;
+    const auto peerSlots = reinterpret_cast<SimPeer*>(rawPeers);
+    for (int i = 0; i < peers; i++)
+        sources[cntSources++] = new(peerSlots + i) SimPeer(htonl(0xC0000201u + i), jitter);
+
+    // update source selection at 16 Hz
+    taskSelect = runSleep(SRC_UPDT_INTV, runSelect, nullptr);
+}
+
+uint32_t ntp::refId() {
+    return ::refId;
+}
+
+void ntp::requestSelect() {
+    if (taskSelect != nullptr)
+        runDelay(taskSelect, 0);
+}
@@ -0,0 +1,43 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "oscillator.hpp"
+
+#include "noise.hpp"
+
+#include <cmath>
+
+sim::Oscillator::Oscillator() : walk(0), flicker{}, elapsed(0) { }
+
+double sim::Oscillator::step(const double interval, const double temp) {
+    // flicker FM (sum of octave-spaced first-order processes, each with variance floor^2 / 2)
+    const double level = flickerFM * M_SQRT1_2;
+    if (elapsed == 0) {
+        // start from the stationary distribution
+        for (auto &pole : flicker)
+            pole = level * noise::gauss();
+    }
+    elapsed += interval;
+
+    // white FM (constant over the interval)
+    double freq = whiteFM * noise::gauss() / std::sqrt(interval);
+
+    double tau = FLICKER_BASE;
+    for (auto &pole : flicker) {
+        const double decay = std::exp(-interval / tau);
+        pole = decay * pole + std::sqrt(1 - decay * decay) * level * noise::gauss();
+        freq += pole;
+        tau *= 2;
+    }
+
+    // random-walk FM
+    walk += walkFM * std::sqrt(3 * interval) * noise::gauss();
+    freq += walk;
+
+    // deterministic terms
+    const double dt = temp - tempRef;
+    freq += offset + aging * elapsed / 86400;
+    freq += (tempco1 + tempco2 * dt) * dt;
+    return freq;
+}
@@ -0,0 +1,52 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+namespace sim {
+    /**
+     * Oscillator frequency error model.
+     * Noise levels are specified as the Allan deviation of each power-law component at a 1 second tau.
+     */
+    class Oscillator {
+        // number of octave-spaced poles used to synthesize flicker FM noise
+        static constexpr int FLICKER_POLES = 20;
+        // time constant of the fastest flicker FM pole (seconds)
+        static constexpr double FLICKER_BASE = 0x1p-3;
+
+        // random-walk FM state
+        double walk;
+        // flicker FM state
+        double flicker[FLICKER_POLES];
+        // elapsed time (seconds)
+        double elapsed;
+
+    public:
+        // static frequency offset
+        double offset = 2e-6;
+        // linear aging rate (per day)
+        double aging = 1e-9;
+        // temperature coefficients (per degree Celsius and per degree Celsius squared)
+        double tempco1 = 20e-9;
+        double tempco2 = 1e-9;
+        // temperature coefficient reference point (degrees Celsius)
+        double tempRef = 25;
+        // white FM noise level
+        double whiteFM = 2e-11;
+        // flicker FM noise level (Allan deviation floor)
+        double flickerFM = 5e-12;
+        // random-walk FM noise level
+        double walkFM = 1e-13;
+
+        Oscillator();
+
+        /**
+         * Advance the oscillator model
+         * @param interval elapsed time in seconds
+         * @param temp oscillator temperature in Celsius
+         * @return fractional frequency error over the interval
+         */
+        double step(double interval, double temp);
+    };
+}
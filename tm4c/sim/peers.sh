@@ -0,0 +1,23 @@
+#!/bin/sh
+# Check that the clock discipline filters the offset noise of NTP peers when no GPS reference is present.
+# usage: peers.sh SIMULATOR [options...]
+set -e
+
+sim="$1"
+shift
+jitter=1e-3
+
+result=0
+for peers in 1 2; do
+    out=$("$sim" --duration 43200 --seed 1 --gps-fix 1e9 --ntp-peers $peers --ntp-jitter $jitter "$@")
+    offset=$(echo "$out" | sed -n 's/^offset rms: *\([^ ]*\) s.*/\1/p')
+    freq=$(echo "$out" | sed -n 's/^frequency rms: *\([^ ]*\).*/\1/p')
+
+    echo "$peers peer(s) offset rms:    ${offset:-none} s"
+    echo "$peers peer(s) frequency rms: ${freq:-none}"
+    # the loop must average out the peer jitter instead of tracking each sample
+    [ -n "$offset" ] && [ -n "$freq" ] &&
+        awk -v o="$offset" -v f="$freq" -v j="$jitter" 'BEGIN { exit !(o < j / 2 && f < 1e-6) }' ||
+        result=1
+done
+exit $result
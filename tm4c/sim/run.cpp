@@ -0,0 +1,157 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "sim.hpp"
+
+#include "../lib/format.hpp"
+#include "../lib/run.hpp"
+
+#include <cstdlib>
+
+
+/**
+ * Simulated task scheduler (mirrors the scheduling semantics of lib/run.cpp using the simulated monotonic clock)
+ */
+struct Task {
+    enum Schedule {
+        Free,
+        Sleep,
+        Periodic
+    };
+
+    Schedule schedule;
+    RunCall callback;
+    void *reference;
+    // next run time (32.32 fixed-point monotonic time)
+    uint64_t runNext;
+    // run or sleep interval (32.32 fixed-point seconds)
+    uint64_t runInterval;
+};
+
+// Task element pool.
+static Task taskPool[32];
+// Currently running task.
+static Task *taskActive;
+
+/**
+ * Convert 8.24 fixed-point seconds into 32.32 fixed-point seconds.
+ * @param fixed_8_24 fixed-point value to convert
+ * @return 32.32 fixed-point seconds
+ */
+static uint64_t toFixed(uint32_t fixed_8_24) {
+    if (fixed_8_24 > RUN_MAX)
+        fixed_8_24 = RUN_MAX;
+    return static_cast<uint64_t>(fixed_8_24) << 8;
+}
+
+static Task* alloc(const Task::Schedule schedule, const uint64_t interval, const RunCall callback, void *ref) {
+    for (auto &task : taskPool) {
+        if (task.schedule != Task::Free)
+            continue;
+        task.schedule = schedule;
+        task.callback = callback;
+        task.reference = ref;
+        task.runInterval = interval;
+        task.runNext = clock::monotonic::now() + interval;
+        return &task;
+    }
+    // task pool exhausted
+    abort();
+}
+
+bool sim::nextTask(uint64_t &due) {
+    const Task *next = nullptr;
+    for (const auto &task : taskPool) {
+        if (task.schedule == Task::Free)
+            continue;
+        if (next == nullptr || static_cast<int64_t>(task.runNext - next->runNext) < 0)
+            next = &task;
+    }
+    if (next == nullptr)
+        return false;
+    due = next->runNext;
+    return true;
+}
+
+void sim::runTask() {
+    Task *next = nullptr;
+    for (auto &task : taskPool) {
+        if (task.schedule == Task::Free)
+            continue;
+        if (next == nullptr || static_cast<int64_t>(task.runNext - next->runNext) < 0)
+            next = &task;
+    }
+    if (next == nullptr)
+        return;
+
+    // run the task
+    taskActive = next;
+    (*next->callback)(next->reference);
+    taskActive = nullptr;
+
+    // requeue the task (unless it was canceled)
+    if (next->schedule == Task::Free)
+        return;
+    next->runNext = next->runInterval + (
+        next->schedule == Task::Periodic ? next->runNext : clock::monotonic::now()
+    );
+}
+
+void initScheduler() {
+    for (auto &task : taskPool)
+        task.schedule = Task::Free;
+}
+
+void* runWait(const RunCall callback, void *ref) {
+    // wait tasks wake at the maximum raw clock interval if they are not awoken
+    return alloc(Task::Sleep, (static_cast<uint64_t>(MAX_RAW_INTV) << 32) / CLK_FREQ, callback, ref);
+}
+
+void* runSleep(const uint32_t delay, const RunCall callback, void *ref) {
+    return alloc(Task::Sleep, toFixed(delay), callback, ref);
+}
+
+void* runPeriodic(const uint32_t interval, const RunCall callback, void *ref) {
+    return alloc(Task::Periodic, toFixed(interval), callback, ref);
+}
+
+void runAdjust(void *taskHandle, const uint32_t interval) {
+    static_cast<Task*>(taskHandle)->runInterval = toFixed(interval);
+}
+
+void runDelay(void *taskHandle, const uint32_t delay) {
+    const auto task = static_cast<Task*>(taskHandle);
+    if (task->schedule != Task::Free)
+        task->runNext = clock::monotonic::now() + toFixed(delay);
+}
+
+void runWake(void *taskHandle) {
+    const auto task = static_cast<Task*>(taskHandle);
+    if (task != taskActive)
+        task->runNext = clock::monotonic::now();
+}
+
+void runCancel(const RunCall callback, const void *ref) {
+    for (auto &task : taskPool) {
+        if (task.schedule == Task::Free)
+            continue;
+        if (callback != nullptr && task.callback != callback)
+            continue;
+        if (ref != nullptr && task.reference != ref)
+            continue;
+        task.schedule = Task::Free;
+    }
+}
+
+unsigned runStatus(char *buffer) {
+    char *end = buffer;
+    for (const auto &task : taskPool) {
+        if (task.schedule == Task::Free)
+            continue;
+        end = append(end, task.schedule == Task::Periodic ? "P " : "S ");
+        end += toHex(reinterpret_cast<uintptr_t>(task.reference), 8, '0', end);
+        *end++ = '\n';
+    }
+    return end - buffer;
+}
@@ -0,0 +1,135 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Host-side simulation of the GPSDO hardware.
+ * Simulated time is tracked as "true" time (32.32 fixed-point seconds since power-on). The monotonic clock
+ * is derived from true time by integrating the fractional frequency error of the simulated oscillator.
+ */
+namespace sim {
+    // TAI timestamp of the start of the simulation (2026-10-19, PTP 1970 epoch)
+    static constexpr uint32_t TAI_START = 0x6AD55DA5u;
+    // TAI/UTC offset reported by the GPS receiver
+    static constexpr int TAI_OFFSET = 37;
+
+    /**
+     * Convert fixed-point seconds to floating-point seconds
+     * @param value signed 32.32 fixed-point value
+     * @return seconds
+     */
+    inline double toSeconds(const int64_t value) {
+        return 0x1p-32 * static_cast<double>(value);
+    }
+
+    /**
+     * Convert floating-point seconds to fixed-point seconds
+     * @param value seconds
+     * @return signed 32.32 fixed-point value
+     */
+    inline int64_t toFixed(const double value) {
+        return static_cast<int64_t>(0x1p32 * value);
+    }
+
+    /**
+     * Get the current true time
+     * @return 32.32 fixed-point seconds since power-on
+     */
+    uint64_t now();
+
+    /**
+     * Advance true time and integrate the oscillator phase
+     * @param time new true time (32.32 fixed-point seconds)
+     */
+    void advance(uint64_t time);
+
+    /**
+     * Set the fractional frequency error of the oscillator
+     * @param freq fractional frequency error
+     */
+    void setFrequency(double freq);
+
+    /**
+     * Get the exact (unquantized) monotonic time
+     * @return 32.32 fixed-point monotonic time
+     */
+    uint64_t monoExact();
+
+    /**
+     * Determine the true time at which the monotonic clock reaches the given value
+     * @param mono 32.32 fixed-point monotonic time
+     * @return 32.32 fixed-point true time (never earlier than the current time)
+     */
+    uint64_t trueFromMono(uint64_t mono);
+
+    /**
+     * Initialize the simulated clock domains
+     */
+    void initClock();
+
+    /**
+     * Set the temperature reported by the temperature sensor
+     * @param temp temperature in Celsius
+     */
+    void setTemperature(float temp);
+
+    /**
+     * Capture a GPS PPS edge at the current time and hand it off to the GPS reference
+     */
+    void pulse();
+
+    /**
+     * Receive a GPS timing message
+     * @param epoch TAI second preceding the next PPS edge
+     */
+    void timeMessage(uint32_t epoch);
+
+    /**
+     * Receive a GPS time pulse message (UBX-TIM-TP)
+     * @param qErr quantization error of the next PPS edge in seconds
+     */
+    void timePulse(double qErr);
+
+    /**
+     * Load simulated EEPROM contents from a file
+     * @param path file path
+     * @return true if the file was loaded
+     */
+    bool loadEeprom(const char *path);
+
+    /**
+     * Save simulated EEPROM contents to a file
+     * @param path file path
+     * @return true if the file was saved
+     */
+    bool saveEeprom(const char *path);
+
+    /**
+     * Get the monotonic time of the next scheduled task
+     * @param due 32.32 fixed-point monotonic time of the next task
+     * @return true if a task is scheduled
+     */
+    bool nextTask(uint64_t &due);
+
+    /**
+     * Run the next scheduled task
+     */
+    void runTask();
+
+    /**
+     * Initialize the simulated NTP server with a GPS reference source and wide area NTP peers
+     * @param peers number of NTP peers
+     * @param jitter offset noise of the NTP peers in seconds
+     */
+    void initNtp(int peers, double jitter);
+
+    /**
+     * Get the number of PPS edges the GPS reference counted as missed
+     * @return missed pulse count
+     */
+    uint32_t missedPulses();
+}
@@ -0,0 +1,56 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "stats.hpp"
+
+#include <cmath>
+
+double sim::stats::rms(const double *values, const int count) {
+    if (count < 1)
+        return NAN;
+    double acc = 0;
+    for (int i = 0; i < count; ++i)
+        acc += values[i] * values[i];
+    return std::sqrt(acc / count);
+}
+
+double sim::stats::peak(const double *values, const int count) {
+    double max = 0;
+    for (int i = 0; i < count; ++i) {
+        if (std::fabs(values[i]) > max)
+            max = std::fabs(values[i]);
+    }
+    return max;
+}
+
+double sim::stats::adev(const double *phase, const int count, const double interval, const int factor) {
+    const int terms = count - 2 * factor;
+    if (terms < 1)
+        return NAN;
+    double acc = 0;
+    for (int i = 0; i < terms; ++i) {
+        const double diff = phase[i + 2 * factor] - 2 * phase[i + factor] + phase[i];
+        acc += diff * diff;
+    }
+    const double tau = factor * interval;
+    return std::sqrt(acc / (2 * tau * tau * terms));
+}
+
+double sim::stats::tdev(const double *phase, const int count, const int factor) {
+    const int terms = count - 3 * factor + 1;
+    if (terms < 1)
+        return NAN;
+    // running sum of second differences over a window of n samples
+    double window = 0;
+    for (int i = 0; i < factor; ++i)
+        window += phase[i + 2 * factor] - 2 * phase[i + factor] + phase[i];
+    double acc = window * window;
+    for (int j = 1; j < terms; ++j) {
+        const int tail = j - 1, head = j + factor - 1;
+        window -= phase[tail + 2 * factor] - 2 * phase[tail + factor] + phase[tail];
+        window += phase[head + 2 * factor] - 2 * phase[head + factor] + phase[head];
+        acc += window * window;
+    }
+    return std::sqrt(acc / (6.0 * factor * factor * terms));
+}
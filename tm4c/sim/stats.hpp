@@ -0,0 +1,42 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+namespace sim::stats {
+    /**
+     * Compute the root-mean-square of a series
+     * @param values series values
+     * @param count number of values
+     * @return root-mean-square value
+     */
+    double rms(const double *values, int count);
+
+    /**
+     * Compute the maximum absolute value of a series
+     * @param values series values
+     * @param count number of values
+     * @return maximum absolute value
+     */
+    double peak(const double *values, int count);
+
+    /**
+     * Compute the overlapping Allan deviation from phase samples
+     * @param phase phase samples in seconds (uniformly spaced)
+     * @param count number of samples
+     * @param interval sample interval in seconds
+     * @param factor averaging factor (tau = factor * interval)
+     * @return Allan deviation (NaN if there are too few samples)
+     */
+    double adev(const double *phase, int count, double interval, int factor);
+
+    /**
+     * Compute the time deviation from phase samples
+     * @param phase phase samples in seconds (uniformly spaced)
+     * @param count number of samples
+     * @param factor averaging factor (tau = factor * sample interval)
+     * @return time deviation in seconds (NaN if there are too few samples)
+     */
+    double tdev(const double *phase, int count, int factor);
+}
@@ -0,0 +1,34 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "thermal.hpp"
+
+#include "noise.hpp"
+
+#include <cmath>
+
+sim::Thermal::Thermal() : walk(0), current(NAN), elapsed(0) { }
+
+double sim::Thermal::update(const double interval) {
+    elapsed += interval;
+    walk += walkRate * std::sqrt(interval) * noise::gauss();
+
+    // ambient temperature
+    double ambient = base + walk;
+    if (period > 0)
+        ambient += swing * std::sin(2 * M_PI * elapsed / period);
+    if (step != 0 && elapsed >= stepTime)
+        ambient += step;
+
+    // first-order thermal lag
+    if (std::isnan(current) || lag <= 0)
+        current = ambient;
+    else
+        current += (ambient - current) * (1 - std::exp(-interval / lag));
+    return current;
+}
+
+float sim::Thermal::sensor() const {
+    return static_cast<float>(current + sensorNoise * noise::gauss());
+}
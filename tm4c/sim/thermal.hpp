@@ -0,0 +1,55 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+namespace sim {
+    /**
+     * Oscillator temperature profile.
+     * The ambient temperature is composed of a sinusoidal swing, a random walk and an optional step change.
+     * The oscillator temperature follows the ambient temperature with a first-order thermal lag.
+     */
+    class Thermal {
+        // random walk state
+        double walk;
+        // oscillator temperature
+        double current;
+        // elapsed time (seconds)
+        double elapsed;
+
+    public:
+        // mean ambient temperature (Celsius)
+        double base = 35;
+        // peak amplitude of the sinusoidal swing (Celsius)
+        double swing = 2;
+        // period of the sinusoidal swing (seconds)
+        double period = 86400;
+        // random walk rate (Celsius per root second)
+        double walkRate = 2e-3;
+        // step change amplitude (Celsius)
+        double step = 0;
+        // step change time (seconds)
+        double stepTime = 0;
+        // thermal time constant of the oscillator (seconds)
+        double lag = 300;
+        // temperature sensor noise (Celsius)
+        double sensorNoise = 0.05;
+
+        Thermal();
+
+        /**
+         * Advance the temperature profile
+         * @param interval elapsed time in seconds
+         * @return oscillator temperature in Celsius
+         */
+        double update(double interval);
+
+        /**
+         * Sample the temperature sensor
+         * @return measured temperature in Celsius
+         */
+        [[nodiscard]]
+        float sensor() const;
+    };
+}
@@ -0,0 +1,23 @@
+#!/bin/sh
+# Compare time-to-lock after a cold start with a warm start from persisted EEPROM state.
+# usage: warmstart.sh SIMULATOR [options...]
+set -e
+
+sim="$1"
+shift
+eeprom=$(mktemp)
+trap 'rm -f "$eeprom"' EXIT
+
+lockTime() {
+    sed -n 's/^time to lock: *\([0-9]*\) s.*/\1/p'
+}
+
+# cold start with blank EEPROM (runs long enough to persist loop state)
+rm -f "$eeprom"
+cold=$("$sim" --duration 5000 --seed 1 --eeprom "$eeprom" "$@" | lockTime)
+# warm start from the state saved by the previous run
+warm=$("$sim" --duration 1000 --seed 2 --eeprom "$eeprom" "$@" | lockTime)
+
+echo "cold start time to lock: ${cold:-none} s"
+echo "warm start time to lock: ${warm:-none} s"
+[ -n "$cold" ] && [ -n "$warm" ] && [ "$warm" -lt "$cold" ]
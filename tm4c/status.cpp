@@ -13,6 +13,7 @@
 #include "lib/led.hpp"
 #include "lib/net.hpp"
 #include "lib/run.hpp"
+#include "lib/store.hpp"
 #include "lib/clock/capture.hpp"
 #include "lib/clock/comp.hpp"
 #include "lib/clock/mono.hpp"
@@ -23,6 +24,7 @@
 #include "lib/net/udp.hpp"
 #include "lib/net/util.hpp"
 #include "lib/ntp/pll.hpp"
+#include "lib/ptp/ptp.hpp"
 
 #include <cstring>
 
@@ -98,7 +100,10 @@ static void status::process(uint8_t *frame, int flen) {
     char *body = response.data;
     // force null termination
     body[size] = 0;
-    if (strncmp(body, "clock", 5) == 0 && hasTerminus(body, 8)) {
+    if (strncmp(body, "adev", 4) == 0 && hasTerminus(body, 4)) {
+        size = PLL_stability(body);
+    }
+    else if (strncmp(body, "clock", 5) == 0 && hasTerminus(body, 8)) {
         size = statusClock(body);
     }
     else if (strncmp(body, "eeprom", 6) == 0 && hasTerminus(body, 8)) {
@@ -113,6 +118,22 @@ static void status::process(uint8_t *frame, int flen) {
     else if (strncmp(body, "pll", 3) == 0 && hasTerminus(body, 3)) {
         size = PLL_status(body);
     }
+    else if (strncmp(body, "ptp", 3) == 0 && hasTerminus(body, 3)) {
+        size = ptp::status(body);
+    }
+    else if (strncmp(body, "ptp ", 4) == 0) {
+        // select a profile
+        int length = 0;
+        while (!hasTerminus(body + 4, length))
+            ++length;
+        if (ptp::setProfile(body + 4, length))
+            size = ptp::status(body);
+        else {
+            char *end = body + 4 + length;
+            end = append(end, ": invalid profile\n");
+            size = end - body;
+        }
+    }
     else if (strncmp(body, "system", 6) == 0 && hasTerminus(body, 6)) {
         size = statusSystem(body);
     }
@@ -122,6 +143,9 @@ static void status::process(uint8_t *frame, int flen) {
     else if (strncmp(body, "som", 3) == 0 && hasTerminus(body, 3)) {
         size = statusSom(body);
     }
+    else if (strncmp(body, "store", 5) == 0 && hasTerminus(body, 5)) {
+        size = store::status(body);
+    }
     else {
         char tmp[32];
         strncpy(tmp, body, size);
@@ -429,6 +453,53 @@ static unsigned statusGPS(char *body) {
     end = append(end, tmp);
     end = append(end, " ps/s\n");
 
+    // UART link
+    tmp[toBase(gps::baudRate(), 10, tmp)] = 0;
+    end = append(end, "uart baud: ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    tmp[toBase(gps::rxOverruns(), 10, tmp)] = 0;
+    end = append(end, "uart overruns: ");
+    end = append(end, tmp);
+    end = append(end, "\n");
+
+    // survey-in and timing mode
+    end = append(end, "timing mode: ");
+    switch (gps::surveyState()) {
+        case gps::SURVEY_DISABLED:
+            end = append(end, "disabled\n");
+            break;
+        case gps::SURVEY_RUNNING:
+            end = append(end, "survey-in\n");
+            break;
+        case gps::SURVEY_FIXED:
+            end = append(end, gps::timingMode() ? "fixed position\n" : "fixed position (pending)\n");
+            break;
+        case gps::SURVEY_UNSUPPORTED:
+            end = append(end, "unsupported by receiver\n");
+            break;
+    }
+
+    if (gps::surveyState() != gps::SURVEY_DISABLED) {
+        tmp[toBase(gps::surveyDuration(), 10, tmp)] = 0;
+        end = append(end, "survey duration: ");
+        end = append(end, tmp);
+        tmp[toBase(gps::surveyTarget(), 10, tmp)] = 0;
+        end = append(end, " of ");
+        end = append(end, tmp);
+        end = append(end, " s\n");
+
+        end = append(end, "survey accuracy: ");
+        if (gps::surveyAccuracy() < 0)
+            end = append(end, "pending\n");
+        else {
+            tmp[fmtFloat(gps::surveyAccuracy(), 0, 3, tmp)] = 0;
+            end = append(end, tmp);
+            end = append(end, " m\n");
+        }
+    }
+
     return end - body;
 }
 
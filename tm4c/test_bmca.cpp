@@ -0,0 +1,396 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "test_ptp_stubs.hpp"
+
+#include "lib/net/ip.hpp"
+#include "lib/ntp/GPS.hpp"
+#include "lib/ptp/bmca.hpp"
+#include "lib/ptp/common.hpp"
+#include "lib/ptp/profile.hpp"
+#include "lib/ptp/ptp.hpp"
+#include "lib/ptp/transport.hpp"
+
+void PTP_process(uint8_t *frame, int size);
+
+using stubs::MY_IP;
+using stubs::monoNow;
+using stubs::tasks;
+
+// simulated transmit path (transmitted frames are counted by message type)
+static int txCount[16];
+static std::vector<uint8_t> lastAnnounce;
+
+static bool transmit(const uint8_t *frame, const int size, network::CallbackTx, void *) {
+    ptp::Address src, dst;
+    const int offset = ptp::transport::parse(frame, size, src, dst);
+    if (offset >= 0) {
+        const int type = frame[offset] & 0xF;
+        ++txCount[type];
+        if (type == PTP2_MT_ANNOUNCE)
+            lastAnnounce.assign(frame + offset, frame + size);
+    }
+    return true;
+}
+
+// task handles in order of creation
+static constexpr int TASK_BMCA = 1;
+static constexpr int TASK_ANNOUNCE = 2;
+
+/**
+ * Grandmaster data set and announcing port of a simulated master
+ */
+struct Master {
+    const char *name;
+    uint8_t mac[6];
+    uint8_t priority1;
+    uint8_t clockClass;
+    uint8_t accuracy;
+    uint16_t variance;
+    uint8_t priority2;
+    // grandmaster identity (zero to use the identity of the announcing port)
+    uint8_t gmIdentity[8];
+    uint16_t stepsRemoved;
+    int8_t logInterval;
+    uint8_t domain;
+};
+
+// the local clock: priority 128/128, class 6, accuracy 0x21 (50 ns rms)
+static constexpr Master MASTERS[] = {
+    {"rubidium", {0x00, 0x1B, 0x21, 0x00, 0x00, 0x01}, 128, 6, 0x20, 0x4000, 128, {}, 0, 0, 1},
+    {"boundary", {0x00, 0x1B, 0x21, 0x00, 0x00, 0x02}, 128, 248, 0xFE, 0xFFFF, 128, {}, 0, 0, 1},
+    {"holdover", {0x00, 0x1B, 0x21, 0x00, 0x00, 0x03}, 128, 7, 0x22, 0x6000, 128, {}, 0, 0, 1},
+    // rubidium through a boundary clock
+    {"relay", {0x00, 0x1B, 0x21, 0x00, 0x00, 0x04}, 128, 6, 0x20, 0x4000, 128, {0x00, 0x1B, 0x21, 0xFF, 0xFE, 0x00, 0x00, 0x01}, 1, 0, 1},
+    // same quality as the local clock with a lower and a higher identity
+    {"twin low", {0x00, 0x00, 0x00, 0x00, 0x00, 0x05}, 128, 6, 0x21, 0x4F7E, 128, {}, 0, 0, 1},
+    {"twin high", {0xFE, 0x00, 0x00, 0x00, 0x00, 0x06}, 128, 6, 0x21, 0x4F7E, 128, {}, 0, 0, 1},
+    // better priority but announcing in another domain
+    {"other domain", {0x00, 0x1B, 0x21, 0x00, 0x00, 0x07}, 1, 6, 0x20, 0x4000, 128, {}, 0, 0, 4},
+    // better priority but too many boundary clocks away
+    {"distant", {0x00, 0x1B, 0x21, 0x00, 0x00, 0x08}, 1, 6, 0x20, 0x4000, 128, {}, 255, 0, 1},
+    // fast announce rate (8 Hz)
+    {"telecom", {0x00, 0x1B, 0x21, 0x00, 0x00, 0x09}, 64, 6, 0x21, 0x4F7E, 128, {}, 0, -3, 1},
+};
+
+enum {
+    RUBIDIUM, BOUNDARY, HOLDOVER, RELAY, TWIN_LOW, TWIN_HIGH, OTHER_DOMAIN, DISTANT, TELECOM
+};
+
+static uint16_t get16(const uint8_t *data) {
+    return (data[0] << 8) | data[1];
+}
+
+// EUI-64 port identity from a MAC address
+static void toIdentity(const uint8_t *mac, uint8_t *identity) {
+    memcpy(identity, mac, 3);
+    identity[3] = 0xFF;
+    identity[4] = 0xFE;
+    memcpy(identity + 5, mac + 3, 3);
+}
+
+// deliver an announce message from a master over the layer-2 transport
+static void announce(const Master &master, const uint16_t sequence, const int length = 64) {
+    uint8_t frame[14 + 64] = {};
+    memcpy(frame, ptpMac, 6);
+    memcpy(frame + 6, master.mac, 6);
+    frame[12] = 0x88;
+    frame[13] = 0xF7;
+
+    auto msg = frame + 14;
+    msg[0] = PTP2_MT_ANNOUNCE;
+    msg[1] = 2;
+    msg[3] = 64;
+    msg[4] = master.domain;
+    toIdentity(master.mac, msg + 20);
+    msg[29] = 1;
+    msg[30] = sequence >> 8;
+    msg[31] = sequence;
+    msg[32] = PTP2_CTRL_OTHER;
+    msg[33] = master.logInterval;
+    msg[45] = 37;
+    msg[47] = master.priority1;
+    msg[48] = master.clockClass;
+    msg[49] = master.accuracy;
+    msg[50] = master.variance >> 8;
+    msg[51] = master.variance;
+    msg[52] = master.priority2;
+    const uint8_t none[8] = {};
+    if (memcmp(master.gmIdentity, none, 8) != 0)
+        memcpy(msg + 53, master.gmIdentity, 8);
+    else
+        toIdentity(master.mac, msg + 53);
+    msg[61] = master.stepsRemoved >> 8;
+    msg[62] = master.stepsRemoved;
+    msg[63] = PTP2_TSRC_ATOMIC;
+    PTP_process(frame, 14 + length);
+}
+
+/**
+ * Announce sequence replayed against the port
+ */
+struct Event {
+    double time;
+    // announcing master or -1 for a checkpoint
+    int master;
+    // expected state at a checkpoint
+    PTP2_PORT_STATE state;
+    // expected best foreign master at a checkpoint (-1 for none)
+    int best;
+};
+
+class Sequence {
+    std::vector<Event> events;
+
+public:
+    // a master announces at its own interval
+    void train(const int master, const double start, const double end) {
+        const double interval = std::ldexp(1.0, MASTERS[master].logInterval);
+        for (double t = start; t < end; t += interval)
+            events.push_back({t, master, PTP2_PS_INITIALIZING, -1});
+    }
+
+    // check the port state
+    void expect(const double time, const PTP2_PORT_STATE state, const int best = -1) {
+        events.push_back({time, -1, state, best});
+    }
+
+    // replay the sequence and return the number of failed checkpoints
+    int replay(const char *name, double &clock) {
+        std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+            return a.time < b.time;
+        });
+        uint16_t sequence[std::size(MASTERS)] = {};
+        int failed = 0;
+        const double start = clock;
+        for (const auto &event : events) {
+            // run the state decision task at 16 Hz up to the event
+            const double time = start + event.time;
+            while (clock + 0.0625 <= time) {
+                clock += 0.0625;
+                monoNow = static_cast<uint64_t>(std::ldexp(clock, 32));
+                tasks[TASK_BMCA].callback(nullptr);
+            }
+            monoNow = static_cast<uint64_t>(std::ldexp(time, 32));
+            if (event.master >= 0) {
+                announce(MASTERS[event.master], sequence[event.master]++);
+                continue;
+            }
+
+            const auto state = ptp::bmca::getState();
+            ptp::bmca::DataSet best = {};
+            const bool found = ptp::bmca::getBest(best);
+            uint8_t identity[8] = {};
+            if (event.best >= 0) {
+                const auto &master = MASTERS[event.best];
+                toIdentity(master.mac, identity);
+            }
+            const bool bestOk = (event.best < 0) ? !found : (found && memcmp(best.sender.identity, identity, 8) == 0);
+            if (state != event.state || !bestOk) {
+                fprintf(stdout, "FAIL: %s at %.2f s: state %d (expected %d), best %s\n", name, event.time, state,
+                        event.state, found ? "present" : "none");
+                failed = 1;
+            }
+        }
+        clock = start + events.back().time;
+        return failed;
+    }
+};
+
+// restart master selection
+static void restart(double &clock) {
+    ptp::bmca::reset();
+    clock += 1;
+    monoNow = static_cast<uint64_t>(std::ldexp(clock, 32));
+}
+
+int main() {
+    int failed = 0;
+    ipAddress = MY_IP;
+    stubs::model.transmit = transmit;
+    stubs::holdoverError = 1.5e-6f;
+    double clock = 100;
+    monoNow = static_cast<uint64_t>(std::ldexp(clock, 32));
+    ptp::init();
+    if (tasks.size() != 4) {
+        fprintf(stdout, "FAIL: expected unicast, bmca, announce and sync tasks\n");
+        return 1;
+    }
+
+    // a better grandmaster silences the port until its announce messages stop
+    {
+        Sequence seq;
+        seq.expect(0.1, PTP2_PS_LISTENING);
+        seq.train(RUBIDIUM, 0.5, 11);
+        seq.expect(1.0, PTP2_PS_LISTENING);
+        seq.expect(1.6, PTP2_PS_PASSIVE, RUBIDIUM);
+        seq.expect(10.6, PTP2_PS_PASSIVE, RUBIDIUM);
+        seq.expect(13.4, PTP2_PS_PASSIVE, RUBIDIUM);
+        seq.expect(13.6, PTP2_PS_MASTER);
+        failed |= seq.replay("rubidium", clock);
+    }
+
+    // no messages are sent and no delay requests are answered while passive
+    {
+        Sequence seq;
+        seq.train(RUBIDIUM, 0, 3);
+        seq.expect(2.5, PTP2_PS_PASSIVE, RUBIDIUM);
+        failed |= seq.replay("passive", clock);
+        memset(txCount, 0, sizeof(txCount));
+        tasks[TASK_ANNOUNCE].callback(nullptr);
+        tasks[TASK_ANNOUNCE + 1].callback(nullptr);
+        if (txCount[PTP2_MT_ANNOUNCE] != 0 || txCount[PTP2_MT_SYNC] != 0) {
+            fprintf(stdout, "FAIL: passive port transmitted announce or sync\n");
+            failed = 1;
+        }
+        restart(clock);
+    }
+
+    // several grandmasters: the best is tracked as the others come and go
+    {
+        Sequence seq;
+        seq.train(BOUNDARY, 0, 30);
+        seq.train(HOLDOVER, 0.2, 30);
+        seq.train(RUBIDIUM, 0.4, 10);
+        seq.train(RELAY, 0.6, 20);
+        seq.expect(5, PTP2_PS_PASSIVE, RUBIDIUM);
+        // the relayed rubidium replaces the direct path
+        seq.expect(14, PTP2_PS_PASSIVE, RELAY);
+        // the local clock outranks the remaining masters
+        seq.expect(24, PTP2_PS_MASTER, HOLDOVER);
+        failed |= seq.replay("multiple", clock);
+    }
+
+    // loss of GPS drops the clock class to 7 and the backup grandmaster takes over
+    {
+        stubs::holdover = PLL_HOLD_ACTIVE;
+        Sequence seq;
+        seq.train(HOLDOVER, 0, 10);
+        seq.expect(5, PTP2_PS_PASSIVE, HOLDOVER);
+        failed |= seq.replay("holdover", clock);
+        stubs::holdover = PLL_HOLD_NONE;
+        Sequence recover;
+        recover.train(HOLDOVER, 0, 3);
+        recover.expect(2.5, PTP2_PS_MASTER, HOLDOVER);
+        failed |= recover.replay("recovery", clock);
+        restart(clock);
+    }
+
+    // equal data sets are ranked by clock identity
+    {
+        Sequence seq;
+        seq.train(TWIN_HIGH, 0, 6);
+        seq.expect(5, PTP2_PS_MASTER, TWIN_HIGH);
+        seq.train(TWIN_LOW, 6, 12);
+        seq.expect(11, PTP2_PS_PASSIVE, TWIN_LOW);
+        failed |= seq.replay("identity", clock);
+        restart(clock);
+    }
+
+    // announce messages from other domains, distant masters and truncated messages are ignored
+    {
+        Sequence seq;
+        seq.train(OTHER_DOMAIN, 0, 6);
+        seq.train(DISTANT, 0, 6);
+        seq.expect(5, PTP2_PS_MASTER);
+        failed |= seq.replay("ignored", clock);
+        for (int i = 0; i < 4; ++i)
+            announce(MASTERS[RUBIDIUM], i, 63);
+        if (ptp::bmca::getState() != PTP2_PS_MASTER) {
+            fprintf(stdout, "FAIL: truncated announce accepted\n");
+            failed = 1;
+        }
+        restart(clock);
+    }
+
+    // announce messages must arrive within the qualification window
+    {
+        Sequence seq;
+        for (int i = 0; i < 5; ++i)
+            seq.train(RUBIDIUM, 5.0 * i, 5.0 * i + 0.5);
+        seq.expect(24, PTP2_PS_MASTER);
+        failed |= seq.replay("qualification", clock);
+        restart(clock);
+    }
+
+    // a fast master times out after three of its own announce intervals
+    {
+        Sequence seq;
+        seq.train(TELECOM, 0, 5);
+        seq.expect(4.9, PTP2_PS_PASSIVE, TELECOM);
+        seq.expect(5.3, PTP2_PS_PASSIVE, TELECOM);
+        seq.expect(5.5, PTP2_PS_MASTER);
+        failed |= seq.replay("telecom", clock);
+        restart(clock);
+    }
+
+    // a full table keeps the best masters
+    {
+        Master worse[10];
+        for (int i = 0; i < 10; ++i) {
+            worse[i] = MASTERS[BOUNDARY];
+            worse[i].mac[5] = 0x40 + i;
+            worse[i].priority2 = 200 + i;
+        }
+        monoNow = static_cast<uint64_t>(std::ldexp(clock + 4, 32));
+        tasks[TASK_BMCA].callback(nullptr);
+        for (int round = 0; round < 2; ++round) {
+            clock += 1;
+            monoNow = static_cast<uint64_t>(std::ldexp(clock + 4, 32));
+            for (int i = 0; i < 10; ++i)
+                announce(worse[i], round);
+        }
+        char buffer[2048];
+        buffer[ptp::bmca::status(buffer)] = 0;
+        if (strstr(buffer, "foreign:   8 (8 qualified)") == nullptr || strstr(buffer, "4 dropped") == nullptr) {
+            fprintf(stdout, "FAIL: foreign master table overflow\n%s", buffer);
+            failed = 1;
+        }
+        Sequence seq;
+        seq.train(RUBIDIUM, 5, 8);
+        seq.expect(7, PTP2_PS_PASSIVE, RUBIDIUM);
+        failed |= seq.replay("table", clock);
+        restart(clock);
+    }
+
+    // the announced clock quality follows the PLL
+    {
+        Sequence seq;
+        seq.expect(4, PTP2_PS_MASTER);
+        failed |= seq.replay("quality", clock);
+        stubs::offsetRms = 2e-6f;
+        tasks[TASK_ANNOUNCE].callback(nullptr);
+        const auto &msg = lastAnnounce;
+        if (msg.size() < 64 || msg[48] != PTP2_CLK_CLASS_PRIMARY || msg[49] != 0x24 || get16(msg.data() + 50) != toPtpLogVariance(2e-6f)) {
+            fprintf(stdout, "FAIL: announced quality does not follow the PLL\n");
+            failed = 1;
+        }
+        if (toPtpLogVariance(2e-6f) <= toPtpLogVariance(50e-9f)) {
+            fprintf(stdout, "FAIL: log variance does not increase with the error\n");
+            failed = 1;
+        }
+        stubs::refId = 0;
+        tasks[TASK_ANNOUNCE].callback(nullptr);
+        if (msg[48] != PTP2_CLK_CLASS_PRI_FAIL || msg[49] != 0x31 || get16(msg.data() + 50) != 0xFFFF) {
+            fprintf(stdout, "FAIL: announced quality without a reference\n");
+            failed = 1;
+        }
+        stubs::refId = ntp::GPS::REF_ID;
+        stubs::offsetRms = 50e-9f;
+    }
+
+    char buffer[2048];
+    buffer[ptp::bmca::status(buffer)] = 0;
+    fputs(buffer, stdout);
+    fprintf(stdout, failed ? "FAILED\n" : "PASSED\n");
+    return failed;
+}
@@ -0,0 +1,478 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "test_ptp_stubs.hpp"
+
+#include "lib/net/ip.hpp"
+#include "lib/ptp/common.hpp"
+#include "lib/ptp/ptp.hpp"
+#include "lib/ptp/transport.hpp"
+
+// Delay_Req flood benchmark: requests arrive at the ethernet line rate (or pile up in the receive ring while the CPU
+// is busy), the unmodified PTP code queues and answers them, and a simulated 100 Mb/s transmitter drains the ring.
+
+void PTP_process(uint8_t *frame, int size);
+
+using stubs::MY_IP;
+
+static constexpr uint8_t PTP_MAC[6] = {0x01, 0x1B, 0x19, 0x00, 0x00, 0x00};
+
+// simulated hardware (nanoseconds)
+static constexpr int RX_RING_SIZE = 128;
+static constexpr int TX_RING_SIZE = 128;
+static constexpr uint64_t LINK_RATE = 100000000;
+// CPU time model: frame reception, response and scheduler overhead
+static constexpr uint64_t COST_RX = 2000;
+static constexpr uint64_t COST_TX = 3000;
+static constexpr uint64_t COST_TASK = 1000;
+// multicast sync interval (faster than any profile so that every burst spans several messages)
+static constexpr uint64_t SYNC_PERIOD = 500000;
+// TAI offset of the monotonic clock (32.32)
+static constexpr uint64_t TAI_OFFSET = 1700000000ull << 32;
+static constexpr uint64_t NEVER = UINT64_MAX;
+
+// simulated time
+static uint64_t simTime;
+// time at which the scheduler resumes after a stall
+static uint64_t busyUntil;
+
+static uint64_t toFixed(const uint64_t ns) {
+    return ((ns / 1000000000) << 32) | (((ns % 1000000000) << 32) / 1000000000);
+}
+
+// transmission time of a frame including preamble, FCS and interframe gap
+static uint64_t wireTime(const int size) {
+    const int bytes = (size < 60 ? 60 : size) + 4 + 8 + 12;
+    return bytes * 8 * 1000000000ull / LINK_RATE;
+}
+
+// simulated receive ring
+struct RxFrame {
+    uint64_t arrival;
+    std::vector<uint8_t> data;
+};
+static std::vector<RxFrame> arrivals;
+static size_t nextArrival;
+static std::deque<RxFrame> rxRing;
+static uint64_t rxTime;
+static int rxOverflow;
+
+// responses fail to transmit (e.g. no route to the requester)
+static bool txFail;
+
+// simulated transmit ring
+struct TxFrame {
+    std::vector<uint8_t> data;
+    network::CallbackTx callback;
+    void *ref;
+    uint64_t queued;
+};
+static std::deque<TxFrame> txRing;
+static uint64_t wireFree;
+static uint64_t txTime;
+static uint64_t txClock;
+static int txFree = TX_RING_SIZE - 1;
+static int txFreeMin;
+static int txCount;
+
+// completed delay responses
+struct Response {
+    std::vector<uint8_t> data;
+    uint64_t departed;
+};
+static std::vector<Response> responses;
+
+static bool transmit(const uint8_t *frame, const int size, const network::CallbackTx callback, void *ref) {
+    if (txFree < 1 || (txFail && (frame[14] & 0xF) == PTP2_MT_DELAY_RESP))
+        return false;
+    --txFree;
+    if (txFree < txFreeMin)
+        txFreeMin = txFree;
+    ++txCount;
+    txRing.push_back({std::vector<uint8_t>(frame, frame + size), callback, ref, txClock});
+    return true;
+}
+
+static int getTxFree() {
+    return txFree;
+}
+
+static void getRxTime(uint64_t *stamps) {
+    stamps[0] = toFixed(rxTime);
+    stamps[1] = stamps[0];
+    stamps[2] = stamps[0] + TAI_OFFSET;
+}
+
+static void getTxTime(uint64_t *stamps) {
+    stamps[0] = toFixed(txTime);
+    stamps[1] = stamps[0];
+    stamps[2] = stamps[0] + TAI_OFFSET;
+}
+
+static uint64_t getTai() {
+    return toFixed(simTime) + TAI_OFFSET;
+}
+
+static uint64_t getMono() {
+    return toFixed(simTime);
+}
+
+// simulated scheduler (the delay response task is run once woken, the back-off task once postponed)
+static uint64_t respondAt;
+static uint64_t retryAt = UINT64_MAX;
+
+// task handles in order of creation
+static constexpr int TASK_BMCA = 1;
+static constexpr int TASK_SYNC = 3;
+// sleeping tasks in order of creation
+static constexpr int SLEEP_RETRY = 0;
+
+static uint16_t get16(const uint8_t *data) {
+    return (data[0] << 8) | data[1];
+}
+
+// move arrived frames into the receive ring (the hardware drops frames when it is full)
+static void receive() {
+    while (nextArrival < arrivals.size() && arrivals[nextArrival].arrival <= simTime) {
+        if (rxRing.size() < RX_RING_SIZE)
+            rxRing.push_back(arrivals[nextArrival]);
+        else
+            ++rxOverflow;
+        ++nextArrival;
+    }
+}
+
+// completion time of the frame at the head of the transmit ring
+static uint64_t nextDeparture() {
+    if (txRing.empty())
+        return NEVER;
+    const auto start = wireFree > txRing.front().queued ? wireFree : txRing.front().queued;
+    return start + wireTime(static_cast<int>(txRing.front().data.size()));
+}
+
+// complete transmissions (callbacks may queue follow-up messages)
+static void transmit() {
+    while (nextDeparture() <= simTime) {
+        const auto frame = txRing.front();
+        txRing.pop_front();
+        const auto start = wireFree > frame.queued ? wireFree : frame.queued;
+        wireFree = start + wireTime(static_cast<int>(frame.data.size()));
+        txTime = wireFree;
+        ++txFree;
+        if ((frame.data[14] & 0xF) == PTP2_MT_DELAY_RESP)
+            responses.push_back({frame.data, wireFree});
+        if (frame.callback) {
+            txClock = wireFree;
+            frame.callback(frame.ref, frame.data.data(), static_cast<int>(frame.data.size()));
+            txClock = simTime;
+        }
+    }
+}
+
+static void advance(const uint64_t time) {
+    simTime = time;
+    txClock = simTime;
+    receive();
+    transmit();
+}
+
+// layer-2 delay request from a distinct slave
+static std::vector<uint8_t> buildRequest(const int slave, const uint16_t sequence) {
+    std::vector<uint8_t> frame(14 + 44, 0);
+    memcpy(frame.data(), PTP_MAC, 6);
+    const uint8_t mac[6] = {0x02, 0x00, 0x00, 0xAA, static_cast<uint8_t>(slave >> 8), static_cast<uint8_t>(slave)};
+    memcpy(frame.data() + 6, mac, 6);
+    frame[12] = 0x88;
+    frame[13] = 0xF7;
+    const auto msg = frame.data() + 14;
+    msg[0] = PTP2_MT_DELAY_REQ;
+    msg[1] = 2;
+    msg[3] = 44;
+    msg[4] = PTP2_DOMAIN;
+    // correction field (2 ns)
+    msg[13] = 0x02;
+    // source port identity
+    memcpy(msg + 20, mac, 3);
+    msg[23] = 0xFF;
+    msg[24] = 0xFE;
+    memcpy(msg + 25, mac + 3, 3);
+    msg[29] = 1;
+    msg[30] = sequence >> 8;
+    msg[31] = sequence;
+    msg[32] = PTP2_CTRL_DELAY_REQ;
+    msg[33] = 0x7F;
+    return frame;
+}
+
+static uint32_t get32(const uint8_t *data) {
+    return (get16(data) << 16) | get16(data + 2);
+}
+
+// receive timestamp of a response (within the 1 ns resolution of the 32.32 conversion)
+static bool checkTimestamp(const uint8_t *ts, const uint64_t arrival) {
+    const uint64_t seconds = (static_cast<uint64_t>(get16(ts)) << 32) | get32(ts + 2);
+    const int64_t nanos = get32(ts + 6);
+    const int64_t expect = static_cast<int64_t>(arrival % 1000000000);
+    return seconds == (TAI_OFFSET >> 32) + arrival / 1000000000 && nanos >= expect - 1 && nanos <= expect;
+}
+
+// convert a scheduler delay (8.24 fixed point) to nanoseconds
+static uint64_t fromRun(const uint32_t delay) {
+    return (static_cast<uint64_t>(delay) * 1000000000) >> 24;
+}
+
+// note a back-off of the response task
+static void checkRetry() {
+    auto &retry = stubs::sleepers[SLEEP_RETRY];
+    if (retry.postponed) {
+        retry.postponed = false;
+        retryAt = simTime + fromRun(retry.interval);
+    }
+}
+
+// read a value from a line of the delay section of the ptp status report
+static int statusValue(const char *label) {
+    char buffer[8192];
+    buffer[ptp::status(buffer)] = 0;
+    const char *line = strstr(buffer, "delay status:");
+    line = line == nullptr ? nullptr : strstr(line, label);
+    if (line == nullptr)
+        return -1;
+    int value = -1;
+    sscanf(line + strlen(label), " %d", &value);
+    return value;
+}
+
+struct Result {
+    int requests;
+    int answered;
+    int dropped;
+    int overflow;
+    int mismatched;
+    int failed;
+    int deferred;
+    int syncSent;
+    int syncSkipped;
+    int freeMin;
+    int queuePeak;
+    float latencyMean;
+    float latencyMax;
+};
+
+/**
+ * Run a flood of delay requests through the simulated interface
+ * @param count number of requests
+ * @param gap interval between request arrivals (ns)
+ * @param stall time the CPU is unavailable when the burst starts (ns)
+ * @return benchmark result
+ */
+static Result flood(const int count, const uint64_t gap, const uint64_t stall) {
+    Result result = {};
+    result.requests = count;
+
+    // expected receive time of each request
+    const uint64_t start = simTime + 1000000;
+    std::vector<uint64_t> arrived(count);
+    arrivals.clear();
+    nextArrival = 0;
+    for (int i = 0; i < count; ++i) {
+        arrived[i] = start + i * gap;
+        arrivals.push_back({arrived[i], buildRequest(i, static_cast<uint16_t>(0x8000 + i))});
+    }
+    responses.clear();
+    rxOverflow = 0;
+    txFreeMin = txFree;
+    busyUntil = start + stall;
+    const int dropped = statusValue("dropped:");
+    const int failed = statusValue("failed:");
+    const int deferred = statusValue("deferred:");
+    uint64_t nextSync = start;
+    int syncs = 0;
+    const int skipped = statusValue("skipped:");
+
+    for (;;) {
+        // the scheduler runs the ready task that has been waiting the longest
+        const bool idle = nextArrival >= arrivals.size() && rxRing.empty() && !stubs::waitWoken && txRing.empty() &&
+            retryAt == NEVER;
+        const uint64_t rxAt = rxRing.empty() ? NEVER : rxRing.front().arrival;
+        const uint64_t respAt = stubs::waitWoken ? respondAt : NEVER;
+        const uint64_t syncAt = idle ? NEVER : nextSync;
+        uint64_t ready = rxAt < respAt ? rxAt : respAt;
+        if (syncAt < ready)
+            ready = syncAt;
+        if (retryAt < ready)
+            ready = retryAt;
+
+        if (ready <= simTime && simTime >= busyUntil) {
+            if (ready == rxAt) {
+                // the receive task processes every pending frame
+                while (!rxRing.empty()) {
+                    const auto frame = rxRing.front();
+                    rxRing.pop_front();
+                    rxTime = frame.arrival;
+                    auto data = frame.data;
+                    const bool woken = stubs::waitWoken;
+                    PTP_process(data.data(), static_cast<int>(data.size()));
+                    if (stubs::waitWoken && !woken)
+                        respondAt = simTime;
+                    advance(simTime + COST_RX);
+                }
+                advance(simTime + COST_TASK);
+            }
+            else if (ready == respAt) {
+                stubs::waitWoken = false;
+                const int before = txCount;
+                stubs::waitTask(nullptr);
+                checkRetry();
+                advance(simTime + COST_TASK + COST_TX * (txCount - before));
+                if (stubs::waitWoken)
+                    respondAt = simTime;
+            }
+            else if (ready == retryAt) {
+                retryAt = NEVER;
+                const bool woken = stubs::waitWoken;
+                stubs::sleepers[SLEEP_RETRY].callback(nullptr);
+                advance(simTime + COST_TASK);
+                if (stubs::waitWoken && !woken)
+                    respondAt = simTime;
+            }
+            else {
+                const int before = txCount;
+                stubs::tasks[TASK_SYNC].callback(nullptr);
+                ++syncs;
+                nextSync += SYNC_PERIOD;
+                advance(simTime + COST_TASK + COST_TX * (txCount - before));
+            }
+            continue;
+        }
+
+        // advance to the next event (tasks wait while the CPU is stalled)
+        uint64_t next = nextDeparture();
+        if (nextArrival < arrivals.size() && arrivals[nextArrival].arrival < next)
+            next = arrivals[nextArrival].arrival;
+        const uint64_t resume = ready > busyUntil ? ready : busyUntil;
+        if (resume < next)
+            next = resume;
+        if (next == NEVER)
+            break;
+        advance(next);
+    }
+
+    // validate responses and measure the receive to departure latency
+    double latencySum = 0;
+    for (const auto &response : responses) {
+        const auto msg = response.data.data() + 14;
+        const int index = get16(msg + 30) - 0x8000;
+        const auto request = buildRequest(index, 0);
+        if (
+            index < 0 || index >= count || response.data.size() != 14 + 54 ||
+            memcmp(response.data.data(), request.data() + 6, 6) != 0 ||
+            memcmp(msg + 44, request.data() + 14 + 20, 10) != 0 || msg[13] != 0x02 ||
+            !checkTimestamp(msg + 34, arrived[index])
+        ) {
+            ++result.mismatched;
+            continue;
+        }
+        const float latency = 1e-3f * static_cast<float>(response.departed - arrived[index]);
+        latencySum += latency;
+        if (latency > result.latencyMax)
+            result.latencyMax = latency;
+        ++result.answered;
+    }
+    result.latencyMean = result.answered > 0 ? static_cast<float>(latencySum / result.answered) : 0;
+    result.dropped = statusValue("dropped:") - dropped;
+    result.failed = statusValue("failed:") - failed;
+    result.deferred = statusValue("deferred:") - deferred;
+    result.overflow = rxOverflow;
+    result.syncSkipped = statusValue("skipped:") - skipped;
+    result.syncSent = syncs - result.syncSkipped;
+    result.freeMin = txFreeMin;
+    result.queuePeak = statusValue("(peak");
+    return result;
+}
+
+static void report(const char *name, const Result &result) {
+    fprintf(stdout, "%-20s %6d %8d %7d %8d %9.1f %8.1f %7d %5d/%d\n",
+        name, result.requests, result.answered, result.dropped, result.overflow,
+        result.latencyMean, result.latencyMax, result.freeMin, result.syncSent, result.syncSent + result.syncSkipped);
+}
+
+int main() {
+    int failed = 0;
+    ipAddress = MY_IP;
+    stubs::model = {transmit, getTxFree, getRxTime, getTxTime, getTai, getMono};
+    ptp::init();
+    // claim the master role (announce receipt timeout without other masters)
+    simTime = 4000000000ull;
+    txClock = simTime;
+    stubs::tasks[TASK_BMCA].callback(nullptr);
+
+    fprintf(stdout, "%-20s %6s %8s %7s %8s %9s %8s %7s %7s\n",
+        "scenario", "req", "answered", "dropped", "overflow", "mean(us)", "max(us)", "minfree", "sync");
+
+    // bursts at the ethernet line rate (minimum size frames)
+    const uint64_t lineRate = wireTime(14 + 44);
+    for (const int count : {16, 64, 128, 256, 1024}) {
+        char name[32];
+        snprintf(name, sizeof(name), "line rate x%d", count);
+        const auto result = flood(count, lineRate, 0);
+        report(name, result);
+        if (result.answered != count || result.mismatched != 0 || result.dropped != 0) {
+            fprintf(stdout, "FAIL: %s: incomplete responses\n", name);
+            failed = 1;
+        }
+        if (result.syncSkipped != 0 || result.freeMin < ptp::transport::TX_RESERVE) {
+            fprintf(stdout, "FAIL: %s: transmit ring reserve exhausted\n", name);
+            failed = 1;
+        }
+        // the longest burst fills the ring to the floor and the response task backs off
+        if (count == 1024 && result.deferred == 0) {
+            fprintf(stdout, "FAIL: %s: response task did not back off\n", name);
+            failed = 1;
+        }
+    }
+
+    // requests pile up in the receive ring while the CPU is busy (the receive task then queues them at once)
+    const auto stall = flood(160, lineRate, 1500000);
+    report("stall 1.5 ms x160", stall);
+    if (stall.overflow != 160 - RX_RING_SIZE || stall.answered + stall.dropped != RX_RING_SIZE || stall.mismatched != 0) {
+        fprintf(stdout, "FAIL: stall: responses and drops do not account for every request\n");
+        failed = 1;
+    }
+    if (stall.dropped != RX_RING_SIZE - stall.queuePeak || stall.syncSkipped != 0) {
+        fprintf(stdout, "FAIL: stall: queue overflow not counted\n");
+        failed = 1;
+    }
+
+    // responses that cannot be sent drop their request instead of stalling the queue
+    txFail = true;
+    const auto failing = flood(32, lineRate, 0);
+    txFail = false;
+    report("send failure x32", failing);
+    if (failing.answered != 0 || failing.failed != 32 || statusValue("queue:") != 0) {
+        fprintf(stdout, "FAIL: send failure: requests not dropped\n");
+        failed = 1;
+    }
+
+    // every queued request was either answered or counted as failed
+    const int requests = statusValue("requests:");
+    const int answered = statusValue("responses:");
+    const int rejected = statusValue("failed:");
+    const int queued = statusValue("queue:");
+    fprintf(stdout, "status: %d requests queued, %d answered, %d failed, %d pending\n",
+        requests, answered, rejected, queued);
+    if (requests != answered + rejected || queued != 0) {
+        fprintf(stdout, "FAIL: status counters\n");
+        failed = 1;
+    }
+
+    fprintf(stdout, failed ? "FAILED\n" : "PASSED\n");
+    return failed;
+}
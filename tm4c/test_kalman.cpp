@@ -0,0 +1,129 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "lib/ntp/kalman.hpp"
+
+static constexpr int DURATION = 1 << 14;
+static constexpr float MAX_TRIM = 250e-6f;
+
+float gauss() {
+    const float u = (static_cast<float>(rand()) + 1.0f) / (static_cast<float>(RAND_MAX) + 2.0f);
+    const float v = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    return sqrtf(-2.0f * logf(u)) * cosf(6.2831853f * v);
+}
+
+// previous PI loop (PLL_updateOffset)
+struct LoopPI {
+    float offsetMS = 0, integral = 0;
+
+    float update(const int interval, const float offset, float) {
+        offsetMS = offsetMS == 0 ? offset * offset : offsetMS + (offset * offset - offsetMS) * 0x1p-4f;
+        float rate = sqrtf(offsetMS) / 1e-6f;
+        if (rate > 0x1p-1f) rate = 0x1p-1f;
+        if (rate < 0x1p-3f) rate = 0x1p-3f;
+        rate *= ldexpf(1.0f, -interval);
+        const float prop = offset * rate;
+        integral += prop * 0x1p-5f;
+        return prop + integral;
+    }
+};
+
+// Kalman discipline (PLL_KALMAN)
+struct LoopKalman {
+    ntp::Kalman kalman{};
+    float trim = 0;
+
+    float update(const int interval, const float offset, const float stdDev) {
+        const float dt = ldexpf(1.0f, interval);
+        kalman.update(dt, trim, offset, stdDev);
+        trim = kalman.getFrequency() + kalman.getPhase() / (4.0f * dt);
+        return trim;
+    }
+};
+
+struct Result {
+    double settle;
+    double rms;
+};
+
+/**
+ * Run a closed-loop simulation of the TAI clock discipline
+ * @param interval update interval in log2 seconds
+ * @param noise measurement noise in seconds
+ * @param seed random seed
+ */
+template<typename Loop>
+Result simulate(const int interval, const float noise, const unsigned seed) {
+    srand(seed);
+    Loop loop{};
+    const double dt = ldexp(1.0, interval);
+    const int steps = static_cast<int>(DURATION / dt);
+
+    // initial phase and frequency error
+    double phase = 1e-3, freq = 20e-6, trim = 0;
+    int settled = 0;
+    double rms = 0;
+    int rmsCount = 0;
+    for (int i = 0; i < steps; ++i) {
+        // oscillator with white and random-walk frequency noise
+        freq += 1e-11 * sqrt(dt) * gauss();
+        phase += (freq + 1e-10 * gauss() / sqrt(dt) - trim) * dt;
+
+        // measure offset and update loop
+        const float offset = static_cast<float>(phase) + noise * gauss();
+        float next = loop.update(interval, offset, noise);
+        if (next > MAX_TRIM) next = MAX_TRIM;
+        if (next < -MAX_TRIM) next = -MAX_TRIM;
+        trim = next;
+
+        // settling time (last excursion beyond 3x noise floor)
+        if (fabs(phase) > 3 * noise + 50e-9)
+            settled = i + 1;
+        // steady-state RMS over the second half
+        if (i >= steps / 2) {
+            rms += phase * phase;
+            ++rmsCount;
+        }
+    }
+    return {settled * dt, sqrt(rms / rmsCount)};
+}
+
+int main(int argc, char **argv) {
+    int failed = 0;
+    struct {
+        const char *name;
+        int interval;
+        float noise;
+    } scenarios[] = {
+        {"gps pps", 0, 20e-9f},
+        {"lan peer", 4, 50e-6f},
+        {"wan peer", 6, 500e-6f},
+    };
+
+    for (const auto &scenario : scenarios) {
+        Result pi = {}, kf = {};
+        static constexpr int RUNS = 8;
+        for (int run = 0; run < RUNS; ++run) {
+            const auto a = simulate<LoopPI>(scenario.interval, scenario.noise, run + 1);
+            const auto b = simulate<LoopKalman>(scenario.interval, scenario.noise, run + 1);
+            pi.settle += a.settle / RUNS;
+            pi.rms += a.rms / RUNS;
+            kf.settle += b.settle / RUNS;
+            kf.rms += b.rms / RUNS;
+        }
+        fprintf(stdout, "%s: settling pi %.0f s, kalman %.0f s; steady-state rms pi %.3e s, kalman %.3e s\n",
+                scenario.name, pi.settle, kf.settle, pi.rms, kf.rms);
+        if (!std::isfinite(kf.rms) || kf.rms > pi.rms || kf.settle > pi.settle) {
+            fprintf(stdout, "FAIL: %s\n", scenario.name);
+            ++failed;
+        }
+    }
+
+    fflush(stdout);
+    return failed;
+}
@@ -0,0 +1,492 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "test_ptp_stubs.hpp"
+
+#include "lib/net/ip.hpp"
+#include "lib/net/util.hpp"
+#include "lib/ptp/bmca.hpp"
+#include "lib/ptp/common.hpp"
+#include "lib/ptp/manage.hpp"
+#include "lib/ptp/ptp.hpp"
+
+void PTP_process(uint8_t *frame, int size);
+
+using stubs::MY_IP;
+using stubs::TxFrame;
+using stubs::drain;
+using stubs::monoNow;
+
+// interface and port identity of the pmc instance in the captures
+static constexpr uint8_t PMC_MAC[6] = {0x3C, 0xEC, 0xEF, 0x12, 0xAB, 0xCD};
+static constexpr uint8_t PMC_PORT[10] = {0x3C, 0xEC, 0xEF, 0xFF, 0xFE, 0x12, 0xAB, 0xCD, 0x2F, 0x1A};
+
+// hardware timestamps follow the scheduler time
+static void getStamps(uint64_t *stamps) {
+    stamps[0] = monoNow;
+    stamps[1] = monoNow;
+    stamps[2] = monoNow;
+}
+
+// task handles in order of creation
+static constexpr int TASK_BMCA = 1;
+static constexpr int TASK_SYNC = 3;
+
+static uint16_t get16(const uint8_t *data) {
+    return (data[0] << 8) | data[1];
+}
+
+static uint32_t get32(const uint8_t *data) {
+    return (get16(data) << 16) | get16(data + 2);
+}
+
+static int64_t get64(const uint8_t *data) {
+    return static_cast<int64_t>((static_cast<uint64_t>(get32(data)) << 32) | get32(data + 4));
+}
+
+// little-endian counter of the linuxptp port statistics
+static uint64_t getLe64(const uint8_t *data) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i)
+        value = (value << 8) | data[i];
+    return value;
+}
+
+static std::vector<uint8_t> fromHex(const char *hex) {
+    std::vector<uint8_t> bytes;
+    for (; hex[0] && hex[1]; hex += 2) {
+        unsigned value;
+        sscanf(hex, "%2x", &value);
+        bytes.push_back(value);
+    }
+    return bytes;
+}
+
+/**
+ * Management requests captured from linuxptp pmc (`pmc -2 -d 1` unless noted)
+ */
+struct Capture {
+    const char *name;
+    const char *hex;
+};
+
+static constexpr Capture CAPTURES[] = {
+    {"GET NULL_MANAGEMENT",
+        "011b190000003cecef12abcd88f70d120036010000000000000000000000000000003ceceffffe12abcd2f1a0000047f"
+        "ffffffffffffffffffff01010000000100020000"
+    },
+    {"GET DEFAULT_DATA_SET",
+        "011b190000003cecef12abcd88f70d12004a010000000000000000000000000000003ceceffffe12abcd2f1a0001047f"
+        "ffffffffffffffffffff010100000001001620000000000000000000000000000000000000000000"
+    },
+    {"GET CURRENT_DATA_SET",
+        "011b190000003cecef12abcd88f70d120048010000000000000000000000000000003ceceffffe12abcd2f1a0002047f"
+        "ffffffffffffffffffff01010000000100142001000000000000000000000000000000000000"
+    },
+    {"GET PARENT_DATA_SET",
+        "011b190000003cecef12abcd88f70d120056010000000000000000000000000000003ceceffffe12abcd2f1a0003047f"
+        "ffffffffffffffffffff0101000000010022200200000000000000000000000000000000000000000000000000000000"
+        "00000000"
+    },
+    {"GET TIME_PROPERTIES_DATA_SET",
+        "011b190000003cecef12abcd88f70d12003a010000000000000000000000000000003ceceffffe12abcd2f1a0004047f"
+        "ffffffffffffffffffff0101000000010006200300000000"
+    },
+    {"GET PORT_DATA_SET",
+        "011b190000003cecef12abcd88f70d120050010000000000000000000000000000003ceceffffe12abcd2f1a0005047f"
+        "ffffffffffffffffffff010100000001001c20040000000000000000000000000000000000000000000000000000"
+    },
+    {"GET PORT_STATS_NP",
+        "011b190000003cecef12abcd88f70d120140010000000000000000000000000000003ceceffffe12abcd2f1a0006047f"
+        "ffffffffffffffffffff010100000001010cc00500000000000000000000000000000000000000000000000000000000"
+        "000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000"
+        "000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000"
+        "000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000"
+        "000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000"
+        "00000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000"
+    },
+    {"GET DEFAULT_DATA_SET (-z)",
+        "011b190000003cecef12abcd88f70d120036010000000000000000000000000000003ceceffffe12abcd2f1a0007047f"
+        "ffffffffffffffffffff01010000000100022000"
+    },
+    {"SET PRIORITY1 100",
+        "011b190000003cecef12abcd88f70d120038010000000000000000000000000000003ceceffffe12abcd2f1a0008047f"
+        "ffffffffffffffffffff010101000001000420056400"
+    },
+    {"CMD NULL_MANAGEMENT",
+        "011b190000003cecef12abcd88f70d120036010000000000000000000000000000003ceceffffe12abcd2f1a0009047f"
+        "ffffffffffffffffffff01010300000100020000"
+    },
+    {"TARGET other clock",
+        "011b190000003cecef12abcd88f70d12004a010000000000000000000000000000003ceceffffe12abcd2f1a000a047f"
+        "001b21fffe0000010001010100000001001620000000000000000000000000000000000000000000"
+    },
+    {"GET TIME_PROPERTIES_DATA_SET (-4)",
+        "01005e0001813cecef12abcd080045000056123440000111c407c0a80132e00001810140014000421fc60d12003a0100"
+        "00000000000000000000000000003ceceffffe12abcd2f1a000b047fffffffffffffffffffff01010000000100062003"
+        "00000000"
+    },
+};
+
+enum {
+    GET_NULL, GET_DEFAULT, GET_CURRENT, GET_PARENT, GET_TIME, GET_PORT, GET_STATS, GET_DEFAULT_ZERO,
+    SET_PRIORITY1, CMD_NULL, OTHER_TARGET, GET_TIME_UDP
+};
+
+// response to a layer-2 capture containing the default data set of the local clock
+static constexpr char DEFAULT_RESPONSE[] =
+    "3cecef12abcd00000000000088f7"
+    // header: management, version 2, 74 bytes, domain 1, port 0000020000123456/1, sequence 1
+    "0d02004a0100000000000000000000000000000000000200001234560001000104" "7f"
+    // target port, boundary hops, RESPONSE
+    "3ceceffffe12abcd2f1a" "0000" "0200"
+    // MANAGEMENT TLV
+    "0001" "0016" "2000"
+    // two-step, 1 port, priority1 128, class 6, accuracy 0x21, variance 0x4f7e, priority2 128
+    "0100" "0001" "80" "06214f7e" "80"
+    // clock identity, domain 1
+    "0000020000123456" "0100";
+
+/**
+ * Decoded management response (the checks follow the receive path of pmc)
+ */
+struct Response {
+    const uint8_t *msg;
+    int action;
+    int tlvType;
+    int managementId;
+    int length;
+    const uint8_t *data;
+};
+
+static bool decode(const TxFrame &frame, Response &response, const bool udp = false) {
+    const auto &bytes = frame.data;
+    const int offset = udp ? 42 : 14;
+    if (static_cast<int>(bytes.size()) < offset + 54)
+        return false;
+    const auto msg = bytes.data() + offset;
+    const int size = static_cast<int>(bytes.size()) - offset;
+    // header
+    if ((msg[0] & 0xF) != PTP2_MT_MANAGEMENT || (msg[1] & 0xF) != 2 || get16(msg + 2) != size || msg[4] != 1)
+        return false;
+    if (msg[32] != PTP2_CTRL_MANAGEMENT || msg[33] != 0x7F)
+        return false;
+    // addressed to the pmc port
+    if (memcmp(msg + 34, PMC_PORT, 10) != 0)
+        return false;
+    response.msg = msg;
+    response.action = msg[46] & 0xF;
+    response.tlvType = get16(msg + 48);
+    response.length = get16(msg + 50);
+    if (54 + response.length - 2 != size)
+        return false;
+    response.managementId = get16(msg + 52);
+    response.data = msg + 54;
+    if (response.tlvType == PTP2_TT_MANAGEMENT_STATUS) {
+        // error id precedes the management id
+        response.managementId = get16(msg + 54);
+        response.data = msg + 52;
+    }
+    return true;
+}
+
+// deliver a capture and decode the single response
+static bool request(const int index, Response &response, std::vector<TxFrame> &sent) {
+    auto frame = fromHex(CAPTURES[index].hex);
+    PTP_process(frame.data(), static_cast<int>(frame.size()));
+    sent = drain();
+    if (sent.size() != 1 || !decode(sent[0], response, index == GET_TIME_UDP)) {
+        fprintf(stdout, "FAIL: %s: no valid response\n", CAPTURES[index].name);
+        return false;
+    }
+    return true;
+}
+
+static int expect(const int index, const char *field, const int64_t value, const int64_t expected) {
+    if (value == expected)
+        return 0;
+    fprintf(stdout, "FAIL: %s: %s %lld (expected %lld)\n", CAPTURES[index].name, field,
+            static_cast<long long>(value), static_cast<long long>(expected));
+    return 1;
+}
+
+// GET a data set and check the TLV framing
+static const uint8_t* getDataSet(const int index, const int id, const int length, int &failed) {
+    static std::vector<TxFrame> sent;
+    Response response = {};
+    if (!request(index, response, sent)) {
+        failed = 1;
+        return nullptr;
+    }
+    int errors = expect(index, "action", response.action, PTP2_MA_RESPONSE);
+    errors += expect(index, "tlv type", response.tlvType, PTP2_TT_MANAGEMENT);
+    errors += expect(index, "management id", response.managementId, id);
+    errors += expect(index, "data length", response.length - 2, length);
+    if (errors != 0) {
+        failed = 1;
+        return nullptr;
+    }
+    return response.data;
+}
+
+// deliver an announce message from a better grandmaster over the layer-2 transport
+static constexpr uint8_t GM_MAC[6] = {0x00, 0x1B, 0x21, 0x00, 0x00, 0x01};
+static constexpr uint8_t GM_PORT[10] = {0x00, 0x1B, 0x21, 0xFF, 0xFE, 0x00, 0x00, 0x01, 0x00, 0x01};
+static constexpr uint8_t GM_IDENTITY[8] = {0xEC, 0x46, 0x70, 0xFF, 0xFE, 0x00, 0x0A, 0x0B};
+
+static void announce(const uint16_t sequence) {
+    uint8_t frame[14 + 64] = {};
+    memcpy(frame, ptpMac, 6);
+    memcpy(frame + 6, GM_MAC, 6);
+    frame[12] = 0x88;
+    frame[13] = 0xF7;
+    auto msg = frame + 14;
+    msg[0] = PTP2_MT_ANNOUNCE;
+    msg[1] = 2;
+    msg[3] = 64;
+    msg[4] = PTP2_DOMAIN;
+    // UTC offset valid, PTP timescale
+    msg[7] = PTP2_FLAG_UTC_VALID | PTP2_FLAG_PTP_TIMESCALE;
+    memcpy(msg + 20, GM_PORT, 10);
+    msg[30] = sequence >> 8;
+    msg[31] = sequence;
+    msg[32] = PTP2_CTRL_OTHER;
+    msg[45] = 37;
+    msg[47] = 64;
+    msg[48] = 6;
+    msg[49] = 0x20;
+    msg[50] = 0x40;
+    msg[51] = 0x00;
+    msg[52] = 128;
+    memcpy(msg + 53, GM_IDENTITY, 8);
+    msg[62] = 1;
+    msg[63] = PTP2_TSRC_ATOMIC;
+    PTP_process(frame, sizeof(frame));
+}
+
+static int testMaster() {
+    int failed = 0;
+    const uint8_t localPort[10] = {0x00, 0x00, 0x02, 0x00, 0x00, 0x12, 0x34, 0x56, 0x00, 0x01};
+    std::vector<TxFrame> sent;
+    Response response = {};
+
+    // NULL_MANAGEMENT is answered with an empty TLV
+    if (request(GET_NULL, response, sent)) {
+        failed |= expect(GET_NULL, "action", response.action, PTP2_MA_RESPONSE);
+        failed |= expect(GET_NULL, "tlv length", response.length, 2);
+        // boundary hops are consumed by the request
+        failed |= expect(GET_NULL, "starting hops", response.msg[44], 0);
+    }
+    else
+        failed = 1;
+
+    // byte-exact default data set
+    if (request(GET_DEFAULT, response, sent)) {
+        const auto golden = fromHex(DEFAULT_RESPONSE);
+        if (sent[0].data != golden) {
+            fprintf(stdout, "FAIL: default data set response differs from the reference encoding\n");
+            for (const auto byte : sent[0].data)
+                fprintf(stdout, "%02x", byte);
+            fprintf(stdout, "\n");
+            failed = 1;
+        }
+    }
+    else
+        failed = 1;
+
+    // zero-length GET (pmc -z)
+    if (const auto ds = getDataSet(GET_DEFAULT_ZERO, PTP2_MID_DEFAULT_DATA_SET, 20, failed)) {
+        failed |= expect(GET_DEFAULT_ZERO, "priority1", ds[4], 128);
+        failed |= expect(GET_DEFAULT_ZERO, "clockIdentity", memcmp(ds + 10, localPort, 8), 0);
+    }
+
+    if (const auto ds = getDataSet(GET_CURRENT, PTP2_MID_CURRENT_DATA_SET, 18, failed)) {
+        failed |= expect(GET_CURRENT, "stepsRemoved", get16(ds), 0);
+        failed |= expect(GET_CURRENT, "offsetFromMaster", get64(ds + 2), 0);
+        failed |= expect(GET_CURRENT, "meanPathDelay", get64(ds + 10), 0);
+    }
+
+    if (const auto ds = getDataSet(GET_PARENT, PTP2_MID_PARENT_DATA_SET, 32, failed)) {
+        failed |= expect(GET_PARENT, "parentPortIdentity", memcmp(ds, localPort, 10), 0);
+        failed |= expect(GET_PARENT, "parentStats", ds[10], 0);
+        failed |= expect(GET_PARENT, "observedParentOffsetScaledLogVariance", get16(ds + 12), 0xFFFF);
+        failed |= expect(GET_PARENT, "observedParentClockPhaseChangeRate", get32(ds + 14), 0x7FFFFFFF);
+        failed |= expect(GET_PARENT, "grandmasterPriority1", ds[18], 128);
+        failed |= expect(GET_PARENT, "grandmasterClockClass", ds[19], 6);
+        failed |= expect(GET_PARENT, "grandmasterClockAccuracy", ds[20], 0x21);
+        failed |= expect(GET_PARENT, "grandmasterOffsetScaledLogVariance", get16(ds + 21), 0x4F7E);
+        failed |= expect(GET_PARENT, "grandmasterPriority2", ds[23], 128);
+        failed |= expect(GET_PARENT, "grandmasterIdentity", memcmp(ds + 24, localPort, 8), 0);
+    }
+
+    if (const auto ds = getDataSet(GET_TIME, PTP2_MID_TIME_PROPERTIES, 4, failed)) {
+        failed |= expect(GET_TIME, "currentUtcOffset", get16(ds), 37);
+        // UTC offset valid, PTP timescale, time and frequency traceable
+        failed |= expect(GET_TIME, "flags", ds[2], 0x3C);
+        failed |= expect(GET_TIME, "timeSource", ds[3], PTP2_TSRC_GPS);
+    }
+
+    if (const auto ds = getDataSet(GET_PORT, PTP2_MID_PORT_DATA_SET, 26, failed)) {
+        failed |= expect(GET_PORT, "portIdentity", memcmp(ds, localPort, 10), 0);
+        failed |= expect(GET_PORT, "portState", ds[10], PTP2_PS_MASTER);
+        failed |= expect(GET_PORT, "logMinDelayReqInterval", static_cast<int8_t>(ds[11]), 0);
+        failed |= expect(GET_PORT, "peerMeanPathDelay", get64(ds + 12), 0);
+        failed |= expect(GET_PORT, "logAnnounceInterval", static_cast<int8_t>(ds[20]), 0);
+        failed |= expect(GET_PORT, "announceReceiptTimeout", ds[21], 3);
+        failed |= expect(GET_PORT, "logSyncInterval", static_cast<int8_t>(ds[22]), -4);
+        failed |= expect(GET_PORT, "delayMechanism", ds[23], PTP2_DM_E2E);
+        failed |= expect(GET_PORT, "logMinPdelayReqInterval", static_cast<int8_t>(ds[24]), 0);
+        failed |= expect(GET_PORT, "versionNumber", ds[25] & 0xF, 2);
+    }
+
+    // counters include the sync, delay and management traffic so far (the request itself is counted)
+    if (const auto ds = getDataSet(GET_STATS, PTP2_MID_PORT_STATS_NP, 266, failed)) {
+        const auto rx = ds + 10;
+        const auto tx = ds + 10 + 128;
+        failed |= expect(GET_STATS, "portIdentity", memcmp(ds, localPort, 10), 0);
+        failed |= expect(GET_STATS, "rx delay_req", getLe64(rx + 8 * PTP2_MT_DELAY_REQ), 3);
+        failed |= expect(GET_STATS, "rx management", getLe64(rx + 8 * PTP2_MT_MANAGEMENT), 8);
+        failed |= expect(GET_STATS, "tx sync", getLe64(tx + 8 * PTP2_MT_SYNC), 2);
+        failed |= expect(GET_STATS, "tx follow_up", getLe64(tx + 8 * PTP2_MT_FOLLOW_UP), 2);
+        failed |= expect(GET_STATS, "tx delay_resp", getLe64(tx + 8 * PTP2_MT_DELAY_RESP), 3);
+        failed |= expect(GET_STATS, "tx management", getLe64(tx + 8 * PTP2_MT_MANAGEMENT), 7);
+        fprintf(stdout, "port stats: rx %llu delay_req, %llu management; tx %llu sync, %llu follow_up, %llu delay_resp\n",
+            static_cast<unsigned long long>(getLe64(rx + 8)), static_cast<unsigned long long>(getLe64(rx + 8 * 13)),
+            static_cast<unsigned long long>(getLe64(tx)), static_cast<unsigned long long>(getLe64(tx + 8 * 8)),
+            static_cast<unsigned long long>(getLe64(tx + 8 * 9)));
+    }
+
+    // unknown management IDs are refused
+    if (request(SET_PRIORITY1, response, sent)) {
+        failed |= expect(SET_PRIORITY1, "action", response.action, PTP2_MA_RESPONSE);
+        failed |= expect(SET_PRIORITY1, "tlv type", response.tlvType, PTP2_TT_MANAGEMENT_STATUS);
+        failed |= expect(SET_PRIORITY1, "tlv length", response.length, 8);
+        failed |= expect(SET_PRIORITY1, "error", get16(response.data), PTP2_ME_NO_SUCH_ID);
+        failed |= expect(SET_PRIORITY1, "management id", response.managementId, 0x2005);
+    }
+    else
+        failed = 1;
+
+    // commands are acknowledged
+    if (request(CMD_NULL, response, sent)) {
+        failed |= expect(CMD_NULL, "action", response.action, PTP2_MA_ACKNOWLEDGE);
+        failed |= expect(CMD_NULL, "tlv type", response.tlvType, PTP2_TT_MANAGEMENT);
+    }
+    else
+        failed = 1;
+
+    // requests for other clocks are ignored
+    auto frame = fromHex(CAPTURES[OTHER_TARGET].hex);
+    PTP_process(frame.data(), static_cast<int>(frame.size()));
+    if (!drain().empty()) {
+        fprintf(stdout, "FAIL: %s: unexpected response\n", CAPTURES[OTHER_TARGET].name);
+        failed = 1;
+    }
+
+    // UDP requests to the multicast group are answered on the group
+    if (request(GET_TIME_UDP, response, sent)) {
+        const auto &bytes = sent[0].data;
+        failed |= expect(GET_TIME_UDP, "ip destination", get32(bytes.data() + 30), 0xE0000181);
+        failed |= expect(GET_TIME_UDP, "udp port", get16(bytes.data() + 36), PTP2_PORT_GENERAL);
+        failed |= expect(GET_TIME_UDP, "management id", response.managementId, PTP2_MID_TIME_PROPERTIES);
+    }
+    else
+        failed = 1;
+
+    return failed;
+}
+
+static int testPassive() {
+    int failed = 0;
+    // a better grandmaster one boundary clock away announces for four seconds
+    uint16_t sequence = 0;
+    for (int tick = 0; tick < 64; ++tick) {
+        monoNow += 1ull << 28;
+        stubs::tasks[TASK_BMCA].callback(nullptr);
+        if ((tick & 15) == 0)
+            announce(sequence++);
+    }
+    drain();
+    if (ptp::bmca::getState() != PTP2_PS_PASSIVE) {
+        fprintf(stdout, "FAIL: port is not passive\n");
+        return 1;
+    }
+    // slave measurement: 1.5 us ahead of the master, 2.8 us path delay
+    ptp::manage::setCurrent((1500ll << 32) / 1000000000, 2.8e-6f);
+
+    if (const auto ds = getDataSet(GET_CURRENT, PTP2_MID_CURRENT_DATA_SET, 18, failed)) {
+        failed |= expect(GET_CURRENT, "stepsRemoved", get16(ds), 2);
+        const double offset = static_cast<double>(get64(ds + 2)) / 65536;
+        const double delay = static_cast<double>(get64(ds + 10)) / 65536;
+        fprintf(stdout, "current data set: offset %.3f ns, delay %.3f ns\n", offset, delay);
+        if (offset < 1499 || offset > 1500.5 || delay < 2799 || delay > 2800.5) {
+            fprintf(stdout, "FAIL: wrong offset from master or mean path delay\n");
+            failed = 1;
+        }
+    }
+
+    if (const auto ds = getDataSet(GET_PARENT, PTP2_MID_PARENT_DATA_SET, 32, failed)) {
+        failed |= expect(GET_PARENT, "parentPortIdentity", memcmp(ds, GM_PORT, 10), 0);
+        failed |= expect(GET_PARENT, "grandmasterPriority1", ds[18], 64);
+        failed |= expect(GET_PARENT, "grandmasterClockAccuracy", ds[20], 0x20);
+        failed |= expect(GET_PARENT, "grandmasterOffsetScaledLogVariance", get16(ds + 21), 0x4000);
+        failed |= expect(GET_PARENT, "grandmasterIdentity", memcmp(ds + 24, GM_IDENTITY, 8), 0);
+    }
+
+    if (const auto ds = getDataSet(GET_TIME, PTP2_MID_TIME_PROPERTIES, 4, failed)) {
+        failed |= expect(GET_TIME, "currentUtcOffset", get16(ds), 37);
+        failed |= expect(GET_TIME, "flags", ds[2], PTP2_FLAG_UTC_VALID | PTP2_FLAG_PTP_TIMESCALE);
+        failed |= expect(GET_TIME, "timeSource", ds[3], PTP2_TSRC_ATOMIC);
+    }
+
+    if (const auto ds = getDataSet(GET_PORT, PTP2_MID_PORT_DATA_SET, 26, failed))
+        failed |= expect(GET_PORT, "portState", ds[10], PTP2_PS_PASSIVE);
+
+    return failed;
+}
+
+int main() {
+    int failed = 0;
+    ipAddress = MY_IP;
+    stubs::model.rxTime = getStamps;
+    stubs::model.txTime = getStamps;
+    monoNow = 100ull << 32;
+    ptp::init();
+    // claim the master role (announce receipt timeout without other masters)
+    monoNow += 4ull << 32;
+    stubs::tasks[TASK_BMCA].callback(nullptr);
+
+    // traffic for the message counters: one sync (two transports) and three delay requests
+    stubs::tasks[TASK_SYNC].callback(nullptr);
+    drain();
+    for (uint16_t seq = 0; seq < 3; ++seq) {
+        uint8_t frame[14 + 44] = {};
+        memcpy(frame, ptpMac, 6);
+        memcpy(frame + 6, PMC_MAC, 6);
+        frame[12] = 0x88;
+        frame[13] = 0xF7;
+        auto msg = frame + 14;
+        msg[0] = PTP2_MT_DELAY_REQ;
+        msg[1] = 2;
+        msg[3] = 44;
+        msg[4] = PTP2_DOMAIN;
+        memcpy(msg + 20, PMC_PORT, 10);
+        msg[31] = seq;
+        msg[32] = PTP2_CTRL_DELAY_REQ;
+        msg[33] = 0x7F;
+        PTP_process(frame, sizeof(frame));
+    }
+    drain();
+
+    failed |= testMaster();
+    failed |= testPassive();
+
+    fprintf(stdout, failed ? "FAILED\n" : "PASSED\n");
+    return failed;
+}
@@ -0,0 +1,705 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "test_ptp_stubs.hpp"
+
+#include "lib/store.hpp"
+#include "lib/net/ip.hpp"
+#include "lib/net/udp.hpp"
+#include "lib/net/util.hpp"
+#include "lib/ptp/bmca.hpp"
+#include "lib/ptp/common.hpp"
+#include "lib/ptp/profile.hpp"
+#include "lib/ptp/ptp.hpp"
+#include "lib/ptp/transport.hpp"
+
+void PTP_process(uint8_t *frame, int size);
+
+using stubs::MY_MAC;
+using stubs::MY_IP;
+using stubs::TxFrame;
+using stubs::drain;
+using stubs::monoNow;
+using stubs::records;
+using stubs::tasks;
+using stubs::txFree;
+using stubs::txStamps;
+
+// simulated time of the received request and of each completed transmission (32.32 TAI)
+static constexpr uint64_t RX_TIME = (1000ull << 32) | 0x80000000u; // 1000.5 s
+static constexpr uint64_t TX_TIME = (2000ull << 32) | 0x40000000u; // 2000.25 s
+
+// task handles in order of creation
+static constexpr int TASK_BMCA = 1;
+static constexpr int TASK_ANNOUNCE = 2;
+static constexpr int TASK_SYNC = 3;
+
+// let the announce receipt timeout expire without other masters
+static void claimMaster() {
+    monoNow += 4ull << 32;
+    tasks[TASK_BMCA].callback(nullptr);
+}
+
+// independent RFC 1071 checksum
+static uint16_t checksum(const uint8_t *data, const int len, uint32_t sum = 0) {
+    for (int i = 0; i + 1 < len; i += 2)
+        sum += (data[i] << 8) | data[i + 1];
+    if (len & 1)
+        sum += data[len - 1] << 8;
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return sum;
+}
+
+static uint16_t get16(const uint8_t *data) {
+    return (data[0] << 8) | data[1];
+}
+
+static uint32_t get32(const uint8_t *data) {
+    return (get16(data) << 16) | get16(data + 2);
+}
+
+/**
+ * Delay_Req as emitted by a ptp4l slave (E2E, domain 1): 44 byte message, control field 1,
+ * logMessageInterval 0x7F and a zero origin timestamp.
+ */
+struct Request {
+    const char *name;
+    ptp::Transport transport;
+    uint8_t srcMac[6];
+    uint32_t srcIp;
+    // destination (zero for the default multicast group)
+    uint32_t dstIp;
+    uint8_t domain;
+    uint8_t version;
+    uint16_t flags;
+    uint16_t seq;
+    // bytes removed from the end of the frame
+    int truncate;
+    // a response is expected
+    bool valid;
+};
+
+static constexpr Request CORPUS[] = {
+    {"udp multicast", ptp::TRANSPORT_UDP, {0x00, 0x1B, 0x21, 0xAA, 0x00, 0x01}, 0x1401A8C0u, 0, 1, 2, 0, 0x0001, 0, true},
+    {"udp multicast #2", ptp::TRANSPORT_UDP, {0x00, 0x1B, 0x21, 0xAA, 0x00, 0x02}, 0x1501A8C0u, 0, 1, 2, 0, 0xFFFF, 0, true},
+    {"udp unicast", ptp::TRANSPORT_UDP, {0x00, 0x1B, 0x21, 0xAA, 0x00, 0x01}, 0x1401A8C0u, MY_IP, 1, 2, PTP2_FLAG_UNICAST, 0x1234, 0, true},
+    {"l2 multicast", ptp::TRANSPORT_L2, {0x00, 0x1B, 0x21, 0xAA, 0x00, 0x03}, 0, 0, 1, 2, 0, 0x0042, 0, true},
+    {"udp other domain", ptp::TRANSPORT_UDP, {0x00, 0x1B, 0x21, 0xAA, 0x00, 0x01}, 0x1401A8C0u, 0, 0, 2, 0, 0x0002, 0, false},
+    {"l2 other domain", ptp::TRANSPORT_L2, {0x00, 0x1B, 0x21, 0xAA, 0x00, 0x03}, 0, 0, 4, 2, 0, 0x0003, 0, false},
+    {"udp version 1", ptp::TRANSPORT_UDP, {0x00, 0x1B, 0x21, 0xAA, 0x00, 0x01}, 0x1401A8C0u, 0, 1, 1, 0, 0x0004, 0, false},
+    {"udp other host", ptp::TRANSPORT_UDP, {0x00, 0x1B, 0x21, 0xAA, 0x00, 0x01}, 0x1401A8C0u, 0x0B01A8C0u, 1, 2, 0, 0x0005, 0, false},
+    {"udp truncated", ptp::TRANSPORT_UDP, {0x00, 0x1B, 0x21, 0xAA, 0x00, 0x01}, 0x1401A8C0u, 0, 1, 2, 0, 0x0006, 4, false},
+    {"own frame", ptp::TRANSPORT_L2, {0x02, 0x00, 0x00, 0x12, 0x34, 0x56}, 0, 0, 1, 2, 0, 0x0007, 0, false},
+};
+
+// build the ethernet frame for a request
+static std::vector<uint8_t> buildRequest(const Request &req) {
+    uint8_t msg[44] = {};
+    msg[0] = PTP2_MT_DELAY_REQ;
+    msg[1] = req.version;
+    msg[2] = 0;
+    msg[3] = sizeof(msg);
+    msg[4] = req.domain;
+    msg[6] = req.flags >> 8;
+    msg[7] = req.flags;
+    // correction field carries a residence time from a transparent clock
+    msg[13] = 0x20;
+    // source port identity (EUI-64 from the MAC address, port 1)
+    memcpy(msg + 20, req.srcMac, 3);
+    msg[23] = 0xFF;
+    msg[24] = 0xFE;
+    memcpy(msg + 25, req.srcMac + 3, 3);
+    msg[29] = 1;
+    msg[30] = req.seq >> 8;
+    msg[31] = req.seq;
+    msg[32] = PTP2_CTRL_DELAY_REQ;
+    msg[33] = 0x7F;
+
+    std::vector<uint8_t> frame;
+    uint8_t eth[14];
+    if (req.transport == ptp::TRANSPORT_L2) {
+        memcpy(eth, ptpMac, 6);
+        memcpy(eth + 6, req.srcMac, 6);
+        eth[12] = 0x88;
+        eth[13] = 0xF7;
+        frame.insert(frame.end(), eth, eth + sizeof(eth));
+        frame.insert(frame.end(), msg, msg + sizeof(msg));
+        // minimum ethernet payload
+        frame.resize(60);
+    }
+    else {
+        const uint32_t dstIp = req.dstIp ? req.dstIp : PTP2_MCAST_PRIMARY;
+        if (req.dstIp == 0)
+            IPv4_macMulticast(eth, dstIp);
+        else
+            memcpy(eth, MY_MAC, 6);
+        memcpy(eth + 6, req.srcMac, 6);
+        eth[12] = 0x08;
+        eth[13] = 0x00;
+
+        uint8_t ip[20] = {0x45, 0x00};
+        ip[3] = sizeof(ip) + 8 + sizeof(msg);
+        ip[5] = static_cast<uint8_t>(req.seq);
+        ip[6] = 0x40;
+        ip[8] = req.dstIp ? 64 : 1;
+        ip[9] = 17;
+        memcpy(ip + 12, &req.srcIp, 4);
+        memcpy(ip + 16, &dstIp, 4);
+        const uint16_t ipSum = ~checksum(ip, sizeof(ip));
+        ip[10] = ipSum >> 8;
+        ip[11] = ipSum;
+
+        uint8_t udp[8] = {0x01, 0x3F, 0x01, 0x3F};
+        udp[5] = 8 + sizeof(msg);
+        // pseudo header, UDP header and payload
+        uint8_t pseudo[12] = {};
+        memcpy(pseudo, ip + 12, 8);
+        pseudo[9] = 17;
+        pseudo[11] = udp[5];
+        uint16_t udpSum = ~checksum(msg, sizeof(msg), checksum(udp, 8, checksum(pseudo, sizeof(pseudo))));
+        if (udpSum == 0)
+            udpSum = 0xFFFF;
+        udp[6] = udpSum >> 8;
+        udp[7] = udpSum;
+
+        frame.insert(frame.end(), eth, eth + sizeof(eth));
+        frame.insert(frame.end(), ip, ip + sizeof(ip));
+        frame.insert(frame.end(), udp, udp + sizeof(udp));
+        frame.insert(frame.end(), msg, msg + sizeof(msg));
+    }
+    frame.resize(frame.size() - req.truncate);
+    return frame;
+}
+
+// deliver a frame as the ethernet dispatcher does
+static void deliver(std::vector<uint8_t> frame) {
+    const auto ethType = get16(frame.data() + 12);
+    if (ethType == 0x88F7)
+        PTP_process(frame.data(), static_cast<int>(frame.size()));
+    else if (ethType == 0x0800)
+        IPv4_process(frame.data(), static_cast<int>(frame.size()));
+}
+
+/**
+ * Validate the link and network headers of a transmitted frame
+ * @param frame transmitted frame
+ * @param transport expected transport
+ * @param port expected UDP port (UDP only)
+ * @param dstIp expected IPv4 destination (UDP only)
+ * @param dstMac expected MAC destination
+ * @return offset of the PTP message or -1 on failure
+ */
+static int checkFrame(const std::vector<uint8_t> &frame, const ptp::Transport transport, const uint16_t port, const uint32_t dstIp, const uint8_t *dstMac) {
+    const auto data = frame.data();
+    if (memcmp(data, dstMac, 6) != 0) {
+        fprintf(stdout, "  wrong destination MAC\n");
+        return -1;
+    }
+    if (transport == ptp::TRANSPORT_L2) {
+        if (get16(data + 12) != 0x88F7) {
+            fprintf(stdout, "  wrong ethernet type\n");
+            return -1;
+        }
+        return 14;
+    }
+
+    if (get16(data + 12) != 0x0800 || data[14] != 0x45 || data[23] != 17) {
+        fprintf(stdout, "  not a UDP/IPv4 frame\n");
+        return -1;
+    }
+    if (checksum(data + 14, 20) != 0xFFFF) {
+        fprintf(stdout, "  bad IPv4 checksum\n");
+        return -1;
+    }
+    if (get16(data + 16) != frame.size() - 14) {
+        fprintf(stdout, "  bad IPv4 length\n");
+        return -1;
+    }
+    uint32_t src, dst;
+    memcpy(&src, data + 26, 4);
+    memcpy(&dst, data + 30, 4);
+    if (src != MY_IP || dst != dstIp) {
+        fprintf(stdout, "  wrong IPv4 addresses\n");
+        return -1;
+    }
+    if ((dst & 0xF0) == 0xE0 && data[22] != 1) {
+        fprintf(stdout, "  multicast TTL is not 1\n");
+        return -1;
+    }
+    if (get16(data + 34) != port || get16(data + 36) != port) {
+        fprintf(stdout, "  wrong UDP ports (%d -> %d)\n", get16(data + 34), get16(data + 36));
+        return -1;
+    }
+    const int udpLen = get16(data + 38);
+    if (udpLen != static_cast<int>(frame.size()) - 34) {
+        fprintf(stdout, "  bad UDP length\n");
+        return -1;
+    }
+    uint8_t pseudo[12] = {};
+    memcpy(pseudo, data + 26, 8);
+    pseudo[9] = 17;
+    pseudo[10] = udpLen >> 8;
+    pseudo[11] = udpLen;
+    if (checksum(data + 34, udpLen, checksum(pseudo, sizeof(pseudo))) != 0xFFFF) {
+        fprintf(stdout, "  bad UDP checksum\n");
+        return -1;
+    }
+    return 42;
+}
+
+// domain and majorSdoId of the active profile
+static uint8_t domain = PTP2_DOMAIN;
+static uint8_t sdoId = 0;
+
+// validate the common header of a transmitted message
+static bool checkHeader(const uint8_t *msg, const PTP2_MTYPE type, const int length, const uint8_t control) {
+    if ((msg[0] & 0xF) != type || (msg[0] >> 4) != sdoId || (msg[1] & 0xF) != 2) {
+        fprintf(stdout, "  wrong message type %d\n", msg[0] & 0xF);
+        return false;
+    }
+    if (get16(msg + 2) != length) {
+        fprintf(stdout, "  wrong message length %d\n", get16(msg + 2));
+        return false;
+    }
+    if (msg[4] != domain || msg[32] != control) {
+        fprintf(stdout, "  wrong domain or control field\n");
+        return false;
+    }
+    // clock identity is the EUI-48 in the lower six bytes, port 1
+    if (memcmp(msg + 22, MY_MAC, 6) != 0 || get16(msg + 28) != 1) {
+        fprintf(stdout, "  wrong source port identity\n");
+        return false;
+    }
+    return true;
+}
+
+// validate a timestamp against a 32.32 time
+static bool checkTimestamp(const uint8_t *ts, const uint64_t time) {
+    const uint64_t seconds = (static_cast<uint64_t>(get16(ts)) << 32) | get32(ts + 2);
+    const uint32_t nanos = get32(ts + 6);
+    const auto expect = static_cast<uint32_t>(((time & 0xFFFFFFFFu) * 1000000000ull) >> 32);
+    if (seconds != (time >> 32) || nanos != expect) {
+        fprintf(stdout, "  wrong timestamp %llu.%09u\n", static_cast<unsigned long long>(seconds), nanos);
+        return false;
+    }
+    return true;
+}
+
+static bool replayRequest(const Request &req) {
+    deliver(buildRequest(req));
+    const auto sent = drain();
+
+    if (!req.valid) {
+        if (sent.empty())
+            return true;
+        fprintf(stdout, "FAIL: %s: unexpected response\n", req.name);
+        return false;
+    }
+    if (sent.size() != 1) {
+        fprintf(stdout, "FAIL: %s: %d responses\n", req.name, static_cast<int>(sent.size()));
+        return false;
+    }
+
+    // multicast requests get multicast responses, unicast requests a unicast response
+    const auto &frame = sent[0].data;
+    uint8_t dstMac[6];
+    uint32_t dstIp = 0;
+    if (req.transport == ptp::TRANSPORT_L2)
+        memcpy(dstMac, req.srcMac, 6);
+    else if (req.dstIp == 0) {
+        dstIp = PTP2_MCAST_PRIMARY;
+        IPv4_macMulticast(dstMac, dstIp);
+    }
+    else {
+        dstIp = req.srcIp;
+        memcpy(dstMac, req.srcMac, 6);
+    }
+    const int offset = checkFrame(frame, req.transport, PTP2_PORT_GENERAL, dstIp, dstMac);
+    const auto msg = frame.data() + offset;
+    if (offset < 0 || !checkHeader(msg, PTP2_MT_DELAY_RESP, 54, PTP2_CTRL_DELAY_RESP)) {
+        fprintf(stdout, "FAIL: %s: malformed response\n", req.name);
+        return false;
+    }
+    if (get16(msg + 30) != req.seq) {
+        fprintf(stdout, "FAIL: %s: sequence %04x != %04x\n", req.name, get16(msg + 30), req.seq);
+        return false;
+    }
+    if (get16(msg + 6) != (req.flags & PTP2_FLAG_UNICAST)) {
+        fprintf(stdout, "FAIL: %s: wrong flags %04x\n", req.name, get16(msg + 6));
+        return false;
+    }
+    if (msg[13] != 0x20) {
+        fprintf(stdout, "FAIL: %s: correction field not returned\n", req.name);
+        return false;
+    }
+    // requesting port identity
+    const auto request = buildRequest(req);
+    const auto reqMsg = request.data() + (req.transport == ptp::TRANSPORT_L2 ? 14 : 42);
+    if (memcmp(msg + 44, reqMsg + 20, 10) != 0) {
+        fprintf(stdout, "FAIL: %s: wrong requesting port identity\n", req.name);
+        return false;
+    }
+    if (!checkTimestamp(msg + 34, RX_TIME)) {
+        fprintf(stdout, "FAIL: %s: wrong receive timestamp\n", req.name);
+        return false;
+    }
+    return true;
+}
+
+// replay Delay_Req frames from a pcap capture (ethernet link type)
+static int replayCapture(const char *path, int &requests) {
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        fprintf(stdout, "FAIL: cannot open %s\n", path);
+        return 1;
+    }
+    uint8_t header[24];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || get32(header) != 0xD4C3B2A1u || header[20] != 1) {
+        fprintf(stdout, "FAIL: %s is not a little-endian ethernet pcap file\n", path);
+        fclose(file);
+        return 1;
+    }
+
+    int failed = 0;
+    uint8_t record[16];
+    while (fread(record, 1, sizeof(record), file) == sizeof(record)) {
+        uint32_t length;
+        memcpy(&length, record + 8, 4);
+        std::vector<uint8_t> frame(length);
+        if (fread(frame.data(), 1, length, file) != length)
+            break;
+
+        // retarget the capture at the simulated interface
+        ptp::Address src, dst;
+        const int offset = ptp::transport::parse(frame.data(), static_cast<int>(length), src, dst);
+        if (offset < 0 || (frame[offset] & 0xF) != PTP2_MT_DELAY_REQ || frame[offset + 4] != PTP2_DOMAIN)
+            continue;
+        if (!ptp::transport::isMulticast(dst)) {
+            memcpy(frame.data(), MY_MAC, 6);
+            if (dst.transport == ptp::TRANSPORT_UDP)
+                continue;
+        }
+        ++requests;
+
+        deliver(frame);
+        const auto sent = drain();
+        if (sent.size() != 1) {
+            fprintf(stdout, "FAIL: capture request %d: %d responses\n", requests, static_cast<int>(sent.size()));
+            failed = 1;
+            continue;
+        }
+        const auto msg = sent[0].data.data() + offset;
+        if (sent[0].data.size() != static_cast<size_t>(offset + 54) || get16(msg + 30) != get16(frame.data() + offset + 30)) {
+            fprintf(stdout, "FAIL: capture request %d: mismatched response\n", requests);
+            failed = 1;
+        }
+    }
+    fclose(file);
+    return failed;
+}
+
+// read a value from a line of the ptp status report
+static float statusValue(const char *label, const int field = 0) {
+    char buffer[4096];
+    buffer[ptp::status(buffer)] = 0;
+    const char *line = strstr(buffer, label);
+    if (line == nullptr)
+        return -1;
+    line += strlen(label);
+    float value[2] = {-1, -1};
+    sscanf(line, " %f %*[^,], %f", value, value + 1);
+    return value[field];
+}
+
+// select a profile by name
+static bool selectProfile(const char *name) {
+    if (!ptp::setProfile(name, static_cast<int>(strlen(name))))
+        return false;
+    const auto &profile = ptp::profile::active();
+    domain = profile.domain;
+    sdoId = profile.sdoId;
+    claimMaster();
+    return true;
+}
+
+static int testProfiles(const Request &pdelay) {
+    int failed = 0;
+
+    if (ptp::setProfile("gptpx", 5) || ptp::setProfile("gptp", 3) || ptp::profile::activeId() != ptp::PROFILE_DEFAULT) {
+        fprintf(stdout, "FAIL: invalid profile name accepted\n");
+        failed = 1;
+    }
+
+    // IEEE 802.1AS: layer-2 only, path trace and follow-up information TLVs
+    if (!selectProfile("gptp") || records[store::ID_PTP] != ptp::PROFILE_GPTP) {
+        fprintf(stdout, "FAIL: gptp profile not selected\n");
+        return 1;
+    }
+    if (tasks[TASK_ANNOUNCE].interval != RUN_SEC || tasks[TASK_SYNC].interval != RUN_SEC >> 3) {
+        fprintf(stdout, "FAIL: gptp message rates not applied\n");
+        failed = 1;
+    }
+    tasks[TASK_ANNOUNCE].callback(nullptr);
+    auto sent = drain();
+    int offset = sent.size() == 1 ? checkFrame(sent[0].data, ptp::TRANSPORT_L2, 0, 0, gPtpMac) : -1;
+    auto msg = sent.empty() ? nullptr : sent[0].data.data() + offset;
+    if (offset < 0 || !checkHeader(msg, PTP2_MT_ANNOUNCE, 76, PTP2_CTRL_OTHER) ||
+        get16(msg + 64) != PTP2_TT_PATH_TRACE || get16(msg + 66) != 8 || memcmp(msg + 70, MY_MAC, 6) != 0) {
+        fprintf(stdout, "FAIL: malformed gptp announce\n");
+        failed = 1;
+    }
+    tasks[TASK_SYNC].callback(nullptr);
+    sent = drain();
+    offset = sent.size() == 2 ? checkFrame(sent[1].data, ptp::TRANSPORT_L2, 0, 0, gPtpMac) : -1;
+    msg = sent.size() < 2 ? nullptr : sent[1].data.data() + offset;
+    static constexpr uint8_t FOLLOW_UP_INFO[10] = {0x00, 0x03, 0x00, 0x1C, 0x00, 0x80, 0xC2, 0x00, 0x00, 0x01};
+    if (offset < 0 || !checkHeader(msg, PTP2_MT_FOLLOW_UP, 76, PTP2_CTRL_FOLLOW_UP) ||
+        msg[33] != static_cast<uint8_t>(-3) || memcmp(msg + 44, FOLLOW_UP_INFO, sizeof(FOLLOW_UP_INFO)) != 0) {
+        fprintf(stdout, "FAIL: malformed gptp follow-up\n");
+        failed = 1;
+    }
+
+    // telecom: domain 24 and 128 Hz sync on layer-2
+    if (!selectProfile("telecom") || records[store::ID_PTP] != ptp::PROFILE_TELECOM) {
+        fprintf(stdout, "FAIL: telecom profile not selected\n");
+        return 1;
+    }
+    if (tasks[TASK_ANNOUNCE].interval != RUN_SEC >> 3 || tasks[TASK_SYNC].interval != RUN_SEC >> 7) {
+        fprintf(stdout, "FAIL: telecom message rates not applied\n");
+        failed = 1;
+    }
+    Request request = pdelay;
+    deliver(buildRequest(request));
+    if (!drain().empty()) {
+        fprintf(stdout, "FAIL: request from the previous domain answered\n");
+        failed = 1;
+    }
+    request.domain = 24;
+    deliver(buildRequest(request));
+    sent = drain();
+    msg = sent.size() == 1 ? sent[0].data.data() + 14 : nullptr;
+    if (msg == nullptr || !checkHeader(msg, PTP2_MT_DELAY_RESP, 54, PTP2_CTRL_DELAY_RESP) || msg[33] != static_cast<uint8_t>(-7)) {
+        fprintf(stdout, "FAIL: telecom delay response\n");
+        failed = 1;
+    }
+
+    // admission control withholds sync when the ring reserve would be used
+    txFree = ptp::transport::TX_RESERVE + 1;
+    tasks[TASK_SYNC].callback(nullptr);
+    if (!drain().empty() || statusValue("skipped:") != 1) {
+        fprintf(stdout, "FAIL: sync not withheld\n");
+        failed = 1;
+    }
+    txFree = ptp::transport::TX_RESERVE + 2;
+    tasks[TASK_SYNC].callback(nullptr);
+    sent = drain();
+    if (sent.size() != 2 || checkFrame(sent[0].data, ptp::TRANSPORT_L2, 0, 0, ptpMac) < 0) {
+        fprintf(stdout, "FAIL: %d telecom sync frames\n", static_cast<int>(sent.size()));
+        failed = 1;
+    }
+    txFree = 127;
+
+    // reselecting the active profile leaves the port and the stored selection alone
+    records.erase(store::ID_PTP);
+    if (!ptp::setProfile("telecom", 7) || records.count(store::ID_PTP) != 0 || ptp::bmca::getState() != PTP2_PS_MASTER) {
+        fprintf(stdout, "FAIL: reselecting the active profile restarted the port\n");
+        failed = 1;
+    }
+
+    // departure statistics: alternating +/-1 us departure error and 50 us latency, one sync withheld
+    // (a profile change restarts the statistics)
+    selectProfile("default");
+    selectProfile("telecom");
+    const uint64_t period = static_cast<uint64_t>(RUN_SEC >> 7) << 8;
+    for (int i = 0; i < 512; ++i) {
+        if (i == 100) {
+            txFree = 0;
+            tasks[TASK_SYNC].callback(nullptr);
+            txFree = 127;
+            continue;
+        }
+        monoNow = (1000ull << 32) + i * period;
+        const int64_t error = ((i & 1) ? 1ll << 32 : -(1ll << 32)) / 1000000;
+        txStamps[0] = monoNow + (50ull << 32) / 1000000 + error;
+        tasks[TASK_SYNC].callback(nullptr);
+        drain();
+    }
+    const float jitterRms = statusValue("jitter:");
+    const float jitterMax = statusValue("jitter:", 1);
+    const float latencyMean = statusValue("latency:");
+    const float latencyMax = statusValue("latency:", 1);
+    fprintf(stdout, "telecom sync: jitter %.3f us rms, %.3f us max, latency %.3f us mean, %.3f us max\n",
+        jitterRms, jitterMax, latencyMean, latencyMax);
+    if (jitterRms < 1.9f || jitterRms > 2.1f || jitterMax < 1.9f || jitterMax > 2.1f) {
+        fprintf(stdout, "FAIL: wrong sync departure jitter\n");
+        failed = 1;
+    }
+    if (latencyMean < 49.5f || latencyMean > 50.5f || latencyMax < 50.9f || latencyMax > 51.1f) {
+        fprintf(stdout, "FAIL: wrong sync latency\n");
+        failed = 1;
+    }
+
+    // restore the default profile
+    selectProfile("default");
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    int failed = 0;
+    ipAddress = MY_IP;
+    // requests are received at RX_TIME and transmissions complete at TX_TIME
+    stubs::model.taiNow = [] { return RX_TIME; };
+    stubs::rxStamps[2] = RX_TIME;
+    txStamps[2] = TX_TIME;
+    // an invalid stored profile is ignored
+    records[store::ID_PTP] = ptp::PROFILE_COUNT;
+    ptp::init();
+    // unicast, bmca, announce and sync tasks
+    if (tasks.size() != 4 || tasks[TASK_ANNOUNCE].interval != RUN_SEC || tasks[TASK_SYNC].interval != RUN_SEC >> 4) {
+        fprintf(stdout, "FAIL: expected announce and sync tasks at the default profile rates\n");
+        return 1;
+    }
+    // nothing is sent or answered while listening for other masters
+    tasks[TASK_ANNOUNCE].callback(nullptr);
+    tasks[TASK_SYNC].callback(nullptr);
+    deliver(buildRequest(CORPUS[0]));
+    if (!drain().empty()) {
+        fprintf(stdout, "FAIL: transmission while listening\n");
+        failed = 1;
+    }
+    claimMaster();
+
+    // replay the request corpus
+    int responses = 0;
+    for (const auto &req : CORPUS) {
+        if (!replayRequest(req))
+            failed = 1;
+        else if (req.valid)
+            ++responses;
+    }
+    fprintf(stdout, "delay requests: %d replayed, %d answered\n", static_cast<int>(std::size(CORPUS)), responses);
+
+    // replay a capture when provided
+    if (argc > 1) {
+        int requests = 0;
+        failed |= replayCapture(argv[1], requests);
+        fprintf(stdout, "capture: %d delay requests replayed\n", requests);
+    }
+
+    // announce is a general message on every transport
+    tasks[TASK_ANNOUNCE].callback(nullptr);
+    auto sent = drain();
+    uint8_t mcastMac[6];
+    IPv4_macMulticast(mcastMac, PTP2_MCAST_PRIMARY);
+    if (sent.size() != 2) {
+        fprintf(stdout, "FAIL: %d announce frames\n", static_cast<int>(sent.size()));
+        failed = 1;
+    }
+    else {
+        const int l2 = checkFrame(sent[0].data, ptp::TRANSPORT_L2, 0, 0, ptpMac);
+        const int udp = checkFrame(sent[1].data, ptp::TRANSPORT_UDP, PTP2_PORT_GENERAL, PTP2_MCAST_PRIMARY, mcastMac);
+        if (l2 < 0 || udp < 0) {
+            fprintf(stdout, "FAIL: malformed announce frame\n");
+            failed = 1;
+        }
+        else {
+            const auto msg = sent[1].data.data() + udp;
+            const uint16_t flags = PTP2_FLAG_PTP_TIMESCALE | PTP2_FLAG_UTC_VALID | PTP2_FLAG_TIME_TRACEABLE | PTP2_FLAG_FREQ_TRACEABLE;
+            if (!checkHeader(msg, PTP2_MT_ANNOUNCE, 64, PTP2_CTRL_OTHER) || get16(msg + 6) != flags) {
+                fprintf(stdout, "FAIL: malformed announce message\n");
+                failed = 1;
+            }
+            if (get16(msg + 44) != 37 || msg[48] != PTP2_CLK_CLASS_PRIMARY || msg[63] != PTP2_TSRC_GPS ||
+                msg[47] != 128 || msg[52] != 128 || msg[49] != 0x21 || get16(msg + 50) != toPtpLogVariance(50e-9f)) {
+                fprintf(stdout, "FAIL: wrong announce data set\n");
+                failed = 1;
+            }
+        }
+    }
+
+    // two-step sync with follow-up on every transport
+    for (int i = 0; i < 2; ++i) {
+        tasks[TASK_SYNC].callback(nullptr);
+        sent = drain();
+        if (sent.size() != 4) {
+            fprintf(stdout, "FAIL: %d sync frames\n", static_cast<int>(sent.size()));
+            failed = 1;
+            continue;
+        }
+        const struct {
+            ptp::Transport transport;
+            uint16_t port;
+            uint32_t ip;
+            const uint8_t *mac;
+            PTP2_MTYPE type;
+            uint8_t control;
+        } expect[4] = {
+            {ptp::TRANSPORT_L2, 0, 0, ptpMac, PTP2_MT_SYNC, PTP2_CTRL_SYNC},
+            {ptp::TRANSPORT_UDP, PTP2_PORT_EVENT, PTP2_MCAST_PRIMARY, mcastMac, PTP2_MT_SYNC, PTP2_CTRL_SYNC},
+            {ptp::TRANSPORT_L2, 0, 0, ptpMac, PTP2_MT_FOLLOW_UP, PTP2_CTRL_FOLLOW_UP},
+            {ptp::TRANSPORT_UDP, PTP2_PORT_GENERAL, PTP2_MCAST_PRIMARY, mcastMac, PTP2_MT_FOLLOW_UP, PTP2_CTRL_FOLLOW_UP},
+        };
+        for (int j = 0; j < 4; ++j) {
+            const int offset = checkFrame(sent[j].data, expect[j].transport, expect[j].port, expect[j].ip, expect[j].mac);
+            const auto msg = sent[j].data.data() + offset;
+            if (offset < 0 || !checkHeader(msg, expect[j].type, 44, expect[j].control)) {
+                fprintf(stdout, "FAIL: malformed sync frame %d\n", j);
+                failed = 1;
+                continue;
+            }
+            if (get16(msg + 30) != i || msg[33] != static_cast<uint8_t>(-4)) {
+                fprintf(stdout, "FAIL: wrong sync sequence or interval\n");
+                failed = 1;
+            }
+            if (expect[j].type == PTP2_MT_SYNC && get16(msg + 6) != PTP2_FLAG_TWO_STEP) {
+                fprintf(stdout, "FAIL: sync without two-step flag\n");
+                failed = 1;
+            }
+            if (expect[j].type == PTP2_MT_FOLLOW_UP && !checkTimestamp(msg + 34, TX_TIME)) {
+                fprintf(stdout, "FAIL: wrong precise origin timestamp\n");
+                failed = 1;
+            }
+        }
+    }
+
+    // peer delay request is answered with a two-step response and follow-up
+    Request pdelay = CORPUS[3];
+    auto frame = buildRequest(pdelay);
+    frame[14] = PTP2_MT_PDELAY_REQ;
+    frame[17] = 54;
+    frame[46] = PTP2_CTRL_OTHER;
+    frame.resize(14 + 54);
+    deliver(frame);
+    sent = drain();
+    if (sent.size() != 2) {
+        fprintf(stdout, "FAIL: %d peer delay frames\n", static_cast<int>(sent.size()));
+        failed = 1;
+    }
+    else {
+        const auto resp = sent[0].data.data() + 14;
+        const auto fup = sent[1].data.data() + 14;
+        if (!checkHeader(resp, PTP2_MT_PDELAY_RESP, 54, PTP2_CTRL_OTHER) || get16(resp + 6) != PTP2_FLAG_TWO_STEP ||
+            !checkTimestamp(resp + 34, RX_TIME)) {
+            fprintf(stdout, "FAIL: malformed peer delay response\n");
+            failed = 1;
+        }
+        if (!checkHeader(fup, PTP2_MT_PDELAY_FOLLOW_UP, 54, PTP2_CTRL_OTHER) || !checkTimestamp(fup + 34, TX_TIME) ||
+            memcmp(fup + 44, frame.data() + 34, 10) != 0 || get16(fup + 30) != pdelay.seq) {
+            fprintf(stdout, "FAIL: malformed peer delay follow-up\n");
+            failed = 1;
+        }
+    }
+
+    failed |= testProfiles(pdelay);
+
+    fprintf(stdout, failed ? "FAILED\n" : "PASSED\n");
+    return failed;
+}
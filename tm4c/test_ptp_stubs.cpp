@@ -0,0 +1,202 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include "test_ptp_stubs.hpp"
+
+#include <cstring>
+
+#include "lib/led.hpp"
+#include "lib/store.hpp"
+#include "lib/clock/mono.hpp"
+#include "lib/clock/tai.hpp"
+#include "lib/net/icmp.hpp"
+#include "lib/ntp/GPS.hpp"
+#include "lib/ntp/ntp.hpp"
+
+stubs::Model stubs::model = {};
+std::vector<stubs::TxFrame> stubs::txQueue;
+int stubs::txFree = 127;
+uint64_t stubs::rxStamps[3];
+uint64_t stubs::txStamps[3];
+uint64_t stubs::monoNow;
+uint64_t stubs::taiOffset;
+
+uint32_t stubs::refId = ntp::GPS::REF_ID;
+int stubs::selectRequests;
+PllHoldover stubs::holdover = PLL_HOLD_NONE;
+float stubs::holdoverError;
+float stubs::offsetRms = 50e-9f;
+
+std::vector<stubs::Task> stubs::tasks;
+std::vector<stubs::Task> stubs::sleepers;
+RunCall stubs::waitTask;
+bool stubs::waitWoken;
+
+std::map<int, uint32_t> stubs::records;
+
+std::vector<stubs::TxFrame> stubs::drain() {
+    // run the woken task as the scheduler does after the receive task (bounded if the ring stays full)
+    for (int i = 0; waitWoken && i < 1000; ++i) {
+        waitWoken = false;
+        waitTask(nullptr);
+    }
+    std::vector<TxFrame> sent;
+    for (size_t i = 0; i < txQueue.size(); ++i) {
+        const auto frame = txQueue[i];
+        if (frame.callback)
+            frame.callback(frame.ref, frame.data.data(), static_cast<int>(frame.data.size()));
+        sent.push_back(frame);
+    }
+    txQueue.clear();
+    return sent;
+}
+
+
+// -----------------------------------------------------------------------------
+// simulated network interface -------------------------------------------------
+// -----------------------------------------------------------------------------
+
+void getMAC(void *mac) {
+    memcpy(mac, stubs::MY_MAC, 6);
+}
+
+int isMyMAC(const void *mac) {
+    return memcmp(mac, stubs::MY_MAC, 6);
+}
+
+void copyMAC(void *dst, const void *src) {
+    memcpy(dst, src, 6);
+}
+
+bool network::transmit(const uint8_t *frame, const int size, const CallbackTx callback, void *ref) {
+    if (stubs::model.transmit)
+        return stubs::model.transmit(frame, size, callback, ref);
+    stubs::txQueue.push_back({std::vector<uint8_t>(frame, frame + size), callback, ref});
+    return true;
+}
+
+int network::getTxFree() {
+    if (stubs::model.txFree)
+        return stubs::model.txFree();
+    return stubs::txFree;
+}
+
+void network::getRxTime(uint64_t *stamps) {
+    if (stubs::model.rxTime)
+        return stubs::model.rxTime(stamps);
+    memcpy(stamps, stubs::rxStamps, sizeof(stubs::rxStamps));
+}
+
+void network::getTxTime(uint64_t *stamps) {
+    if (stubs::model.txTime)
+        return stubs::model.txTime(stamps);
+    memcpy(stamps, stubs::txStamps, sizeof(stubs::txStamps));
+}
+
+void ICMP_process(uint8_t *, int) {}
+
+void LED_act0() {}
+
+
+// -----------------------------------------------------------------------------
+// simulated clock and reference state -----------------------------------------
+// -----------------------------------------------------------------------------
+
+volatile uint64_t clkTaiUtcOffset = 37ull << 32;
+
+uint64_t clock::tai::now() {
+    if (stubs::model.taiNow)
+        return stubs::model.taiNow();
+    return clock::monotonic::now() + stubs::taiOffset;
+}
+
+uint64_t clock::monotonic::now() {
+    if (stubs::model.monoNow)
+        return stubs::model.monoNow();
+    return stubs::monoNow;
+}
+
+uint32_t ntp::refId() {
+    return stubs::refId;
+}
+
+void ntp::requestSelect() {
+    ++stubs::selectRequests;
+}
+
+PllHoldover PLL_holdoverState() {
+    return stubs::holdover;
+}
+
+float PLL_holdoverError() {
+    return stubs::holdoverError;
+}
+
+float PLL_offsetRms() {
+    return stubs::offsetRms;
+}
+
+
+// -----------------------------------------------------------------------------
+// simulated scheduler ---------------------------------------------------------
+// -----------------------------------------------------------------------------
+
+void* runPeriodic(const uint32_t interval, const RunCall callback, void *ref) {
+    stubs::tasks.push_back({callback, ref, interval, false});
+    return reinterpret_cast<void*>(stubs::tasks.size());
+}
+
+void* runSleep(const uint32_t delay, const RunCall callback, void *ref) {
+    stubs::sleepers.push_back({callback, ref, delay, false});
+    return reinterpret_cast<void*>(stubs::sleepers.size());
+}
+
+void* runWait(const RunCall callback, void *) {
+    stubs::waitTask = callback;
+    return &stubs::waitTask;
+}
+
+void runAdjust(void *taskHandle, const uint32_t interval) {
+    const auto index = reinterpret_cast<size_t>(taskHandle);
+    if (index > 0 && index <= stubs::tasks.size())
+        stubs::tasks[index - 1].interval = interval;
+}
+
+void runDelay(void *taskHandle, const uint32_t delay) {
+    const auto index = reinterpret_cast<size_t>(taskHandle);
+    if (index > 0 && index <= stubs::sleepers.size()) {
+        stubs::sleepers[index - 1].interval = delay;
+        stubs::sleepers[index - 1].postponed = true;
+    }
+}
+
+void runWake(void *) {
+    stubs::waitWoken = true;
+}
+
+void runCancel(RunCall, const void *ref) {
+    for (auto &task : stubs::sleepers) {
+        if (task.ref == ref)
+            task.callback = nullptr;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// simulated record store ------------------------------------------------------
+// -----------------------------------------------------------------------------
+
+bool store::load(const int id, void *data, const int words) {
+    if (words != 1 || stubs::records.count(id) == 0)
+        return false;
+    memcpy(data, &stubs::records[id], 4);
+    return true;
+}
+
+bool store::save(const int id, const void *data, const int words) {
+    if (words != 1)
+        return false;
+    memcpy(&stubs::records[id], data, 4);
+    return true;
+}
@@ -0,0 +1,89 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "lib/net.hpp"
+#include "lib/run.hpp"
+#include "lib/ntp/pll.hpp"
+
+/**
+ * Host-side fakes of the hardware, clock, reference and scheduler interfaces used by the PTP tests.
+ * The default transmit model queues frames in txQueue and reports the timestamps in rxStamps and txStamps.
+ * Tests with a wire-level transmit model install their own hooks in stubs::model.
+ */
+namespace stubs {
+    // local interface
+    static constexpr uint8_t MY_MAC[6] = {0x02, 0x00, 0x00, 0x12, 0x34, 0x56};
+    static constexpr uint32_t MY_IP = 0x0A01A8C0u; // 192.168.1.10
+
+    struct TxFrame {
+        std::vector<uint8_t> data;
+        network::CallbackTx callback;
+        void *ref;
+    };
+
+    /**
+     * Scenario-specific simulation hooks (unset hooks use the default model)
+     */
+    struct Model {
+        bool (*transmit)(const uint8_t *frame, int size, network::CallbackTx callback, void *ref);
+        int (*txFree)();
+        void (*rxTime)(uint64_t *stamps);
+        void (*txTime)(uint64_t *stamps);
+        uint64_t (*taiNow)();
+        uint64_t (*monoNow)();
+    };
+    extern Model model;
+
+    // frames queued by the default transmit model
+    extern std::vector<TxFrame> txQueue;
+    // free transmit ring segments
+    extern int txFree;
+    // hardware timestamps of the received frame and of the completed transmission
+    extern uint64_t rxStamps[3];
+    extern uint64_t txStamps[3];
+    // monotonic time of the scheduler, TAI is offset from it (32.32)
+    extern uint64_t monoNow;
+    extern uint64_t taiOffset;
+
+    // reference state
+    extern uint32_t refId;
+    extern int selectRequests;
+    extern PllHoldover holdover;
+    extern float holdoverError;
+    extern float offsetRms;
+
+    /**
+     * Simulated scheduler task (tasks are invoked by the test)
+     */
+    struct Task {
+        RunCall callback;
+        void *ref;
+        uint32_t interval;
+        // the next execution was postponed by runDelay() (to interval)
+        bool postponed;
+    };
+    // periodic tasks in order of creation (handles are one-based indices)
+    extern std::vector<Task> tasks;
+    // sleeping tasks in order of creation
+    extern std::vector<Task> sleepers;
+    // waiting task and its wake-up flag
+    extern RunCall waitTask;
+    extern bool waitWoken;
+
+    // simulated record store
+    extern std::map<int, uint32_t> records;
+
+    /**
+     * Run the woken task and complete all frames queued by the default transmit model
+     * (callbacks may queue further frames)
+     * @return the completed frames
+     */
+    std::vector<TxFrame> drain();
+}
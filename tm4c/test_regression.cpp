@@ -0,0 +1,381 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+
+#include "lib/regression.hpp"
+
+static constexpr int WINDOW = 256;
+static constexpr int SAMPLES = 1 << 16;
+
+// reference two-pass fit (previous runCompensation implementation)
+void fitBatch(const float *ring, const int head, float &offset, float &slope, float &offsetVariance) {
+    static constexpr auto cc = static_cast<float>(WINDOW);
+    static constexpr auto xc_ = 0.5f * cc * (cc - 1.0f);
+    static constexpr auto xx_ = 2.0f * (cc - 0.5f) * xc_ / 3.0f;
+    static constexpr auto xc = xc_ / cc;
+    static constexpr auto xx = xx_ / cc;
+
+    float yc = 0, yx = 0;
+    for (int i = 0; i < WINDOW; ++i) {
+        const auto x = static_cast<float>(i);
+        const auto y = ring[(head - i) & (WINDOW - 1)];
+        yc += y;
+        yx += y * x;
+    }
+    yc /= cc;
+    yx /= cc;
+
+    slope = (yx - yc * xc) / (xx - xc * xc);
+    offset = yc - xc * slope;
+
+    float mse = 0;
+    for (int i = 0; i < WINDOW; ++i) {
+        const auto x = static_cast<float>(i);
+        const auto y = ring[(head - i) & (WINDOW - 1)];
+        const float error = y - offset - x * slope;
+        mse += error * error;
+    }
+    mse /= cc;
+    offsetVariance = mse / (xx - xc * xc) * xx;
+}
+
+// double precision reference fit
+void fitExact(const float *ring, const int head, double &offset, double &slope) {
+    double yc = 0, yx = 0, xc = 0, xx = 0;
+    for (int i = 0; i < WINDOW; ++i) {
+        const double y = ring[(head - i) & (WINDOW - 1)];
+        yc += y;
+        yx += y * i;
+        xc += i;
+        xx += static_cast<double>(i) * i;
+    }
+    yc /= WINDOW;
+    yx /= WINDOW;
+    xc /= WINDOW;
+    xx /= WINDOW;
+    slope = (yx - yc * xc) / (xx - xc * xc);
+    offset = yc - xc * slope;
+}
+
+// reference centered slope (previous capture implementation)
+float periodBatch(const uint32_t *ring, const int head) {
+    static constexpr int mid = (WINDOW - 1) / 2;
+    static constexpr auto cc_ = static_cast<float>(mid + 1);
+    static constexpr auto xc_ = 0.5f * cc_ * (cc_ - 1.0f);
+    static constexpr auto xx_ = 2.0f * (cc_ - 0.5f) * xc_ / 3.0f;
+
+    const auto pivot = head - mid;
+    const auto zero = ring[pivot & (WINDOW - 1)];
+    float yx = 0;
+    for (int i = -mid; i <= mid; ++i) {
+        const auto x = static_cast<float>(i);
+        const auto y = static_cast<float>(static_cast<int32_t>(zero - ring[(pivot - i) & (WINDOW - 1)]));
+        yx += y * x;
+    }
+    return yx / (2.0f * xx_);
+}
+
+// previous uncompensated weighted linear fit
+void fitNaive(int cnt, const float *x, const float *y, const float *w, float &offset, float &slope) {
+    float scratch[5] = {};
+    for (int i = 0; i < cnt; ++i) {
+        scratch[0] += w[i];
+        scratch[1] += w[i] * x[i];
+        scratch[2] += w[i] * x[i] * x[i];
+        scratch[3] += w[i] * y[i];
+        scratch[4] += w[i] * y[i] * x[i];
+    }
+    for (int i = 1; i < 5; ++i)
+        scratch[i] /= scratch[0];
+    slope = (scratch[4] - scratch[1] * scratch[3]) / (scratch[2] - scratch[1] * scratch[1]);
+    offset = scratch[3] - scratch[1] * slope;
+}
+
+// long double reference weighted linear fit
+void fitReference(int cnt, const float *x, const float *y, const float *w, long double &offset, long double &slope) {
+    long double sums[5] = {};
+    for (int i = 0; i < cnt; ++i) {
+        const long double xi = x[i], yi = y[i], wi = w[i];
+        sums[0] += wi;
+        sums[1] += wi * xi;
+        sums[2] += wi * xi * xi;
+        sums[3] += wi * yi;
+        sums[4] += wi * yi * xi;
+    }
+    for (int i = 1; i < 5; ++i)
+        sums[i] /= sums[0];
+    slope = (sums[4] - sums[1] * sums[3]) / (sums[2] - sums[1] * sums[1]);
+    offset = sums[3] - sums[1] * slope;
+}
+
+// previous Source::updateFilter() reweighting (one refit per sample weight update)
+void fitPerSample(int cnt, const float *x, const float *y, float *w, float &offset, float &slope) {
+    float offsetVar, slopeVar;
+    regression::fitLinear(cnt, x, y, w, offset, slope, offsetVar, slopeVar);
+    offsetVar += 1e-18f;
+    for (int i = 0; i < cnt; i++) {
+        const float error = y[i] - offset - x[i] * slope;
+        w[i] = offsetVar / (offsetVar + error * error);
+        regression::fitLinear(cnt, x, y, w, offset, slope, offsetVar, slopeVar);
+    }
+}
+
+float gauss() {
+    const float u = (static_cast<float>(rand()) + 1.0f) / (static_cast<float>(RAND_MAX) + 2.0f);
+    const float v = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    return sqrtf(-2.0f * logf(u)) * cosf(6.2831853f * v);
+}
+
+// layout of ntp::Source::Sample
+struct Sample {
+    uint64_t taiLocal;
+    uint64_t taiRemote;
+    float delay;
+};
+
+// memory and cycle report for a source history configuration
+template<int DEPTH>
+void reportHistory(const char *name) {
+    using clk = std::chrono::steady_clock;
+    static constexpr int TRIALS = 1 << 12;
+
+    static float xs[TRIALS][DEPTH], ys[TRIALS][DEPTH];
+    for (auto t = 0; t < TRIALS; ++t) {
+        for (int i = 0; i < DEPTH; ++i) {
+            xs[t][i] = 64.0f * static_cast<float>(i);
+            ys[t][i] = -1e-6f * xs[t][i] + 50e-6f * gauss();
+        }
+    }
+
+    float w[DEPTH], offset, slope, offsetVar, slopeVar, sink = 0;
+    auto start = clk::now();
+    for (int t = 0; t < TRIALS; ++t) {
+        for (auto &v : w) v = 1;
+        fitPerSample(DEPTH, xs[t], ys[t], w, offset, slope);
+        sink += offset;
+    }
+    const double costOld = std::chrono::duration<double, std::nano>(clk::now() - start).count() / TRIALS;
+
+    start = clk::now();
+    for (int t = 0; t < TRIALS; ++t) {
+        for (auto &v : w) v = 1;
+        regression::fitRobust(DEPTH, xs[t], ys[t], w, 3, 1e-18f, offset, slope, offsetVar, slopeVar);
+        sink += offset;
+    }
+    const double costNew = std::chrono::duration<double, std::nano>(clk::now() - start).count() / TRIALS;
+
+    fprintf(stdout, "history %s (%d samples): %d bytes per source, filter irls %.1f ns, per-sample %.1f ns\n",
+            name, DEPTH, static_cast<int>(DEPTH * sizeof(Sample)), costNew, costOld);
+    if (!std::isfinite(sink))
+        fprintf(stdout, "WARN: non-finite filter result\n");
+}
+
+int main(int argc, char **argv) {
+    using clk = std::chrono::steady_clock;
+    int failed = 0;
+
+    // synthetic temperature series (slow drift with measurement noise)
+    static float series[SAMPLES];
+    for (int i = 0; i < SAMPLES; ++i)
+        series[i] = 40.0f + 2.0f * sinf(static_cast<float>(i) * 1e-4f) + 0.01f * gauss();
+
+    // accuracy against the batch fit
+    {
+        static float ring[WINDOW];
+        regression::Window<WINDOW> window;
+        double errBatch = 0, errOffset = 0, errSlope = 0, errNoise = 0;
+        for (int i = 0; i < SAMPLES; ++i) {
+            ring[i & (WINDOW - 1)] = series[i];
+            window.push(series[i]);
+            if (i < WINDOW)
+                continue;
+
+            double o, s;
+            float o0, s0, v0, o1, s1, v1, sv;
+            fitExact(ring, i, o, s);
+            fitBatch(ring, i, o0, s0, v0);
+            window.fit(o1, s1, v1, sv);
+            errBatch = fmax(errBatch, fabs(o0 - o));
+            errOffset = fmax(errOffset, fabs(o1 - o));
+            errSlope = fmax(errSlope, fabs(s1 - s));
+            errNoise = fmax(errNoise, fabs(sqrt(v1) - sqrt(v0)));
+        }
+        fprintf(stdout, "window max error: offset %.3e C (batch %.3e C), slope %.3e C, noise %.3e C\n",
+                errOffset, errBatch, errSlope, errNoise);
+        if (errOffset > errBatch || errSlope > 1e-7 || errNoise > 1e-4) {
+            fprintf(stdout, "FAIL: window fit diverges from reference fit\n");
+            ++failed;
+        }
+    }
+
+    // accuracy of timer regression across counter wrap-around
+    {
+        static uint32_t ring[WINDOW];
+        regression::TimerWindow<WINDOW> window;
+        double errPeriod = 0;
+        double phase = 4294000000.0;
+        for (int i = 0; i < SAMPLES; ++i) {
+            phase += 96000.0 + 2.0 * gauss();
+            const auto raw = static_cast<uint32_t>(static_cast<uint64_t>(phase));
+            ring[i & (WINDOW - 1)] = raw;
+            window.push(raw);
+            if (i < WINDOW)
+                continue;
+
+            const float p0 = periodBatch(ring, i);
+            const float p1 = window.period();
+            errPeriod = fmax(errPeriod, fabs(p1 - p0) / p0);
+        }
+        fprintf(stdout, "timer max relative error: %.3e\n", errPeriod);
+        if (errPeriod > 1e-5) {
+            fprintf(stdout, "FAIL: timer period diverges from batch fit\n");
+            ++failed;
+        }
+    }
+
+    // robust peer filter against the per-sample reweighting filter
+    {
+        static constexpr int HISTORY = 16;
+        static constexpr int TRIALS = 1 << 14;
+        static constexpr float POLL = 16.0f;
+        static constexpr float DRIFT = 2e-6f;
+
+        static float xs[TRIALS][HISTORY], ys[TRIALS][HISTORY];
+        for (auto t = 0; t < TRIALS; ++t) {
+            for (int i = 0; i < HISTORY; ++i) {
+                // sample age, offset relative to newest sample, occasional queuing delay spikes
+                xs[t][i] = POLL * static_cast<float>(i);
+                float noise = 20e-6f * gauss();
+                if (rand() % 8 == 0)
+                    noise += 500e-6f * fabsf(gauss());
+                ys[t][i] = -DRIFT * xs[t][i] + noise;
+            }
+        }
+
+        double errOld[2] = {}, errNew[2] = {};
+        float w[HISTORY], offset, slope, offsetVar, slopeVar;
+        auto start = clk::now();
+        for (int t = 0; t < TRIALS; ++t) {
+            for (auto &v : w) v = 1;
+            fitPerSample(HISTORY, xs[t], ys[t], w, offset, slope);
+            errOld[0] += offset * offset;
+            errOld[1] += (slope + DRIFT) * (slope + DRIFT);
+        }
+        const double costOld = std::chrono::duration<double, std::nano>(clk::now() - start).count() / TRIALS;
+
+        start = clk::now();
+        for (int t = 0; t < TRIALS; ++t) {
+            for (auto &v : w) v = 1;
+            regression::fitRobust(HISTORY, xs[t], ys[t], w, 3, 1e-18f, offset, slope, offsetVar, slopeVar);
+            errNew[0] += offset * offset;
+            errNew[1] += (slope + DRIFT) * (slope + DRIFT);
+        }
+        const double costNew = std::chrono::duration<double, std::nano>(clk::now() - start).count() / TRIALS;
+
+        for (int i = 0; i < 2; ++i) {
+            errOld[i] = sqrt(errOld[i] / TRIALS);
+            errNew[i] = sqrt(errNew[i] / TRIALS);
+        }
+        fprintf(stdout, "peer filter rms error: offset %.3e s (per-sample %.3e s), drift %.3e (per-sample %.3e)\n",
+                errNew[0], errOld[0], errNew[1], errOld[1]);
+        fprintf(stdout, "peer filter cost: irls %.1f ns, per-sample %.1f ns (%.1fx)\n",
+                costNew, costOld, costOld / costNew);
+        if (errNew[0] > 1.1 * errOld[0] || errNew[1] > 1.1 * errOld[1]) {
+            fprintf(stdout, "FAIL: robust filter is less accurate than per-sample filter\n");
+            ++failed;
+        }
+    }
+
+    // compensated accumulation of small increments (PLL integral)
+    {
+        float naive = 20e-6f, accum = 20e-6f, residual = 0;
+        regression::Sum sum;
+        sum += 20e-6f;
+        long double exact = 20e-6f;
+        for (int i = 0; i < SAMPLES * 16; ++i) {
+            const float delta = 1e-13f * (1.0f + gauss());
+            naive += delta;
+            regression::accumulate(accum, residual, delta);
+            sum += delta;
+            exact += delta;
+        }
+        const auto errNaive = static_cast<double>(fabsl(naive - exact));
+        const auto errAccum = static_cast<double>(fabsl(accum - exact));
+        const auto errSum = static_cast<double>(fabsl(sum.value() - exact));
+        fprintf(stdout, "integral error: naive %.3e, accumulate %.3e, sum %.3e\n", errNaive, errAccum, errSum);
+        if (errAccum > 1e-12 || errSum > 1e-12) {
+            fprintf(stdout, "FAIL: compensated accumulation error too large\n");
+            ++failed;
+        }
+    }
+
+    // weighted linear fit precision (64 samples spanning 4096 seconds)
+    {
+        static constexpr int DEPTH = 64;
+        static constexpr int TRIALS = 1 << 12;
+        double errNaive = 0, errShift = 0;
+        float x[DEPTH], y[DEPTH], w[DEPTH];
+        for (int t = 0; t < TRIALS; ++t) {
+            const float bias = 1e-3f * gauss();
+            for (int i = 0; i < DEPTH; ++i) {
+                x[i] = 64.0f * static_cast<float>(i) + 0.5f * gauss();
+                y[i] = bias - 1e-7f * x[i] + 2e-9f * gauss();
+                w[i] = 0.5f + 0.5f * fabsf(gauss());
+            }
+            long double o, s;
+            float o0, s0, o1, s1, ov, sv;
+            fitReference(DEPTH, x, y, w, o, s);
+            fitNaive(DEPTH, x, y, w, o0, s0);
+            regression::fitLinear(DEPTH, x, y, w, o1, s1, ov, sv);
+            errNaive = fmax(errNaive, static_cast<double>(fabsl(o0 - o)));
+            errShift = fmax(errShift, static_cast<double>(fabsl(o1 - o)));
+        }
+        fprintf(stdout, "linear fit max offset error: naive %.3e s, compensated %.3e s\n", errNaive, errShift);
+        if (errShift * 8 > errNaive) {
+            fprintf(stdout, "FAIL: compensated linear fit error too large\n");
+            ++failed;
+        }
+    }
+
+    // source history configurations
+    reportHistory<16>("lan");
+    reportHistory<64>("wan");
+
+    // update cost
+    {
+        static float ring[WINDOW];
+        regression::Window<WINDOW> window;
+        float sink = 0, o, s, v, sv;
+
+        auto start = clk::now();
+        for (int i = 0; i < SAMPLES; ++i) {
+            ring[i & (WINDOW - 1)] = series[i];
+            fitBatch(ring, i, o, s, v);
+            sink += o;
+        }
+        const double batch = std::chrono::duration<double, std::nano>(clk::now() - start).count() / SAMPLES;
+
+        start = clk::now();
+        for (int i = 0; i < SAMPLES; ++i) {
+            window.push(series[i]);
+            if (window.size() < 2)
+                continue;
+            window.fit(o, s, v, sv);
+            sink += o;
+        }
+        const double sliding = std::chrono::duration<double, std::nano>(clk::now() - start).count() / SAMPLES;
+
+        fprintf(stdout, "update cost: batch %.1f ns, sliding %.1f ns (%.1fx)\n", batch, sliding, batch / sliding);
+        if (!std::isfinite(sink))
+            ++failed;
+    }
+
+    fflush(stdout);
+    return failed;
+}
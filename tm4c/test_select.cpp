@@ -0,0 +1,100 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "lib/ntp/select.hpp"
+
+using ntp::select::Candidate;
+
+static constexpr int TRIALS = 1 << 14;
+
+float gauss() {
+    const float u = (static_cast<float>(rand()) + 1.0f) / (static_cast<float>(RAND_MAX) + 2.0f);
+    const float v = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    return sqrtf(-2.0f * logf(u)) * cosf(6.2831853f * v);
+}
+
+// previous selection (lowest distance wins)
+int selectSingle(const Candidate *candidates, const int count) {
+    int best = 0;
+    for (int i = 1; i < count; ++i) {
+        if (candidates[i].distance < candidates[best].distance)
+            best = i;
+    }
+    return best;
+}
+
+/**
+ * Simulate a set of truechimers and falsetickers
+ * @param name scenario name
+ * @param truechimers number of truechimers
+ * @param falsetickers number of falsetickers
+ * @param prefer include a preferred reference among the truechimers
+ * @return number of failures
+ */
+int simulate(const char *name, const int truechimers, const int falsetickers, const bool prefer) {
+    const int count = truechimers + falsetickers;
+    double errSingle = 0, errCombined = 0;
+    int missed = 0, rejected = 0;
+
+    for (int t = 0; t < TRIALS; ++t) {
+        Candidate candidates[ntp::select::MAX_CANDIDATES];
+        for (int i = 0; i < count; ++i) {
+            auto &cand = candidates[i];
+            if (i < truechimers) {
+                // WAN peers with 100-300 us jitter (or a 50 ns reference)
+                const bool ref = prefer && i == 0;
+                const float jitter = ref ? 50e-9f : 100e-6f * (1.0f + 0.5f * static_cast<float>(i));
+                cand.offset = jitter * gauss();
+                cand.jitter = jitter;
+                cand.distance = 3.0f * jitter;
+                cand.prefer = ref;
+            }
+            else {
+                // falsetickers with a 5 ms bias and optimistic distance
+                cand.offset = 5e-3f + 20e-6f * gauss();
+                cand.jitter = 20e-6f;
+                cand.distance = 100e-6f;
+                cand.prefer = false;
+            }
+        }
+
+        const int single = selectSingle(candidates, count);
+        errSingle += candidates[single].offset * candidates[single].offset;
+
+        float offset, jitter;
+        if (ntp::select::run(candidates, count, offset, jitter) < 0) {
+            ++missed;
+            continue;
+        }
+        errCombined += offset * offset;
+        for (int i = truechimers; i < count; ++i)
+            rejected += candidates[i].status == ntp::select::STATUS_FALSETICKER;
+    }
+
+    errSingle = sqrt(errSingle / TRIALS);
+    errCombined = sqrt(errCombined / (TRIALS - missed));
+    fprintf(stdout, "%s: rms error single %.3e s, combined %.3e s, falsetickers rejected %.1f%%, no clique %d\n",
+            name, errSingle, errCombined,
+            falsetickers ? 100.0 * rejected / (falsetickers * (TRIALS - missed)) : 100.0, missed);
+
+    if (errCombined > errSingle || missed * 10 > TRIALS) {
+        fprintf(stdout, "FAIL: %s\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int failed = 0;
+    failed += simulate("truechimers only", 5, 0, false);
+    failed += simulate("one falseticker", 4, 1, false);
+    failed += simulate("two falsetickers", 5, 2, false);
+    failed += simulate("reference with falseticker", 3, 1, true);
+    fflush(stdout);
+    return failed;
+}
@@ -0,0 +1,539 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "test_ptp_stubs.hpp"
+
+#include "lib/clock/tai.hpp"
+#include "lib/clock/util.hpp"
+#include "lib/net/ip.hpp"
+#include "lib/net/udp.hpp"
+#include "lib/net/util.hpp"
+#include "lib/ntp/PTP.hpp"
+#include "lib/ptp/bmca.hpp"
+#include "lib/ptp/common.hpp"
+#include "lib/ptp/profile.hpp"
+#include "lib/ptp/ptp.hpp"
+
+void PTP_process(uint8_t *frame, int size);
+
+using stubs::MY_MAC;
+using stubs::MY_IP;
+using stubs::monoNow;
+using stubs::rxStamps;
+using stubs::selectRequests;
+using stubs::sleepers;
+using stubs::tasks;
+using stubs::txQueue;
+using stubs::txStamps;
+
+// task handles in order of creation
+static constexpr int TASK_BMCA = 1;
+
+// placement storage for the slave (as in ntp::init())
+static char rawPtp[sizeof(ntp::PTP)] [[gnu::aligned(8)]];
+
+/**
+ * Read-only view of the filter state of the slave source
+ */
+struct View {
+    ntp::PTP *source;
+
+    [[nodiscard]]
+    double offset() const {
+        return 0x1p-32 * static_cast<double>(source->getFilteredOffset());
+    }
+
+    [[nodiscard]]
+    RPY_Source_Data data() const {
+        RPY_Source_Data data = {};
+        source->getSourceData(data);
+        return data;
+    }
+};
+
+// (re)create the slave source
+static View createSlave() {
+    auto slave = reinterpret_cast<ntp::PTP*>(rawPtp);
+    if (slave->isAllocated())
+        slave->~PTP();
+    return {new(slave) ntp::PTP()};
+}
+
+// run the delay request task of the slave
+static void tickSlave() {
+    for (const auto &task : sleepers) {
+        if (task.callback != nullptr)
+            task.callback(task.ref);
+    }
+}
+
+// EUI-64 port identity from a MAC address
+static void toIdentity(const uint8_t *mac, uint8_t *identity) {
+    memcpy(identity, mac, 3);
+    identity[3] = 0xFF;
+    identity[4] = 0xFE;
+    memcpy(identity + 5, mac + 3, 3);
+}
+
+static int fail(const char *name, const char *what, const double value, const double expected) {
+    fprintf(stdout, "FAIL: %s: %s %.9g (expected %.9g)\n", name, what, value, expected);
+    return 1;
+}
+
+
+// -----------------------------------------------------------------------------
+// replay of recorded master traffic -------------------------------------------
+// -----------------------------------------------------------------------------
+
+enum EventType {
+    // frame received from the master at the local hardware time
+    EV_RX,
+    // delay request task runs at the local time
+    EV_TICK,
+    // delay request transmitted at the local hardware time (frame is the expected request)
+    EV_TX
+};
+
+struct TraceEvent {
+    EventType type;
+    uint32_t seconds;
+    uint32_t nanos;
+    const char *frame;
+};
+
+/**
+ * Two-step layer-2 master (domain 1, 1 Hz announce and sync) with a transparent clock on the path.
+ * The local clock leads the master by 1500 ns, the path delay is 2800 ns in each direction and the transparent clock
+ * reports 812 ns of sync and 437 ns of delay request residence time.
+ */
+static const TraceEvent TRACE[] = {
+    {EV_RX, 1700000037u, 14300u, "011b19000000001b218a3c1088f70b0200400100003c000000000000000000000000001b21fffe8a3c10000100000500000000000000000000000025008006214e5d80001b21fffe8a3c10000020"},
+    {EV_RX, 1700000037u, 125005112u, "011b19000000001b218a3c1088f70002002c0100020000000000032c000000000000001b21fffe8a3c1000010000000000000000000000000000"},
+    {EV_RX, 1700000037u, 125054300u, "011b19000000001b218a3c1088f70802002c01000000000000000000000000000000001b21fffe8a3c1000010000020000006553f12507735940"},
+    {EV_RX, 1700000038u, 14300u, "011b19000000001b218a3c1088f70b0200400100003c000000000000000000000000001b21fffe8a3c10000100010500000000000000000000000025008006214e5d80001b21fffe8a3c10000020"},
+    {EV_RX, 1700000038u, 125005112u, "011b19000000001b218a3c1088f70002002c0100020000000000032c000000000000001b21fffe8a3c1000010001000000000000000000000000"},
+    {EV_RX, 1700000038u, 125054300u, "011b19000000001b218a3c1088f70802002c01000000000000000000000000000000001b21fffe8a3c1000010001020000006553f12607735940"},
+    {EV_TICK, 1700000038u, 500001500u, ""},
+    {EV_TX, 1700000038u, 500021500u, "011b1900000002000012345688f70102002c01000000000000000000000000000000000002000012345600010001017f00000000000000000000"},
+    {EV_RX, 1700000038u, 500057537u, "011b19000000001b218a3c1088f709020036010000000000000001b5000000000000001b21fffe8a3c1000010001030000006553f1261dcdbfc500000200001234560001"},
+    {EV_RX, 1700000039u, 14300u, "011b19000000001b218a3c1088f70b0200400100003c000000000000000000000000001b21fffe8a3c10000100020500000000000000000000000025008006214e5d80001b21fffe8a3c10000020"},
+    {EV_RX, 1700000039u, 125005112u, "011b19000000001b218a3c1088f70002002c0100020000000000032c000000000000001b21fffe8a3c1000010002000000000000000000000000"},
+    {EV_RX, 1700000039u, 125054300u, "011b19000000001b218a3c1088f70802002c01000000000000000000000000000000001b21fffe8a3c1000010002020000006553f12707735940"},
+    {EV_TICK, 1700000039u, 500001500u, ""},
+    {EV_TX, 1700000039u, 500021500u, "011b1900000002000012345688f70102002c01000000000000000000000000000000000002000012345600010002017f00000000000000000000"},
+    {EV_RX, 1700000039u, 500057537u, "011b19000000001b218a3c1088f709020036010000000000000001b5000000000000001b21fffe8a3c1000010002030000006553f1271dcdbfc500000200001234560001"},
+    {EV_RX, 1700000040u, 14300u, "011b19000000001b218a3c1088f70b0200400100003c000000000000000000000000001b21fffe8a3c10000100030500000000000000000000000025008006214e5d80001b21fffe8a3c10000020"},
+    {EV_RX, 1700000040u, 125005112u, "011b19000000001b218a3c1088f70002002c0100020000000000032c000000000000001b21fffe8a3c1000010003000000000000000000000000"},
+    {EV_RX, 1700000040u, 125054300u, "011b19000000001b218a3c1088f70802002c01000000000000000000000000000000001b21fffe8a3c1000010003020000006553f12807735940"},
+    {EV_TICK, 1700000040u, 500001500u, ""},
+    {EV_TX, 1700000040u, 500021500u, "011b1900000002000012345688f70102002c01000000000000000000000000000000000002000012345600010003017f00000000000000000000"},
+    {EV_RX, 1700000040u, 500057537u, "011b19000000001b218a3c1088f709020036010000000000000001b5000000000000001b21fffe8a3c1000010003030000006553f1281dcdbfc500000200001234560001"},
+    {EV_RX, 1700000041u, 14300u, "011b19000000001b218a3c1088f70b0200400100003c000000000000000000000000001b21fffe8a3c10000100040500000000000000000000000025008006214e5d80001b21fffe8a3c10000020"},
+    {EV_RX, 1700000041u, 125005112u, "011b19000000001b218a3c1088f70002002c0100020000000000032c000000000000001b21fffe8a3c1000010004000000000000000000000000"},
+    {EV_RX, 1700000041u, 125054300u, "011b19000000001b218a3c1088f70802002c01000000000000000000000000000000001b21fffe8a3c1000010004020000006553f12907735940"},
+    {EV_TICK, 1700000041u, 500001500u, ""},
+    {EV_TX, 1700000041u, 500021500u, "011b1900000002000012345688f70102002c01000000000000000000000000000000000002000012345600010004017f00000000000000000000"},
+    {EV_RX, 1700000041u, 500057537u, "011b19000000001b218a3c1088f709020036010000000000000001b5000000000000001b21fffe8a3c1000010004030000006553f1291dcdbfc500000200001234560001"},
+    {EV_RX, 1700000042u, 14300u, "011b19000000001b218a3c1088f70b0200400100003c000000000000000000000000001b21fffe8a3c10000100050500000000000000000000000025008006214e5d80001b21fffe8a3c10000020"},
+    {EV_RX, 1700000042u, 125005112u, "011b19000000001b218a3c1088f70002002c0100020000000000032c000000000000001b21fffe8a3c1000010005000000000000000000000000"},
+    {EV_RX, 1700000042u, 125054300u, "011b19000000001b218a3c1088f70802002c01000000000000000000000000000000001b21fffe8a3c1000010005020000006553f12a07735940"},
+    {EV_TICK, 1700000042u, 500001500u, ""},
+    {EV_TX, 1700000042u, 500021500u, "011b1900000002000012345688f70102002c01000000000000000000000000000000000002000012345600010005017f00000000000000000000"},
+    {EV_RX, 1700000042u, 500057537u, "011b19000000001b218a3c1088f709020036010000000000000001b5000000000000001b21fffe8a3c1000010005030000006553f12a1dcdbfc500000200001234560001"},
+};
+
+static std::vector<uint8_t> fromHex(const char *hex) {
+    std::vector<uint8_t> data;
+    for (; hex[0] && hex[1]; hex += 2) {
+        unsigned byte;
+        sscanf(hex, "%2x", &byte);
+        data.push_back(byte);
+    }
+    return data;
+}
+
+static uint64_t toStamp(const uint32_t seconds, const uint32_t nanos) {
+    fixed_32_32 scratch = {};
+    scratch.ipart = seconds;
+    scratch.fpart = nanosToFrac(nanos);
+    return scratch.full;
+}
+
+static int replayTrace() {
+    const char *name = "replay";
+    int failed = 0;
+    const auto slave = createSlave();
+
+    int requests = 0;
+    for (const auto &event : TRACE) {
+        const uint64_t stamp = toStamp(event.seconds, event.nanos);
+        monoNow = stamp;
+        if (event.type == EV_TICK) {
+            tickSlave();
+            continue;
+        }
+        auto frame = fromHex(event.frame);
+        if (event.type == EV_RX) {
+            rxStamps[0] = rxStamps[1] = rxStamps[2] = stamp;
+            PTP_process(frame.data(), static_cast<int>(frame.size()));
+            continue;
+        }
+
+        // compare the delay request with the recorded request (the source MAC is inserted by the hardware and the
+        // origin timestamp is approximate)
+        ++requests;
+        if (txQueue.size() != 1) {
+            fprintf(stdout, "FAIL: %s: %d requests queued at %u s\n", name, static_cast<int>(txQueue.size()), event.seconds);
+            failed = 1;
+            txQueue.clear();
+            continue;
+        }
+        auto sent = txQueue.front();
+        txQueue.clear();
+        auto &data = sent.data;
+        if (data.size() == frame.size()) {
+            memcpy(data.data() + 6, frame.data() + 6, 6);
+            memset(data.data() + 14 + 34, 0, 10);
+        }
+        if (data != frame) {
+            fprintf(stdout, "FAIL: %s: delay request %d differs from the recording\n", name, requests);
+            failed = 1;
+        }
+        txStamps[0] = txStamps[1] = txStamps[2] = stamp;
+        if (sent.callback)
+            sent.callback(sent.ref, data.data(), static_cast<int>(data.size()));
+    }
+
+    const auto state = ptp::bmca::getState();
+    if (state != PTP2_PS_PASSIVE)
+        failed += fail(name, "port state", state, PTP2_PS_PASSIVE);
+    if (requests != 5)
+        failed += fail(name, "delay requests", requests, 5);
+    if (fabs(slave.offset() + 1500e-9) > 1e-9)
+        failed += fail(name, "offset", slave.offset(), -1500e-9);
+    if (fabs(slave.source->getDelayMean() - 2800e-9) > 1e-9)
+        failed += fail(name, "path delay", slave.source->getDelayMean(), 2800e-9);
+    const auto data = slave.data();
+    if (htons(data.mode) != RPY_SD_MD_REF || data.ip_addr.addr.in4 != ntp::PTP::REF_ID)
+        failed += fail(name, "chronyc mode", htons(data.mode), RPY_SD_MD_REF);
+    if (htons(data.reachability) != 0x1F)
+        failed += fail(name, "reach", htons(data.reachability), 0x1F);
+
+    if (!failed)
+        fprintf(stdout, "PASS: %s (%d samples)\n", name, requests);
+    return failed;
+}
+
+
+// -----------------------------------------------------------------------------
+// synthetic master ------------------------------------------------------------
+// -----------------------------------------------------------------------------
+
+// origin of the simulated time scale (TAI)
+static constexpr uint64_t EPOCH = 1800000000ull << 32;
+// offset of the local clock from true time (seconds)
+static constexpr double LOCAL_OFFSET = 2.5e-6;
+
+static uint64_t toFixed(const double seconds) {
+    return EPOCH + static_cast<int64_t>(std::ldexp(seconds, 32));
+}
+
+static double gauss() {
+    const double u = (static_cast<double>(rand()) + 1.0) / (static_cast<double>(RAND_MAX) + 2.0);
+    const double v = static_cast<double>(rand()) / static_cast<double>(RAND_MAX);
+    return sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v);
+}
+
+/**
+ * Layer-2 master with a simulated path to the slave
+ */
+struct Master {
+    uint8_t mac[6];
+    uint8_t clockClass;
+    bool oneStep;
+    // PTP timescale (false for an arbitrary timescale)
+    bool timescale;
+    // offset of the master clock from true time (seconds)
+    double error;
+    // one-way path delays (seconds)
+    double delayToSlave;
+    double delayToMaster;
+    // transparent clock residence times (seconds)
+    double residenceSync;
+    double residenceDelay;
+    // timestamp noise (seconds rms)
+    double jitter;
+
+    uint16_t seqAnnounce;
+    uint16_t seqSync;
+    uint16_t requests;
+
+    void header(HEADER_PTP &header, const PTP2_MTYPE type, const int size) const {
+        initPtpHeader(header, type, size, 0);
+        toIdentity(mac, header.sourceIdentity.identity);
+    }
+
+    // deliver a message received at a true time
+    void deliver(const void *message, const int size, const double time) const {
+        std::vector<uint8_t> frame(14 + size);
+        memcpy(frame.data(), ptpMac, 6);
+        memcpy(frame.data() + 6, mac, 6);
+        frame[12] = 0x88;
+        frame[13] = 0xF7;
+        memcpy(frame.data() + 14, message, size);
+        monoNow = toFixed(time);
+        rxStamps[0] = monoNow;
+        rxStamps[1] = rxStamps[2] = toFixed(time + LOCAL_OFFSET);
+        PTP_process(frame.data(), static_cast<int>(frame.size()));
+    }
+
+    void announce(const double time) {
+        MessagePTP<PTP2_ANNOUNCE> msg = {};
+        header(msg.ptp, PTP2_MT_ANNOUNCE, sizeof(msg));
+        msg.ptp.sequenceId = htons(seqAnnounce++);
+        uint16_t flags = PTP2_FLAG_UTC_VALID | PTP2_FLAG_TIME_TRACEABLE | PTP2_FLAG_FREQ_TRACEABLE;
+        if (timescale)
+            flags |= PTP2_FLAG_PTP_TIMESCALE;
+        msg.ptp.flags = htons(flags);
+        msg.data.currentUtcOffset = htons(37);
+        msg.data.grandMasterPriority = 128;
+        msg.data.grandMasterClockQuality.clockClass = clockClass;
+        msg.data.grandMasterClockQuality.clockAccuracy = 0x21;
+        msg.data.grandMasterClockQuality.offsetScaledLogVariance = htons(0x4E5D);
+        msg.data.grandMasterPriority2 = 128;
+        toIdentity(mac, msg.data.grandMasterIdentity);
+        msg.data.timeSource = PTP2_TSRC_GPS;
+        deliver(&msg, sizeof(msg), time + delayToSlave);
+    }
+
+    void sync(const double time) {
+        MessagePTP<PTP2_TIMESTAMP> msg = {};
+        header(msg.ptp, PTP2_MT_SYNC, sizeof(msg));
+        msg.ptp.sequenceId = htons(seqSync);
+        msg.ptp.correctionField = htonll(static_cast<uint64_t>(llround(residenceSync * 0x1p16 * 1e9)));
+        const double arrival = time + delayToSlave + residenceSync + jitter * gauss();
+        if (oneStep) {
+            toPtpTimestamp(toFixed(time + error), &msg.data);
+            deliver(&msg, sizeof(msg), arrival);
+        }
+        else {
+            msg.ptp.flags = htons(PTP2_FLAG_TWO_STEP);
+            toPtpTimestamp(toFixed(time + error - 25e-6), &msg.data);
+            deliver(&msg, sizeof(msg), arrival);
+
+            MessagePTP<PTP2_TIMESTAMP> followup = {};
+            header(followup.ptp, PTP2_MT_FOLLOW_UP, sizeof(followup));
+            followup.ptp.sequenceId = htons(seqSync);
+            toPtpTimestamp(toFixed(time + error), &followup.data);
+            deliver(&followup, sizeof(followup), arrival + 50e-6);
+        }
+        ++seqSync;
+    }
+
+    /**
+     * Complete pending transmissions and answer delay requests
+     * @param time departure time of the requests
+     * @param other also answer with a response for another slave
+     */
+    void respond(const double time, const bool other = false) {
+        auto queue = std::move(txQueue);
+        txQueue.clear();
+        for (auto &sent : queue) {
+            ptp::Address src, dst;
+            const int offset = ptp::transport::parse(sent.data.data(), static_cast<int>(sent.data.size()), src, dst);
+            if (offset < 0)
+                continue;
+            const auto &request = MessagePTP<PTP2_TIMESTAMP>::from(sent.data.data() + offset);
+            if (request.ptp.messageType != PTP2_MT_DELAY_REQ)
+                continue;
+            ++requests;
+
+            // hardware transmit time of the request
+            const double departure = time + 0.01 + 20e-6;
+            const double local = departure + LOCAL_OFFSET + jitter * gauss();
+            txStamps[0] = toFixed(departure);
+            txStamps[1] = txStamps[2] = toFixed(local);
+            if (sent.callback)
+                sent.callback(sent.ref, sent.data.data(), static_cast<int>(sent.data.size()));
+
+            MessagePTP<PTP2_DELAY_RESP> response = {};
+            header(response.ptp, PTP2_MT_DELAY_RESP, sizeof(response));
+            response.ptp.sequenceId = request.ptp.sequenceId;
+            response.ptp.correctionField = htonll(static_cast<uint64_t>(llround(residenceDelay * 0x1p16 * 1e9)));
+            const double arrival = departure + delayToMaster + residenceDelay;
+            toPtpTimestamp(toFixed(arrival + error + jitter * gauss()), &response.data.receiveTimestamp);
+
+            // a response to another slave with the same sequence number must be ignored
+            if (other) {
+                auto decoy = response;
+                toIdentity(mac, decoy.data.requestingIdentity.identity);
+                decoy.data.requestingIdentity.portNumber = htons(1);
+                toPtpTimestamp(toFixed(arrival + error + 1e-3), &decoy.data.receiveTimestamp);
+                deliver(&decoy, sizeof(decoy), arrival + delayToSlave);
+            }
+
+            response.data.requestingIdentity = request.ptp.sourceIdentity;
+            deliver(&response, sizeof(response), arrival + delayToSlave);
+        }
+    }
+};
+
+/**
+ * Run masters and the slave for a span of time
+ * @param clock simulated true time
+ * @param seconds duration
+ * @param masters active masters (announce at 1 Hz, sync at 16 Hz)
+ * @param count number of active masters
+ * @param other answer with responses for another slave
+ */
+static void simulate(double &clock, const int seconds, Master **masters, const int count, const bool other = false) {
+    for (int s = 0; s < seconds; ++s) {
+        for (int k = 0; k < 16; ++k) {
+            const double time = clock + k / 16.0;
+            monoNow = toFixed(time);
+            tasks[TASK_BMCA].callback(nullptr);
+            for (int i = 0; i < count; ++i) {
+                if (k == 0)
+                    masters[i]->announce(time + 0.001);
+                masters[i]->sync(time + 0.002);
+            }
+            if (k == 8) {
+                monoNow = toFixed(time + 0.01);
+                tickSlave();
+                if (count > 0)
+                    masters[0]->respond(time, other);
+                txQueue.clear();
+            }
+        }
+        clock += 1;
+    }
+}
+
+static int testSynthetic(double &clock) {
+    int failed = 0;
+    const auto slave = createSlave();
+
+    // two-step grandmaster behind a transparent clock
+    Master gm = {{0x00, 0x1B, 0x21, 0x00, 0x00, 0x01}, 6, false, true, 0, 5e-6, 5e-6, 1.2e-6, 0.7e-6, 20e-9};
+    // a worse master in the same domain with a wildly different time
+    Master rogue = {{0x00, 0x1B, 0x21, 0x00, 0x00, 0x02}, 248, false, true, 0.25, 5e-6, 5e-6, 0, 0, 0};
+    Master *both[] = {&gm, &rogue};
+    simulate(clock, 40, both, 2, true);
+
+    const char *name = "two-step";
+    if (ptp::bmca::getState() != PTP2_PS_PASSIVE)
+        failed += fail(name, "port state", ptp::bmca::getState(), PTP2_PS_PASSIVE);
+    if (!slave.source->isSelectable())
+        failed += fail(name, "selectable", 0, 1);
+    if (fabs(slave.offset() + LOCAL_OFFSET) > 60e-9)
+        failed += fail(name, "offset", slave.offset(), -LOCAL_OFFSET);
+    if (fabs(slave.source->getDelayMean() - 5e-6) > 20e-9)
+        failed += fail(name, "path delay", slave.source->getDelayMean(), 5e-6);
+    if (slave.source->getJitter() > 60e-9)
+        failed += fail(name, "jitter", slave.source->getJitter(), 20e-9);
+    if (slave.source->getStratum() != 0)
+        failed += fail(name, "stratum", slave.source->getStratum(), 0);
+    auto data = slave.data();
+    if (htons(data.reachability) != 0xFF || htons(data.state) != RPY_SD_ST_SELECTABLE)
+        failed += fail(name, "chronyc reach", htons(data.reachability), 0xFF);
+    if (gm.requests < 38)
+        failed += fail(name, "delay requests", gm.requests, 39);
+    if (!failed)
+        fprintf(stdout, "PASS: %s (offset %.1f ns, delay %.1f ns)\n", name, 1e9 * slave.offset(), 1e9 * slave.source->getDelayMean());
+
+    // source selection picks the slave: the port reports SLAVE and adopts the UTC offset
+    name = "selected";
+    int before = failed;
+    const int requests = selectRequests;
+    stubs::refId = ntp::PTP::REF_ID;
+    simulate(clock, 2, both, 2);
+    if (ptp::bmca::getState() != PTP2_PS_SLAVE)
+        failed += fail(name, "port state", ptp::bmca::getState(), PTP2_PS_SLAVE);
+    if (clkTaiUtcOffset != 37ull << 32)
+        failed += fail(name, "TAI offset", static_cast<double>(clkTaiUtcOffset >> 32), 37);
+    if (selectRequests - requests != 2)
+        failed += fail(name, "selection requests", selectRequests - requests, 2);
+    ptp::bmca::DataSet local;
+    ptp::bmca::getLocal(local);
+    if (local.timeSource != PTP2_TSRC_PTP)
+        failed += fail(name, "time source", local.timeSource, PTP2_TSRC_PTP);
+    if (failed == before)
+        fprintf(stdout, "PASS: %s\n", name);
+
+    // the grandmaster fails over to a one-step master on an asymmetric path
+    name = "failover";
+    before = failed;
+    Master backup = {{0x00, 0x1B, 0x21, 0x00, 0x00, 0x03}, 7, true, true, 0, 3e-6, 7e-6, 0, 0, 0};
+    Master *next[] = {&backup};
+    simulate(clock, 8, next, 1);
+    ptp::bmca::DataSet parent;
+    ptp::Address addr;
+    uint8_t identity[8];
+    toIdentity(backup.mac, identity);
+    if (!ptp::bmca::getParent(parent, addr) || memcmp(parent.identity, identity, 8) != 0)
+        failed += fail(name, "parent", 0, 1);
+    // asymmetry biases the offset by half the difference of the path delays
+    if (fabs(slave.offset() + LOCAL_OFFSET - 2e-6) > 2e-9)
+        failed += fail(name, "offset", slave.offset(), 2e-6 - LOCAL_OFFSET);
+    if (slave.source->getStratum() != 0)
+        failed += fail(name, "stratum", slave.source->getStratum(), 0);
+    if (failed == before)
+        fprintf(stdout, "PASS: %s (offset %.1f ns)\n", name, 1e9 * slave.offset());
+
+    // loss of all masters: no further requests and the source becomes unselectable
+    name = "loss";
+    before = failed;
+    stubs::refId = 0;
+    simulate(clock, 20, nullptr, 0);
+    if (ptp::bmca::getState() != PTP2_PS_MASTER)
+        failed += fail(name, "port state", ptp::bmca::getState(), PTP2_PS_MASTER);
+    if (slave.source->isSelectable())
+        failed += fail(name, "selectable", 1, 0);
+    data = slave.data();
+    if (htons(data.reachability) != 0)
+        failed += fail(name, "reach", htons(data.reachability), 0);
+    if (failed == before)
+        fprintf(stdout, "PASS: %s\n", name);
+
+    // a master on an arbitrary timescale is followed but never sampled
+    name = "arbitrary timescale";
+    before = failed;
+    Master arb = {{0x00, 0x1B, 0x21, 0x00, 0x00, 0x04}, 6, false, false, 0, 5e-6, 5e-6, 0, 0, 0};
+    Master *only[] = {&arb};
+    simulate(clock, 6, only, 1);
+    if (ptp::bmca::getState() != PTP2_PS_PASSIVE)
+        failed += fail(name, "port state", ptp::bmca::getState(), PTP2_PS_PASSIVE);
+    if (arb.requests != 0)
+        failed += fail(name, "delay requests", arb.requests, 0);
+    if (failed == before)
+        fprintf(stdout, "PASS: %s\n", name);
+    return failed;
+}
+
+int main() {
+    int failed = 0;
+    ipAddress = MY_IP;
+    // no reference is selected and the TAI offset is learned from the master
+    stubs::refId = 0;
+    stubs::offsetRms = 0;
+    clkTaiUtcOffset = 36ull << 32;
+    ptp::init();
+
+    failed |= replayTrace();
+
+    // restart master selection and the slave
+    ptp::bmca::reset();
+    double clock = 0;
+    failed |= testSynthetic(clock);
+
+    fprintf(stdout, failed ? "FAILED\n" : "PASSED\n");
+    return failed;
+}
@@ -8,7 +8,28 @@
 #include <cstdlib>
 #include <cstring>
 
-float som[16][3] = {
+#include "lib/regression.hpp"
+#include "lib/ntp/tmodel.hpp"
+
+#define SOM_NODE_DIM (3)
+#define SOM_NODE_CNT (16)
+#define SOM_FILL_OFF (0.2f)
+#define SOM_FILL_REG (4.0f)
+#define SOM_RATE (0x1p-12f)
+#define SOM_PRIOR (16.0f)
+
+// replay duration (four days at one sample per second)
+static constexpr int REPLAY_LENGTH = 4 * 86400;
+// replay temperature cycle period (seconds)
+static constexpr float REPLAY_PERIOD = 86400;
+// replay measurement noise (ppm)
+static constexpr float REPLAY_NOISE = 0.005f;
+// replay outlier rate and magnitude (ppm)
+static constexpr float REPLAY_OUTLIER_RATE = 0.01f;
+static constexpr float REPLAY_OUTLIER = 1.0f;
+
+// SOM dump from the "som" status command (temperature C, compensation ppm, fill)
+float som[SOM_NODE_CNT][SOM_NODE_DIM] = {
         38.1113888, -172.392272, 0.999986816,
         38.60752, -172.171296, 0.999984256,
         38.8272064, -172.07312, 0.99997312,
@@ -27,124 +48,310 @@ float som[16][3] = {
         45.9950176, -169.162288, 0.999999232
 };
 
-void fitQuadratic(const float * const data, const int cnt, float *coef) {
-    // compute equation matrix
-    float xx[3][4] = {0};
-    for (int i = 0; i < cnt; i++) {
-        auto row = data + (i * 3);
-        const float w = row[2];
-        const float x = row[0];
-        const float y = row[1];
-
-        // constant terms
-        xx[2][2] += w;
-        xx[2][3] += w * y;
-
-        // linear terms
-        float z = x;
-        xx[1][2] += w * z;
-        xx[1][3] += w * z * y;
-
-        // quadratic terms
-        z *= x;
-        xx[0][2] += w * z;
-        xx[0][3] += w * z * y;
-
-        // cubic terms
-        z *= x;
-        xx[0][1] += w * z;
-
-        // quartic terms
-        z *= x;
-        xx[0][0] += w * z;
-    }
-    // employ matrix symmetry
-    xx[1][0] = xx[0][1];
-    xx[1][1] = xx[0][2];
-    xx[2][0] = xx[0][2];
-    xx[2][1] = xx[1][2];
-
-    // row-echelon reduction
-    if(xx[1][0] != 0) {
-        const float f = xx[1][0] / xx[0][0];
-        xx[1][1] -= f * xx[0][1];
-        xx[1][2] -= f * xx[0][2];
-        xx[1][3] -= f * xx[0][3];
-    }
-
-    // row-echelon reduction
-    {
-        const float f = xx[2][0] / xx[0][0];
-        xx[2][1] -= f * xx[0][1];
-        xx[2][2] -= f * xx[0][2];
-        xx[2][3] -= f * xx[0][3];
-    }
-
-    // row-echelon reduction
-    if(xx[2][1] != 0) {
-        const float f = xx[2][1] / xx[1][1];
-        xx[2][2] -= f * xx[1][2];
-        xx[2][3] -= f * xx[1][3];
-    }
-
-    // compute coefficients
-    coef[0] = xx[2][3] / xx[2][2];
-    coef[1] = (xx[1][3] - xx[1][2] * coef[0]) / xx[1][1];
-    coef[2] = (xx[0][3] - xx[0][2] * coef[0] - xx[0][1] * coef[1]) / xx[0][0];
+float gauss() {
+    const float u = (static_cast<float>(rand()) + 1.0f) / (static_cast<float>(RAND_MAX) + 2.0f);
+    const float v = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    return sqrtf(-2.0f * logf(u)) * cosf(6.2831853f * v);
 }
 
-int main(int argc, char **argv) {
-    float scratch[sizeof(som) / sizeof(float)];
-    memcpy(scratch, som, sizeof(som));
-
-    float coef[3];
-    fitQuadratic(scratch, 16, coef);
-    float rmse = 0, norm = 0;
-    for(auto &row : som) {
-        float x = row[0];
-        float y = coef[0];
-        y += x * coef[1];
-        y += x * x * coef[2];
-        y -= row[1];
-        rmse += y * y * row[2];
-        norm += row[2];
+float uniform() {
+    return static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+}
+
+/**
+ * Load a SOM dump captured from the "som" status command
+ * @param path file path
+ * @return true if all node values were loaded
+ */
+bool loadDump(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr)
+        return false;
+    static char text[4096];
+    text[fread(text, 1, sizeof(text) - 1, file)] = 0;
+    fclose(file);
+
+    const char *ptr = strchr(text, '{');
+    if (ptr == nullptr)
+        return false;
+    for (auto &value : som[0]) {
+        while (*ptr != 0 && strchr("{}, \t\r\n", *ptr) != nullptr)
+            ++ptr;
+        char *end;
+        value = strtof(ptr, &end);
+        if (end == ptr)
+            return false;
+        ptr = end;
     }
-    rmse /= norm;
+    return true;
+}
 
-    for(auto &row : som) {
-        float x = row[0];
-        float y = coef[0];
-        y += x * coef[1];
-        y += x * x * coef[2];
-        y -= row[1];
-        row[2] *= expf(-0.25 * (y * y) / rmse);
+/**
+ * Reference compensation curve interpolated between SOM nodes
+ * @param temp temperature in Celsius
+ * @return compensation in ppm
+ */
+float reference(const float temp) {
+    if (temp <= som[0][0])
+        return som[0][1];
+    for (int i = 1; i < SOM_NODE_CNT; i++) {
+        if (temp <= som[i][0]) {
+            const float f = (temp - som[i - 1][0]) / (som[i][0] - som[i - 1][0]);
+            return som[i - 1][1] + f * (som[i][1] - som[i - 1][1]);
+        }
     }
+    return som[SOM_NODE_CNT - 1][1];
+}
 
-    memcpy(scratch, som, sizeof(som));
-    fitQuadratic(scratch, 16, coef);
-    for(int i = 0; i < 3; i++)
-        fprintf(stdout, "%f\n", coef[i]);
-    fflush(stdout);
+// previous temperature compensation (SOM filter with batch quadratic refit)
+struct LegacySom {
+    float node[SOM_NODE_CNT][SOM_NODE_DIM] = {};
+    float residual[SOM_NODE_CNT][SOM_NODE_DIM] = {};
+    float nw[SOM_NODE_CNT] = {};
+    float mean[SOM_NODE_DIM] = {};
+    float coef[3] = {};
+    float mse = 0;
+    bool seeded = false;
+
+    LegacySom() {
+        for (int i = 0; i < SOM_NODE_CNT; i++)
+            nw[i] = std::exp(-2.0f * static_cast<float>(i * i));
+    }
 
-    fprintf(stdout, "plot:\n");
-    fprintf(stdout, "temp,som,linear,quadratic\n");
-    rmse = 0, norm = 0;
-    for(auto &row : som) {
-        fprintf(stdout, "%f,%f", row[0], row[1]);
-        float x = row[0];
-        float y = coef[0];
-        y += x * coef[1];
-        fprintf(stdout, ",%f", y);
-        y += x * x * coef[2];
-        fprintf(stdout, ",%f\n", y);
-        y -= row[1];
-        rmse += y * y * row[2];
+    void update(const float temp, const float comp, float alpha) {
+        if (!seeded) {
+            constexpr int mid = SOM_NODE_CNT / 2;
+            for (int i = 0; i < SOM_NODE_CNT; i++) {
+                node[i][0] = temp + 0.1f * static_cast<float>(i - mid);
+                node[i][1] = comp;
+                node[i][2] = 0;
+            }
+            seeded = true;
+            return;
+        }
+
+        int best = 0;
+        float dist = std::abs(temp - node[0][0]);
+        for (int i = 1; i < SOM_NODE_CNT; i++) {
+            const float diff = std::abs(temp - node[i][0]);
+            if (diff < dist) {
+                dist = diff;
+                best = i;
+            }
+        }
+
+        alpha *= SOM_RATE;
+        for (int i = 0; i < SOM_NODE_CNT; i++) {
+            const float w = alpha * nw[std::abs(i - best)];
+            regression::accumulate(node[i][0], residual[i][0], (temp - node[i][0]) * w);
+            regression::accumulate(node[i][1], residual[i][1], (comp - node[i][1]) * w);
+            regression::accumulate(node[i][2], residual[i][2], (1.0f - node[i][2]) * w);
+        }
+    }
+
+    void computeMean(const float *data) {
+        regression::Sum sums[SOM_NODE_DIM];
+        for (int i = 0; i < SOM_NODE_CNT; i++) {
+            sums[0] += data[0] * data[2];
+            sums[1] += data[1] * data[2];
+            sums[2] += data[2];
+            data += SOM_NODE_DIM;
+        }
+        mean[2] = sums[2].value();
+        mean[0] = sums[0].value() / mean[2];
+        mean[1] = sums[1].value() / mean[2];
+    }
+
+    void fitQuadratic(const float *data) {
+        regression::Sum sums[3][4];
+        for (int i = 0; i < SOM_NODE_CNT; i++) {
+            const float x = data[0] - mean[0];
+            const float y = data[1] - mean[1];
+            float z = data[2];
+            data += SOM_NODE_DIM;
+            sums[2][2] += z;
+            sums[2][3] += z * y;
+            z *= x;
+            sums[1][2] += z;
+            sums[1][3] += z * y;
+            z *= x;
+            sums[0][2] += z;
+            sums[0][3] += z * y;
+            z *= x;
+            sums[0][1] += z;
+            z *= x;
+            sums[0][0] += z;
+        }
+        float xx[3][4];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j <= 3; j++)
+                xx[i][j] = sums[i][j].value();
+        }
+        xx[1][0] = xx[0][1];
+        xx[1][1] = xx[0][2];
+        xx[2][0] = xx[0][2];
+        xx[2][1] = xx[1][2];
+        for (int r = 1; r < 3; r++) {
+            const float f = xx[r][0] / xx[0][0];
+            for (int c = 1; c <= 3; c++)
+                xx[r][c] -= f * xx[0][c];
+        }
+        {
+            const float f = xx[2][1] / xx[1][1];
+            xx[2][2] -= f * xx[1][2];
+            xx[2][3] -= f * xx[1][3];
+        }
+        coef[0] = xx[2][3] / xx[2][2];
+        coef[1] = (xx[1][3] - xx[1][2] * coef[0]) / xx[1][1];
+        coef[2] = (xx[0][3] - xx[0][2] * coef[0] - xx[0][1] * coef[1]) / xx[0][0];
+    }
+
+    float residualOf(const float *row) const {
+        const float x = row[0] - mean[0];
+        return row[1] - mean[1] - coef[0] - x * coef[1] - x * x * coef[2];
+    }
+
+    void computeMSE(const float *data) {
+        regression::Sum acc;
+        for (int i = 0; i < SOM_NODE_CNT; i++) {
+            const float y = residualOf(data);
+            acc += y * y * data[2];
+            data += SOM_NODE_DIM;
+        }
+        mse = acc.value() / mean[2];
+    }
+
+    // complete pass of the previous nine-step regression state machine
+    bool fit(const float (*data)[SOM_NODE_DIM]) {
+        computeMean(data[0]);
+        if (mean[2] < SOM_FILL_REG)
+            return false;
+        fitQuadratic(data[0]);
+        computeMSE(data[0]);
+        float scratch[SOM_NODE_CNT][SOM_NODE_DIM];
+        for (int i = 0; i < SOM_NODE_CNT; i++) {
+            const float y = residualOf(data[i]);
+            scratch[i][0] = data[i][0];
+            scratch[i][1] = data[i][1];
+            scratch[i][2] = data[i][2] * std::exp(-0.25f * y * y / mse);
+        }
+        computeMean(scratch[0]);
+        fitQuadratic(scratch[0]);
+        computeMSE(scratch[0]);
+        return true;
+    }
+
+    float estimate(const float temp) const {
+        const float x = temp - mean[0];
+        return mean[1] + coef[0] + x * coef[1] + x * x * coef[2];
+    }
+};
+
+struct Score {
+    float rmse;
+    float peak;
+};
+
+// weighted error against the SOM nodes (ppm)
+template<typename F>
+Score score(F estimate) {
+    float acc = 0, norm = 0, peak = 0;
+    for (auto &row : som) {
+        const float diff = estimate(row[0]) - row[1];
+        acc += diff * diff * row[2];
         norm += row[2];
+        if (fabsf(diff) > peak)
+            peak = fabsf(diff);
     }
+    return {sqrtf(acc / norm), peak};
+}
+
+void printScore(const char *name, const Score &s) {
+    fprintf(stdout, "%-24s %10.4f %10.4f\n", name, s.rmse, s.peak);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && !loadDump(argv[1])) {
+        fprintf(stderr, "failed to load SOM dump from %s\n", argv[1]);
+        return 1;
+    }
+
+    float tempMin = som[0][0], tempMax = som[0][0];
+    for (auto &row : som) {
+        if (row[0] < tempMin) tempMin = row[0];
+        if (row[0] > tempMax) tempMax = row[0];
+    }
+    fprintf(stdout, "som dump: %.3f C to %.3f C\n\n", tempMin, tempMax);
+    fprintf(stdout, "%-24s %10s %10s\n", "model", "rmse (ppm)", "peak (ppm)");
+
+    // fit the recorded SOM directly
+    LegacySom legacyDump;
+    legacyDump.fit(som);
+    printScore("legacy fit of dump", score([&](float t) { return legacyDump.estimate(t); }));
+
+    // SOM dump as a model prior (compensation as a fraction, as stored on the device)
+    float prior[SOM_NODE_CNT][SOM_NODE_DIM];
+    for (int i = 0; i < SOM_NODE_CNT; i++) {
+        prior[i][0] = som[i][0];
+        prior[i][1] = som[i][1] * 1e-6f;
+        prior[i][2] = som[i][2];
+    }
+    static ntp::TempModel priorOnly;
+    priorOnly.setPrior(prior[0], SOM_NODE_CNT, SOM_NODE_DIM, SOM_PRIOR);
+    printScore("model of dump (prior)", score([&](float t) { return 1e6f * priorOnly.estimate(t); }));
+
+    // replay a temperature cycle over the recorded range against the interpolated SOM curve
+    srand(1);
+    LegacySom legacy;
+    static ntp::TempModel model;
+    static ntp::TempModel modelPrior;
+    modelPrior.setPrior(prior[0], SOM_NODE_CNT, SOM_NODE_DIM, SOM_PRIOR);
+    const float center = 0.5f * (tempMax + tempMin);
+    const float swing = 0.5f * (tempMax - tempMin);
+    float lag = 0, worstModel = 0;
+    for (int i = 0; i < REPLAY_LENGTH; i++) {
+        const float phase = 6.2831853f * static_cast<float>(i) / REPLAY_PERIOD;
+        const float temp = center + swing * sinf(phase) + 0.05f * gauss();
+        float comp = reference(temp) + REPLAY_NOISE * gauss();
+        if (uniform() < REPLAY_OUTLIER_RATE)
+            comp += REPLAY_OUTLIER * (uniform() < 0.5f ? -1.0f : 1.0f);
+
+        // previous pipeline: SOM update followed by a batch refit at the end of the replay
+        legacy.update(temp, comp * 1e-6f, 1.0f);
+        model.update(temp, comp * 1e-6f, 1.0f);
+        modelPrior.update(temp, comp * 1e-6f, 1.0f);
+
+        // tracking error over the final day
+        if (i >= REPLAY_LENGTH - 86400) {
+            const float err = fabsf(1e6f * model.estimate(temp) - reference(temp));
+            if (err > worstModel) worstModel = err;
+            lag += err;
+        }
+    }
+
+    float scaled[SOM_NODE_CNT][SOM_NODE_DIM];
+    for (int i = 0; i < SOM_NODE_CNT; i++) {
+        scaled[i][0] = legacy.node[i][0];
+        scaled[i][1] = legacy.node[i][1] * 1e6f;
+        scaled[i][2] = legacy.node[i][2];
+    }
+    legacy.fit(scaled);
+
+    printScore("legacy som replay", score([&](float t) { return legacy.estimate(t); }));
+    printScore("model replay", score([&](float t) { return 1e6f * model.estimate(t); }));
+    printScore("model replay + prior", score([&](float t) { return 1e6f * modelPrior.estimate(t); }));
+    fprintf(stdout, "\nmodel tracking error over final day: mean %.4f ppm, peak %.4f ppm\n", lag / 86400, worstModel);
+    fprintf(stdout, "model prediction rmse: %.4f ppm\n", 1e6f * model.getRmse());
     fflush(stdout);
 
-    rmse = sqrtf(rmse / norm);
-    fprintf(stdout, "\nrmse: %f\n", rmse);
+    fprintf(stdout, "\nplot:\n");
+    fprintf(stdout, "temp,som,legacy,model\n");
+    for (auto &row : som) {
+        fprintf(
+            stdout, "%f,%f,%f,%f\n",
+            row[0], row[1], legacy.estimate(row[0]), 1e6f * model.estimate(row[0])
+        );
+    }
     fflush(stdout);
 
     return 0;
@@ -0,0 +1,204 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "lib/run.hpp"
+#include "lib/store.hpp"
+
+// simulated EEPROM geometry (6 KiB in blocks of 16 words)
+static constexpr int EEPROM_WORDS = 1536;
+static constexpr int BLOCK_WORDS = 16;
+static constexpr int BLOCKS = EEPROM_WORDS / BLOCK_WORDS;
+// simulated runtime (hourly SOM, tcmp and PLL saves)
+static constexpr int HOURS = 24 * 365;
+
+// simulated EEPROM backend
+static uint32_t eeprom[EEPROM_WORDS];
+static uint32_t blockWrites[BLOCKS];
+static int eepromAddr;
+// fail all writes after this many words (negative to disable)
+static int powerBudget = -1;
+
+void EEPROM_seek(const uint32_t addr) {
+    eepromAddr = static_cast<int>(addr) % EEPROM_WORDS;
+}
+
+uint32_t EEPROM_read() {
+    const auto word = eeprom[eepromAddr];
+    eepromAddr = (eepromAddr + 1) % EEPROM_WORDS;
+    return word;
+}
+
+void EEPROM_write(const uint32_t data) {
+    if (powerBudget == 0)
+        return;
+    if (powerBudget > 0)
+        --powerBudget;
+    eeprom[eepromAddr] = data;
+    ++blockWrites[eepromAddr / BLOCK_WORDS];
+    eepromAddr = (eepromAddr + 1) % EEPROM_WORDS;
+}
+
+// simulated scheduler (only the store write task is used)
+static RunCall task;
+
+void* runSleep(uint32_t, const RunCall callback, void *) {
+    task = callback;
+    return reinterpret_cast<void*>(callback);
+}
+
+void runCancel(const RunCall callback, const void *) {
+    if (task == callback)
+        task = nullptr;
+}
+
+// run the write task until idle
+static int flush() {
+    int runs = 0;
+    while (task != nullptr) {
+        task(nullptr);
+        ++runs;
+    }
+    return runs;
+}
+
+// interrupt the write task (simulated reset)
+static void reset() {
+    task = nullptr;
+    powerBudget = -1;
+    store::init();
+}
+
+static void fill(uint32_t *data, const int words, const uint32_t seed) {
+    for (int i = 0; i < words; ++i)
+        data[i] = seed * 2654435761u + i;
+}
+
+static bool check(const int id, const int words, const uint32_t seed) {
+    uint32_t expect[store::MAX_WORDS], actual[store::MAX_WORDS];
+    fill(expect, words, seed);
+    return store::load(id, actual, words) && memcmp(expect, actual, words * sizeof(uint32_t)) == 0;
+}
+
+static void save(const int id, const int words, const uint32_t seed) {
+    uint32_t data[store::MAX_WORDS];
+    fill(data, words, seed);
+    store::save(id, data, words);
+}
+
+int main() {
+    static constexpr int SOM_WORDS = 48;
+    static constexpr int TCMP_WORDS = 7;
+    static constexpr int PLL_WORDS = 5;
+    int failed = 0;
+
+    // blank EEPROM
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    reset();
+    if (store::load(store::ID_SOM, eeprom, SOM_WORDS)) {
+        fprintf(stdout, "FAIL: record found in blank EEPROM\n");
+        failed = 1;
+    }
+
+    // round trip
+    save(store::ID_SOM, SOM_WORDS, 1);
+    save(store::ID_TCMP, TCMP_WORDS, 1);
+    save(store::ID_PLL, PLL_WORDS, 1);
+    const int runs = flush();
+    fprintf(stdout, "initial save: %d task runs (one word each)\n", runs);
+    reset();
+    if (!check(store::ID_SOM, SOM_WORDS, 1) || !check(store::ID_TCMP, TCMP_WORDS, 1) || !check(store::ID_PLL, PLL_WORDS, 1)) {
+        fprintf(stdout, "FAIL: records lost across reset\n");
+        failed = 1;
+    }
+    if (store::load(store::ID_PLL, eeprom, PLL_WORDS + 1)) {
+        fprintf(stdout, "FAIL: record loaded with wrong size\n");
+        failed = 1;
+    }
+
+    // frequent small records must not evict a rarely written record
+    for (uint32_t i = 2; i < 2000; ++i) {
+        save(store::ID_PLL, PLL_WORDS, i);
+        flush();
+    }
+    reset();
+    if (!check(store::ID_SOM, SOM_WORDS, 1) || !check(store::ID_PLL, PLL_WORDS, 1999)) {
+        fprintf(stdout, "FAIL: newest records not retained under ring wrap\n");
+        failed = 1;
+    }
+
+    // interrupted writes fall back to the previous copy
+    int interrupted = 0;
+    uint32_t previous = 1;
+    for (int budget = 0; budget < SOM_WORDS + 3; ++budget) {
+        const auto seed = static_cast<uint32_t>(100 + budget);
+        save(store::ID_SOM, SOM_WORDS, seed);
+        powerBudget = budget;
+        flush();
+        reset();
+        if (!check(store::ID_SOM, SOM_WORDS, previous))
+            ++interrupted;
+        // complete the write so the next iteration has a known previous copy
+        save(store::ID_SOM, SOM_WORDS, seed);
+        flush();
+        previous = seed;
+    }
+    fprintf(stdout, "interrupted writes: %d of %d lost the previous copy\n", interrupted, SOM_WORDS + 3);
+    if (interrupted != 0) {
+        fprintf(stdout, "FAIL: interrupted write corrupted the store\n");
+        failed = 1;
+    }
+
+    // corrupted newest copy falls back to the previous copy
+    save(store::ID_TCMP, TCMP_WORDS, 7);
+    flush();
+    save(store::ID_TCMP, TCMP_WORDS, 8);
+    flush();
+    reset();
+    char buffer[1024];
+    buffer[store::status(buffer)] = 0;
+    for (auto &word : eeprom) {
+        // locate newest TCMP payload and flip a bit
+        uint32_t expect[TCMP_WORDS];
+        fill(expect, TCMP_WORDS, 8);
+        if (word == expect[0]) {
+            word ^= 1u << 7;
+            break;
+        }
+    }
+    reset();
+    if (!check(store::ID_TCMP, TCMP_WORDS, 7)) {
+        fprintf(stdout, "FAIL: corrupted record not rejected\n");
+        failed = 1;
+    }
+    fprintf(stdout, "\n%s\n", buffer);
+
+    // wear over one year of hourly saves compared to rewriting the SOM block in place
+    memset(blockWrites, 0, sizeof(blockWrites));
+    for (int hour = 0; hour < HOURS; ++hour) {
+        save(store::ID_SOM, SOM_WORDS, hour);
+        save(store::ID_TCMP, TCMP_WORDS, hour);
+        save(store::ID_PLL, PLL_WORDS, hour);
+        flush();
+    }
+    uint32_t maxStore = 0, minStore = ~0u;
+    for (int block = 0x80 / BLOCK_WORDS; block < 0x600 / BLOCK_WORDS; ++block) {
+        if (blockWrites[block] > maxStore) maxStore = blockWrites[block];
+        if (blockWrites[block] < minStore) minStore = blockWrites[block];
+    }
+    // legacy: 48 SOM words rewritten in place spanning three blocks
+    const uint32_t maxLegacy = HOURS * BLOCK_WORDS;
+    fprintf(stdout, "word writes per block over %d hours: store %u to %u, legacy %u (%.1fx)\n",
+            HOURS, minStore, maxStore, maxLegacy, static_cast<float>(maxLegacy) / static_cast<float>(maxStore));
+    if (maxStore >= maxLegacy || 10 * maxStore > 11 * minStore) {
+        fprintf(stdout, "FAIL: writes are not leveled across the ring\n");
+        failed = 1;
+    }
+
+    return failed;
+}
@@ -0,0 +1,188 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+
+#include "lib/survey.hpp"
+
+// antenna position
+static constexpr double TRUE_LAT = 47.6062;
+static constexpr double TRUE_LON = -122.3321;
+static constexpr double TRUE_ALT = 85.0;
+// survey duration (one fix per second)
+static constexpr int SURVEY_LENGTH = 86400;
+// independent survey runs
+static constexpr int SURVEY_RUNS = 24;
+// correlated position error (multipath and atmosphere): time constant (s) and horizontal/vertical deviation (m)
+static constexpr double NOISE_TAU = 300;
+static constexpr double NOISE_HORZ = 2.0;
+static constexpr double NOISE_VERT = 4.0;
+// white position error (m)
+static constexpr double NOISE_WHITE = 0.5;
+// fraction of degraded fixes (large reported and actual error)
+static constexpr double DEGRADED = 0.02;
+// accuracy limit used for convergence checks (m)
+static constexpr float ACCURACY_LIMIT = 0.5f;
+
+static constexpr double METERS_PER_DEG = 111319.49;
+
+static double uniform() {
+    return static_cast<double>(rand()) / static_cast<double>(RAND_MAX);
+}
+
+static double gauss() {
+    const double u = (static_cast<double>(rand()) + 1.0) / (static_cast<double>(RAND_MAX) + 2.0);
+    return sqrt(-2.0 * log(u)) * cos(6.283185307179586 * uniform());
+}
+
+struct Receiver {
+    double error[3];
+
+    /**
+     * Generate the next position fix
+     */
+    void fix(int32_t &lat, int32_t &lon, int32_t &alt, uint32_t &hAcc, uint32_t &vAcc) {
+        const double a = exp(-1.0 / NOISE_TAU);
+        const double b = sqrt(1 - a * a);
+        error[0] = a * error[0] + b * NOISE_HORZ * gauss();
+        error[1] = a * error[1] + b * NOISE_HORZ * gauss();
+        error[2] = a * error[2] + b * NOISE_VERT * gauss();
+        double north = error[0] + NOISE_WHITE * gauss();
+        double east = error[1] + NOISE_WHITE * gauss();
+        double up = error[2] + NOISE_WHITE * gauss();
+        hAcc = 2500;
+        vAcc = 5000;
+        if (uniform() < DEGRADED) {
+            north += 50 * gauss();
+            east += 50 * gauss();
+            up += 100 * gauss();
+            hAcc = 60000;
+            vAcc = 120000;
+        }
+        const double scaleLon = METERS_PER_DEG * cos(TRUE_LAT * M_PI / 180);
+        lat = static_cast<int32_t>(llround(1e7 * (TRUE_LAT + north / METERS_PER_DEG)));
+        lon = static_cast<int32_t>(llround(1e7 * (TRUE_LON + east / scaleLon)));
+        alt = static_cast<int32_t>(llround(1e3 * (TRUE_ALT + up)));
+    }
+};
+
+/**
+ * Distance of a surveyed position from the true antenna position
+ */
+static double positionError(const gps::Survey &survey) {
+    int32_t lat, lon, alt;
+    survey.getPosition(lat, lon, alt);
+    const double north = (1e-7 * lat - TRUE_LAT) * METERS_PER_DEG;
+    const double east = (1e-7 * lon - TRUE_LON) * METERS_PER_DEG * cos(TRUE_LAT * M_PI / 180);
+    const double up = 1e-3 * alt - TRUE_ALT;
+    return sqrt(north * north + east * east + up * up);
+}
+
+int main() {
+    int failed = 0;
+
+    // accuracy estimate must be consistent with the actual error of the average
+    double sumError2 = 0, sumAccuracy2 = 0, sumNaive2 = 0;
+    int outliers = 0, early = 0;
+    uint32_t rejected = 0, convergedAt = 0;
+    for (int run = 0; run < SURVEY_RUNS; ++run) {
+        srand(run + 1);
+        Receiver receiver = {};
+        gps::Survey survey = {};
+        // per-fix scatter (what an estimate ignoring correlation would use)
+        double sum2 = 0;
+        int count = 0;
+        uint32_t first = 0;
+        for (int sec = 0; sec < SURVEY_LENGTH; ++sec) {
+            int32_t lat, lon, alt;
+            uint32_t hAcc, vAcc;
+            receiver.fix(lat, lon, alt, hAcc, vAcc);
+            if (survey.update(lat, lon, alt, hAcc, vAcc)) {
+                const double north = (1e-7 * lat - TRUE_LAT) * METERS_PER_DEG;
+                const double east = (1e-7 * lon - TRUE_LON) * METERS_PER_DEG * cos(TRUE_LAT * M_PI / 180);
+                const double up = 1e-3 * alt - TRUE_ALT;
+                sum2 += north * north + east * east + up * up;
+                ++count;
+            }
+            // convergence requires the minimum duration
+            if (survey.converged(SURVEY_LENGTH / 4, ACCURACY_LIMIT) && first == 0) {
+                first = survey.getAccepted();
+                if (first < SURVEY_LENGTH / 4)
+                    ++early;
+            }
+        }
+        const double error = positionError(survey);
+        const double accuracy = survey.getAccuracy();
+        const double naive = sqrt(sum2 / count / count);
+        sumError2 += error * error;
+        sumAccuracy2 += accuracy * accuracy;
+        sumNaive2 += naive * naive;
+        if (error > 3 * accuracy)
+            ++outliers;
+        rejected += survey.getRejected();
+        convergedAt += first;
+    }
+    const double rmsError = sqrt(sumError2 / SURVEY_RUNS);
+    const double rmsAccuracy = sqrt(sumAccuracy2 / SURVEY_RUNS);
+    const double rmsNaive = sqrt(sumNaive2 / SURVEY_RUNS);
+    fprintf(stdout, "survey:     %d runs of %d s, %u degraded fixes rejected\n", SURVEY_RUNS, SURVEY_LENGTH, rejected);
+    fprintf(stdout, "error:      %.3f m rms, block estimate %.3f m rms, per-fix estimate %.3f m rms\n",
+            rmsError, rmsAccuracy, rmsNaive);
+    fprintf(stdout, "converged:  %.0f s average (limit %.2f m), %d runs beyond 3x estimate\n",
+            static_cast<double>(convergedAt) / SURVEY_RUNS, ACCURACY_LIMIT, outliers);
+    if (rmsAccuracy < 0.5 * rmsError || rmsAccuracy > 2 * rmsError || outliers > 1) {
+        fprintf(stdout, "FAIL: survey accuracy estimate is inconsistent with the actual error\n");
+        failed = 1;
+    }
+    if (early != 0 || convergedAt == 0) {
+        fprintf(stdout, "FAIL: survey converged before the minimum duration or not at all\n");
+        failed = 1;
+    }
+    if (rejected < SURVEY_RUNS * SURVEY_LENGTH * DEGRADED / 2) {
+        fprintf(stdout, "FAIL: degraded fixes were not rejected\n");
+        failed = 1;
+    }
+
+    // convergence requires enough blocks for an accuracy estimate
+    gps::Survey survey = {};
+    for (int i = 0; i < gps::Survey::BLOCK_SIZE * (gps::Survey::MIN_BLOCKS - 1); ++i)
+        survey.update(475000000, -1223000000, 85000, 1000, 1000);
+    if (survey.getAccuracy() >= 0 || survey.converged(0, 1e3f)) {
+        fprintf(stdout, "FAIL: survey converged without an accuracy estimate\n");
+        failed = 1;
+    }
+    for (int i = 0; i < gps::Survey::BLOCK_SIZE; ++i)
+        survey.update(475000000, -1223000000, 85000, 1000, 1000);
+    if (!survey.converged(0, 1e-3f)) {
+        fprintf(stdout, "FAIL: stationary survey did not converge\n");
+        failed = 1;
+    }
+
+    // surveyed position must round-trip exactly for every hemisphere
+    static constexpr int32_t POSITIONS[][3] = {
+        {475000000, -1223000000, 85000},
+        {-338688000, 1512093000, -12345},
+        {0, 0, 0},
+        {899000000, 1799000000, 4000000},
+    };
+    for (const auto &pos : POSITIONS) {
+        survey.reset();
+        for (int i = 0; i < gps::Survey::BLOCK_SIZE * gps::Survey::MIN_BLOCKS; ++i) {
+            // alternate +/- one unit around the position
+            const int32_t delta = (i & 1) ? 1 : -1;
+            survey.update(pos[0] + delta, pos[1] + delta, pos[2] + delta, 1000, 1000);
+        }
+        int32_t lat, lon, alt;
+        survey.getPosition(lat, lon, alt);
+        if (lat != pos[0] || lon != pos[1] || alt != pos[2]) {
+            fprintf(stdout, "FAIL: surveyed position %d %d %d != %d %d %d\n", lat, lon, alt, pos[0], pos[1], pos[2]);
+            failed = 1;
+        }
+    }
+
+    return failed;
+}
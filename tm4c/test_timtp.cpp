@@ -0,0 +1,226 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "lib/ntp/timepulse.hpp"
+
+// synthetic recording length (one hour at one pulse per second)
+static constexpr int REPLAY_LENGTH = 3600;
+// PPS white jitter (s)
+static constexpr double REPLAY_JITTER = 2e-9;
+// PPS sawtooth quantization span (s) and drift rate (cycles/s)
+static constexpr double REPLAY_SAW = 21e-9;
+static constexpr double REPLAY_SAW_RATE = 0.013;
+// TIM-TP lead time before each PPS edge (s)
+static constexpr double REPLAY_LEAD = 0.6;
+// fraction of TIM-TP messages lost or flagged invalid
+static constexpr double REPLAY_DROP = 0.02;
+static constexpr double REPLAY_INVALID = 0.01;
+
+static double uniform() {
+    return static_cast<double>(rand()) / static_cast<double>(RAND_MAX);
+}
+
+static double gauss() {
+    const double u = (static_cast<double>(rand()) + 1.0) / (static_cast<double>(RAND_MAX) + 2.0);
+    return sqrt(-2.0 * log(u)) * cos(6.283185307179586 * uniform());
+}
+
+static uint64_t toFixed(const double seconds) {
+    return static_cast<uint64_t>(llround(seconds * 0x1p32));
+}
+
+/**
+ * Write a UBX frame to a recording
+ * @param file recording
+ * @param time monotonic receive time (32.32 fixed-point)
+ */
+static void writeUbx(FILE *file, const uint64_t time, const uint8_t _class, const uint8_t id, const uint8_t *payload, const int len) {
+    uint8_t frame[64] = {0xB5, 0x62, _class, id, static_cast<uint8_t>(len), static_cast<uint8_t>(len >> 8)};
+    memcpy(frame + 6, payload, len);
+    uint8_t chkA = 0, chkB = 0;
+    for (int i = 2; i < len + 6; ++i) {
+        chkA += frame[i];
+        chkB += chkA;
+    }
+    frame[len + 6] = chkA;
+    frame[len + 7] = chkB;
+
+    fprintf(file, "%016llx ubx ", static_cast<unsigned long long>(time));
+    for (int i = 0; i < len + 8; ++i)
+        fprintf(file, "%02x", frame[i]);
+    fprintf(file, "\n");
+}
+
+/**
+ * Synthesize a recording of GPS messages and PPS captures.
+ * Each line holds a hexadecimal 32.32 monotonic timestamp followed by "pps" for a PPS capture or "ubx" and the
+ * hexadecimal bytes of a received UBX frame.
+ * @param file destination
+ */
+static void synthesize(FILE *file) {
+    const double sawPhase = uniform();
+    for (int pulse = 1; pulse <= REPLAY_LENGTH; ++pulse) {
+        const double saw = sawPhase + REPLAY_SAW_RATE * pulse;
+        const double qErr = REPLAY_SAW * (saw - floor(saw) - 0.5);
+        const double edge = pulse + qErr + REPLAY_JITTER * gauss();
+        const uint64_t received = toFixed(pulse - REPLAY_LEAD);
+
+        // NAV-TIMEGPS (ignored by the time pulse correction)
+        uint8_t timeGps[16] = {};
+        timeGps[10] = 18;
+        timeGps[11] = 0x07;
+        writeUbx(file, received - toFixed(0.05), 0x01, 0x20, timeGps, sizeof(timeGps));
+
+        // TIM-TP for the next edge
+        if (uniform() >= REPLAY_DROP) {
+            uint8_t timTp[ntp::TimePulse::PAYLOAD_SIZE] = {};
+            const auto towMS = static_cast<uint32_t>(pulse * 1000);
+            const auto ps = static_cast<int32_t>(lround(qErr * 1e12));
+            memcpy(timTp + 0, &towMS, sizeof(towMS));
+            memcpy(timTp + 8, &ps, sizeof(ps));
+            timTp[14] = uniform() < REPLAY_INVALID ? 0x10 : 0x00;
+            writeUbx(file, received, 0x0D, 0x01, timTp, sizeof(timTp));
+        }
+
+        fprintf(file, "%016llx pps\n", static_cast<unsigned long long>(toFixed(edge)));
+    }
+}
+
+static int fromHex(const char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+struct Replay {
+    ntp::TimePulse timePulse;
+    double sumRaw, sumCorr;
+    int pulses, corrected, frames, badFrames;
+};
+
+/**
+ * Decode a UBX frame and pass time pulse messages to the correction
+ */
+static void processUbx(Replay &replay, const uint64_t time, const uint8_t *frame, const int len) {
+    if (len < 8 || frame[0] != 0xB5 || frame[1] != 0x62 || frame[4] + (frame[5] << 8) != len - 8) {
+        ++replay.badFrames;
+        return;
+    }
+    uint8_t chkA = 0, chkB = 0;
+    for (int i = 2; i < len - 2; ++i) {
+        chkA += frame[i];
+        chkB += chkA;
+    }
+    if (chkA != frame[len - 2] || chkB != frame[len - 1]) {
+        ++replay.badFrames;
+        return;
+    }
+    ++replay.frames;
+    if (frame[2] == 0x0D && frame[3] == 0x01 && len - 8 == ntp::TimePulse::PAYLOAD_SIZE)
+        replay.timePulse.update(time, frame + 6);
+}
+
+/**
+ * Replay a recording and accumulate PPS offsets with and without the quantization error correction
+ * @return false if the recording is malformed
+ */
+static bool replay(FILE *file, Replay &replay) {
+    char line[256];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        char *ptr;
+        const uint64_t time = strtoull(line, &ptr, 16);
+        while (*ptr == ' ')
+            ++ptr;
+
+        if (strncmp(ptr, "pps", 3) == 0) {
+            // offset of the capture from the nearest second
+            const int64_t frac = static_cast<int32_t>(static_cast<uint32_t>(time));
+            int64_t correction = 0;
+            if (replay.timePulse.correct(time, correction))
+                ++replay.corrected;
+            const double raw = 0x1p-32 * static_cast<double>(frac);
+            const double corr = 0x1p-32 * static_cast<double>(frac - correction);
+            replay.sumRaw += raw * raw;
+            replay.sumCorr += corr * corr;
+            ++replay.pulses;
+            continue;
+        }
+
+        if (strncmp(ptr, "ubx ", 4) == 0) {
+            ptr += 4;
+            uint8_t frame[128];
+            int len = 0;
+            while (len < static_cast<int>(sizeof(frame)) && fromHex(ptr[0]) >= 0 && fromHex(ptr[1]) >= 0) {
+                frame[len++] = static_cast<uint8_t>((fromHex(ptr[0]) << 4) | fromHex(ptr[1]));
+                ptr += 2;
+            }
+            processUbx(replay, time, frame, len);
+            continue;
+        }
+
+        return false;
+    }
+    return replay.pulses > 0;
+}
+
+int main(int argc, char **argv) {
+    int failed = 0;
+
+    // replay a captured recording if provided, otherwise a synthetic one
+    FILE *file;
+    if (argc > 1) {
+        file = fopen(argv[1], "r");
+        if (file == nullptr) {
+            fprintf(stdout, "failed to open %s\n", argv[1]);
+            return 1;
+        }
+    }
+    else {
+        file = tmpfile();
+        synthesize(file);
+        rewind(file);
+    }
+
+    Replay result = {};
+    if (!replay(file, result)) {
+        fprintf(stdout, "FAIL: malformed recording\n");
+        return 1;
+    }
+    fclose(file);
+
+    const double rmsRaw = sqrt(result.sumRaw / result.pulses);
+    const double rmsCorr = sqrt(result.sumCorr / result.pulses);
+    fprintf(stdout, "pulses:            %d\n", result.pulses);
+    fprintf(stdout, "ubx frames:        %d (%d bad)\n", result.frames, result.badFrames);
+    fprintf(stdout, "corrected pulses:  %d (matched %u, missed %u)\n",
+            result.corrected, result.timePulse.getMatched(), result.timePulse.getMissed());
+    fprintf(stdout, "offset rms raw:    %.3f ns\n", rmsRaw * 1e9);
+    fprintf(stdout, "offset rms corr:   %.3f ns\n", rmsCorr * 1e9);
+
+    if (rmsCorr >= 0.5 * rmsRaw) {
+        fprintf(stdout, "FAIL: quantization error correction did not reduce offset jitter\n");
+        failed = 1;
+    }
+    if (argc <= 1) {
+        // lost and invalid reports must not be applied to other pulses
+        const int expected = static_cast<int>(result.pulses * (1 - REPLAY_DROP - REPLAY_INVALID));
+        if (result.badFrames != 0 || result.corrected < expected - 30 || result.corrected > expected + 30) {
+            fprintf(stdout, "FAIL: unexpected number of corrected pulses (expected about %d)\n", expected);
+            failed = 1;
+        }
+        if (rmsCorr > 1.5 * REPLAY_JITTER) {
+            fprintf(stdout, "FAIL: residual offset jitter exceeds PPS white jitter\n");
+            failed = 1;
+        }
+    }
+
+    return failed;
+}
@@ -0,0 +1,243 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include "lib/rxring.hpp"
+
+// simulated duration (seconds, one message burst per second)
+static constexpr int DURATION = 600;
+// UART hardware FIFO depth
+static constexpr int FIFO_DEPTH = 16;
+// receive timeout (bit periods of idle line)
+static constexpr int RX_TIMEOUT_BITS = 32;
+// burst start relative to the PPS edge (s)
+static constexpr double BURST_DELAY = 0.05;
+// receive ring size (matches lib/gps.cpp)
+static constexpr int RING_SIZE = 512;
+
+// messages per burst (NAV-PVT, NAV-TIMEGPS, NAV-CLOCK, TIM-TP payload sizes)
+static constexpr int BURST_PAYLOADS[] = {92, 16, 20, 16};
+
+struct Policy {
+    const char *name;
+    int baud;
+    // RX FIFO interrupt level
+    int level;
+    // watermark interrupt leaves one byte for the receive timeout
+    bool leaveOne;
+    // wake parser only on idle line or half-full ring
+    bool burst;
+};
+
+struct Result {
+    int interrupts;
+    int wakes;
+    int frames;
+    int partialWakes;
+    int inPlace;
+    uint32_t overruns;
+    // delay from the end of a burst to the parser hand-off
+    double maxLatency;
+    // delay from the start of a burst to the hand-off of its last message
+    double maxDelivery;
+};
+
+/**
+ * Build a burst of UBX frames
+ * @param data destination
+ * @param seq burst sequence number (used as payload contents)
+ * @return burst length in bytes
+ */
+static int buildBurst(uint8_t *data, const int seq) {
+    int len = 0;
+    for (const int size : BURST_PAYLOADS) {
+        uint8_t *frame = data + len;
+        frame[0] = 0xB5;
+        frame[1] = 0x62;
+        frame[2] = 0x01;
+        frame[3] = static_cast<uint8_t>(size);
+        frame[4] = static_cast<uint8_t>(size);
+        frame[5] = 0;
+        for (int i = 0; i < size; ++i)
+            frame[6 + i] = static_cast<uint8_t>(seq + i);
+        uint8_t chkA = 0, chkB = 0;
+        for (int i = 2; i < size + 6; ++i) {
+            chkA += frame[i];
+            chkB += chkA;
+        }
+        frame[size + 6] = chkA;
+        frame[size + 7] = chkB;
+        len += size + 8;
+    }
+    return len;
+}
+
+/**
+ * Parser hand-off: consume all committed bytes and count complete UBX frames
+ * @return true if the hand-off ended on a frame boundary
+ */
+static bool parse(RxRing<RING_SIZE> &ring, Result &result) {
+    const int count = ring.available();
+    int offset = 0;
+    while (count - offset >= 8) {
+        if (ring.peek(offset) != 0xB5 || ring.peek(offset + 1) != 0x62) {
+            ++offset;
+            continue;
+        }
+        const int size = ring.peek(offset + 4) | (ring.peek(offset + 5) << 8);
+        if (count - offset < size + 8)
+            break;
+        uint8_t chkA = 0, chkB = 0;
+        // use a direct view of the payload when it does not wrap
+        const uint8_t *view = ring.span(offset + 2, size + 4);
+        for (int i = 0; i < size + 4; ++i) {
+            chkA += view != nullptr ? view[i] : ring.peek(offset + 2 + i);
+            chkB += chkA;
+        }
+        if (chkA == ring.peek(offset + size + 6) && chkB == ring.peek(offset + size + 7)) {
+            ++result.frames;
+            if (view != nullptr)
+                ++result.inPlace;
+        }
+        offset += size + 8;
+    }
+    // bytes of an incomplete frame remain for the next hand-off
+    ring.consume(offset);
+    return offset == count;
+}
+
+static Result simulate(const Policy &policy) {
+    static RxRing<RING_SIZE> ring;
+    ring = {};
+    Result result = {};
+
+    const double byteTime = 10.0 / policy.baud;
+    const double timeout = RX_TIMEOUT_BITS / static_cast<double>(policy.baud);
+    uint8_t fifo[FIFO_DEPTH];
+    int fifoLen = 0;
+    uint8_t burst[512];
+
+    for (int sec = 0; sec < DURATION; ++sec) {
+        const int len = buildBurst(burst, sec);
+        const double start = sec + BURST_DELAY;
+        const int frames = result.frames + static_cast<int>(std::size(BURST_PAYLOADS));
+        double time = start;
+        double lastByte = time;
+
+        auto interrupt = [&](const bool idle, const double now) {
+            ++result.interrupts;
+            if (idle) {
+                // receive timeout drains the FIFO
+                for (int i = 0; i < fifoLen; ++i)
+                    ring.put(fifo[i]);
+                fifoLen = 0;
+            }
+            else {
+                // watermark drains the FIFO (optionally leaving one byte)
+                const int count = policy.leaveOne ? policy.level - 1 : fifoLen;
+                for (int i = 0; i < count; ++i)
+                    ring.put(fifo[i]);
+                memmove(fifo, fifo + count, fifoLen - count);
+                fifoLen -= count;
+            }
+            if (!ring.commit(idle) && policy.burst)
+                return;
+            ++result.wakes;
+            if (!parse(ring, result))
+                ++result.partialWakes;
+            // burst has been delivered
+            if (result.frames == frames) {
+                if (now - lastByte > result.maxLatency)
+                    result.maxLatency = now - lastByte;
+                if (now - start > result.maxDelivery)
+                    result.maxDelivery = now - start;
+            }
+        };
+
+        for (int i = 0; i < len; ++i) {
+            time += byteTime;
+            fifo[fifoLen++] = burst[i];
+            lastByte = time;
+            if (fifoLen >= policy.level)
+                interrupt(false, time);
+        }
+        // idle line after the burst
+        if (fifoLen > 0)
+            interrupt(true, lastByte + timeout);
+    }
+
+    result.overruns = ring.getOverruns();
+    return result;
+}
+
+int main() {
+    int failed = 0;
+
+    const Policy legacy = {"9600 baud, wake per interrupt", 9600, 8, false, false};
+    const Policy burst = {"115200 baud, burst hand-off", 115200, 14, true, true};
+    const Result a = simulate(legacy);
+    const Result b = simulate(burst);
+
+    const int frames = DURATION * static_cast<int>(std::size(BURST_PAYLOADS));
+    for (const auto &[policy, result] : {std::pair{legacy, a}, std::pair{burst, b}}) {
+        fprintf(stdout, "%s:\n", policy.name);
+        fprintf(stdout, "  interrupts/s:     %.1f\n", static_cast<double>(result.interrupts) / DURATION);
+        fprintf(stdout, "  parser wakes/s:   %.1f\n", static_cast<double>(result.wakes) / DURATION);
+        fprintf(stdout, "  partial wakes/s:  %.1f\n", static_cast<double>(result.partialWakes) / DURATION);
+        fprintf(stdout, "  frames:           %d of %d (%d in place)\n", result.frames, frames, result.inPlace);
+        fprintf(stdout, "  overruns:         %u\n", result.overruns);
+        fprintf(stdout, "  idle latency:     %.3f ms\n", result.maxLatency * 1e3);
+        fprintf(stdout, "  burst delivery:   %.3f ms\n", result.maxDelivery * 1e3);
+    }
+
+    if (a.frames != frames || b.frames != frames || a.overruns != 0 || b.overruns != 0) {
+        fprintf(stdout, "FAIL: messages lost\n");
+        failed = 1;
+    }
+    if (b.wakes != DURATION || b.partialWakes != 0) {
+        fprintf(stdout, "FAIL: parser was not handed whole message bursts\n");
+        failed = 1;
+    }
+    if (b.interrupts >= a.interrupts || b.wakes * 8 >= a.wakes || b.maxDelivery * 8 >= a.maxDelivery) {
+        fprintf(stdout, "FAIL: interrupt rate or message delivery delay was not reduced\n");
+        failed = 1;
+    }
+    // at most one frame per ring wrap-around needs to be read byte by byte
+    uint8_t data[512];
+    const int wraps = DURATION * buildBurst(data, 0) / RING_SIZE + 1;
+    if (b.inPlace < frames - wraps) {
+        fprintf(stdout, "FAIL: payloads were not parsed in place\n");
+        failed = 1;
+    }
+
+    // a burst larger than half the ring must wake the parser before the line goes idle
+    RxRing<RING_SIZE> ring = {};
+    Result flood = {};
+    int woken = 0;
+    for (int rep = 0; rep < 4; ++rep) {
+        const int len = buildBurst(data, rep);
+        for (int i = 0; i < len; ++i) {
+            ring.put(data[i]);
+            if ((i & 15) == 15 && ring.commit(false)) {
+                ++woken;
+                parse(ring, flood);
+            }
+        }
+    }
+    if (ring.commit(true))
+        parse(ring, flood);
+    fprintf(stdout, "\nflood: %d early wakes, %d frames, %u overruns\n", woken, flood.frames, ring.getOverruns());
+    if (woken == 0 || flood.frames != 16 || ring.getOverruns() != 0) {
+        fprintf(stdout, "FAIL: long burst overran the ring\n");
+        failed = 1;
+    }
+
+    return failed;
+}
@@ -0,0 +1,386 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "lib/ubx.hpp"
+
+// synthetic recording length (seconds of receiver output)
+static constexpr int CORPUS_SECONDS = 3600;
+// benchmark repetitions over the recording
+static constexpr int BENCH_REPEAT = 8;
+// fuzz iterations and recording length per iteration (seconds)
+static constexpr int FUZZ_ITERATIONS = 2000;
+static constexpr int FUZZ_SECONDS = 10;
+// receive ring size (matches lib/gps.cpp)
+static constexpr int RING_SIZE = 512;
+
+// messages emitted every second (class, id, payload length)
+static constexpr struct {
+    uint8_t msgClass, msgId;
+    int length;
+} EPOCH_MESSAGES[] = {
+    {0x01, 0x07, 92}, // NAV-PVT
+    {0x01, 0x20, 16}, // NAV-TIMEGPS
+    {0x01, 0x22, 20}, // NAV-CLOCK
+    {0x0D, 0x01, 16}, // TIM-TP
+    {0x05, 0x01, 2},  // ACK-ACK (not registered)
+};
+
+// dispatch verification
+static uint32_t received[4];
+static uint32_t falseDispatch;
+static uint32_t falseNmea;
+static uint32_t nmeaReceived;
+
+/**
+ * Generate deterministic payload contents
+ */
+static uint8_t payloadByte(const uint8_t msgClass, const uint8_t msgId, const uint32_t seq, const int i) {
+    if (i < 4)
+        return static_cast<uint8_t>(seq >> (8 * i));
+    return static_cast<uint8_t>(msgClass * 31 + msgId * 17 + seq * 7 + i * 3);
+}
+
+template<int INDEX>
+static void handler(const uint8_t *payload) {
+    const auto &msg = EPOCH_MESSAGES[INDEX];
+    uint32_t seq;
+    memcpy(&seq, payload, sizeof(seq));
+    for (int i = 0; i < msg.length; ++i) {
+        if (payload[i] != payloadByte(msg.msgClass, msg.msgId, seq, i)) {
+            ++falseDispatch;
+            return;
+        }
+    }
+    ++received[INDEX];
+}
+
+static void handlerNmea(const char *sentence, const int length) {
+    if (length < 6 || strncmp(sentence, "$GNRMC", 6) != 0)
+        ++falseNmea;
+    else
+        ++nmeaReceived;
+}
+
+static constexpr ubx::Message registry[] = {
+    {0x01, 0x07, 92, handler<0>},
+    {0x01, 0x20, 16, handler<1>},
+    {0x01, 0x22, 20, handler<2>},
+    {0x0D, 0x01, 16, handler<3>},
+};
+static_assert(ubx::isUnique(registry), "registry must not contain duplicate messages");
+
+struct Frame {
+    size_t start, end;
+    int index;
+};
+
+static void appendUbx(std::vector<uint8_t> &out, std::vector<Frame> &frames, const int index, const uint32_t seq) {
+    const auto &msg = EPOCH_MESSAGES[index];
+    const size_t start = out.size();
+    out.push_back(ubx::SYNC_1);
+    out.push_back(ubx::SYNC_2);
+    out.push_back(msg.msgClass);
+    out.push_back(msg.msgId);
+    out.push_back(static_cast<uint8_t>(msg.length));
+    out.push_back(static_cast<uint8_t>(msg.length >> 8));
+    for (int i = 0; i < msg.length; ++i)
+        out.push_back(payloadByte(msg.msgClass, msg.msgId, seq, i));
+    uint8_t chkA = 0, chkB = 0;
+    for (size_t i = start + 2; i < out.size(); ++i) {
+        chkA += out[i];
+        chkB += chkA;
+    }
+    out.push_back(chkA);
+    out.push_back(chkB);
+    frames.push_back({start, out.size(), index});
+}
+
+static void appendNmea(std::vector<uint8_t> &out, std::vector<Frame> &frames, const uint32_t seq) {
+    char body[80];
+    snprintf(body, sizeof(body), "GNRMC,%06u.00,A,4807.03800,N,01131.00000,E,0.011,,230394,,,A", seq % 240000);
+    uint8_t chk = 0;
+    for (const char *ptr = body; *ptr != 0; ++ptr)
+        chk ^= *ptr;
+    char line[96];
+    snprintf(line, sizeof(line), "$%s*%02X\r\n", body, chk);
+    const size_t start = out.size();
+    out.insert(out.end(), line, line + strlen(line));
+    frames.push_back({start, out.size(), -1});
+}
+
+/**
+ * Synthesize MAX-8 output: NMEA sentences until the receiver is configured, then one UBX burst per second
+ */
+static void synthesize(std::vector<uint8_t> &out, std::vector<Frame> &frames, const int seconds, const uint32_t base) {
+    for (int sec = 0; sec < seconds; ++sec) {
+        const uint32_t seq = base + sec;
+        if (sec < 3 || sec % 600 == 0)
+            appendNmea(out, frames, seq);
+        for (int index = 0; index < 4; ++index)
+            appendUbx(out, frames, index, seq);
+        if (sec % 60 == 0)
+            appendUbx(out, frames, 4, seq);
+    }
+}
+
+/**
+ * Feed a byte stream through the receive ring in randomly sized hand-offs
+ */
+static void feed(ubx::Parser &parser, RxRing<RING_SIZE> &ring, const std::vector<uint8_t> &data) {
+    size_t i = 0;
+    while (i < data.size()) {
+        const size_t chunk = 1 + rand() % 64;
+        for (size_t j = 0; j < chunk && i < data.size(); ++j)
+            ring.put(data[i++]);
+        ring.commit(true);
+        parser.parse(ring);
+    }
+}
+
+// legacy per-byte parser (copy into message buffer, checksum in a second pass, nested dispatch)
+struct Legacy {
+    uint8_t msgBuff[256];
+    int lenNEMA, lenUBX, endUBX;
+
+    void process(const uint8_t *msg, const int len) {
+        uint8_t chkA = 0, chkB = 0;
+        for (int i = 2; i < len - 2; i++) {
+            chkA += msg[i];
+            chkB += chkA;
+        }
+        if (chkA != msg[len - 2] || chkB != msg[len - 1])
+            return;
+        const uint8_t _class = msg[2];
+        const uint8_t _id = msg[3];
+        const uint16_t size = msg[4] | (msg[5] << 8);
+        if (_class == 0x01) {
+            if (_id == 0x07 && size == 92) { handler<0>(msg + 6); return; }
+            if (_id == 0x20 && size == 16) { handler<1>(msg + 6); return; }
+            if (_id == 0x22 && size == 20) { handler<2>(msg + 6); return; }
+        }
+        if (_class == 0x0D) {
+            if (_id == 0x01 && size == 16) { handler<3>(msg + 6); return; }
+        }
+    }
+
+    void parse(RxRing<RING_SIZE> &ring) {
+        const int count = ring.available();
+        for (int i = 0; i < count; i++) {
+            const uint8_t byte = ring.peek(i);
+            if (lenUBX) {
+                if (lenUBX < 256)
+                    msgBuff[lenUBX] = byte;
+                if (++lenUBX >= endUBX) {
+                    process(msgBuff, lenUBX);
+                    lenUBX = 0;
+                    endUBX = 0;
+                    continue;
+                }
+                if (lenUBX == 6) {
+                    endUBX = 8 + (msgBuff[4] | (msgBuff[5] << 8));
+                    if (endUBX > 256)
+                        lenUBX = 0;
+                    continue;
+                }
+                if (lenUBX == 2 && msgBuff[1] != 0x62)
+                    lenUBX = 0;
+                continue;
+            }
+            if (lenNEMA) {
+                if (lenNEMA < 256)
+                    msgBuff[lenNEMA++] = byte;
+                if (byte == '\r' || byte == '\n')
+                    lenNEMA = 0;
+            }
+            if (byte == '$') {
+                msgBuff[0] = byte;
+                lenNEMA = 1;
+                continue;
+            }
+            if (byte == 0xB5) {
+                lenNEMA = 0;
+                msgBuff[0] = byte;
+                lenUBX = 1;
+                endUBX = 8;
+            }
+        }
+        ring.consume(count);
+    }
+};
+
+template<typename P>
+static double benchmark(P &parser, const std::vector<uint8_t> &data) {
+    static RxRing<RING_SIZE> ring;
+    const auto start = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < BENCH_REPEAT; ++rep) {
+        size_t i = 0;
+        while (i < data.size()) {
+            // hand off in bursts of up to 192 bytes
+            for (int j = 0; j < 192 && i < data.size(); ++j)
+                ring.put(data[i++]);
+            ring.commit(true);
+            parser.parse(ring);
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(data.size() * BENCH_REPEAT);
+}
+
+/**
+ * Check whether a corrupted frame still passes the UBX checksum (the 16-bit Fletcher sum cannot detect all errors)
+ */
+static bool isCollision(const std::vector<uint8_t> &data, const Frame &frame) {
+    const auto &msg = EPOCH_MESSAGES[frame.index];
+    const uint8_t *ptr = data.data() + frame.start;
+    if (ptr[0] != ubx::SYNC_1 || ptr[1] != ubx::SYNC_2 || ptr[2] != msg.msgClass || ptr[3] != msg.msgId ||
+        (ptr[4] | (ptr[5] << 8)) != msg.length)
+        return false;
+    uint8_t chkA = 0, chkB = 0;
+    for (int i = 2; i < ubx::HEADER_SIZE + msg.length; ++i) {
+        chkA += ptr[i];
+        chkB += chkA;
+    }
+    return chkA == ptr[ubx::HEADER_SIZE + msg.length] && chkB == ptr[ubx::HEADER_SIZE + msg.length + 1];
+}
+
+static uint32_t totalReceived() {
+    return received[0] + received[1] + received[2] + received[3];
+}
+
+int main(int argc, char **argv) {
+    int failed = 0;
+
+    // clean recording (or a captured raw receiver stream)
+    std::vector<uint8_t> corpus;
+    std::vector<Frame> frames;
+    if (argc > 1) {
+        FILE *file = fopen(argv[1], "rb");
+        if (file == nullptr) {
+            fprintf(stdout, "failed to open %s\n", argv[1]);
+            return 1;
+        }
+        uint8_t buffer[4096];
+        size_t len;
+        while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            corpus.insert(corpus.end(), buffer, buffer + len);
+        fclose(file);
+    }
+    else
+        synthesize(corpus, frames, CORPUS_SECONDS, 0);
+
+    static RxRing<RING_SIZE> ring;
+    static ubx::Parser parser(registry, handlerNmea);
+    feed(parser, ring, corpus);
+    fprintf(stdout, "recording:  %zu bytes, %u frames, %u dispatched, %u nmea, %u unknown, %u errors, %u copied\n",
+            corpus.size(), parser.getFrames(), totalReceived(), nmeaReceived, parser.getUnknown(),
+            parser.getErrors(), parser.getCopied());
+    if (argc <= 1) {
+        uint32_t expected = 0, expectedNmea = 0;
+        for (const auto &frame : frames) {
+            if (frame.index < 0) ++expectedNmea;
+            else if (frame.index < 4) ++expected;
+        }
+        if (totalReceived() != expected || nmeaReceived != expectedNmea || parser.getErrors() != 0 ||
+            parser.getFrames() != frames.size()) {
+            fprintf(stdout, "FAIL: clean recording was not parsed completely\n");
+            failed = 1;
+        }
+    }
+    if (falseDispatch != 0 || falseNmea != 0) {
+        fprintf(stdout, "FAIL: %u corrupt payloads dispatched\n", falseDispatch + falseNmea);
+        failed = 1;
+    }
+
+    // benchmark against the legacy parser
+    static Legacy legacy;
+    static ubx::Parser bench(registry, handlerNmea);
+    const double nsLegacy = benchmark(legacy, corpus);
+    const double nsTable = benchmark(bench, corpus);
+    fprintf(stdout, "benchmark:  legacy %.2f ns/byte, table-driven %.2f ns/byte (%.2fx)\n",
+            nsLegacy, nsTable, nsLegacy / nsTable);
+
+    // fuzz: mutate short recordings and check that only genuine payloads are dispatched and intact frames survive
+    uint32_t lostIntact = 0, mutations = 0, collisions = 0;
+    const uint32_t falseBefore = falseDispatch;
+    for (int iter = 0; iter < FUZZ_ITERATIONS; ++iter) {
+        srand(iter + 1);
+        std::vector<uint8_t> data;
+        std::vector<Frame> fuzzFrames;
+        synthesize(data, fuzzFrames, FUZZ_SECONDS, iter * FUZZ_SECONDS);
+        std::vector<bool> touched(data.size() + 1, false);
+
+        const int count = 1 + rand() % 16;
+        for (int m = 0; m < count; ++m) {
+            const size_t at = rand() % data.size();
+            switch (rand() % 5) {
+                case 0: // bit flip
+                    data[at] ^= static_cast<uint8_t>(1u << (rand() % 8));
+                    touched[at] = true;
+                    break;
+                case 1: // substituted byte
+                    data[at] = static_cast<uint8_t>(rand());
+                    touched[at] = true;
+                    break;
+                case 2: // spurious sync with random header
+                    data[at] = ubx::SYNC_1;
+                    if (at + 1 < data.size()) data[at + 1] = ubx::SYNC_2;
+                    if (at + 2 < data.size()) data[at + 2] = 0x01;
+                    if (at + 3 < data.size()) data[at + 3] = static_cast<uint8_t>(rand());
+                    for (size_t i = at; i < at + 4 && i < data.size(); ++i)
+                        touched[i] = true;
+                    break;
+                case 3: // spurious NMEA start
+                    data[at] = '$';
+                    touched[at] = true;
+                    break;
+                default: // burst of line noise
+                    for (size_t i = at; i < at + 1 + rand() % 32 && i < data.size(); ++i) {
+                        data[i] = static_cast<uint8_t>(rand());
+                        touched[i] = true;
+                    }
+                    break;
+            }
+            ++mutations;
+        }
+
+        uint32_t intact = 0;
+        for (const auto &frame : fuzzFrames) {
+            if (frame.index < 0 || frame.index >= 4)
+                continue;
+            bool ok = true;
+            for (size_t i = frame.start; i < frame.end && ok; ++i)
+                ok = !touched[i];
+            if (ok) ++intact;
+            else if (isCollision(data, frame)) ++collisions;
+        }
+
+        // idle line flushes any frame started by a corrupt header
+        data.insert(data.end(), ubx::HEADER_SIZE + ubx::MAX_PAYLOAD + 2, 0);
+
+        const uint32_t before = totalReceived();
+        RxRing<RING_SIZE> fuzzRing = {};
+        ubx::Parser fuzzParser(registry, handlerNmea);
+        feed(fuzzParser, fuzzRing, data);
+        if (totalReceived() - before < intact)
+            lostIntact += intact - (totalReceived() - before);
+    }
+    fprintf(stdout, "fuzz:       %d recordings, %u mutations, %u intact frames lost\n",
+            FUZZ_ITERATIONS, mutations, lostIntact);
+    fprintf(stdout, "            %u corrupt UBX payloads dispatched (%u undetectable by checksum), %u corrupt NMEA\n",
+            falseDispatch - falseBefore, collisions, falseNmea);
+    // corrupt payloads may only be dispatched when the corruption preserved the checksum (NMEA only has 8 bits)
+    if (lostIntact != 0 || falseDispatch - falseBefore > collisions) {
+        fprintf(stdout, "FAIL: parser did not recover from corrupt input\n");
+        failed = 1;
+    }
+
+    return failed;
+}
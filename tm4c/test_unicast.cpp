@@ -0,0 +1,483 @@
+//
+// Created by robert on 10/19/26.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "test_ptp_stubs.hpp"
+
+#include "lib/net/ip.hpp"
+#include "lib/net/udp.hpp"
+#include "lib/net/util.hpp"
+#include "lib/ptp/common.hpp"
+#include "lib/ptp/ptp.hpp"
+#include "lib/ptp/unicast.hpp"
+
+using stubs::MY_MAC;
+using stubs::MY_IP;
+
+// simulated slaves (more than the slave table holds)
+static constexpr int SLAVES = 300;
+// slave table size (matches the default in lib/ptp/unicast.cpp)
+static constexpr int TABLE_SIZE = 128;
+// slaves with a short grant duration
+static constexpr int SHORT_GRANTS = 16;
+static constexpr uint32_t SHORT_DURATION = 10;
+static constexpr uint32_t LONG_DURATION = 300;
+// requested intervals (log2 s)
+static constexpr int8_t LOG_ANNOUNCE = 0;
+static constexpr int8_t LOG_SYNC = -3;
+static constexpr int8_t LOG_DELAY = 0;
+// simulated run time (s)
+static constexpr int RUN_SECONDS = 20;
+// unicast task rate (matches lib/ptp/unicast.cpp)
+static constexpr int TICK_RATE = 128;
+// background traffic burst (frames of one segment every 50 ms, heavy bursts leave no room for unicast)
+static constexpr int BACKGROUND_FRAMES = 64;
+static constexpr int BACKGROUND_HEAVY = 112;
+static constexpr int HEAVY_SECONDS = 5;
+static constexpr int BACKGROUND_TICKS = TICK_RATE / 20;
+// transmit ring (matches lib/net.cpp)
+static constexpr int TX_RING_SIZE = 128;
+static constexpr int SEGMENT_SIZE = 128;
+// 100 Mb/s link, preamble, FCS and inter-frame gap
+static constexpr double LINK_RATE = 100e6;
+static constexpr int FRAME_OVERHEAD = 24;
+
+// simulated transmit ring with wire-rate departure
+struct TxFrame {
+    std::vector<uint8_t> data;
+    network::CallbackTx callback;
+    void *ref;
+    double departure;
+    int segments;
+};
+static std::deque<TxFrame> txRing;
+static double simTime;
+static double lastDeparture;
+static double txStamp;
+static int ringUsed;
+static int maxRingUsed;
+static int overflowPtp;
+static int overflowOther;
+
+// per-slave sync departure tracking
+struct SlaveStats {
+    int syncs;
+    int followups;
+    double lastSync;
+    uint16_t lastSeq;
+};
+static SlaveStats stats[SLAVES];
+static double jitterMax;
+static double jitterSum2;
+static int jitterCount;
+static double queueMax;
+static double tickTime;
+// grant responses received by each slave
+static int grantsReceived[SLAVES];
+static int grantsRefused[SLAVES];
+static int acksReceived[SLAVES];
+// grant TLVs with a nonzero reserved field
+static int grantsReserved;
+
+static uint16_t get16(const uint8_t *data) {
+    return (data[0] << 8) | data[1];
+}
+
+static uint32_t get32(const uint8_t *data) {
+    return (get16(data) << 16) | get16(data + 2);
+}
+
+static uint32_t slaveIp(const int index) {
+    return 0x0000000Au | ((index >> 8) << 16) | ((index & 0xFF) << 24); // 10.0.x.y
+}
+
+static int slaveIndex(const uint32_t ip) {
+    if ((ip & 0xFFFF) != 0x000A)
+        return -1;
+    const int index = static_cast<int>(((ip >> 16) & 0xFF) << 8 | (ip >> 24));
+    return index < SLAVES ? index : -1;
+}
+
+// record a PTP frame leaving the wire
+static void observe(const TxFrame &frame) {
+    const auto data = frame.data.data();
+    if (frame.data.size() < 42 + sizeof(HEADER_PTP) || get16(data + 12) != 0x0800)
+        return;
+    uint32_t dst;
+    memcpy(&dst, data + 30, 4);
+    const int index = slaveIndex(dst);
+    if (index < 0)
+        return;
+    const auto msg = data + 42;
+    auto &slave = stats[index];
+    switch (msg[0] & 0xF) {
+        case PTP2_MT_SYNC: {
+            const double interval = std::ldexp(1.0, LOG_SYNC);
+            if (slave.syncs > 0 && get16(msg + 30) == static_cast<uint16_t>(slave.lastSeq + 1)) {
+                const double jitter = std::fabs(frame.departure - slave.lastSync - interval);
+                jitterMax = std::max(jitterMax, jitter);
+                jitterSum2 += jitter * jitter;
+                ++jitterCount;
+            }
+            slave.lastSync = frame.departure;
+            slave.lastSeq = get16(msg + 30);
+            ++slave.syncs;
+            break;
+        }
+        case PTP2_MT_FOLLOW_UP:
+            if (get16(msg + 30) == slave.lastSeq)
+                ++slave.followups;
+            break;
+        case PTP2_MT_SIGNALING:
+            for (int ptr = 44; ptr + 4 <= static_cast<int>(frame.data.size()) - 42; ptr += 4 + get16(msg + ptr + 2)) {
+                const auto type = get16(msg + ptr);
+                if (type == PTP2_TT_GRANT_UNICAST) {
+                    if (msg[ptr + 10] != 0)
+                        ++grantsReserved;
+                    if (get32(msg + ptr + 6) != 0)
+                        ++grantsReceived[index];
+                    else
+                        ++grantsRefused[index];
+                }
+                else if (type == PTP2_TT_ACK_CANCEL_UNICAST)
+                    ++acksReceived[index];
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// complete transmissions up to the given time (callbacks may queue further frames)
+static void advance(const double time) {
+    while (!txRing.empty() && txRing.front().departure <= time) {
+        const auto frame = txRing.front();
+        txRing.pop_front();
+        ringUsed -= frame.segments;
+        observe(frame);
+        if (frame.callback) {
+            simTime = frame.departure;
+            txStamp = frame.departure;
+            frame.callback(frame.ref, frame.data.data(), static_cast<int>(frame.data.size()));
+        }
+    }
+    simTime = time;
+}
+
+static bool transmit(const uint8_t *frame, const int size, const network::CallbackTx callback, void *ref) {
+    const int segments = (size + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+    const bool ptp = size >= 42 && get16(frame + 12) == 0x0800 && (get16(frame + 36) == 319 || get16(frame + 36) == 320);
+    if (TX_RING_SIZE - 1 - ringUsed < segments) {
+        ++(ptp ? overflowPtp : overflowOther);
+        return false;
+    }
+    const double start = std::max(simTime, lastDeparture);
+    const double departure = start + (std::max(size, 60) + FRAME_OVERHEAD) * 8 / LINK_RATE;
+    lastDeparture = departure;
+    ringUsed += segments;
+    maxRingUsed = std::max(maxRingUsed, ringUsed);
+    if (ptp)
+        queueMax = std::max(queueMax, departure - tickTime);
+    txRing.push_back({std::vector<uint8_t>(frame, frame + size), callback, ref, departure, segments});
+    return true;
+}
+
+static int getTxFree() {
+    return TX_RING_SIZE - 1 - ringUsed;
+}
+
+static uint64_t toFixed(const double time) {
+    return static_cast<uint64_t>(time * 4294967296.0);
+}
+
+static void getRxTime(uint64_t *stamps) {
+    stamps[0] = stamps[1] = stamps[2] = toFixed(simTime);
+}
+
+static void getTxTime(uint64_t *stamps) {
+    stamps[0] = stamps[1] = stamps[2] = toFixed(txStamp);
+}
+
+static uint64_t getTime() {
+    return toFixed(simTime);
+}
+
+// simulated scheduler (only the unicast and master selection tasks are run)
+static RunCall unicastTask;
+static RunCall bmcaTask;
+
+static void findTasks() {
+    for (const auto &task : stubs::tasks) {
+        if (task.interval == RUN_SEC / TICK_RATE)
+            unicastTask = task.callback;
+        // scheduled ahead of the 16 Hz multicast sync task
+        if (task.interval == RUN_SEC >> 4 && bmcaTask == nullptr)
+            bmcaTask = task.callback;
+    }
+}
+
+// build a signaling message from a slave
+struct Tlv {
+    uint16_t type;
+    PTP2_MTYPE messageType;
+    int8_t logInterval;
+    uint32_t duration;
+};
+
+static void sendSignaling(const int index, const Tlv *tlvs, const int count) {
+    uint8_t msg[44 + 4 * 10] = {};
+    int size = 44;
+    msg[0] = PTP2_MT_SIGNALING;
+    msg[1] = 2;
+    msg[4] = PTP2_DOMAIN;
+    msg[6] = PTP2_FLAG_UNICAST >> 8;
+    // source port identity
+    msg[20] = 0x00;
+    msg[21] = 0x1B;
+    msg[22] = 0x21;
+    msg[23] = 0xFF;
+    msg[24] = 0xFE;
+    msg[26] = index >> 8;
+    msg[27] = index;
+    msg[29] = 1;
+    msg[32] = PTP2_CTRL_OTHER;
+    msg[33] = 0x7F;
+    // target port identity (wildcard)
+    memset(msg + 34, 0xFF, 10);
+    for (int i = 0; i < count; ++i) {
+        const auto &tlv = tlvs[i];
+        auto ptr = msg + size;
+        ptr[0] = tlv.type >> 8;
+        ptr[1] = tlv.type;
+        ptr[4] = tlv.messageType << 4;
+        if (tlv.type == PTP2_TT_REQUEST_UNICAST) {
+            ptr[3] = 6;
+            ptr[5] = tlv.logInterval;
+            ptr[6] = tlv.duration >> 24;
+            ptr[7] = tlv.duration >> 16;
+            ptr[8] = tlv.duration >> 8;
+            ptr[9] = tlv.duration;
+            size += 10;
+        }
+        else {
+            ptr[3] = 2;
+            size += 6;
+        }
+    }
+    msg[2] = size >> 8;
+    msg[3] = size;
+
+    uint8_t frame[42 + sizeof(msg)] = {};
+    auto &packet = FrameUdp4::from(frame);
+    memcpy(packet.eth.macDst, MY_MAC, 6);
+    packet.eth.macSrc[0] = 0x02;
+    packet.eth.macSrc[4] = index >> 8;
+    packet.eth.macSrc[5] = index;
+    IPv4_init(frame);
+    packet.ip4.src = slaveIp(index);
+    packet.ip4.dst = MY_IP;
+    packet.ip4.proto = IP_PROTO_UDP;
+    packet.udp.portSrc = htons(PTP2_PORT_GENERAL);
+    packet.udp.portDst = htons(PTP2_PORT_GENERAL);
+    memcpy(frame + 42, msg, size);
+    UDP_finalize(frame, 42 + size);
+    IPv4_finalize(frame, 42 + size);
+    IPv4_process(frame, std::max(42 + size, 60));
+}
+
+static void requestService(const int index, const uint32_t duration) {
+    const Tlv tlvs[] = {
+        {PTP2_TT_REQUEST_UNICAST, PTP2_MT_ANNOUNCE, LOG_ANNOUNCE, duration},
+        {PTP2_TT_REQUEST_UNICAST, PTP2_MT_SYNC, LOG_SYNC, duration},
+        {PTP2_TT_REQUEST_UNICAST, PTP2_MT_DELAY_RESP, LOG_DELAY, duration},
+    };
+    sendSignaling(index, tlvs, 3);
+}
+
+// run the unicast task with background traffic
+static void run(const int ticks, int &tick, const int backgroundFrames) {
+    uint8_t background[SEGMENT_SIZE] = {};
+    background[12] = 0x08;
+    for (int i = 0; i < ticks; ++i, ++tick) {
+        tickTime = static_cast<double>(tick) / TICK_RATE;
+        advance(tickTime);
+        // background burst ahead of the unicast task (e.g. NTP responses)
+        if (tick % BACKGROUND_TICKS == 0) {
+            for (int j = 0; j < backgroundFrames; ++j)
+                network::transmit(background, sizeof(background));
+        }
+        unicastTask(nullptr);
+    }
+    advance(static_cast<double>(tick) / TICK_RATE);
+}
+
+int main() {
+    int failed = 0;
+    ipAddress = MY_IP;
+    stubs::model = {transmit, getTxFree, getRxTime, getTxTime, getTime, getTime};
+    ptp::init();
+    findTasks();
+    if (unicastTask == nullptr || bmcaTask == nullptr) {
+        fprintf(stdout, "FAIL: unicast task not scheduled\n");
+        return 1;
+    }
+    // claim the domain once the announce receipt timeout expires
+    advance(4.0);
+    bmcaTask(nullptr);
+
+    // every slave requests announce, sync and delay response service
+    int tick = 0;
+    for (int i = 0; i < SLAVES; ++i) {
+        requestService(i, i < SHORT_GRANTS ? SHORT_DURATION : LONG_DURATION);
+        advance(simTime + 1e-3);
+    }
+    int granted = 0, refused = 0;
+    for (int i = 0; i < SLAVES; ++i) {
+        if (grantsReceived[i] == 3)
+            ++granted;
+        if (grantsRefused[i] == 3)
+            ++refused;
+    }
+    fprintf(stdout, "grants: %d slaves granted, %d slaves refused\n", granted, refused);
+    if (granted != TABLE_SIZE || refused != SLAVES - TABLE_SIZE || ptp::unicast::getActive() != TABLE_SIZE) {
+        fprintf(stdout, "FAIL: slave table not filled exactly\n");
+        failed = 1;
+    }
+    if (ptp::unicast::getRefused() != 3u * (SLAVES - TABLE_SIZE)) {
+        fprintf(stdout, "FAIL: refused grants not reported\n");
+        failed = 1;
+    }
+
+    // invalid requests are refused without disturbing the existing grants
+    const Tlv fast = {PTP2_TT_REQUEST_UNICAST, PTP2_MT_SYNC, -8, LONG_DURATION};
+    const Tlv pdelay = {PTP2_TT_REQUEST_UNICAST, PTP2_MT_PDELAY_RESP, 0, LONG_DURATION};
+    sendSignaling(TABLE_SIZE - 1, &fast, 1);
+    sendSignaling(TABLE_SIZE - 1, &pdelay, 1);
+    // rate admission refuses renewals beyond the aggregate budget (128 Hz sync)
+    const Tlv burst = {PTP2_TT_REQUEST_UNICAST, PTP2_MT_SYNC, -7, LONG_DURATION};
+    int renewed = 0;
+    for (int i = SHORT_GRANTS; i < SHORT_GRANTS + 16; ++i) {
+        const int before = grantsReceived[i];
+        sendSignaling(i, &burst, 1);
+        advance(simTime + 1e-3);
+        renewed += grantsReceived[i] - before;
+    }
+    fprintf(stdout, "128 Hz sync renewals: %d of 16 granted\n", renewed);
+    if (renewed == 0 || renewed == 16) {
+        fprintf(stdout, "FAIL: rate admission not applied\n");
+        failed = 1;
+    }
+    // restore the requested rate
+    const Tlv normal = {PTP2_TT_REQUEST_UNICAST, PTP2_MT_SYNC, LOG_SYNC, LONG_DURATION};
+    for (int i = SHORT_GRANTS; i < SHORT_GRANTS + 16; ++i)
+        sendSignaling(i, &normal, 1);
+    advance(simTime + 1e-3);
+
+    // run the transmission schedule
+    tick = static_cast<int>(std::ceil(simTime * TICK_RATE));
+    memset(stats, 0, sizeof(stats));
+    jitterMax = jitterSum2 = 0;
+    jitterCount = 0;
+    queueMax = 0;
+    run(RUN_SECONDS * TICK_RATE, tick, BACKGROUND_FRAMES);
+
+    // short grants expire, long grants keep the exact rate
+    int rateErrors = 0;
+    int followupErrors = 0;
+    for (int i = 0; i < TABLE_SIZE; ++i) {
+        const int seconds = (i < SHORT_GRANTS) ? static_cast<int>(SHORT_DURATION) : RUN_SECONDS;
+        const int expect = seconds << -LOG_SYNC;
+        if (std::abs(stats[i].syncs - expect) > 1)
+            ++rateErrors;
+        if (stats[i].followups != stats[i].syncs)
+            ++followupErrors;
+    }
+    for (int i = TABLE_SIZE; i < SLAVES; ++i) {
+        if (stats[i].syncs != 0)
+            ++rateErrors;
+    }
+    const double jitterRms = jitterCount ? std::sqrt(jitterSum2 / jitterCount) : 0;
+    fprintf(stdout, "ring occupancy: %d / %d segments (overflow: %d ptp, %d other)\n",
+        maxRingUsed, TX_RING_SIZE, overflowPtp, overflowOther);
+    fprintf(stdout, "sync jitter: %.1f us rms, %.1f us max (queue delay %.1f us max)\n",
+        jitterRms * 1e6, jitterMax * 1e6, queueMax * 1e6);
+    if (overflowPtp != 0) {
+        fprintf(stdout, "FAIL: PTP transmissions overran the transmit ring\n");
+        failed = 1;
+    }
+    if (rateErrors || followupErrors) {
+        fprintf(stdout, "FAIL: %d slaves with the wrong sync count, %d with missing follow-ups\n", rateErrors, followupErrors);
+        failed = 1;
+    }
+    if (jitterMax > 1e-3) {
+        fprintf(stdout, "FAIL: sync jitter exceeds 1 ms\n");
+        failed = 1;
+    }
+    if (ptp::unicast::getActive() != TABLE_SIZE - SHORT_GRANTS) {
+        fprintf(stdout, "FAIL: short grants did not expire\n");
+        failed = 1;
+    }
+
+    // heavy background traffic defers bursts to the next tick without losing messages
+    memset(stats, 0, sizeof(stats));
+    jitterMax = jitterSum2 = 0;
+    jitterCount = 0;
+    run(HEAVY_SECONDS * TICK_RATE, tick, BACKGROUND_HEAVY);
+    rateErrors = 0;
+    for (int i = SHORT_GRANTS; i < TABLE_SIZE; ++i) {
+        if (std::abs(stats[i].syncs - (HEAVY_SECONDS << -LOG_SYNC)) > 1 || stats[i].followups != stats[i].syncs)
+            ++rateErrors;
+    }
+    fprintf(stdout, "heavy background: %.1f us max jitter (overflow: %d ptp, %d other)\n",
+        jitterMax * 1e6, overflowPtp, overflowOther);
+    if (overflowPtp != 0 || rateErrors != 0) {
+        fprintf(stdout, "FAIL: deferred bursts lost messages\n");
+        failed = 1;
+    }
+    if (jitterMax > 1.0 / TICK_RATE + 2e-3) {
+        fprintf(stdout, "FAIL: deferred sync jitter exceeds one task interval\n");
+        failed = 1;
+    }
+
+    // expired entries are reused by refused slaves
+    const int before = grantsReceived[TABLE_SIZE];
+    requestService(TABLE_SIZE, LONG_DURATION);
+    advance(simTime + 1e-3);
+    if (grantsReceived[TABLE_SIZE] != before + 3) {
+        fprintf(stdout, "FAIL: expired table entry not reused\n");
+        failed = 1;
+    }
+
+    // cancelled sync stops immediately
+    const Tlv cancel = {PTP2_TT_CANCEL_UNICAST, PTP2_MT_SYNC, 0, 0};
+    const int victim = TABLE_SIZE - 1;
+    sendSignaling(victim, &cancel, 1);
+    advance(simTime + 1e-3);
+    const int syncs = stats[victim].syncs;
+    run(TICK_RATE, tick, BACKGROUND_FRAMES);
+    if (acksReceived[victim] != 1 || stats[victim].syncs != syncs) {
+        fprintf(stdout, "FAIL: sync cancellation not acknowledged\n");
+        failed = 1;
+    }
+
+    // IEEE 1588 reserved fields are transmitted as zero
+    if (grantsReserved != 0) {
+        fprintf(stdout, "FAIL: %d grants with a nonzero reserved field\n", grantsReserved);
+        failed = 1;
+    }
+
+    char status[1024];
+    status[ptp::unicast::status(status)] = 0;
+    fputs(status, stdout);
+
+    fprintf(stdout, failed ? "FAILED\n" : "PASSED\n");
+    return failed;
+}